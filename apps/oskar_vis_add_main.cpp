@@ -26,13 +26,19 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "binary/oskar_binary.h"
 #include "settings/oskar_option_parser.h"
-#include "vis/oskar_vis.h"
 #include "utility/oskar_get_error_string.h"
+#include "utility/oskar_thread.h"
 #include "utility/oskar_version_string.h"
+#include "vis/oskar_vis.h"
+#include "vis/oskar_vis_block.h"
+#include "vis/oskar_vis_header.h"
 
 #include <string>
+#include <vector>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <cfloat>
 #include <iomanip>
@@ -40,8 +46,28 @@
 using namespace std;
 using namespace oskar;
 
+// Reads visibility blocks from one input file, aligned to the time
+// samples of the blocks in the first input file.
+struct VisReader
+{
+    oskar_Binary* h;
+    oskar_VisHeader* hdr;
+    oskar_VisBlock* native;   // Cache of a block in the file's own layout.
+    int native_index;         // Index of the cached block, or -1.
+    oskar_VisBlock* dst;      // Block to fill (in the output layout).
+    int block_index;          // Index of the output block to read.
+    int max_times_out;        // Time samples per output block.
+    int status;
+};
+
 // -----------------------------------------------------------------------------
 static bool is_compatible(const oskar_Vis* vis1, const oskar_Vis* vis2);
+static bool is_compatible(const oskar_VisHeader* h1, const oskar_VisHeader* h2);
+static void* read_block(void* arg);
+static void scale_add(oskar_Mem* out, double scale_out, const oskar_Mem* in,
+        double scale_in, int* status);
+static int add_in_memory(int num_in_files, const char* const* in_files,
+        const vector<double>& scale, const string& out_path, bool verbose);
 static void print_error(int status, const char* message);
 // -----------------------------------------------------------------------------
 
@@ -52,9 +78,12 @@ int main(int argc, char** argv)
     opt.set_description("Application to combine OSKAR binary visibility files.");
     opt.add_required("OSKAR visibility files...");
     opt.add_flag("-o", "Output visibility file name", 1, "out.vis", false, "--output");
+    opt.add_flag("-s", "Comma-separated list of scale factors, "
+            "one for each input file", 1, "", false, "--scale");
     opt.add_flag("-q", "Disable log messages", false, "--quiet");
     opt.add_example("oskar_vis_add file1.vis file2.vis");
     opt.add_example("oskar_vis_add file1.vis file2.vis -o combined.vis");
+    opt.add_example("oskar_vis_add file1.vis file2.vis -s 1,-1 -o diff.vis");
     opt.add_example("oskar_vis_add -q file1.vis file2.vis file3.vis");
     opt.add_example("oskar_vis_add *.vis");
     if (!opt.check_options(argc, argv)) return EXIT_FAILURE;
@@ -69,6 +98,30 @@ int main(int argc, char** argv)
         opt.error("Please provide 2 or more visibility files to combine.");
         return EXIT_FAILURE;
     }
+    vector<double> scale(num_in_files, 1.0);
+    if (opt.is_set("-s"))
+    {
+        const char* p = opt.get_string("-s");
+        int num_scale = 0;
+        for (char* end = 0; *p; p = end)
+        {
+            const double val = strtod(p, &end);
+            if (end == p || (*end && *end != ','))
+            {
+                opt.error("Invalid scale factor list '%s'.",
+                        opt.get_string("-s"));
+                return EXIT_FAILURE;
+            }
+            if (num_scale < num_in_files) scale[num_scale] = val;
+            num_scale++;
+            if (*end == ',') end++;
+        }
+        if (num_scale != num_in_files)
+        {
+            opt.error("Please provide one scale factor for each input file.");
+            return EXIT_FAILURE;
+        }
+    }
 
     // Print if verbose.
     if (verbose)
@@ -77,11 +130,277 @@ int main(int argc, char** argv)
         cout << "Combining the " << num_in_files << " input files:" << endl;
         for (int i = 0; i < num_in_files; ++i)
         {
-            cout << "  [" << setw(2) << i << "] " << in_files[i] << endl;
+            cout << "  [" << setw(2) << i << "] " << in_files[i];
+            if (scale[i] != 1.0) cout << " (x " << scale[i] << ")";
+            cout << endl;
         }
     }
 
-    // Add the data. ==========================================================
+    // Open the inputs and read their headers. ================================
+    int status = 0;
+    vector<VisReader> readers(num_in_files);
+    for (int i = 0; i < num_in_files; ++i)
+    {
+        VisReader& r = readers[i];
+        r.h = 0; r.hdr = 0; r.native = 0; r.native_index = -1;
+        r.dst = 0; r.block_index = 0; r.max_times_out = 0; r.status = 0;
+        if (status) continue;
+        r.h = oskar_binary_create(in_files[i], 'r', &status);
+        r.hdr = oskar_vis_header_read(r.h, &status);
+
+        // Old format files have no block structure to stream, and blocks
+        // that hold only some of the channels cannot be combined by time.
+        const bool old_format = (status == OSKAR_ERR_BINARY_TAG_NOT_FOUND);
+        if (old_format || (!status &&
+                oskar_vis_header_max_channels_per_block(r.hdr) !=
+                oskar_vis_header_num_channels_total(r.hdr)))
+        {
+            status = 0;
+            for (int j = 0; j <= i; ++j)
+            {
+                oskar_vis_header_free(readers[j].hdr, &status);
+                oskar_binary_free(readers[j].h);
+            }
+            if (verbose)
+                cout << (old_format ? "Old-format" : "Channel-split") <<
+                        " input found: combining in memory." << endl;
+            return add_in_memory(num_in_files, in_files, scale,
+                    out_path, verbose);
+        }
+        if (status)
+        {
+            string msg = string("Failed to read visibility data file ") +
+                    in_files[i];
+            print_error(status, msg.c_str());
+        }
+        else if (i > 0 && !is_compatible(readers[0].hdr, r.hdr))
+        {
+            cerr << "ERROR: Input visibility data must match!" << endl;
+            status = OSKAR_ERR_TYPE_MISMATCH;
+        }
+    }
+
+    // Stream the data block by block. =========================================
+    // Each input has two blocks in the output layout, so that the next block
+    // can be read from every input while the current one is summed and
+    // written. Blocks of the first input accumulate the result.
+    oskar_Binary* h_out = 0;
+    vector<oskar_VisBlock*> blocks(2 * num_in_files, (oskar_VisBlock*)0);
+    vector<oskar_Thread*> threads(num_in_files, (oskar_Thread*)0);
+    int num_blocks = 0;
+    if (!status)
+    {
+        const oskar_VisHeader* hdr = readers[0].hdr;
+        const int max_times = oskar_vis_header_max_times_per_block(hdr);
+        num_blocks = (oskar_vis_header_num_times_total(hdr) +
+                max_times - 1) / max_times;
+        for (int i = 0; i < num_in_files; ++i)
+        {
+            VisReader& r = readers[i];
+            r.max_times_out = max_times;
+            if (oskar_vis_header_max_times_per_block(r.hdr) != max_times)
+                r.native = oskar_vis_block_create_from_header(OSKAR_CPU,
+                        r.hdr, &status);
+            blocks[2 * i] = oskar_vis_block_create_from_header(OSKAR_CPU,
+                    hdr, &status);
+            blocks[2 * i + 1] = oskar_vis_block_create_from_header(OSKAR_CPU,
+                    hdr, &status);
+        }
+        oskar_mem_clear_contents(oskar_vis_header_settings(readers[0].hdr),
+                &status);
+        h_out = oskar_vis_header_write(readers[0].hdr, out_path.c_str(),
+                &status);
+        if (verbose && !status)
+            cout << "Writing OSKAR visibility file: " << out_path << endl;
+    }
+    for (int b = 0; b < num_blocks; ++b)
+    {
+        // Start reading the first block.
+        if (b == 0)
+        {
+            for (int i = 0; i < num_in_files; ++i)
+            {
+                readers[i].dst = blocks[2 * i];
+                readers[i].block_index = 0;
+                threads[i] = oskar_thread_create(read_block, &readers[i], 0);
+            }
+        }
+
+        // Wait for the current block to be read.
+        for (int i = 0; i < num_in_files; ++i)
+        {
+            oskar_thread_join(threads[i]);
+            oskar_thread_free(threads[i]);
+            threads[i] = 0;
+            if (readers[i].status && !status)
+            {
+                status = readers[i].status;
+                string msg = string("Failed to read visibility data file ") +
+                        in_files[i];
+                print_error(status, msg.c_str());
+            }
+        }
+        if (status) break;
+
+        // Start reading the next block.
+        if (b + 1 < num_blocks)
+        {
+            for (int i = 0; i < num_in_files; ++i)
+            {
+                readers[i].dst = blocks[2 * i + ((b + 1) & 1)];
+                readers[i].block_index = b + 1;
+                threads[i] = oskar_thread_create(read_block, &readers[i], 0);
+            }
+        }
+
+        // Sum the current block and write it.
+        oskar_VisBlock* out = blocks[b & 1];
+        for (int i = 1; i < num_in_files; ++i)
+        {
+            const oskar_VisBlock* in = blocks[2 * i + (b & 1)];
+            const double scale_out = (i == 1) ? scale[0] : 1.0;
+            if (oskar_vis_block_has_cross_correlations(out))
+                scale_add(oskar_vis_block_cross_correlations(out), scale_out,
+                        oskar_vis_block_cross_correlations_const(in),
+                        scale[i], &status);
+            if (oskar_vis_block_has_auto_correlations(out))
+                scale_add(oskar_vis_block_auto_correlations(out), scale_out,
+                        oskar_vis_block_auto_correlations_const(in),
+                        scale[i], &status);
+        }
+        oskar_vis_block_write(out, h_out, b, &status);
+        if (status)
+        {
+            print_error(status, "Failed writing output visibility block.");
+            break;
+        }
+    }
+
+    // Clean up. ===============================================================
+    for (int i = 0; i < num_in_files; ++i)
+    {
+        if (threads[i])
+        {
+            oskar_thread_join(threads[i]);
+            oskar_thread_free(threads[i]);
+        }
+        oskar_vis_block_free(blocks[2 * i], &status);
+        oskar_vis_block_free(blocks[2 * i + 1], &status);
+        oskar_vis_block_free(readers[i].native, &status);
+        oskar_vis_header_free(readers[i].hdr, &status);
+        oskar_binary_free(readers[i].h);
+    }
+    oskar_binary_free(h_out);
+    return status;
+}
+
+static void* read_block(void* arg)
+{
+    VisReader* r = (VisReader*) arg;
+    const oskar_VisHeader* hdr = r->hdr;
+    const int max_times_in = oskar_vis_header_max_times_per_block(hdr);
+    const int num_times_total = oskar_vis_header_num_times_total(hdr);
+    const int start_time = r->block_index * r->max_times_out;
+    int num_times = num_times_total - start_time;
+    if (num_times > r->max_times_out) num_times = r->max_times_out;
+    if (r->status) return 0;
+
+    // Read directly if the block layouts match.
+    if (!r->native)
+    {
+        oskar_vis_block_read(r->dst, hdr, r->h, r->block_index, &r->status);
+        return 0;
+    }
+
+    // Otherwise, copy time samples from the block(s) that contain them.
+    oskar_VisBlock* dst = r->dst;
+    oskar_vis_block_set_num_times(dst, num_times, &r->status);
+    oskar_vis_block_set_start_time_index(dst, start_time);
+    const int num_channels = oskar_vis_block_num_channels(dst);
+    const size_t num_baselines = oskar_vis_block_num_baselines(dst);
+    const size_t num_stations = oskar_vis_block_num_stations(dst);
+    for (int t = start_time; t < start_time + num_times; ++t)
+    {
+        const int native_index = t / max_times_in;
+        if (native_index != r->native_index)
+        {
+            oskar_vis_block_read(r->native, hdr, r->h, native_index,
+                    &r->status);
+            r->native_index = native_index;
+        }
+        if (r->status) break;
+        const size_t t_in = t - native_index * max_times_in;
+        const size_t t_out = t - start_time;
+        if (oskar_vis_block_has_cross_correlations(dst))
+        {
+            const size_t n = num_baselines * num_channels;
+            oskar_mem_copy_contents(oskar_vis_block_cross_correlations(dst),
+                    oskar_vis_block_cross_correlations_const(r->native),
+                    t_out * n, t_in * n, n, &r->status);
+            oskar_mem_copy_contents(oskar_vis_block_baseline_uu_metres(dst),
+                    oskar_vis_block_baseline_uu_metres_const(r->native),
+                    t_out * num_baselines, t_in * num_baselines,
+                    num_baselines, &r->status);
+            oskar_mem_copy_contents(oskar_vis_block_baseline_vv_metres(dst),
+                    oskar_vis_block_baseline_vv_metres_const(r->native),
+                    t_out * num_baselines, t_in * num_baselines,
+                    num_baselines, &r->status);
+            oskar_mem_copy_contents(oskar_vis_block_baseline_ww_metres(dst),
+                    oskar_vis_block_baseline_ww_metres_const(r->native),
+                    t_out * num_baselines, t_in * num_baselines,
+                    num_baselines, &r->status);
+        }
+        if (oskar_vis_block_has_auto_correlations(dst))
+        {
+            const size_t n = num_stations * num_channels;
+            oskar_mem_copy_contents(oskar_vis_block_auto_correlations(dst),
+                    oskar_vis_block_auto_correlations_const(r->native),
+                    t_out * n, t_in * n, n, &r->status);
+        }
+    }
+    return 0;
+}
+
+template<typename FP>
+static void scale_add(size_t n, FP scale_out, FP* out, FP scale_in,
+        const FP* in)
+{
+    if (scale_out == (FP)1 && scale_in == (FP)1)
+    {
+#pragma omp parallel for
+        for (long int i = 0; i < (long int)n; ++i) out[i] += in[i];
+    }
+    else
+    {
+#pragma omp parallel for
+        for (long int i = 0; i < (long int)n; ++i)
+            out[i] = scale_out * out[i] + scale_in * in[i];
+    }
+}
+
+static void scale_add(oskar_Mem* out, double scale_out, const oskar_Mem* in,
+        double scale_in, int* status)
+{
+    if (*status) return;
+    size_t n = oskar_mem_length(out);
+    if (oskar_mem_length(in) != n || oskar_mem_type(in) != oskar_mem_type(out))
+    {
+        *status = OSKAR_ERR_DIMENSION_MISMATCH;
+        return;
+    }
+    if (oskar_mem_is_complex(out)) n *= 2;
+    if (oskar_mem_is_matrix(out)) n *= 4;
+    if (oskar_mem_precision(out) == OSKAR_DOUBLE)
+        scale_add<double>(n, scale_out, oskar_mem_double(out, status),
+                scale_in, oskar_mem_double_const(in, status));
+    else
+        scale_add<float>(n, (float) scale_out, oskar_mem_float(out, status),
+                (float) scale_in, oskar_mem_float_const(in, status));
+}
+
+static int add_in_memory(int num_in_files, const char* const* in_files,
+        const vector<double>& scale, const string& out_path, bool verbose)
+{
     int status = 0;
 
     // Load the first visibility structure.
@@ -116,9 +435,8 @@ int main(int argc, char** argv)
             cerr << "ERROR: Input visibility data must match!" << endl;
             status = OSKAR_ERR_TYPE_MISMATCH;
         }
-        oskar_mem_add(oskar_vis_amplitude(out), oskar_vis_amplitude_const(out),
-                oskar_vis_amplitude_const(in), 0, 0, 0,
-                oskar_mem_length(oskar_vis_amplitude(out)), &status);
+        scale_add(oskar_vis_amplitude(out), (i == 1) ? scale[0] : 1.0,
+                oskar_vis_amplitude_const(in), scale[i], &status);
         if (status)
             print_error(status, "Visibility amplitude addition failed.");
         oskar_vis_free(in, &status);
@@ -141,6 +459,49 @@ static void print_error(int status, const char* message)
     cerr << "REASON: " << oskar_get_error_string(status) << endl;
 }
 
+static bool is_compatible(const oskar_VisHeader* h1, const oskar_VisHeader* h2)
+{
+    if (oskar_vis_header_num_channels_total(h1) !=
+            oskar_vis_header_num_channels_total(h2))
+        return false;
+    if (oskar_vis_header_num_times_total(h1) !=
+            oskar_vis_header_num_times_total(h2))
+        return false;
+    if (oskar_vis_header_num_stations(h1) != oskar_vis_header_num_stations(h2))
+        return false;
+    if (oskar_vis_header_write_auto_correlations(h1) !=
+            oskar_vis_header_write_auto_correlations(h2))
+        return false;
+    if (oskar_vis_header_write_cross_correlations(h1) !=
+            oskar_vis_header_write_cross_correlations(h2))
+        return false;
+    if (fabs(oskar_vis_header_freq_start_hz(h1) -
+            oskar_vis_header_freq_start_hz(h2)) > DBL_EPSILON)
+        return false;
+    if (fabs(oskar_vis_header_freq_inc_hz(h1) -
+            oskar_vis_header_freq_inc_hz(h2)) > DBL_EPSILON)
+        return false;
+    if (fabs(oskar_vis_header_channel_bandwidth_hz(h1) -
+            oskar_vis_header_channel_bandwidth_hz(h2)) > DBL_EPSILON)
+        return false;
+    if (fabs(oskar_vis_header_time_start_mjd_utc(h1) -
+            oskar_vis_header_time_start_mjd_utc(h2)) > DBL_EPSILON)
+        return false;
+    if (fabs(oskar_vis_header_time_inc_sec(h1) -
+            oskar_vis_header_time_inc_sec(h2)) > DBL_EPSILON)
+        return false;
+    if (fabs(oskar_vis_header_phase_centre_ra_deg(h1) -
+            oskar_vis_header_phase_centre_ra_deg(h2)) > DBL_EPSILON)
+        return false;
+    if (fabs(oskar_vis_header_phase_centre_dec_deg(h1) -
+            oskar_vis_header_phase_centre_dec_deg(h2)) > DBL_EPSILON)
+        return false;
+    if (oskar_vis_header_amp_type(h1) != oskar_vis_header_amp_type(h2))
+        return false;
+
+    return true;
+}
+
 
 static bool is_compatible(const oskar_Vis* v1, const oskar_Vis* v2)
 {
@@ -0,0 +1,36 @@
+# - Find FFTW3
+#==============================================================================
+# Find the FFTW3 includes and libraries (double and single precision).
+#
+#  FFTW3_INCLUDE_DIR     - where to find fftw3.h.
+#  FFTW3_LIBRARIES       - List of libraries when using FFTW3.
+#  FFTW3_THREADS_FOUND   - True if the OpenMP versions of FFTW3 were found.
+#  FFTW3_FOUND           - True if FFTW3 found.
+#==============================================================================
+
+find_path(FFTW3_INCLUDE_DIR fftw3.h
+    HINTS ${FFTW3_ROOT}/include ENV FFTW3_ROOT)
+find_library(FFTW3_LIBRARY NAMES fftw3 libfftw3-3
+    HINTS ${FFTW3_ROOT}/lib ENV FFTW3_ROOT)
+find_library(FFTW3F_LIBRARY NAMES fftw3f libfftw3f-3
+    HINTS ${FFTW3_ROOT}/lib ENV FFTW3_ROOT)
+find_library(FFTW3_OMP_LIBRARY NAMES fftw3_omp
+    HINTS ${FFTW3_ROOT}/lib ENV FFTW3_ROOT)
+find_library(FFTW3F_OMP_LIBRARY NAMES fftw3f_omp
+    HINTS ${FFTW3_ROOT}/lib ENV FFTW3_ROOT)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(FFTW3 DEFAULT_MSG
+    FFTW3_LIBRARY FFTW3F_LIBRARY FFTW3_INCLUDE_DIR)
+
+if (FFTW3_FOUND)
+    set(FFTW3_LIBRARIES ${FFTW3_LIBRARY} ${FFTW3F_LIBRARY})
+    if (FFTW3_OMP_LIBRARY AND FFTW3F_OMP_LIBRARY)
+        set(FFTW3_THREADS_FOUND TRUE)
+        list(INSERT FFTW3_LIBRARIES 0
+            ${FFTW3_OMP_LIBRARY} ${FFTW3F_OMP_LIBRARY})
+    endif()
+endif()
+
+mark_as_advanced(FFTW3_INCLUDE_DIR FFTW3_LIBRARY FFTW3F_LIBRARY
+    FFTW3_OMP_LIBRARY FFTW3F_OMP_LIBRARY)
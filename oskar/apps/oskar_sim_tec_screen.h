@@ -45,14 +45,39 @@ extern "C" {
  * Function to simulate a TEC screen
  *
  * @details
+ * Returns the TEC screen for all time steps as a single cube.
+ * This is only suitable for small screens: use oskar_sim_tec_screen_write()
+ * if the cube may not fit in memory.
  *
  * @param settings   Pointer to settings.
+ * @param telescope  Telescope model.
+ * @param pp_lon0    Longitude of the screen centre, in radians.
+ * @param pp_lat0    Latitude of the screen centre, in radians.
+ * @param status     Status return code.
  */
 OSKAR_APPS_EXPORT
 oskar_Mem* oskar_sim_tec_screen(const oskar_Settings_old* settings,
         const oskar_Telescope* telescope, double* pp_lon0, double* pp_lat0,
         int* status);
 
+/**
+ * @brief
+ * Function to simulate a TEC screen and write it to a FITS file.
+ *
+ * @details
+ * Time planes are evaluated in blocks, and each block is written to the
+ * FITS cube by a separate thread while the next one is evaluated, so the
+ * memory used does not depend on the number of time steps.
+ *
+ * @param settings   Pointer to settings.
+ * @param telescope  Telescope model.
+ * @param filename   Name of the FITS file to write.
+ * @param status     Status return code.
+ */
+OSKAR_APPS_EXPORT
+void oskar_sim_tec_screen_write(const oskar_Settings_old* settings,
+        const oskar_Telescope* telescope, const char* filename, int* status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -62,6 +62,11 @@ oskar_Interferometer* oskar_settings_to_interferometer(oskar::SettingsTree* s,
                 oskar_interferometer_set_gpus(h, size, ids, status);
         }
     }
+    if (s->starts_with("num_cpu_threads_per_device", "auto", status))
+        oskar_interferometer_set_num_cpu_threads_per_device(h, -1);
+    else
+        oskar_interferometer_set_num_cpu_threads_per_device(h,
+                s->to_int("num_cpu_threads_per_device", status));
     if (s->starts_with("num_devices", "auto", status))
         oskar_interferometer_set_num_devices(h, -1);
     else
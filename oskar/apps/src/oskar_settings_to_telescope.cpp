@@ -71,8 +71,9 @@ oskar_Telescope* oskar_settings_to_telescope(SettingsTree* s,
 
     /************************************************************************/
     /* Load telescope model folders to define the stations. */
-    oskar_telescope_load(t,
-            s->to_string("telescope/input_directory", status), log, status);
+    oskar_telescope_load_cached(t,
+            s->to_string("telescope/input_directory", status),
+            s->to_string("telescope/snapshot_file", status), log, status);
     if (*status) return t;
 
     /* Return if no stations were found. */
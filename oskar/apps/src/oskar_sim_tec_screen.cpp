@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2016, The University of Oxford
+ * Copyright (c) 2013-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -36,30 +36,160 @@
 #include "sky/oskar_evaluate_tec_tid.h"
 #include "telescope/station/oskar_evaluate_pierce_points.h"
 #include "telescope/oskar_telescope.h"
+#include "utility/oskar_thread.h"
 #include "oskar_settings_to_telescope.h"
 #include "oskar_Settings_old.h"
 
 #include "math/oskar_cmath.h"
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+
+#include <fitsio.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Maximum number of pixels evaluated before a block is written.
+#define MAX_BLOCK_PIXELS (1 << 22)
+
+struct TECScreen
+{
+    int type, im_size, num_pixels, num_times;
+    double t0, tinc, pp_lon0, pp_lat0;
+    oskar_Mem *pp_lon, *pp_lat, *pp_rel_path;
+    oskar_SettingsTIDscreen* TID;
+    double TEC0;
+};
+
+struct WriteArgs
+{
+    fitsfile* f;
+    const oskar_Mem* data;
+    long long first, num;
+    int status;
+};
 
 static void evaluate_station_beam_pp(const oskar_Telescope* tel, int stationID,
         const oskar_Settings_old* settings,
         double* pp_lon0, double* pp_lat0, int* status);
+static void screen_create(TECScreen* s, const oskar_Settings_old* settings,
+        const oskar_Telescope* telescope, int* status);
+static void screen_evaluate(TECScreen* s, int time_start, int num_times,
+        oskar_Mem* planes, int* status);
+static void screen_free(TECScreen* s, int* status);
+static void* write_planes(void* arg);
+static fitsfile* create_fits_file(const char* filename, int precision,
+        int width, int height, int num_times, double centre_deg[2],
+        double fov_deg[2], double start_time_mjd, double delta_time_sec,
+        int* status);
+static void write_axis_header(fitsfile* fptr, int axis_id,
+        const char* ctype, const char* ctype_comment, double crval,
+        double cdelt, double crpix, double crota, int* status);
 
 extern "C"
 oskar_Mem* oskar_sim_tec_screen(const oskar_Settings_old* settings,
         const oskar_Telescope* telescope, double* pp_lon0, double* pp_lat0,
         int* status)
 {
+    TECScreen s;
     oskar_Mem* TEC_screen = 0;
-    const oskar_SettingsIonosphere* MIM = &settings->ionosphere;
-
     if (*status) return 0;
+    screen_create(&s, settings, telescope, status);
+    *pp_lon0 = s.pp_lon0;
+    *pp_lat0 = s.pp_lat0;
+    TEC_screen = oskar_mem_create(s.type, OSKAR_CPU,
+            (size_t) s.num_pixels * s.num_times, status);
+    screen_evaluate(&s, 0, s.num_times, TEC_screen, status);
+    screen_free(&s, status);
+    return TEC_screen;
+}
+
+
+extern "C"
+void oskar_sim_tec_screen_write(const oskar_Settings_old* settings,
+        const oskar_Telescope* telescope, const char* filename, int* status)
+{
+    TECScreen s;
+    WriteArgs args[2];
+    oskar_Mem* planes[2] = {0, 0};
+    memset(args, 0, sizeof(args));
+    oskar_Thread* thread = 0;
+    fitsfile* f = 0;
+    if (*status) return;
 
-    int im_size = MIM->TECImage.size;
-    int num_pixels = im_size * im_size;
-    int type = settings->sim.double_precision ? OSKAR_DOUBLE : OSKAR_SINGLE;
+    // Create the FITS file.
+    screen_create(&s, settings, telescope, status);
+    double centre_deg[2], fov_deg[2];
+    centre_deg[0] = s.pp_lon0 * 180.0 / M_PI;
+    centre_deg[1] = s.pp_lat0 * 180.0 / M_PI;
+    fov_deg[0] = fov_deg[1] =
+            settings->ionosphere.TECImage.fov_rad * 180.0 / M_PI;
+    f = create_fits_file(filename, s.type, s.im_size, s.im_size, s.num_times,
+            centre_deg, fov_deg, s.t0, s.tinc * 86400.0, status);
+
+    // Evaluate the screen in blocks of time planes, and write each block
+    // from a separate thread while the next one is evaluated.
+    int block_size = MAX_BLOCK_PIXELS / s.num_pixels;
+    if (block_size < 1) block_size = 1;
+    if (block_size > s.num_times) block_size = s.num_times;
+    for (int i = 0; i < 2; ++i)
+        planes[i] = oskar_mem_create(s.type, OSKAR_CPU,
+                (size_t) block_size * s.num_pixels, status);
+    for (int t = 0, b = 0; t < s.num_times && !*status; t += block_size, b ^= 1)
+    {
+        const int num_times = (t + block_size <= s.num_times) ?
+                block_size : s.num_times - t;
+        screen_evaluate(&s, t, num_times, planes[b], status);
+
+        // Wait for the previous block to be written.
+        if (thread)
+        {
+            oskar_thread_join(thread);
+            oskar_thread_free(thread);
+            thread = 0;
+            if (!*status) *status = args[!b].status;
+        }
+        if (*status) break;
+
+        // Start writing this block.
+        args[b].f = f;
+        args[b].data = planes[b];
+        args[b].first = 1 + (long long) t * s.num_pixels;
+        args[b].num = (long long) num_times * s.num_pixels;
+        args[b].status = 0;
+        thread = oskar_thread_create(write_planes, (void*)&args[b], 0);
+    }
+    if (thread)
+    {
+        oskar_thread_join(thread);
+        oskar_thread_free(thread);
+        for (int i = 0; i < 2; ++i)
+            if (!*status) *status = args[i].status;
+    }
+    if (f) fits_close_file(f, status);
+    oskar_mem_free(planes[0], status);
+    oskar_mem_free(planes[1], status);
+    screen_free(&s, status);
+}
+
+
+static void screen_create(TECScreen* s, const oskar_Settings_old* settings,
+        const oskar_Telescope* telescope, int* status)
+{
+    const oskar_SettingsIonosphere* MIM = &settings->ionosphere;
+    memset(s, 0, sizeof(TECScreen));
+    if (*status) return;
+
+    s->im_size = MIM->TECImage.size;
+    s->num_pixels = s->im_size * s->im_size;
+    s->type = settings->sim.double_precision ? OSKAR_DOUBLE : OSKAR_SINGLE;
+    s->num_times = settings->obs.num_time_steps;
+    s->t0 = settings->obs.start_mjd_utc;
+    s->tinc = settings->obs.dt_dump_days;
+    s->TEC0 = MIM->TEC0;
+    s->TID = &(MIM->TID[0]);
     double fov = MIM->TECImage.fov_rad;
 
     // Evaluate the p.p. coordinates of the beam phase centre.
@@ -67,56 +197,80 @@ oskar_Mem* oskar_sim_tec_screen(const oskar_Settings_old* settings,
     if (MIM->TECImage.beam_centred)
     {
         evaluate_station_beam_pp(telescope, id, settings,
-                pp_lon0, pp_lat0, status);
+                &s->pp_lon0, &s->pp_lat0, status);
     }
     else
     {
-        const oskar_Station* s = oskar_telescope_station_const(telescope, id);
-        *pp_lon0 = oskar_station_beam_lon_rad(s);
-        *pp_lat0 = oskar_station_beam_lat_rad(s);
+        const oskar_Station* st = oskar_telescope_station_const(telescope, id);
+        s->pp_lon0 = oskar_station_beam_lon_rad(st);
+        s->pp_lat0 = oskar_station_beam_lat_rad(st);
     }
 
-    int num_times = settings->obs.num_time_steps;
-    double t0 = settings->obs.start_mjd_utc;
-    double tinc = settings->obs.dt_dump_days;
-
     // Generate the lon, lat grid used for the TEC values.
-    oskar_Mem *pp_lon, *pp_lat, *pp_rel_path;
-    pp_lon = oskar_mem_create(type, OSKAR_CPU, num_pixels, status);
-    pp_lat = oskar_mem_create(type, OSKAR_CPU, num_pixels, status);
-    oskar_evaluate_image_lon_lat_grid(im_size, im_size, fov, fov,
-            *pp_lon0, *pp_lat0, pp_lon, pp_lat, status);
+    s->pp_lon = oskar_mem_create(s->type, OSKAR_CPU, s->num_pixels, status);
+    s->pp_lat = oskar_mem_create(s->type, OSKAR_CPU, s->num_pixels, status);
+    oskar_evaluate_image_lon_lat_grid(s->im_size, s->im_size, fov, fov,
+            s->pp_lon0, s->pp_lat0, s->pp_lon, s->pp_lat, status);
 
     // Relative path in direction of p.p. (1.0 here as we are not using
     // any stations)
-    pp_rel_path = oskar_mem_create(type, OSKAR_CPU, num_pixels, status);
-    oskar_mem_set_value_real(pp_rel_path, 1.0, 0, num_pixels, status);
-
-    // Initialise return values
-    TEC_screen = oskar_mem_create(type, OSKAR_CPU, num_pixels * num_times,
+    s->pp_rel_path = oskar_mem_create(s->type, OSKAR_CPU, s->num_pixels,
             status);
+    oskar_mem_set_value_real(s->pp_rel_path, 1.0, 0, s->num_pixels, status);
+}
+
+
+static void screen_evaluate(TECScreen* s, int time_start, int num_times,
+        oskar_Mem* planes, int* status)
+{
+    int i, num_threads = 1;
+    if (*status) return;
 
-    oskar_Mem *tec_screen_snapshot = oskar_mem_create_alias(0, 0, 0, status);
-    for (int i = 0; i < num_times; ++i)
+    // Evaluate the time planes in parallel if there are enough of them to
+    // keep all threads busy. Otherwise, the pixels in each plane are
+    // evaluated in parallel by oskar_evaluate_tec_tid().
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+#pragma omp parallel for private(i) if (num_times >= num_threads)
+    for (i = 0; i < num_times; ++i)
     {
-        double gast = t0 + tinc * (double)i;
-        int offset = num_pixels * i;
-        oskar_mem_set_alias(tec_screen_snapshot, TEC_screen,
-                offset, num_pixels, status);
-        oskar_evaluate_tec_tid(tec_screen_snapshot, num_pixels, pp_lon, pp_lat,
-                pp_rel_path, MIM->TEC0, &(MIM->TID[0]), gast);
+        int thread_status = 0;
+        const double gast = s->t0 + s->tinc * (double)(time_start + i);
+        const size_t offset = (size_t) s->num_pixels * i;
+        oskar_Mem* snapshot = oskar_mem_create_alias(planes, offset,
+                s->num_pixels, &thread_status);
+        oskar_evaluate_tec_tid(snapshot, s->num_pixels, s->pp_lon, s->pp_lat,
+                s->pp_rel_path, s->TEC0, s->TID, gast);
+        oskar_mem_free(snapshot, &thread_status);
+        if (thread_status)
+        {
+#pragma omp critical (screen_evaluate)
+            *status = thread_status;
+        }
     }
+}
 
-    oskar_mem_free(pp_lon, status);
-    oskar_mem_free(pp_lat, status);
-    oskar_mem_free(pp_rel_path, status);
-    oskar_mem_free(tec_screen_snapshot, status);
 
-    return TEC_screen;
+static void screen_free(TECScreen* s, int* status)
+{
+    oskar_mem_free(s->pp_lon, status);
+    oskar_mem_free(s->pp_lat, status);
+    oskar_mem_free(s->pp_rel_path, status);
 }
 
 
-void evaluate_station_beam_pp(const oskar_Telescope* tel, int stationID,
+static void* write_planes(void* arg)
+{
+    WriteArgs* a = (WriteArgs*) arg;
+    const int type = oskar_mem_is_double(a->data) ? TDOUBLE : TFLOAT;
+    fits_write_img(a->f, type, a->first, a->num,
+            const_cast<void*>(oskar_mem_void_const(a->data)), &a->status);
+    return 0;
+}
+
+
+static void evaluate_station_beam_pp(const oskar_Telescope* tel, int stationID,
         const oskar_Settings_old* settings,
         double* pp_lon0, double* pp_lat0, int* status)
 {
@@ -201,6 +355,82 @@ void evaluate_station_beam_pp(const oskar_Telescope* tel, int stationID,
     oskar_mem_free(m_pp_rel_path, status);
     oskar_mem_free(hor_x, status);
     oskar_mem_free(hor_y, status);
-    oskar_mem_free(hor_y, status);
+    oskar_mem_free(hor_z, status);
 }
 
+static double fov_to_cellsize(double fov_deg, int num_pixels)
+{
+    double max, inc;
+    max = sin(fov_deg * M_PI / 360.0); /* Divide by 2. */
+    inc = max / (0.5 * num_pixels);
+    return asin(inc) * 180.0 / M_PI;
+}
+
+static fitsfile* create_fits_file(const char* filename, int precision,
+        int width, int height, int num_times, double centre_deg[2],
+        double fov_deg[2], double start_time_mjd, double delta_time_sec,
+        int* status)
+{
+    int imagetype;
+    long naxes[3];
+    double delta;
+    fitsfile* f = 0;
+    FILE* t = 0;
+    if (*status) return 0;
+
+    /* Create a new FITS file and write the image headers. */
+    t = fopen(filename, "rb");
+    if (t)
+    {
+        fclose(t);
+        remove(filename);
+    }
+    imagetype = (precision == OSKAR_DOUBLE ? DOUBLE_IMG : FLOAT_IMG);
+    naxes[0]  = width;
+    naxes[1]  = height;
+    naxes[2]  = num_times;
+    fits_create_file(&f, filename, status);
+    fits_create_img(f, imagetype, 3, naxes, status);
+    fits_write_date(f, status);
+
+    /* Write axis headers. */
+    delta = fov_to_cellsize(fov_deg[0], width);
+    write_axis_header(f, 1, "RA---SIN", "Right Ascension",
+            centre_deg[0], -delta, (width + 1) / 2.0, 0.0, status);
+    delta = fov_to_cellsize(fov_deg[1], height);
+    write_axis_header(f, 2, "DEC--SIN", "Declination",
+            centre_deg[1], delta, (height + 1) / 2.0, 0.0, status);
+    write_axis_header(f, 3, "UTC", "Time",
+            start_time_mjd, delta_time_sec, 1.0, 0.0, status);
+
+    /* Write other headers. */
+    fits_write_key_str(f, "TIMESYS", "UTC", NULL, status);
+    fits_write_key_str(f, "TIMEUNIT", "s", "Time axis units", status);
+    fits_write_key_dbl(f, "MJD-OBS", start_time_mjd, 10, "Start time", status);
+    fits_write_key_dbl(f, "OBSRA", centre_deg[0], 10, "RA", status);
+    fits_write_key_dbl(f, "OBSDEC", centre_deg[1], 10, "DEC", status);
+
+    return f;
+}
+
+static void write_axis_header(fitsfile* fptr, int axis_id,
+        const char* ctype, const char* ctype_comment, double crval,
+        double cdelt, double crpix, double crota, int* status)
+{
+    char key[FLEN_KEYWORD], value[FLEN_VALUE], comment[FLEN_COMMENT];
+    int decimals = 10;
+    if (*status) return;
+
+    strncpy(comment, ctype_comment, FLEN_COMMENT-1);
+    strncpy(value, ctype, FLEN_VALUE-1);
+    fits_make_keyn("CTYPE", axis_id, key, status);
+    fits_write_key_str(fptr, key, value, comment, status);
+    fits_make_keyn("CRVAL", axis_id, key, status);
+    fits_write_key_dbl(fptr, key, crval, decimals, NULL, status);
+    fits_make_keyn("CDELT", axis_id, key, status);
+    fits_write_key_dbl(fptr, key, cdelt, decimals, NULL, status);
+    fits_make_keyn("CRPIX", axis_id, key, status);
+    fits_write_key_dbl(fptr, key, crpix, decimals, NULL, status);
+    fits_make_keyn("CROTA", axis_id, key, status);
+    fits_write_key_dbl(fptr, key, crota, decimals, NULL, status);
+}
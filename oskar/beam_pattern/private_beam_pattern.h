@@ -83,6 +83,27 @@ struct DataProduct
 };
 typedef struct DataProduct DataProduct;
 
+/* Output waiting to be written to a file by the writer thread. */
+struct PendingWrite
+{
+    fitsfile* fits_file;
+    FILE* text_file;
+    long firstpix[4];
+    int num_pix;
+    oskar_Mem* pix; /* Real-valued pixel array to write to FITS file. */
+    char* text; /* Formatted lines to write to text file. */
+    size_t text_length, text_capacity;
+};
+typedef struct PendingWrite PendingWrite;
+
+/* Output for one group of chunks, written in the order it was queued. */
+struct WriteQueue
+{
+    int num_pending, capacity;
+    PendingWrite* pending;
+};
+typedef struct WriteQueue WriteQueue;
+
 struct oskar_BeamPattern
 {
     /* Settings. */
@@ -91,6 +112,9 @@ struct oskar_BeamPattern
     int num_time_steps, num_channels, num_chunks;
     int pol_mode, width, height, num_pixels, nside;
     int num_active_stations, *station_ids;
+    int* station_beam_index; /* Active station whose beam can be reused. */
+    int num_station_beams, *station_beam_order; /* Beams to evaluate. */
+    int* station_reuse_element; /* Reuse element pattern from last beam. */
     int voltage_amp_txt, voltage_phase_txt, voltage_raw_txt, auto_power_txt;
     int voltage_amp_fits, voltage_phase_fits, auto_power_fits;
     int cross_power_amp_txt, cross_power_phase_txt, cross_power_raw_txt;
@@ -106,15 +130,20 @@ struct oskar_BeamPattern
     oskar_Mutex* mutex;
     oskar_Barrier* barrier;
     int i_global, status;
+    volatile int chunk_slot_index; /* Next chunk in the group to simulate. */
 
     /* Input data. */
     oskar_Mem *x, *y, *z;
     oskar_Telescope* tel;
 
     /* Temporary arrays. */
-    oskar_Mem* pix; /* Real-valued pixel array to write to file. */
     oskar_Mem* ctemp; /* Complex-valued array used for reordering. */
 
+    /* Output queues, filled and written in turn. */
+    WriteQueue write_queue[2];
+    oskar_Thread* writer; /* Thread writing the inactive queue to file. */
+    int i_write_queue, write_status;
+
     /* Settings log data. */
     char* settings_log;
     size_t settings_log_length;
@@ -32,6 +32,8 @@
 #include "convert/oskar_convert_fov_to_cellsize.h"
 #include "math/oskar_cmath.h"
 #include "math/private_cond2_2x2.h"
+#include "telescope/station/oskar_station_different.h"
+#include "telescope/station/element/oskar_element_different.h"
 #include "utility/oskar_device.h"
 #include "utility/oskar_file_exists.h"
 #include "oskar_version.h"
@@ -54,6 +56,10 @@ static void set_up_host_data(oskar_BeamPattern* h, int *status);
 static void create_averaged_products(oskar_BeamPattern* h, int ta, int ca,
         int* status);
 static void set_up_device_data(oskar_BeamPattern* h, int* status);
+static void set_up_station_beam_index(oskar_BeamPattern* h, int* status);
+static int separable_element_pattern(const oskar_Station* s);
+static int same_element_pattern(const oskar_BeamPattern* h,
+        const oskar_Station* a, const oskar_Station* b, int* status);
 static void write_axis(fitsfile* fptr, int axis_id, const char* ctype,
         const char* ctype_comment, double crval, double cdelt, double crpix,
         int* status);
@@ -110,11 +116,12 @@ static void set_up_host_data(oskar_BeamPattern* h, int *status)
     /* Work out how many pixel chunks have to be processed. */
     h->num_chunks = (h->num_pixels + h->max_chunk_size - 1) / h->max_chunk_size;
 
-    /* Create scratch arrays for output pixel data. */
-    if (!h->pix)
+    /* Find the stations that can share the same beam. */
+    set_up_station_beam_index(h, status);
+
+    /* Create scratch array for output pixel data. */
+    if (!h->ctemp)
     {
-        h->pix = oskar_mem_create(h->prec, OSKAR_CPU,
-                h->max_chunk_size, status);
         h->ctemp = oskar_mem_create(h->prec | OSKAR_COMPLEX, OSKAR_CPU,
                 h->max_chunk_size, status);
     }
@@ -552,6 +559,138 @@ static const char* stokes_type_to_string(int type)
 }
 
 
+static void set_up_station_beam_index(oskar_BeamPattern* h, int* status)
+{
+    int i, j, k, *element_index;
+    const int num_stations = h->num_active_stations;
+    const int allow_copy =
+            oskar_telescope_allow_station_beam_duplication(h->tel);
+    const int identical = oskar_telescope_identical_stations(h->tel);
+    if (*status) return;
+
+    /* Allocate the index arrays. */
+    h->num_station_beams = 0;
+    free(h->station_beam_index);
+    free(h->station_beam_order);
+    free(h->station_reuse_element);
+    h->station_beam_index = (int*) malloc(num_stations * sizeof(int));
+    h->station_beam_order = (int*) malloc(num_stations * sizeof(int));
+    h->station_reuse_element = (int*) malloc(num_stations * sizeof(int));
+    element_index = (int*) malloc(num_stations * sizeof(int));
+    if (!h->station_beam_index || !h->station_beam_order ||
+            !h->station_reuse_element || !element_index)
+    {
+        free(element_index);
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+
+    /* Each active station uses the beam of the first active station with
+     * the same model, if beam duplication is allowed. Only the beams of
+     * stations that index themselves need to be evaluated. */
+    for (i = 0; i < num_stations; ++i)
+    {
+        const oskar_Station* s;
+        h->station_beam_index[i] = i;
+        if (!allow_copy) continue;
+        if (identical)
+        {
+            h->station_beam_index[i] = 0;
+            continue;
+        }
+        s = oskar_telescope_station_const(h->tel, h->station_ids[i]);
+        for (j = 0; j < i; ++j)
+        {
+            if (h->station_beam_index[j] != j) continue;
+            if (!oskar_station_different(s, oskar_telescope_station_const(
+                    h->tel, h->station_ids[j]), status))
+            {
+                h->station_beam_index[i] = j;
+                break;
+            }
+        }
+    }
+
+    /* Find the first station to be evaluated with the same element pattern
+     * as each other one. This needs no approximation, so it is always done:
+     * only the array pattern differs between these stations. */
+    for (i = 0; i < num_stations; ++i)
+    {
+        const oskar_Station* s;
+        element_index[i] = i;
+        if (h->station_beam_index[i] != i) continue;
+        s = oskar_telescope_station_const(h->tel, h->station_ids[i]);
+        for (j = 0; j < i; ++j)
+        {
+            if (h->station_beam_index[j] != j || element_index[j] != j)
+                continue;
+            if (same_element_pattern(h, s, oskar_telescope_station_const(
+                    h->tel, h->station_ids[j]), status))
+            {
+                element_index[i] = j;
+                break;
+            }
+        }
+    }
+
+    /* Order the beams to evaluate so that those sharing an element pattern
+     * are next to each other, and can reuse it from the one before. */
+    for (j = 0; j < num_stations; ++j)
+    {
+        if (h->station_beam_index[j] != j || element_index[j] != j) continue;
+        for (i = j; i < num_stations; ++i)
+        {
+            if (h->station_beam_index[i] != i || element_index[i] != j)
+                continue;
+            k = h->num_station_beams++;
+            h->station_beam_order[k] = i;
+            h->station_reuse_element[k] = (i != j);
+        }
+    }
+    free(element_index);
+}
+
+
+static int separable_element_pattern(const oskar_Station* s)
+{
+    return oskar_station_type(s) == OSKAR_STATION_TYPE_AA &&
+            !oskar_station_has_child(s) &&
+            oskar_station_num_element_types(s) == 1 &&
+            (oskar_station_common_element_orientation(s) ||
+                    oskar_element_is_isotropic(
+                            oskar_station_element_const(s, 0)));
+}
+
+
+static int same_element_pattern(const oskar_BeamPattern* h,
+        const oskar_Station* a, const oskar_Station* b, int* status)
+{
+    if (*status) return 0;
+    if (!separable_element_pattern(a) || !separable_element_pattern(b))
+        return 0;
+    if (oskar_element_different(oskar_station_element_const(a, 0),
+            oskar_station_element_const(b, 0), status))
+        return 0;
+    if (oskar_station_element_x_alpha_rad(a, 0) !=
+            oskar_station_element_x_alpha_rad(b, 0) ||
+            oskar_station_element_y_alpha_rad(a, 0) !=
+            oskar_station_element_y_alpha_rad(b, 0) ||
+            oskar_station_normalise_final_beam(a) !=
+            oskar_station_normalise_final_beam(b))
+        return 0;
+
+    /* Relative directions are converted to ENU directions using the
+     * station position and beam direction, so these must also match. */
+    if (h->coord_type == OSKAR_ENU_DIRECTIONS) return 1;
+    return oskar_station_lon_rad(a) == oskar_station_lon_rad(b) &&
+            oskar_station_lat_rad(a) == oskar_station_lat_rad(b) &&
+            oskar_station_beam_coord_type(a) ==
+            oskar_station_beam_coord_type(b) &&
+            oskar_station_beam_lon_rad(a) == oskar_station_beam_lon_rad(b) &&
+            oskar_station_beam_lat_rad(a) == oskar_station_beam_lat_rad(b);
+}
+
+
 static void set_up_device_data(oskar_BeamPattern* h, int* status)
 {
     int i, beam_type, max_src, max_size, auto_power, cross_power, raw_data;
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016-2017, The University of Oxford
+ * Copyright (c) 2016-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -49,6 +49,9 @@ void oskar_beam_pattern_free(oskar_BeamPattern* h, int* status)
     free(h->sky_model_file);
     free(h->settings_log);
     free(h->station_ids);
+    free(h->station_beam_index);
+    free(h->station_beam_order);
+    free(h->station_reuse_element);
     free(h);
 }
 
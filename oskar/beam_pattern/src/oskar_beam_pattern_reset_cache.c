@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016, The University of Oxford
+ * Copyright (c) 2016-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -32,6 +32,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <fitsio.h>
 
@@ -41,14 +42,26 @@ extern "C" {
 
 void oskar_beam_pattern_reset_cache(oskar_BeamPattern* h, int* status)
 {
-    int i;
+    int i, j;
     oskar_beam_pattern_free_device_data(h, status);
     oskar_mem_free(h->x, status);
     oskar_mem_free(h->y, status);
     oskar_mem_free(h->z, status);
-    oskar_mem_free(h->pix, status);
     oskar_mem_free(h->ctemp, status);
-    h->x = h->y = h->z = h->pix = h->ctemp = NULL;
+    h->x = h->y = h->z = h->ctemp = NULL;
+
+    /* Free the output queues. */
+    for (i = 0; i < 2; ++i)
+    {
+        WriteQueue* q = &h->write_queue[i];
+        for (j = 0; j < q->capacity; ++j)
+        {
+            oskar_mem_free(q->pending[j].pix, status);
+            free(q->pending[j].text);
+        }
+        free(q->pending);
+        memset(q, 0, sizeof(WriteQueue));
+    }
 
     /* Close files and free data products. */
     for (i = 0; i < h->num_data_products; ++i)
@@ -37,8 +37,10 @@
 #include "utility/oskar_device.h"
 #include "utility/oskar_file_exists.h"
 #include "utility/oskar_get_memory_usage.h"
+#include "utility/oskar_get_num_procs.h"
 #include "oskar_version.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -53,13 +55,19 @@ extern "C" {
 #endif
 
 static void* run_blocks(void* arg);
-static void sim_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_time,
-        int i_channel, int i_active, int device_id, int* status);
+static void sim_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_slot,
+        int i_time, int i_channel, int i_active, int device_id, int* status);
 static void write_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_time,
         int i_channel, int i_active, int* status);
 static void write_pixels(oskar_BeamPattern* h, int i_chunk, int i_time,
         int i_channel, int num_pix, int channel_average, int time_average,
         const oskar_Mem* in, int chunk_desc, int stokes_in, int* status);
+static PendingWrite* next_write(oskar_BeamPattern* h, int* status);
+static void format_text(const oskar_Mem* in, int offset, int num_rows,
+        PendingWrite* w, int* status);
+static void start_writes(oskar_BeamPattern* h, int* status);
+static void finish_writes(oskar_BeamPattern* h, int* status);
+static void* write_queue(void* arg);
 static void complex_to_amp(const oskar_Mem* complex_in, const int offset,
         const int stride, const int num_points, oskar_Mem* output, int* status);
 static void complex_to_phase(const oskar_Mem* complex_in, const int offset,
@@ -128,6 +136,8 @@ void oskar_beam_pattern_run(oskar_BeamPattern* h, int* status)
 
     /* Set status code. */
     h->status = *status;
+    h->write_status = 0;
+    oskar_atomic_store(&h->chunk_slot_index, 0);
 
     /* Start simulation timer. */
     oskar_timer_start(h->tmr_sim);
@@ -184,9 +194,16 @@ static void* run_blocks(void* arg)
     const int device_id = thread_id - 1;
 
 #ifdef _OPENMP
-    /* Disable any nested parallelism. */
+    /* Disable any nested parallelism.
+     * Output conversion can use any cores not used by CPU devices. */
     omp_set_nested(0);
-    omp_set_num_threads(1);
+    if (thread_id == 0)
+    {
+        const int n = oskar_get_num_procs() - (h->num_devices - h->num_gpus);
+        omp_set_num_threads(n > 1 ? n : 1);
+    }
+    else
+        omp_set_num_threads(1);
 #endif
 
     if (device_id >= 0 && device_id < h->num_gpus)
@@ -210,6 +227,17 @@ static void* run_blocks(void* arg)
      *
      * Thread 0 is used for file writes.
      * Threads 1 to n (mapped to compute devices) do the simulation.
+     *
+     * Each iteration covers a group of one chunk per device. The chunks in
+     * the group are handed out using an atomic counter, so a device that
+     * finishes a cheap chunk (e.g. one mostly below the horizon) goes on
+     * to the next chunk in the group instead of waiting at the barrier.
+     * Host buffers belong to the position of the chunk in the group,
+     * not to the device that simulated it.
+     *
+     * Thread 0 only converts the output into pixel values and text, which
+     * are put in a queue. The queue for each group is written to file by
+     * a separate writer thread while thread 0 goes on to the next group.
      */
     for (c = 0; c < h->num_chunks; c += h->num_devices)
     {
@@ -229,7 +257,13 @@ static void* run_blocks(void* arg)
                     t = i_inner;
                 }
                 if (thread_id > 0 || num_threads == 1)
-                    sim_chunks(h, c, t, f, h->i_global & 1, device_id, status);
+                {
+                    int i_slot;
+                    while ((i_slot = oskar_atomic_fetch_add(
+                            &h->chunk_slot_index, 1)) < h->num_devices)
+                        sim_chunks(h, c, i_slot, t, f, h->i_global & 1,
+                                device_id, status);
+                }
                 if (thread_id == 0 && h->i_global > 0)
                     write_chunks(h, cp, tp, fp, h->i_global & 1, status);
 
@@ -241,6 +275,7 @@ static void* run_blocks(void* arg)
                     tp = t;
                     fp = f;
                     h->i_global++;
+                    oskar_atomic_store(&h->chunk_slot_index, 0);
                 }
 
                 /* Barrier 2: Check sim and write are done. */
@@ -251,25 +286,29 @@ static void* run_blocks(void* arg)
 
     /* Write the very last chunk(s). */
     if (thread_id == 0)
+    {
         write_chunks(h, cp, tp, fp, h->i_global & 1, status);
+        finish_writes(h, status);
+    }
 
     return 0;
 }
 
 
-static void sim_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_time,
-        int i_channel, int i_active, int device_id, int* status)
+static void sim_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_slot,
+        int i_time, int i_channel, int i_active, int device_id, int* status)
 {
     int chunk_size, i;
-    DeviceData* d;
+    DeviceData *d, *out;
 
     /* Check if safe to proceed. */
     if (*status) return;
 
-    /* Get chunk index from GPU ID and chunk start,
+    /* Get chunk index from its position in the group and the chunk start,
      * and return immediately if it's out of range. */
     d = &h->d[device_id];
-    const int i_chunk = i_chunk_start + device_id;
+    out = &h->d[i_slot];
+    const int i_chunk = i_chunk_start + i_slot;
     if (i_chunk >= h->num_chunks) return;
 
     /* Get time and frequency values. */
@@ -294,16 +333,33 @@ static void sim_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_time,
         oskar_mem_copy_contents(d->z, h->z, 0, offset, chunk_size, status);
     }
 
-    /* Generate beam for this pixel chunk, for all active stations. */
-    for (i = 0; i < h->num_active_stations; ++i)
+    /* Generate beam for this pixel chunk, for the active stations that need
+     * their own. Stations with the same element pattern as the one before
+     * reuse it, and only evaluate their array pattern. */
+    for (i = 0; i < h->num_station_beams; ++i)
     {
-        const int offset = i * chunk_size;
+        const int i_station = h->station_beam_order[i];
+        oskar_station_work_set_reuse_element_pattern(d->work,
+                h->station_reuse_element[i]);
         oskar_evaluate_station_beam(chunk_size,
                 h->coord_type, d->x, d->y, d->z,
                 oskar_telescope_phase_centre_ra_rad(d->tel),
                 oskar_telescope_phase_centre_dec_rad(d->tel),
-                oskar_telescope_station_const(d->tel, h->station_ids[i]),
-                d->work, i_time, freq_hz, gast, offset, d->jones_data, status);
+                oskar_telescope_station_const(d->tel,
+                        h->station_ids[i_station]),
+                d->work, i_time, freq_hz, gast, i_station * chunk_size,
+                d->jones_data, status);
+    }
+    oskar_station_work_set_reuse_element_pattern(d->work, 0);
+
+    /* Stations that share a beam with an earlier one get a copy of it. */
+    for (i = 0; i < h->num_active_stations; ++i)
+    {
+        const int offset = i * chunk_size;
+        const int i_source = h->station_beam_index[i];
+        if (i_source != i)
+            oskar_mem_copy_contents(d->jones_data, d->jones_data,
+                    offset, i_source * chunk_size, chunk_size, status);
         if (d->auto_power[I])
             oskar_evaluate_auto_power(chunk_size,
                     offset, d->jones_data,
@@ -323,18 +379,18 @@ static void sim_chunks(oskar_BeamPattern* h, int i_chunk_start, int i_time,
         oskar_evaluate_cross_power(chunk_size, h->num_active_stations,
                 d->jones_data, 0, d->cross_power[I], status);
 
-    /* Copy the output data into host memory. */
-    if (d->jones_data_cpu[i_active])
-        oskar_mem_copy_contents(d->jones_data_cpu[i_active], d->jones_data,
+    /* Copy the output data into host memory for this chunk. */
+    if (out->jones_data_cpu[i_active])
+        oskar_mem_copy_contents(out->jones_data_cpu[i_active], d->jones_data,
                 0, 0, chunk_size * h->num_active_stations, status);
     for (i = 0; i < 4; ++i)
     {
         if (d->auto_power[i])
-            oskar_mem_copy_contents(d->auto_power_cpu[i][i_active],
+            oskar_mem_copy_contents(out->auto_power_cpu[i][i_active],
                     d->auto_power[i], 0, 0,
                     chunk_size * h->num_active_stations, status);
         if (d->cross_power[i])
-            oskar_mem_copy_contents(d->cross_power_cpu[i][i_active],
+            oskar_mem_copy_contents(out->cross_power_cpu[i][i_active],
                     d->cross_power[i], 0, 0, chunk_size, status);
     }
     oskar_mutex_lock(h->mutex);
@@ -505,6 +561,9 @@ static void write_chunks(oskar_BeamPattern* h, int i_chunk_start,
             }
         }
     }
+
+    /* Write the queued output for the chunk(s) in the background. */
+    start_writes(h, status);
     oskar_timer_pause(h->tmr_write);
 }
 
@@ -518,10 +577,12 @@ static void write_pixels(oskar_BeamPattern* h, int i_chunk, int i_time,
 
     /* Loop over data products. */
     const int num_pol = h->pol_mode == OSKAR_POL_MODE_FULL ? 4 : 1;
+    WriteQueue* q = &h->write_queue[h->i_write_queue];
     for (i = 0; i < h->num_data_products; ++i)
     {
         fitsfile* f;
         FILE* t;
+        PendingWrite* w;
         int dp, stokes_out, i_station, off;
 
         /* Get data product info. */
@@ -537,53 +598,58 @@ static void write_pixels(oskar_BeamPattern* h, int i_chunk, int i_time,
                 h->data_products[i].stokes_in != stokes_in)
             continue;
 
+        /* Get the next entry in the output queue. */
+        w = next_write(h, status);
+        if (!w) return;
+
         /* Treat raw data output as special case, as it doesn't go via pix. */
         if (dp == RAW_COMPLEX && chunk_desc == JONES_DATA && t)
         {
-            oskar_Mem* station_data;
-            station_data = oskar_mem_create_alias(in, i_station * num_pix,
-                    num_pix, status);
-            oskar_mem_save_ascii(t, 1, 0, num_pix, status, station_data);
-            oskar_mem_free(station_data, status);
+            format_text(in, i_station * num_pix, num_pix, w, status);
+            w->text_file = t;
+            q->num_pending++;
             continue;
         }
         if (dp == CROSS_POWER_RAW_COMPLEX &&
                 chunk_desc == CROSS_POWER_DATA && t)
         {
-            oskar_mem_save_ascii(t, 1, 0, num_pix, status, in);
+            format_text(in, 0, num_pix, w, status);
+            w->text_file = t;
+            q->num_pending++;
             continue;
         }
 
         /* Convert complex values to pixel data. */
-        oskar_mem_clear_contents(h->pix, status);
+        oskar_mem_ensure(w->pix, num_pix, status);
+        oskar_mem_clear_contents(w->pix, status);
         if (chunk_desc == JONES_DATA && dp == AMP)
         {
             off = i_station * num_pix * num_pol;
             if (stokes_out == XX || stokes_out == -1)
-                complex_to_amp(in, off, num_pol, num_pix, h->pix, status);
+                complex_to_amp(in, off, num_pol, num_pix, w->pix, status);
             else if (stokes_out == XY)
-                complex_to_amp(in, off + 1, num_pol, num_pix, h->pix, status);
+                complex_to_amp(in, off + 1, num_pol, num_pix, w->pix, status);
             else if (stokes_out == YX)
-                complex_to_amp(in, off + 2, num_pol, num_pix, h->pix, status);
+                complex_to_amp(in, off + 2, num_pol, num_pix, w->pix, status);
             else if (stokes_out == YY)
-                complex_to_amp(in, off + 3, num_pol, num_pix, h->pix, status);
+                complex_to_amp(in, off + 3, num_pol, num_pix, w->pix, status);
             else continue;
         }
         else if (chunk_desc == JONES_DATA && dp == PHASE)
         {
             off = i_station * num_pix * num_pol;
             if (stokes_out == XX || stokes_out == -1)
-                complex_to_phase(in, off, num_pol, num_pix, h->pix, status);
-            else if (stokes_out == XY)
-                complex_to_phase(in, off + 1, num_pol, num_pix, h->pix, status);
+                complex_to_phase(in, off, num_pol, num_pix, w->pix, status);
             else if (stokes_out == XY)
-                complex_to_phase(in, off + 2, num_pol, num_pix, h->pix, status);
+                complex_to_phase(in, off + 1, num_pol, num_pix, w->pix, status);
             else if (stokes_out == YX)
-                complex_to_phase(in, off + 3, num_pol, num_pix, h->pix, status);
+                complex_to_phase(in, off + 2, num_pol, num_pix, w->pix, status);
+            else if (stokes_out == YY)
+                complex_to_phase(in, off + 3, num_pol, num_pix, w->pix, status);
             else continue;
         }
         else if (chunk_desc == JONES_DATA && dp == IXR)
-            jones_to_ixr(in, i_station * num_pix, num_pix, h->pix, status);
+            jones_to_ixr(in, i_station * num_pix, num_pix, w->pix, status);
         else if (chunk_desc == AUTO_POWER_DATA ||
                 chunk_desc == CROSS_POWER_DATA)
         {
@@ -604,28 +670,173 @@ static void write_pixels(oskar_BeamPattern* h, int i_chunk, int i_time,
                 power_to_stokes_V(in, off, num_pix, h->ctemp, status);
             else continue;
             if (dp == AUTO_POWER || dp == CROSS_POWER_AMP)
-                complex_to_amp(h->ctemp, 0, 1, num_pix, h->pix, status);
+                complex_to_amp(h->ctemp, 0, 1, num_pix, w->pix, status);
             else if (dp == CROSS_POWER_PHASE)
-                complex_to_phase(h->ctemp, 0, 1, num_pix, h->pix, status);
+                complex_to_phase(h->ctemp, 0, 1, num_pix, w->pix, status);
             else continue;
         }
         else continue;
 
         /* Check for FITS file. */
+        w->num_pix = num_pix;
         if (f && h->width && h->height)
         {
-            long firstpix[4];
-            firstpix[0] = 1 + (i_chunk * h->max_chunk_size) % h->width;
-            firstpix[1] = 1 + (i_chunk * h->max_chunk_size) / h->width;
-            firstpix[2] = 1 + i_channel;
-            firstpix[3] = 1 + i_time;
-            fits_write_pix(f, (h->prec == OSKAR_DOUBLE ? TDOUBLE : TFLOAT),
-                    firstpix, num_pix, oskar_mem_void(h->pix), status);
+            w->fits_file = f;
+            w->firstpix[0] = 1 + (i_chunk * h->max_chunk_size) % h->width;
+            w->firstpix[1] = 1 + (i_chunk * h->max_chunk_size) / h->width;
+            w->firstpix[2] = 1 + i_channel;
+            w->firstpix[3] = 1 + i_time;
         }
 
         /* Check for text file. */
-        if (t) oskar_mem_save_ascii(t, 1, 0, num_pix, status, h->pix);
+        if (t)
+        {
+            format_text(w->pix, 0, num_pix, w, status);
+            w->text_file = t;
+        }
+        if (w->fits_file || w->text_file) q->num_pending++;
+    }
+}
+
+
+/* Returns the next entry in the active output queue, which is only
+ * added to the queue once its number of pending entries is incremented. */
+static PendingWrite* next_write(oskar_BeamPattern* h, int* status)
+{
+    PendingWrite* w;
+    WriteQueue* q = &h->write_queue[h->i_write_queue];
+    if (*status) return 0;
+    if (q->num_pending == q->capacity)
+    {
+        const int new_capacity = (q->capacity > 0) ? 2 * q->capacity : 16;
+        PendingWrite* t = (PendingWrite*) realloc(q->pending,
+                new_capacity * sizeof(PendingWrite));
+        if (!t)
+        {
+            *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+            return 0;
+        }
+        memset(t + q->capacity, 0,
+                (new_capacity - q->capacity) * sizeof(PendingWrite));
+        q->pending = t;
+        q->capacity = new_capacity;
+    }
+    w = &q->pending[q->num_pending];
+    if (!w->pix)
+        w->pix = oskar_mem_create(h->prec, OSKAR_CPU, 0, status);
+    w->fits_file = 0;
+    w->text_file = 0;
+    w->text_length = 0;
+    w->num_pix = 0;
+    return w;
+}
+
+
+/* Formats rows of data in the same way as oskar_mem_save_ascii().
+ * Rows are formatted in parallel into fixed-size slots, which are then
+ * packed together so that the text can be written in one call. */
+static void format_text(const oskar_Mem* in, int offset, int num_rows,
+        PendingWrite* w, int* status)
+{
+    int i;
+    size_t len = 0;
+    char* text;
+    if (*status) return;
+    const int num_values = oskar_mem_is_matrix(in) ? 8 :
+            (oskar_mem_is_complex(in) ? 2 : 1);
+    const size_t row_width = num_values * 24 + 2;
+    const size_t required = num_rows * row_width;
+    if (w->text_capacity < required)
+    {
+        free(w->text);
+        w->text = (char*) malloc(required);
+        w->text_capacity = w->text ? required : 0;
+        if (!w->text)
+        {
+            *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+            return;
+        }
+    }
+    text = w->text;
+    if (oskar_mem_is_double(in))
+    {
+        const double* p = (const double*) oskar_mem_void_const(in) +
+                (size_t) offset * num_values;
+#pragma omp parallel for private(i)
+        for (i = 0; i < num_rows; ++i)
+        {
+            int j;
+            char* row = text + i * row_width;
+            for (j = 0; j < num_values; ++j)
+                row += sprintf(row, "% .14e ", p[i * num_values + j]);
+            sprintf(row, "\n");
+        }
+    }
+    else
+    {
+        const float* p = (const float*) oskar_mem_void_const(in) +
+                (size_t) offset * num_values;
+#pragma omp parallel for private(i)
+        for (i = 0; i < num_rows; ++i)
+        {
+            int j;
+            char* row = text + i * row_width;
+            for (j = 0; j < num_values; ++j)
+                row += sprintf(row, "% .6e ", p[i * num_values + j]);
+            sprintf(row, "\n");
+        }
+    }
+    for (i = 0; i < num_rows; ++i)
+    {
+        const char* row = text + i * row_width;
+        const size_t row_len = strlen(row);
+        memmove(text + len, row, row_len);
+        len += row_len;
     }
+    w->text_length = len;
+}
+
+
+/* Waits for the previous output queue to be written, then starts writing
+ * the active one and makes the other queue active. */
+static void start_writes(oskar_BeamPattern* h, int* status)
+{
+    finish_writes(h, status);
+    if (*status || h->write_queue[h->i_write_queue].num_pending == 0) return;
+    h->i_write_queue ^= 1;
+    h->write_queue[h->i_write_queue].num_pending = 0;
+    h->writer = oskar_thread_create(write_queue, (void*)h, 0);
+}
+
+
+static void finish_writes(oskar_BeamPattern* h, int* status)
+{
+    if (!h->writer) return;
+    oskar_thread_join(h->writer);
+    oskar_thread_free(h->writer);
+    h->writer = 0;
+    if (!*status) *status = h->write_status;
+}
+
+
+static void* write_queue(void* arg)
+{
+    int i;
+    oskar_BeamPattern* h = (oskar_BeamPattern*) arg;
+    const WriteQueue* q = &h->write_queue[h->i_write_queue ^ 1];
+    int* status = &h->write_status;
+    for (i = 0; i < q->num_pending && !*status; ++i)
+    {
+        PendingWrite* w = &q->pending[i];
+        if (w->fits_file)
+            fits_write_pix(w->fits_file, (h->prec == OSKAR_DOUBLE ?
+                    TDOUBLE : TFLOAT), w->firstpix, w->num_pix,
+                    oskar_mem_void(w->pix), status);
+        if (w->text_file && fwrite(w->text, 1, w->text_length,
+                w->text_file) != w->text_length)
+            *status = OSKAR_ERR_FILE_IO;
+    }
+    return 0;
 }
 
 
@@ -639,6 +850,7 @@ static void complex_to_amp(const oskar_Mem* complex_in, const int offset,
         const float2* in;
         in = oskar_mem_float2_const(complex_in, status) + offset;
         out = oskar_mem_float(output, status);
+#pragma omp parallel for private(i, j, x, y)
         for (i = 0; i < num_points; ++i)
         {
             j = i * stride;
@@ -653,6 +865,7 @@ static void complex_to_amp(const oskar_Mem* complex_in, const int offset,
         const double2* in;
         in = oskar_mem_double2_const(complex_in, status) + offset;
         out = oskar_mem_double(output, status);
+#pragma omp parallel for private(i, j, x, y)
         for (i = 0; i < num_points; ++i)
         {
             j = i * stride;
@@ -674,6 +887,7 @@ static void complex_to_phase(const oskar_Mem* complex_in, const int offset,
         const float2* in;
         in = oskar_mem_float2_const(complex_in, status) + offset;
         out = oskar_mem_float(output, status);
+#pragma omp parallel for private(i, j)
         for (i = 0; i < num_points; ++i)
         {
             j = i * stride;
@@ -686,6 +900,7 @@ static void complex_to_phase(const oskar_Mem* complex_in, const int offset,
         const double2* in;
         in = oskar_mem_double2_const(complex_in, status) + offset;
         out = oskar_mem_double(output, status);
+#pragma omp parallel for private(i, j)
         for (i = 0; i < num_points; ++i)
         {
             j = i * stride;
@@ -709,6 +924,7 @@ static void jones_to_ixr(const oskar_Mem* jones, const int offset,
         const float4c* in;
         in = oskar_mem_float4c_const(jones, status) + offset;
         out = oskar_mem_float(output, status);
+#pragma omp parallel for private(i, cond, ixr)
         for (i = 0; i < num_points; ++i)
         {
             cond = oskar_cond2_2x2_inline_f(in + i);
@@ -724,6 +940,7 @@ static void jones_to_ixr(const oskar_Mem* jones, const int offset,
         const double4c* in;
         in = oskar_mem_double4c_const(jones, status) + offset;
         out = oskar_mem_double(output, status);
+#pragma omp parallel for private(i, cond, ixr)
         for (i = 0; i < num_points; ++i)
         {
             cond = oskar_cond2_2x2_inline_d(in + i);
@@ -757,6 +974,7 @@ static void power_to_stokes_I(const oskar_Mem* power_in, const int offset,
             const double4c* in;
             out = oskar_mem_double2(output, status);
             in = oskar_mem_double4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
             for (i = 0; i < num_points; ++i)
             {
                 out[i].x = 0.5 * (in[i].a.x + in[i].d.x);
@@ -769,6 +987,7 @@ static void power_to_stokes_I(const oskar_Mem* power_in, const int offset,
             const float4c* in;
             out = oskar_mem_float2(output, status);
             in = oskar_mem_float4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
             for (i = 0; i < num_points; ++i)
             {
                 out[i].x = 0.5 * (in[i].a.x + in[i].d.x);
@@ -796,6 +1015,7 @@ static void power_to_stokes_Q(const oskar_Mem* power_in, const int offset,
         const double4c* in;
         out = oskar_mem_double2(output, status);
         in = oskar_mem_double4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
         for (i = 0; i < num_points; ++i)
         {
             out[i].x = 0.5 * (in[i].a.x - in[i].d.x);
@@ -808,6 +1028,7 @@ static void power_to_stokes_Q(const oskar_Mem* power_in, const int offset,
         const float4c* in;
         out = oskar_mem_float2(output, status);
         in = oskar_mem_float4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
         for (i = 0; i < num_points; ++i)
         {
             out[i].x = 0.5 * (in[i].a.x - in[i].d.x);
@@ -834,6 +1055,7 @@ static void power_to_stokes_U(const oskar_Mem* power_in, const int offset,
         const double4c* in;
         out = oskar_mem_double2(output, status);
         in = oskar_mem_double4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
         for (i = 0; i < num_points; ++i)
         {
             out[i].x = 0.5 * (in[i].b.x + in[i].c.x);
@@ -846,6 +1068,7 @@ static void power_to_stokes_U(const oskar_Mem* power_in, const int offset,
         const float4c* in;
         out = oskar_mem_float2(output, status);
         in = oskar_mem_float4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
         for (i = 0; i < num_points; ++i)
         {
             out[i].x = 0.5 * (in[i].b.x + in[i].c.x);
@@ -872,6 +1095,7 @@ static void power_to_stokes_V(const oskar_Mem* power_in, const int offset,
         const double4c* in;
         out = oskar_mem_double2(output, status);
         in = oskar_mem_double4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
         for (i = 0; i < num_points; ++i)
         {
             out[i].x =  0.5 * (in[i].b.y - in[i].c.y);
@@ -884,6 +1108,7 @@ static void power_to_stokes_V(const oskar_Mem* power_in, const int offset,
         const float4c* in;
         out = oskar_mem_float2(output, status);
         in = oskar_mem_float4c_const(power_in, status) + offset;
+#pragma omp parallel for private(i)
         for (i = 0; i < num_points; ++i)
         {
             out[i].x =  0.5 * (in[i].b.y - in[i].c.y);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2014-2015, The University of Oxford
+ * Copyright (c) 2014-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -67,7 +67,8 @@ enum OSKAR_TAG_GROUPS
     OSKAR_TAG_GROUP_SPLINE_DATA      = 9,
     OSKAR_TAG_GROUP_ELEMENT_DATA     = 10,
     OSKAR_TAG_GROUP_VIS_HEADER       = 11,
-    OSKAR_TAG_GROUP_VIS_BLOCK        = 12
+    OSKAR_TAG_GROUP_VIS_BLOCK        = 12,
+    OSKAR_TAG_GROUP_TELESCOPE_SNAPSHOT = 13
 };
 
 /* Standard metadata tags. */
@@ -113,7 +114,8 @@ enum OSKAR_BINARY_ERROR_CODES
     OSKAR_ERR_BINARY_TAG_NOT_FOUND         = -115,
     OSKAR_ERR_BINARY_TAG_TOO_LONG          = -116,
     OSKAR_ERR_BINARY_TAG_OUT_OF_RANGE      = -117,
-    OSKAR_ERR_BINARY_CRC_FAIL              = -118
+    OSKAR_ERR_BINARY_CRC_FAIL              = -118,
+    OSKAR_ERR_BINARY_MEMORY_ALLOC_FAILURE  = -119
 };
 
 #ifdef __cplusplus
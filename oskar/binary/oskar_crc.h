@@ -92,6 +92,37 @@ oskar_CRC* oskar_crc_create(int type);
 OSKAR_BINARY_EXPORT
 void oskar_crc_free(oskar_CRC* data);
 
+/**
+ * @brief
+ * Returns true if CRC values are computed using hardware instructions.
+ *
+ * @details
+ * Returns true if CRC values are computed using hardware instructions.
+ *
+ * This is possible only for CRC-32C on CPUs that support SSE4.2.
+ *
+ * @param[in] crc_data  Pointer to CRC data table.
+ */
+OSKAR_BINARY_EXPORT
+int oskar_crc_accelerated(const oskar_CRC* crc_data);
+
+/**
+ * @brief
+ * Enables or disables the use of hardware instructions for CRC computation.
+ *
+ * @details
+ * Enables or disables the use of hardware instructions for CRC computation.
+ *
+ * Hardware instructions are used by default where possible.
+ * This function is provided mainly for testing: if enabled, the
+ * instructions are still used only if they are supported.
+ *
+ * @param[in] crc_data  Pointer to CRC data table.
+ * @param[in] value     If true, use hardware instructions where possible.
+ */
+OSKAR_BINARY_EXPORT
+void oskar_crc_set_accelerated(oskar_CRC* crc_data, int value);
+
 /**
  * @brief
  * Updates a CRC value with new data.
@@ -104,6 +135,11 @@ void oskar_crc_free(oskar_CRC* data);
  * http://web.archive.org/web/20121011093914/http://www.intel.com/technology/comms/perfnet/download/CRC_generators.pdf
  * http://create.stephan-brumme.com/crc32/
  *
+ * For CRC-32C, the SSE4.2 crc32 instruction is used instead if the CPU
+ * supports it (see oskar_crc_set_accelerated()).
+ * Large blocks of data are split into segments that are checksummed
+ * in parallel, if OpenMP is available, and the results combined.
+ *
  * @param[in] crc_data  Pointer to CRC data table, which defines the type.
  * @param[in] crc       CRC code to update.
  * @param[in] data      Pointer to data block to use.
@@ -190,6 +190,12 @@ struct oskar_Binary
     unsigned long* crc;         /* CRC-32C code. */
     unsigned long* crc_header;  /* CRC-32C code of payload identifier. */
 
+    /* Hash index of tags, keyed on group, tag and user index
+     * (and names, for extended tags). */
+    int hash_size;              /* Number of slots (a power of two). */
+    int* hash_table;            /* First tag with each key, or -1 if empty. */
+    int* hash_next;             /* Next tag with the same key, or -1. */
+
     /* Data tables used for CRC computation. */
     oskar_CRC* crc_data;
 };
@@ -199,6 +205,9 @@ struct oskar_Binary
 typedef struct oskar_Binary oskar_Binary;
 #endif /* OSKAR_BINARY_TYPEDEF_ */
 
+/* Builds the hash index of the tags in the handle (private). */
+void oskar_binary_build_index(oskar_Binary* handle, int* status);
+
 #ifdef __cplusplus
 }
 #endif
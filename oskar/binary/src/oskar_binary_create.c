@@ -39,6 +39,13 @@ extern "C" {
 
 #define MIN(X,Y) ((X) < (Y) ? (X) : (Y))
 
+/* Sizes of reads used when scanning tags: the larger size is used while
+ * tags are packed closely enough to be found in consecutive reads. */
+#define SCAN_READ_SMALL 4096
+#define SCAN_READ_LARGE 65536
+
+static const char* oskar_binary_scan(FILE* stream, long offset, size_t len,
+        char* buf, long* buf_start, size_t* buf_len);
 static void oskar_binary_resize(oskar_Binary* handle, int m);
 static void oskar_binary_read_header(FILE* stream, oskar_BinaryHeader* header,
         int* status);
@@ -51,6 +58,9 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
     oskar_Binary* handle;
     oskar_BinaryHeader header;
     FILE* stream;
+    char* buf;
+    long offset, buf_start = 0;
+    size_t buf_len = 0;
     int i;
 
     /* Open the file and check or write the header, depending on the mode. */
@@ -97,6 +107,12 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
 
     /* Allocate index and store the stream handle. */
     handle = (oskar_Binary*) malloc(sizeof(oskar_Binary));
+    if (!handle)
+    {
+        fclose(stream);
+        *status = OSKAR_ERR_BINARY_MEMORY_ALLOC_FAILURE;
+        return 0;
+    }
     handle->stream = stream;
     handle->open_mode = mode;
     handle->query_search_start = 0;
@@ -118,6 +134,9 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
     handle->block_size_bytes = 0;
     handle->crc = 0;
     handle->crc_header = 0;
+    handle->hash_size = 0;
+    handle->hash_table = 0;
+    handle->hash_next = 0;
 
     /* Store the contents of the header for later use. */
     handle->bin_version = header.bin_version;
@@ -126,17 +145,29 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
     if (mode == 'w')
         return handle;
 
-    /* Read all tags in the stream. */
+    /* Read all tags in the stream, using buffered reads from the
+     * current position so that small chunks need no extra I/O. */
+    buf = (char*) malloc(SCAN_READ_LARGE);
+    if (!buf)
+    {
+        *status = OSKAR_ERR_BINARY_MEMORY_ALLOC_FAILURE;
+        return handle;
+    }
+    offset = ftell(stream);
     for (i = 0;; ++i)
     {
         oskar_BinaryTag tag;
+        const char* p;
         unsigned long crc;
         int format_version, element_size;
         size_t memcpy_size = 0;
 
         /* Try to read a tag, and end the loop if unsuccessful. */
-        if (fread(&tag, sizeof(oskar_BinaryTag), 1, stream) != 1)
-            break;
+        p = oskar_binary_scan(stream, offset, sizeof(oskar_BinaryTag),
+                buf, &buf_start, &buf_len);
+        if (!p) break;
+        memcpy(&tag, p, sizeof(oskar_BinaryTag));
+        offset += sizeof(oskar_BinaryTag);
 
         /* If the bytes read are not a tag, or the reserved flag bits
          * are not zero, then return an error. */
@@ -252,11 +283,16 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
             handle->name_tag[i]   = (char*) malloc(tag.tag.bytes);
 
             /* Store the tag names. */
-            if (fread(handle->name_group[i], tag.group.bytes, 1, stream) != 1)
-                *status = OSKAR_ERR_BINARY_FILE_INVALID;
-            if (fread(handle->name_tag[i], tag.tag.bytes, 1, stream) != 1)
+            p = oskar_binary_scan(stream, offset,
+                    tag.group.bytes + tag.tag.bytes, buf, &buf_start, &buf_len);
+            if (!p)
+            {
                 *status = OSKAR_ERR_BINARY_FILE_INVALID;
-            if (*status) break;
+                break;
+            }
+            memcpy(handle->name_group[i], p, tag.group.bytes);
+            memcpy(handle->name_tag[i], p + tag.group.bytes, tag.tag.bytes);
+            offset += (tag.group.bytes + tag.tag.bytes);
 
             /* Update the CRC code. */
             crc = oskar_crc_update(handle->crc_data, crc,
@@ -265,25 +301,24 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
                     handle->name_tag[i], tag.tag.bytes);
         }
 
-        /* Store the current stream pointer as the payload offset. */
-        handle->payload_offset_bytes[i] = ftell(stream);
-
-        /* Increment stream pointer by payload size. */
-        if (fseek(stream, (long int) handle->payload_size_bytes[i], SEEK_CUR))
-        {
-            *status = OSKAR_ERR_BINARY_FILE_INVALID;
-            break;
-        }
+        /* Store the current offset as the payload offset,
+         * and skip the payload. */
+        handle->payload_offset_bytes[i] = offset;
+        offset += (long int) handle->payload_size_bytes[i];
 
         /* Store header CRC code and get file CRC code in native byte order. */
         handle->crc_header[i] = crc;
         if (tag.flags & (1 << 6))
         {
-            if (fread(&handle->crc[i], 4, 1, stream) != 1)
+            p = oskar_binary_scan(stream, offset, 4,
+                    buf, &buf_start, &buf_len);
+            if (!p)
             {
                 *status = OSKAR_ERR_BINARY_FILE_INVALID;
                 break;
             }
+            memcpy(&handle->crc[i], p, 4);
+            offset += 4;
 
             if (oskar_endian() != OSKAR_LITTLE_ENDIAN)
                 oskar_endian_swap(&handle->crc[i], sizeof(unsigned long));
@@ -292,10 +327,33 @@ oskar_Binary* oskar_binary_create(const char* filename, char mode, int* status)
         /* Save the number of tags read from the stream. */
         handle->num_chunks = i + 1;
     }
+    free(buf);
 
+    /* Build the hash index used to look up tags. */
+    oskar_binary_build_index(handle, status);
     return handle;
 }
 
+/* Returns a pointer to len bytes of the stream at offset, reading into
+ * the buffer if they are not there already, or NULL if they can't be read. */
+static const char* oskar_binary_scan(FILE* stream, long offset, size_t len,
+        char* buf, long* buf_start, size_t* buf_len)
+{
+    if (offset < *buf_start ||
+            offset + (long) len > *buf_start + (long) *buf_len)
+    {
+        const size_t read_size = (offset == *buf_start + (long) *buf_len) ?
+                SCAN_READ_LARGE : SCAN_READ_SMALL;
+        if (len > read_size || fseek(stream, offset, SEEK_SET))
+            return 0;
+        *buf_start = offset;
+        *buf_len = fread(buf, 1, read_size, stream);
+        if (*buf_len < len)
+            return 0;
+    }
+    return buf + (offset - *buf_start);
+}
+
 static void oskar_binary_resize(oskar_Binary* handle, int m)
 {
     handle->extended = (int*) realloc(handle->extended, m * sizeof(int));
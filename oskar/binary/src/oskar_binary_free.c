@@ -65,6 +65,8 @@ void oskar_binary_free(oskar_Binary* handle)
     free(handle->block_size_bytes);
     free(handle->crc);
     free(handle->crc_header);
+    free(handle->hash_table);
+    free(handle->hash_next);
 
     /* Free the CRC data. */
     oskar_crc_free(handle->crc_data);
@@ -35,6 +35,132 @@
 extern "C" {
 #endif
 
+static unsigned int hash_mix(unsigned int h, unsigned int value)
+{
+    /* FNV-1a, one byte at a time. */
+    int i;
+    for (i = 0; i < 4; ++i, value >>= 8)
+    {
+        h ^= (value & 0xFF);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned int hash_key(int extended, int id_group, int id_tag,
+        int user_index, const char* name_group, const char* name_tag)
+{
+    unsigned int h = 2166136261u;
+    h = hash_mix(h, (unsigned int) extended);
+    h = hash_mix(h, (unsigned int) id_group);
+    h = hash_mix(h, (unsigned int) id_tag);
+    h = hash_mix(h, (unsigned int) user_index);
+    if (extended)
+    {
+        for (; *name_group; ++name_group)
+            h = (h ^ (unsigned char) *name_group) * 16777619u;
+        for (; *name_tag; ++name_tag)
+            h = (h ^ (unsigned char) *name_tag) * 16777619u;
+    }
+    return h;
+}
+
+static int key_matches(const oskar_Binary* handle, int i, int extended,
+        int id_group, int id_tag, int user_index,
+        const char* name_group, const char* name_tag)
+{
+    if (handle->extended[i] != extended ||
+            handle->id_group[i] != id_group ||
+            handle->id_tag[i] != id_tag ||
+            handle->user_index[i] != user_index)
+        return 0;
+    if (extended && (strcmp(name_group, handle->name_group[i]) ||
+            strcmp(name_tag, handle->name_tag[i])))
+        return 0;
+    return 1;
+}
+
+/* Returns the hash table slot for the key: either the slot holding the
+ * first tag with the key, or the empty slot where it would go. */
+static int find_slot(const oskar_Binary* handle, int extended,
+        int id_group, int id_tag, int user_index,
+        const char* name_group, const char* name_tag)
+{
+    const unsigned int mask = (unsigned int) handle->hash_size - 1;
+    unsigned int slot = hash_key(extended, id_group, id_tag, user_index,
+            name_group, name_tag) & mask;
+    for (;; slot = (slot + 1) & mask)
+    {
+        const int i = handle->hash_table[slot];
+        if (i < 0 || key_matches(handle, i, extended, id_group, id_tag,
+                user_index, name_group, name_tag))
+            return (int) slot;
+    }
+}
+
+/* Returns the index of the first tag at or after the search start with
+ * the given key and data type (any type, if zero), or -1 if not found. */
+static int find_tag(const oskar_Binary* handle, unsigned char data_type,
+        int extended, int id_group, int id_tag, int user_index,
+        const char* name_group, const char* name_tag)
+{
+    int i;
+    if (handle->hash_size == 0) return -1;
+    i = handle->hash_table[find_slot(handle, extended, id_group, id_tag,
+            user_index, name_group, name_tag)];
+
+    /* Tags with the same key are chained in order of their index. */
+    for (; i >= 0; i = handle->hash_next[i])
+    {
+        if (i >= handle->query_search_start &&
+                ((handle->data_type[i] == (int) data_type) || (!data_type)))
+            return i;
+    }
+    return -1;
+}
+
+void oskar_binary_build_index(oskar_Binary* handle, int* status)
+{
+    int i, *last = 0, size = 16;
+
+    /* Keep the table no more than half full. */
+    while (size < 2 * handle->num_chunks) size *= 2;
+    free(handle->hash_table);
+    free(handle->hash_next);
+    handle->hash_size = size;
+    handle->hash_table = (int*) malloc(size * sizeof(int));
+    handle->hash_next = (int*) malloc((handle->num_chunks + 1) * sizeof(int));
+    last = (int*) malloc(size * sizeof(int));
+    if (!handle->hash_table || !handle->hash_next || !last)
+    {
+        free(handle->hash_table);
+        free(handle->hash_next);
+        free(last);
+        handle->hash_size = 0;
+        handle->hash_table = 0;
+        handle->hash_next = 0;
+        if (!*status) *status = OSKAR_ERR_BINARY_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+    for (i = 0; i < size; ++i)
+        handle->hash_table[i] = -1;
+
+    /* Add each tag to the end of the chain for its key. */
+    for (i = 0; i < handle->num_chunks; ++i)
+    {
+        const int slot = find_slot(handle, handle->extended[i],
+                handle->id_group[i], handle->id_tag[i], handle->user_index[i],
+                handle->name_group[i], handle->name_tag[i]);
+        handle->hash_next[i] = -1;
+        if (handle->hash_table[slot] < 0)
+            handle->hash_table[slot] = i;
+        else
+            handle->hash_next[last[slot]] = i;
+        last[slot] = i;
+    }
+    free(last);
+}
+
 int oskar_binary_num_tags(const oskar_Binary* handle)
 {
     return handle->num_chunks;
@@ -63,21 +189,11 @@ int oskar_binary_query(const oskar_Binary* handle,
     if (*status) return 0;
 
     /* Find the tag in the index. */
-    for (i = handle->query_search_start; i < handle->num_chunks; ++i)
-    {
-        if (!(handle->extended[i]) &&
-                ((handle->data_type[i] == (int) data_type) || (!data_type)) &&
-                handle->id_group[i] == (int) id_group &&
-                handle->id_tag[i] == (int) id_tag &&
-                handle->user_index[i] == user_index)
-        {
-            /* Match found, so break. */
-            break;
-        }
-    }
+    i = find_tag(handle, data_type, 0, (int) id_group, (int) id_tag,
+            user_index, 0, 0);
 
     /* Check if tag is not present. */
-    if (i >= handle->num_chunks)
+    if (i < 0)
     {
         *status = OSKAR_ERR_BINARY_TAG_NOT_FOUND;
         return -1;
@@ -106,27 +222,11 @@ int oskar_binary_query_ext(const oskar_Binary* handle,
     }
 
     /* Find the tag in the index. */
-    for (i = handle->query_search_start; i < handle->num_chunks; ++i)
-    {
-        if (handle->extended[i] &&
-                ((handle->data_type[i] == (int) data_type) || (!data_type)) &&
-                handle->id_group[i] == (int) lgroup &&
-                handle->id_tag[i] == (int) ltag &&
-                handle->user_index[i] == user_index)
-        {
-            /* Possible match: check names. */
-            if (strcmp(name_group, handle->name_group[i]))
-                continue;
-            if (strcmp(name_tag, handle->name_tag[i]))
-                continue;
-
-            /* Match found, so break. */
-            break;
-        }
-    }
+    i = find_tag(handle, data_type, 1, lgroup, ltag, user_index,
+            name_group, name_tag);
 
     /* Check if tag is not present. */
-    if (i >= handle->num_chunks)
+    if (i < 0)
     {
         *status = OSKAR_ERR_BINARY_TAG_NOT_FOUND;
         return -1;
@@ -31,6 +31,28 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Use the SSE4.2 crc32 instruction (and PCLMULQDQ, to combine interleaved
+ * streams) if the compiler allows it: the CPU is checked at run time. */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CRC_HAVE_HW 1
+#define CRC_TARGET_HW __attribute__((target("sse4.2,pclmul")))
+#include <stdint.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+/* Length of each of the three interleaved streams in the hardware path. */
+#define CRC_HW_STREAM_BYTES 1024
+
+/* Length of segments checksummed in parallel, and the minimum number of
+ * segments for it to be worth doing. */
+#define CRC_SEGMENT_BYTES (1 << 20)
+#define CRC_MIN_SEGMENTS 4
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -38,9 +60,12 @@ extern "C" {
 struct oskar_CRC
 {
     int type;
+    int accelerated;
     unsigned long poly;
     unsigned long init;
     unsigned long xorout;
+    unsigned long x2n[64]; /* x^(2^n) modulo the 32-bit polynomial. */
+    unsigned long hw_shift; /* Constant used to combine hardware streams. */
     unsigned long t[8][256];
 };
 #ifndef OSKAR_CRC_TYPEDEF_
@@ -48,6 +73,161 @@ struct oskar_CRC
 typedef struct oskar_CRC oskar_CRC;
 #endif /* OSKAR_CRC_TYPEDEF_ */
 
+static int crc_hw_supported(void)
+{
+#ifdef CRC_HAVE_HW
+    static int supported = -1;
+    if (supported < 0)
+    {
+        __builtin_cpu_init();
+        supported = (__builtin_cpu_supports("sse4.2") &&
+                __builtin_cpu_supports("pclmul")) ? 1 : 0;
+    }
+    return supported;
+#else
+    return 0;
+#endif
+}
+
+/* Returns a * b modulo the (reflected) 32-bit polynomial. */
+static unsigned long crc_multiply(unsigned long poly,
+        unsigned long a, unsigned long b)
+{
+    unsigned long m = 1uL << 31, p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+    }
+    return p;
+}
+
+/* Returns x^n modulo the (reflected) 32-bit polynomial. */
+static unsigned long crc_x_pow(const oskar_CRC* d, size_t n)
+{
+    unsigned long p = 1uL << 31;
+    int k;
+    for (k = 0; n; n >>= 1, ++k)
+        if (n & 1) p = crc_multiply(d->poly, d->x2n[k], p);
+    return p;
+}
+
+/* Slicing-by-8 update of the unconditioned CRC value. */
+static unsigned long crc_table(const oskar_CRC* crc_data, unsigned long crc,
+        const unsigned char* byte, size_t num_bytes)
+{
+    unsigned char d[8];
+
+    /* Use 8-byte chunks. */
+    if (oskar_endian() == OSKAR_LITTLE_ENDIAN)
+    {
+        while (num_bytes >= 8)
+        {
+            num_bytes -= 8;
+            memcpy(d, byte, 8);
+            byte += 8;
+            d[0] ^= crc         & 0xFF;
+            d[1] ^= (crc >> 8)  & 0xFF;
+            d[2] ^= (crc >> 16) & 0xFF;
+            d[3] ^= (crc >> 24) & 0xFF;
+            crc =   crc_data->t[0][d[7]] ^ crc_data->t[1][d[6]] ^
+                    crc_data->t[2][d[5]] ^ crc_data->t[3][d[4]] ^
+                    crc_data->t[4][d[3]] ^ crc_data->t[5][d[2]] ^
+                    crc_data->t[6][d[1]] ^ crc_data->t[7][d[0]];
+        }
+    }
+    else
+    {
+        while (num_bytes >= 8)
+        {
+            num_bytes -= 8;
+            memcpy(d, byte, 8);
+            byte += 8;
+            d[0] ^= (crc >> 24) & 0xFF;
+            d[1] ^= (crc >> 16) & 0xFF;
+            d[2] ^= (crc >> 8)  & 0xFF;
+            d[3] ^= crc         & 0xFF;
+            crc =   crc_data->t[0][d[4]] ^ crc_data->t[1][d[5]] ^
+                    crc_data->t[2][d[6]] ^ crc_data->t[3][d[7]] ^
+                    crc_data->t[4][d[0]] ^ crc_data->t[5][d[1]] ^
+                    crc_data->t[6][d[2]] ^ crc_data->t[7][d[3]];
+        }
+    }
+
+    /* Must do remaining bytes individually. */
+    while (num_bytes--)
+        crc = (crc >> 8) ^ crc_data->t[0][(crc & 0xFF) ^ *byte++];
+    return crc;
+}
+
+#ifdef CRC_HAVE_HW
+/* Returns crc * x^(8 * CRC_HW_STREAM_BYTES) modulo the polynomial. */
+CRC_TARGET_HW
+static inline uint64_t crc_hw_shift(uint64_t crc, uint64_t k)
+{
+    const __m128i t = _mm_clmulepi64_si128(
+            _mm_cvtsi64_si128((long long) crc),
+            _mm_cvtsi64_si128((long long) k), 0);
+    return _mm_crc32_u64(0, (uint64_t) _mm_cvtsi128_si64(t));
+}
+
+CRC_TARGET_HW
+static inline uint64_t crc_hw_load(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+/* Hardware update of the unconditioned CRC-32C value, using three
+ * interleaved streams to hide the latency of the crc32 instruction. */
+CRC_TARGET_HW
+static unsigned long crc_hw(const oskar_CRC* crc_data, unsigned long crc,
+        const unsigned char* byte, size_t num_bytes)
+{
+    const size_t n = CRC_HW_STREAM_BYTES;
+    uint64_t c0 = crc;
+    size_t i;
+    while (num_bytes && ((uintptr_t) byte & 7))
+    {
+        c0 = _mm_crc32_u8((unsigned int) c0, *byte++);
+        num_bytes--;
+    }
+    for (; num_bytes >= 3 * n; num_bytes -= 3 * n, byte += 3 * n)
+    {
+        uint64_t c1 = 0, c2 = 0;
+        for (i = 0; i < n; i += 8)
+        {
+            c0 = _mm_crc32_u64(c0, crc_hw_load(byte + i));
+            c1 = _mm_crc32_u64(c1, crc_hw_load(byte + n + i));
+            c2 = _mm_crc32_u64(c2, crc_hw_load(byte + 2 * n + i));
+        }
+        c0 = crc_hw_shift(c0, crc_data->hw_shift) ^ c1;
+        c0 = crc_hw_shift(c0, crc_data->hw_shift) ^ c2;
+    }
+    for (; num_bytes >= 8; num_bytes -= 8, byte += 8)
+        c0 = _mm_crc32_u64(c0, crc_hw_load(byte));
+    while (num_bytes--)
+        c0 = _mm_crc32_u8((unsigned int) c0, *byte++);
+    return (unsigned long) c0;
+}
+#endif
+
+static unsigned long crc_raw(const oskar_CRC* crc_data, unsigned long crc,
+        const unsigned char* byte, size_t num_bytes)
+{
+#ifdef CRC_HAVE_HW
+    if (crc_data->accelerated)
+        return crc_hw(crc_data, crc, byte, num_bytes);
+#endif
+    return crc_table(crc_data, crc, byte, num_bytes);
+}
+
 
 oskar_CRC* oskar_crc_create(int type)
 {
@@ -55,7 +235,7 @@ oskar_CRC* oskar_crc_create(int type)
     oskar_CRC* d;
 
     /* Create the data structure. */
-    d = (oskar_CRC*) malloc(sizeof(oskar_CRC));
+    d = (oskar_CRC*) calloc(1, sizeof(oskar_CRC));
     d->type = type;
 
     /* Set the polynomial, initial and post-XOR values based on type. */
@@ -104,9 +284,35 @@ oskar_CRC* oskar_crc_create(int type)
         }
     }
 
+    /* Store x^(2^n) modulo the polynomial, to combine 32-bit CRC values.
+     * Multiplying by x^(8m - 33) before the crc32 instruction shifts a
+     * CRC-32C value by m zero bytes. */
+    if (type == OSKAR_CRC_32 || type == OSKAR_CRC_32C)
+    {
+        d->x2n[0] = 1uL << 30;
+        for (i = 1; i < 64; ++i)
+            d->x2n[i] = crc_multiply(d->poly, d->x2n[i - 1], d->x2n[i - 1]);
+    }
+    if (type == OSKAR_CRC_32C)
+    {
+        d->hw_shift = crc_x_pow(d, 8 * CRC_HW_STREAM_BYTES - 33);
+        d->accelerated = crc_hw_supported();
+    }
+
     return d;
 }
 
+int oskar_crc_accelerated(const oskar_CRC* crc_data)
+{
+    return crc_data->accelerated;
+}
+
+void oskar_crc_set_accelerated(oskar_CRC* crc_data, int value)
+{
+    crc_data->accelerated = (value && crc_data->type == OSKAR_CRC_32C) ?
+            crc_hw_supported() : 0;
+}
+
 void oskar_crc_free(oskar_CRC* data)
 {
     free(data);
@@ -115,52 +321,43 @@ void oskar_crc_free(oskar_CRC* data)
 unsigned long oskar_crc_update(const oskar_CRC* crc_data, unsigned long crc,
         const void* data, size_t num_bytes)
 {
-    const unsigned char* byte;
-    unsigned char d[8];
-
-    /* Use 8-byte chunks. */
+    const unsigned char* byte = (const unsigned char*) data;
     if (crc != crc_data->init) crc ^= crc_data->xorout;
-    byte = (const unsigned char*) data;
-    if (oskar_endian() == OSKAR_LITTLE_ENDIAN)
-    {
-        while (num_bytes >= 8)
-        {
-            num_bytes -= 8;
-            memcpy(d, byte, 8);
-            byte += 8;
-            d[0] ^= crc         & 0xFF;
-            d[1] ^= (crc >> 8)  & 0xFF;
-            d[2] ^= (crc >> 16) & 0xFF;
-            d[3] ^= (crc >> 24) & 0xFF;
-            crc =   crc_data->t[0][d[7]] ^ crc_data->t[1][d[6]] ^
-                    crc_data->t[2][d[5]] ^ crc_data->t[3][d[4]] ^
-                    crc_data->t[4][d[3]] ^ crc_data->t[5][d[2]] ^
-                    crc_data->t[6][d[1]] ^ crc_data->t[7][d[0]];
-        }
-    }
-    else
+
+    /* Checksum large blocks of data in parallel segments, if possible,
+     * then combine them: crc(A + B) = crc(A) * x^(8 * len(B)) + crc(B). */
+#ifdef _OPENMP
+    unsigned long* seg_crc = 0;
+    if (crc_data->type != OSKAR_CRC_8_EBU &&
+            num_bytes >= CRC_MIN_SEGMENTS * (size_t) CRC_SEGMENT_BYTES &&
+            omp_get_max_threads() > 1)
+        seg_crc = (unsigned long*) malloc(sizeof(unsigned long) *
+                ((num_bytes + CRC_SEGMENT_BYTES - 1) / CRC_SEGMENT_BYTES));
+    if (seg_crc)
     {
-        while (num_bytes >= 8)
+        const size_t seg = CRC_SEGMENT_BYTES;
+        const int num_segments = (int) ((num_bytes + seg - 1) / seg);
+        const size_t last_bytes = num_bytes - (num_segments - 1) * seg;
+        unsigned long shift;
+        int i;
+#pragma omp parallel for
+        for (i = 0; i < num_segments; ++i)
         {
-            num_bytes -= 8;
-            memcpy(d, byte, 8);
-            byte += 8;
-            d[0] ^= (crc >> 24) & 0xFF;
-            d[1] ^= (crc >> 16) & 0xFF;
-            d[2] ^= (crc >> 8)  & 0xFF;
-            d[3] ^= crc         & 0xFF;
-            crc =   crc_data->t[0][d[4]] ^ crc_data->t[1][d[5]] ^
-                    crc_data->t[2][d[6]] ^ crc_data->t[3][d[7]] ^
-                    crc_data->t[4][d[0]] ^ crc_data->t[5][d[1]] ^
-                    crc_data->t[6][d[2]] ^ crc_data->t[7][d[3]];
+            seg_crc[i] = crc_raw(crc_data, i == 0 ? crc : 0,
+                    byte + i * seg, i < num_segments - 1 ? seg : last_bytes);
         }
+        shift = crc_x_pow(crc_data, 8 * seg);
+        crc = seg_crc[0];
+        for (i = 1; i < num_segments - 1; ++i)
+            crc = crc_multiply(crc_data->poly, shift, crc) ^ seg_crc[i];
+        shift = crc_x_pow(crc_data, 8 * last_bytes);
+        crc = crc_multiply(crc_data->poly, shift, crc) ^
+                seg_crc[num_segments - 1];
+        free(seg_crc);
+        return crc ^ crc_data->xorout;
     }
-
-    /* Must do remaining bytes individually. */
-    while (num_bytes--)
-        crc = (crc >> 8) ^ crc_data->t[0][(crc & 0xFF) ^ *byte++];
-
-    return crc ^ crc_data->xorout;
+#endif
+    return crc_raw(crc_data, crc, byte, num_bytes) ^ crc_data->xorout;
 }
 
 unsigned long oskar_crc_compute(const oskar_CRC* crc_data, const void* data,
@@ -33,6 +33,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #define ASSERT_INT_EQ(V1, V2) \
     if (V1 != V2) \
     { \
@@ -179,6 +183,106 @@ int main(void)
     /* Remove the file. */
     remove(filename);
 
+    /* Check lookups in a file with many tags, including repeated keys. */
+    {
+        const int num_tags = 20000;
+        size_t size = 0;
+        double t = 0.0;
+        int j, k;
+        h = oskar_binary_create(filename, 'w', &status);
+        for (i = 0; i < num_tags; ++i)
+        {
+            oskar_binary_write_int(h, 1, 2, i, i, &status);
+            oskar_binary_write_ext_int(h, "group", "tag", i, -i, &status);
+        }
+        oskar_binary_write_double(h, 1, 2, 7, 7.5, &status);
+        oskar_binary_write_int(h, 1, 2, 7, 70, &status);
+        oskar_binary_free(h);
+        ASSERT_INT_EQ(0, status);
+
+        /* Read back in a scattered order. */
+        h = oskar_binary_create(filename, 'r', &status);
+        ASSERT_INT_EQ(2 * num_tags + 2, oskar_binary_num_tags(h));
+        for (i = 0, k = 0; i < num_tags; ++i, k = (k + 7919) % num_tags)
+        {
+            oskar_binary_read_int(h, 1, 2, k, &a, &status);
+            oskar_binary_read_ext_int(h, "group", "tag", k, &b, &status);
+            ASSERT_INT_EQ(0, status);
+            ASSERT_INT_EQ(k, a);
+            ASSERT_INT_EQ(-k, b);
+        }
+        oskar_binary_read_ext_int(h, "group", "ta", 3, &b, &status);
+        ASSERT_INT_EQ((int) OSKAR_ERR_BINARY_TAG_NOT_FOUND, status);
+        status = 0;
+
+        /* Check matching by data type, and from a search start index. */
+        oskar_binary_read_double(h, 1, 2, 7, &t, &status);
+        ASSERT_INT_EQ(0, status);
+        ASSERT_DOUBLE_EQ(7.5, t);
+        j = oskar_binary_query(h, 0, 1, 2, 7, &size, &status);
+        ASSERT_INT_EQ(14, j);
+        ASSERT_INT_EQ((int) sizeof(int), (int) size);
+        oskar_binary_set_query_search_start(h, j + 1, &status);
+        j = oskar_binary_query(h, 0, 1, 2, 7, &size, &status);
+        ASSERT_INT_EQ(2 * num_tags, j);
+        ASSERT_INT_EQ((int) sizeof(double), (int) size);
+        oskar_binary_read_int(h, 1, 2, 7, &a, &status);
+        ASSERT_INT_EQ(0, status);
+        ASSERT_INT_EQ(70, a);
+        oskar_binary_read_int(h, 1, 2, 6, &a, &status);
+        ASSERT_INT_EQ((int) OSKAR_ERR_BINARY_TAG_NOT_FOUND, status);
+        status = 0;
+        oskar_binary_free(h);
+        remove(filename);
+    }
+
+    /* Check a record large enough to have its CRC computed in parallel
+     * segments, and that a corrupted byte is detected when it is read. */
+    {
+        const size_t num_bytes = 6 << 20;
+        unsigned char *data, *copy;
+        FILE* file;
+        long offset = 0;
+#ifdef _OPENMP
+        omp_set_num_threads(4);
+#endif
+        data = (unsigned char*) malloc(num_bytes);
+        copy = (unsigned char*) calloc(num_bytes, 1);
+        for (i = 0; i < (int) num_bytes; ++i)
+            data[i] = (unsigned char) ((i * 2654435761u) >> 13);
+        h = oskar_binary_create(filename, 'w', &status);
+        oskar_binary_write(h, OSKAR_CHAR, 3, 4, 5, num_bytes, data, &status);
+        ASSERT_INT_EQ(0, status);
+        oskar_binary_free(h);
+
+        /* Read the record back. */
+        h = oskar_binary_create(filename, 'r', &status);
+        oskar_binary_read(h, OSKAR_CHAR, 3, 4, 5, num_bytes, copy, &status);
+        ASSERT_INT_EQ(0, status);
+        ASSERT_INT_EQ(0, memcmp(data, copy, num_bytes));
+        oskar_binary_free(h);
+
+        /* Flip a byte in the middle of the payload and read it again. */
+        file = fopen(filename, "r+b");
+        if (file && fseek(file, 0, SEEK_END) == 0)
+            offset = ftell(file) - 4 - (long) (num_bytes / 2);
+        if (!file || offset <= 0 || fseek(file, offset, SEEK_SET) != 0)
+        {
+            printf("Unable to modify test file (%s:%i)\n", __FILE__, __LINE__);
+            exit(1);
+        }
+        fputc(data[num_bytes - num_bytes / 2] ^ 0xFF, file);
+        fclose(file);
+        h = oskar_binary_create(filename, 'r', &status);
+        oskar_binary_read(h, OSKAR_CHAR, 3, 4, 5, num_bytes, copy, &status);
+        ASSERT_INT_EQ((int) OSKAR_ERR_BINARY_CRC_FAIL, status);
+        status = 0;
+        oskar_binary_free(h);
+        remove(filename);
+        free(data);
+        free(copy);
+    }
+
     printf("PASS: Test_binary OK.\n");
     return 0;
 }
@@ -0,0 +1,160 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "binary/oskar_crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define ASSERT_CRC_EQ(V1, V2) \
+    if (V1 != V2) \
+    { \
+        printf("Assert: 0x%08lx != 0x%08lx (%s:%i)\n", \
+                (unsigned long) V1, (unsigned long) V2, __FILE__, __LINE__); \
+        exit(1); \
+    }
+
+static double wall_time(void)
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Bit-at-a-time reference implementation. */
+static unsigned long crc_ref(unsigned long poly, unsigned long init,
+        unsigned long xorout, const unsigned char* data, size_t num_bytes)
+{
+    unsigned long crc = init;
+    size_t i;
+    int j;
+    for (i = 0; i < num_bytes; ++i)
+    {
+        crc ^= data[i];
+        for (j = 0; j < 8; ++j)
+            crc = (crc >> 1) ^ ((crc & 1) * poly);
+    }
+    return crc ^ xorout;
+}
+
+/* Returns the time taken to checksum the data a number of times,
+ * and stores the last value computed. */
+static double benchmark(const oskar_CRC* crc_data, const unsigned char* data,
+        size_t num_bytes, int num_iter, unsigned long* crc)
+{
+    int i;
+    double start = wall_time();
+    for (i = 0; i < num_iter; ++i)
+        *crc = oskar_crc_compute(crc_data, data, num_bytes);
+    return wall_time() - start;
+}
+
+int main(void)
+{
+    const char check[] = "123456789";
+    const size_t max_bytes = 16 << 20;
+    const size_t lengths[] = {0, 1, 7, 8, 9, 100, 3071, 3072, 3073,
+            10000, 123457};
+    unsigned char* data;
+    oskar_CRC *crc_32c, *crc_32, *crc_8;
+    unsigned long crc1, crc2;
+    size_t i, j;
+
+    /* Create some test data. */
+    data = (unsigned char*) malloc(max_bytes);
+    srand(2);
+    for (i = 0; i < max_bytes; ++i)
+        data[i] = (unsigned char) (rand() & 0xFF);
+
+    /* Check the standard check values. */
+    crc_32c = oskar_crc_create(OSKAR_CRC_32C);
+    crc_32 = oskar_crc_create(OSKAR_CRC_32);
+    crc_8 = oskar_crc_create(OSKAR_CRC_8_EBU);
+    ASSERT_CRC_EQ(0xE3069283uL, oskar_crc_compute(crc_32c, check, 9));
+    ASSERT_CRC_EQ(0xCBF43926uL, oskar_crc_compute(crc_32, check, 9));
+    ASSERT_CRC_EQ(0x97uL, oskar_crc_compute(crc_8, check, 9));
+
+    /* Check both CRC-32C versions against the reference, at all offsets
+     * and lengths around the stream boundaries, and with updates. */
+    for (j = 0; j < 2; ++j)
+    {
+        oskar_crc_set_accelerated(crc_32c, (int) j);
+        for (i = 0; i < sizeof(lengths) / sizeof(size_t); ++i)
+        {
+            size_t k, off;
+            for (off = 0; off < 8; ++off)
+            {
+                crc1 = oskar_crc_compute(crc_32c, data + off, lengths[i]);
+                crc2 = crc_ref(0x82f63b78uL, 0xFFFFFFFFuL, 0xFFFFFFFFuL,
+                        data + off, lengths[i]);
+                ASSERT_CRC_EQ(crc2, crc1);
+            }
+            k = lengths[i] / 3;
+            crc1 = oskar_crc_compute(crc_32c, data, k);
+            crc1 = oskar_crc_update(crc_32c, crc1, data + k, lengths[i] - k);
+            crc2 = crc_ref(0x82f63b78uL, 0xFFFFFFFFuL, 0xFFFFFFFFuL,
+                    data, lengths[i]);
+            ASSERT_CRC_EQ(crc2, crc1);
+        }
+    }
+
+    /* Check large blocks, using more than one thread so that they are
+     * split into parallel segments. */
+#ifdef _OPENMP
+    omp_set_num_threads(4);
+#endif
+    oskar_crc_set_accelerated(crc_32c, 0);
+    crc1 = oskar_crc_compute(crc_32c, data, max_bytes - 5);
+    crc2 = crc_ref(0x82f63b78uL, 0xFFFFFFFFuL, 0xFFFFFFFFuL,
+            data, max_bytes - 5);
+    ASSERT_CRC_EQ(crc2, crc1);
+    oskar_crc_set_accelerated(crc_32c, 1);
+    crc1 = oskar_crc_compute(crc_32c, data, max_bytes - 5);
+    ASSERT_CRC_EQ(crc2, crc1);
+    crc1 = oskar_crc_compute(crc_32c, data, 5);
+    crc1 = oskar_crc_update(crc_32c, crc1, data + 5, max_bytes - 10);
+    ASSERT_CRC_EQ(crc2, crc1);
+    crc1 = oskar_crc_compute(crc_32, data, max_bytes - 5);
+    crc2 = crc_ref(0xedb88320uL, 0xFFFFFFFFuL, 0xFFFFFFFFuL,
+            data, max_bytes - 5);
+    ASSERT_CRC_EQ(crc2, crc1);
+#ifdef _OPENMP
+    omp_set_num_threads(1);
+    crc1 = oskar_crc_compute(crc_32, data, max_bytes - 5);
+    ASSERT_CRC_EQ(crc2, crc1);
+#endif
+
+    /* Compare speed of the table and hardware versions. */
+    {
+        const size_t sizes[] = {1024, 65536, max_bytes};
+        for (i = 0; i < sizeof(sizes) / sizeof(size_t); ++i)
+        {
+            const int num_iter = (int) (((size_t) 128 << 20) / sizes[i]);
+            double t_table, t_hw;
+            oskar_crc_set_accelerated(crc_32c, 0);
+            t_table = benchmark(crc_32c, data, sizes[i], num_iter, &crc1);
+            oskar_crc_set_accelerated(crc_32c, 1);
+            t_hw = benchmark(crc_32c, data, sizes[i], num_iter, &crc2);
+            ASSERT_CRC_EQ(crc1, crc2);
+            printf("CRC-32C, %9lu bytes: table %7.2f GB/s, "
+                    "%s %7.2f GB/s\n", (unsigned long) sizes[i],
+                    1e-9 * sizes[i] * num_iter / t_table,
+                    oskar_crc_accelerated(crc_32c) ? "SSE4.2" : "table",
+                    1e-9 * sizes[i] * num_iter / t_hw);
+        }
+    }
+
+    oskar_crc_free(crc_32c);
+    oskar_crc_free(crc_32);
+    oskar_crc_free(crc_8);
+    free(data);
+    printf("PASS: Test_crc OK.\n");
+    return 0;
+}
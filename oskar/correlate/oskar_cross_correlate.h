@@ -74,6 +74,40 @@ void oskar_cross_correlate(int num_sources,  const oskar_Jones* jones,
         double gast, double frequency_hz, int offset_out, oskar_Mem* vis,
         int* status);
 
+/**
+ * @brief Multiply a set of Jones matrices with a set of source brightness
+ * matrices to form visibilities, also applying the interferometer phase.
+ *
+ * @details
+ * This is the same as oskar_cross_correlate(), except that the supplied
+ * Jones matrices must not include the interferometer phase (Jones K).
+ * Instead, the phase is evaluated inside the correlator for each station
+ * and source, using the station (u,v,w) coordinates and the source (l,m,n)
+ * direction cosines in the sky model, so that Jones K does not need to be
+ * formed and joined with the other Jones terms first.
+ *
+ * This is currently only available for data in CPU memory.
+ *
+ * @param[in]  num_sources  Number of sources to use.
+ * @param[in]  jones        Set of Jones matrices, excluding Jones K.
+ * @param[in]  sky          Sky model.
+ * @param[in]  tel          Telescope model.
+ * @param[in]  u            Station u coordinates, in metres.
+ * @param[in]  v            Station v coordinates, in metres.
+ * @param[in]  w            Station w coordinates, in metres.
+ * @param[in]  gast         Greenwich apparent sidereal time, in radians.
+ * @param[in]  frequency_hz Current observation frequency, in Hz.
+ * @param[in]  offset_out   Output visibility start offset.
+ * @param[out] vis          Output visibility amplitudes.
+ * @param[in,out] status    Status return code.
+ */
+OSKAR_EXPORT
+void oskar_cross_correlate_with_phase(int num_sources,
+        const oskar_Jones* jones, const oskar_Sky* sky,
+        const oskar_Telescope* tel, const oskar_Mem* u, const oskar_Mem* v,
+        const oskar_Mem* w, double gast, double frequency_hz, int offset_out,
+        oskar_Mem* vis, int* status);
+
 #ifdef __cplusplus
 }
 #endif
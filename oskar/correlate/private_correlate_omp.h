@@ -0,0 +1,242 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_PRIVATE_CORRELATE_OMP_H_
+#define OSKAR_PRIVATE_CORRELATE_OMP_H_
+
+/**
+ * @file private_correlate_omp.h
+ *
+ * @details
+ * Helpers shared by the cache-blocked OpenMP cross-correlation functions.
+ *
+ * Stations are processed in blocks, and sources in tiles, so that the
+ * Jones matrices for a block of stations and a tile of sources stay in
+ * cache while they are correlated with those of every other station.
+ * The loop over sources in a tile is vectorised by the compiler, and
+ * an AVX2 version of each function is compiled (where supported by the
+ * compiler) and selected at run time if the CPU supports it.
+ */
+
+#include "correlate/define_correlate_utils.h"
+#include "math/private_vector_math_inline.h"
+#include "utility/oskar_kernel_macros.h"
+
+#include <cstdlib>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Number of sources in a tile, and maximum number of stations in a block. */
+#define XCORR_TILE_SOURCES 128
+#define XCORR_BLOCK_STATIONS 16
+
+/* Vectorise the loop over sources using OpenMP 4.0, if available. */
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define XCORR_SIMD DO_PRAGMA(omp simd)
+#define XCORR_SIMD_REDUCTION(...) DO_PRAGMA(omp simd reduction(+:__VA_ARGS__))
+#else
+#define XCORR_SIMD
+#define XCORR_SIMD_REDUCTION(...)
+#endif
+
+/* Compile an AVX2 version of each function if the compiler allows it. */
+#if (defined(__GNUC__) || defined(__clang__)) && \
+        (defined(__x86_64__) || defined(__i386__))
+#define XCORR_HAVE_AVX2 1
+#define XCORR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define XCORR_INLINE static inline __attribute__((always_inline))
+#else
+#define XCORR_INLINE static inline
+#endif
+
+static inline int xcorr_use_avx2()
+{
+#ifdef XCORR_HAVE_AVX2
+    static int use_avx2 = -1;
+    if (use_avx2 < 0)
+    {
+        __builtin_cpu_init();
+        use_avx2 = (__builtin_cpu_supports("avx2") &&
+                __builtin_cpu_supports("fma")) ? 1 : 0;
+    }
+    return use_avx2;
+#else
+    return 0;
+#endif
+}
+
+/* Returns the number of stations to process together in one block. */
+static inline int xcorr_block_size(int num_stations)
+{
+    int block_size = XCORR_BLOCK_STATIONS;
+#ifdef _OPENMP
+    /* Make sure there are enough blocks to keep all threads busy. */
+    const int num_threads = omp_get_max_threads();
+    while (block_size > 1 && num_stations < 4 * block_size * num_threads)
+        block_size /= 2;
+#endif
+    return block_size;
+}
+
+/* Terms that are common to all sources on a baseline. */
+template<typename REAL>
+struct XcorrBaseline
+{
+    REAL uu, vv, ww, uu2, vv2, uuvv; /* Bandwidth smearing and Gaussian. */
+    REAL du, dv, dw;                 /* Time-average smearing. */
+    int use;                         /* False if baseline is filtered out. */
+};
+
+/* Replaces a zero argument of sin(x) / x with one small enough that the
+ * result is exactly 1. A conditional expression here would be turned into
+ * a branch around the division, which would not vectorise. */
+XCORR_INLINE double xcorr_sinc_arg(const double x)
+{
+    return x + 1e-300 * (double) (x == 0.0);
+}
+
+XCORR_INLINE float xcorr_sinc_arg(const float x)
+{
+    return x + 1e-30f * (float) (x == 0.0f);
+}
+
+XCORR_INLINE double xcorr_sin(const double x)
+{
+    return oskar_vector_sin_d(x);
+}
+
+XCORR_INLINE float xcorr_sin(const float x)
+{
+    return oskar_vector_sin_f(x);
+}
+
+XCORR_INLINE double xcorr_exp(double x)
+{
+    return oskar_vector_exp_d(x);
+}
+
+XCORR_INLINE float xcorr_exp(float x)
+{
+    return oskar_vector_exp_f(x);
+}
+
+/* Copies the Jones matrices (or scalars) of N reals for a tile of sources
+ * at one station into N separate planes of a scratch buffer, so that they
+ * are loaded with unit stride in the vectorised loop over sources.
+ * This is also where the alignment declared by the vector types is lost,
+ * as the input array may not have been allocated with that alignment. */
+template<int N, typename REAL>
+XCORR_INLINE void xcorr_load_tile(const int num_in_tile,
+        const REAL* const RESTRICT in, REAL* const RESTRICT out)
+{
+    for (int j = 0; j < num_in_tile; ++j)
+        for (int k = 0; k < N; ++k)
+            out[k * XCORR_TILE_SOURCES + j] = in[N * j + k];
+}
+
+/* Evaluates the interferometer phase (Jones K) for a tile of sources at
+ * one station, multiplies it with the Jones matrices (or scalars) of N reals,
+ * and stores the products as N separate planes of a scratch buffer.
+ * The phase is formed in working precision, as by oskar_evaluate_jones_K(),
+ * but the sine and cosine are always evaluated in double precision, as the
+ * single-precision versions are only accurate for small arguments. */
+template<int N, typename REAL>
+XCORR_INLINE void xcorr_load_tile_phase(const int i_start,
+        const int num_in_tile, const REAL wavenumber,
+        const REAL u, const REAL v, const REAL w,
+        const REAL* const RESTRICT source_l,
+        const REAL* const RESTRICT source_m,
+        const REAL* const RESTRICT source_n,
+        const REAL* const RESTRICT in, REAL* const RESTRICT out)
+{
+    XCORR_SIMD
+    for (int j = 0; j < num_in_tile; ++j)
+    {
+        const int i = i_start + j;
+        const REAL phase = wavenumber * (u * source_l[i] +
+                v * source_m[i] + w * (source_n[i] - (REAL) 1));
+        double sin_phase, cos_phase;
+        oskar_vector_sincos_d((double) phase, &sin_phase, &cos_phase);
+        const REAL re = (REAL) cos_phase, im = (REAL) sin_phase;
+        for (int k = 0; k < N; k += 2)
+        {
+            const REAL x = in[N * j + k], y = in[N * j + k + 1];
+            out[k * XCORR_TILE_SOURCES + j]       = re * x - im * y;
+            out[(k + 1) * XCORR_TILE_SOURCES + j] = re * y + im * x;
+        }
+    }
+}
+
+/* Evaluates the terms for the baseline between stations SP and SQ. */
+template<bool TIME_SMEARING, typename REAL>
+XCORR_INLINE void xcorr_baseline_term(const int SP, const int SQ,
+        const REAL* const RESTRICT station_u,
+        const REAL* const RESTRICT station_v,
+        const REAL* const RESTRICT station_w,
+        const REAL* const RESTRICT station_x,
+        const REAL* const RESTRICT station_y,
+        const REAL uv_min_lambda, const REAL uv_max_lambda,
+        const REAL inv_wavelength, const REAL frac_bandwidth,
+        const REAL time_int_sec, const REAL gha0_rad, const REAL dec0_rad,
+        XcorrBaseline<REAL>& t)
+{
+    REAL uv_len;
+    OSKAR_BASELINE_TERMS(REAL, station_u[SP], station_u[SQ],
+            station_v[SP], station_v[SQ], station_w[SP], station_w[SQ],
+            t.uu, t.vv, t.ww, t.uu2, t.vv2, t.uuvv, uv_len);
+    t.use = !(uv_len < uv_min_lambda || uv_len > uv_max_lambda);
+    if (TIME_SMEARING)
+        OSKAR_BASELINE_DELTAS(REAL, station_x[SP], station_x[SQ],
+                station_y[SP], station_y[SQ], t.du, t.dv, t.dw);
+}
+
+/* Evaluates the terms for all baselines of a block of stations. */
+template<bool TIME_SMEARING, typename REAL>
+XCORR_INLINE void xcorr_baseline_terms(const int q0, const int q1,
+        const int num_stations,
+        const REAL* const RESTRICT station_u,
+        const REAL* const RESTRICT station_v,
+        const REAL* const RESTRICT station_w,
+        const REAL* const RESTRICT station_x,
+        const REAL* const RESTRICT station_y,
+        const REAL uv_min_lambda, const REAL uv_max_lambda,
+        const REAL inv_wavelength, const REAL frac_bandwidth,
+        const REAL time_int_sec, const REAL gha0_rad, const REAL dec0_rad,
+        XcorrBaseline<REAL>* RESTRICT terms)
+{
+    for (int SQ = q0; SQ < q1; ++SQ)
+        for (int SP = SQ + 1; SP < num_stations; ++SP)
+            xcorr_baseline_term<TIME_SMEARING, REAL>(SP, SQ,
+                    station_u, station_v, station_w, station_x, station_y,
+                    uv_min_lambda, uv_max_lambda, inv_wavelength,
+                    frac_bandwidth, time_int_sec, gha0_rad, dec0_rad,
+                    terms[(SQ - q0) * num_stations + SP]);
+}
+
+/* Evaluates the smearing and Gaussian source terms for one source.
+ * Each sinc function has its own division, as the product of two
+ * guarded arguments could underflow to zero. */
+#define XCORR_SOURCE_FACTOR(BS, TS, GAUSSIAN, REAL, I, T, FACTOR)\
+        if (GAUSSIAN) {\
+            const REAL arg__ = source_a[I] * T.uu2 + source_b[I] * T.uuvv +\
+                    source_c[I] * T.vv2;\
+            FACTOR = xcorr_exp(-arg__);\
+        }\
+        else FACTOR = (REAL) 1;\
+        if (BS || TS) {\
+            const REAL l__ = source_l[I], m__ = source_m[I];\
+            const REAL n__ = source_n[I] - (REAL) 1;\
+            if (BS) {\
+                const REAL x__ = xcorr_sinc_arg(\
+                        T.uu * l__ + T.vv * m__ + T.ww * n__);\
+                FACTOR *= xcorr_sin(x__) / x__;\
+            }\
+            if (TS) {\
+                const REAL x__ = xcorr_sinc_arg(\
+                        T.du * l__ + T.dv * m__ + T.dw * n__);\
+                FACTOR *= xcorr_sin(x__) / x__;\
+            }\
+        }
+
+#endif /* OSKAR_PRIVATE_CORRELATE_OMP_H_ */
@@ -40,11 +40,44 @@
 extern "C" {
 #endif
 
+static void cross_correlate(int apply_phase, int num_sources,
+        const oskar_Jones* jones, const oskar_Sky* sky,
+        const oskar_Telescope* tel, const oskar_Mem* u, const oskar_Mem* v,
+        const oskar_Mem* w, double gast, double frequency_hz, int offset_out,
+        oskar_Mem* vis, int* status);
+static void cross_correlate_phase_omp(int num_sources, int num_stations,
+        int offset_out, const oskar_Mem* J, const oskar_Sky* sky,
+        const oskar_Mem* u, const oskar_Mem* v, const oskar_Mem* w,
+        const oskar_Mem* x, const oskar_Mem* y, double uv_filter_min,
+        double uv_filter_max, double inv_wavelength, double frac_bandwidth,
+        double time_avg, double gha0, double dec0, oskar_Mem* vis,
+        int* status);
+
 void oskar_cross_correlate(int num_sources,  const oskar_Jones* jones,
         const oskar_Sky* sky, const oskar_Telescope* tel,
         const oskar_Mem* u, const oskar_Mem* v, const oskar_Mem* w,
         double gast, double frequency_hz, int offset_out, oskar_Mem* vis,
         int* status)
+{
+    cross_correlate(0, num_sources, jones, sky, tel, u, v, w,
+            gast, frequency_hz, offset_out, vis, status);
+}
+
+void oskar_cross_correlate_with_phase(int num_sources,
+        const oskar_Jones* jones, const oskar_Sky* sky,
+        const oskar_Telescope* tel, const oskar_Mem* u, const oskar_Mem* v,
+        const oskar_Mem* w, double gast, double frequency_hz, int offset_out,
+        oskar_Mem* vis, int* status)
+{
+    cross_correlate(1, num_sources, jones, sky, tel, u, v, w,
+            gast, frequency_hz, offset_out, vis, status);
+}
+
+static void cross_correlate(int apply_phase, int num_sources,
+        const oskar_Jones* jones, const oskar_Sky* sky,
+        const oskar_Telescope* tel, const oskar_Mem* u, const oskar_Mem* v,
+        const oskar_Mem* w, double gast, double frequency_hz, int offset_out,
+        oskar_Mem* vis, int* status)
 {
     const oskar_Mem *J, *src_a, *src_b, *src_c, *src_l, *src_m, *src_n;
     const oskar_Mem *src_I, *src_Q, *src_U, *src_V, *x, *y;
@@ -134,6 +167,19 @@ void oskar_cross_correlate(int num_sources,  const oskar_Jones* jones,
     x = oskar_telescope_station_true_x_offset_ecef_metres_const(tel);
     y = oskar_telescope_station_true_y_offset_ecef_metres_const(tel);
 
+    /* The interferometer phase can only be applied here on the CPU. */
+    if (apply_phase)
+    {
+        if (location == OSKAR_CPU)
+            cross_correlate_phase_omp(num_sources, num_stations, offset_out,
+                    J, sky, u, v, w, x, y, uv_filter_min, uv_filter_max,
+                    inv_wavelength, frac_bandwidth, time_avg, gha0, dec0,
+                    vis, status);
+        else
+            *status = OSKAR_ERR_BAD_LOCATION;
+        return;
+    }
+
     /* Select kernel. */
     if (location == OSKAR_CPU)
     {
@@ -668,6 +714,205 @@ void oskar_cross_correlate(int num_sources,  const oskar_Jones* jones,
     }
 }
 
+static void cross_correlate_phase_omp(int num_sources, int num_stations,
+        int offset_out, const oskar_Mem* J, const oskar_Sky* sky,
+        const oskar_Mem* u, const oskar_Mem* v, const oskar_Mem* w,
+        const oskar_Mem* x, const oskar_Mem* y, double uv_filter_min,
+        double uv_filter_max, double inv_wavelength, double frac_bandwidth,
+        double time_avg, double gha0, double dec0, oskar_Mem* vis,
+        int* status)
+{
+    const int use_extended = oskar_sky_use_extended(sky);
+    const oskar_Mem* src_I = oskar_sky_I_const(sky);
+    const oskar_Mem* src_Q = oskar_sky_Q_const(sky);
+    const oskar_Mem* src_U = oskar_sky_U_const(sky);
+    const oskar_Mem* src_V = oskar_sky_V_const(sky);
+    const oskar_Mem* src_l = oskar_sky_l_const(sky);
+    const oskar_Mem* src_m = oskar_sky_m_const(sky);
+    const oskar_Mem* src_n = oskar_sky_n_const(sky);
+    const oskar_Mem* src_a = oskar_sky_gaussian_a_const(sky);
+    const oskar_Mem* src_b = oskar_sky_gaussian_b_const(sky);
+    const oskar_Mem* src_c = oskar_sky_gaussian_c_const(sky);
+    if (use_extended)
+    {
+        switch (oskar_mem_type(vis))
+        {
+        case OSKAR_SINGLE_COMPLEX_MATRIX:
+            oskar_cross_correlate_phase_gaussian_omp_f(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_float4c_const(J, status),
+                    oskar_mem_float_const(src_I, status),
+                    oskar_mem_float_const(src_Q, status),
+                    oskar_mem_float_const(src_U, status),
+                    oskar_mem_float_const(src_V, status),
+                    oskar_mem_float_const(src_l, status),
+                    oskar_mem_float_const(src_m, status),
+                    oskar_mem_float_const(src_n, status),
+                    oskar_mem_float_const(src_a, status),
+                    oskar_mem_float_const(src_b, status),
+                    oskar_mem_float_const(src_c, status),
+                    oskar_mem_float_const(u, status),
+                    oskar_mem_float_const(v, status),
+                    oskar_mem_float_const(w, status),
+                    oskar_mem_float_const(x, status),
+                    oskar_mem_float_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_float4c(vis, status), status);
+            break;
+        case OSKAR_DOUBLE_COMPLEX_MATRIX:
+            oskar_cross_correlate_phase_gaussian_omp_d(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_double4c_const(J, status),
+                    oskar_mem_double_const(src_I, status),
+                    oskar_mem_double_const(src_Q, status),
+                    oskar_mem_double_const(src_U, status),
+                    oskar_mem_double_const(src_V, status),
+                    oskar_mem_double_const(src_l, status),
+                    oskar_mem_double_const(src_m, status),
+                    oskar_mem_double_const(src_n, status),
+                    oskar_mem_double_const(src_a, status),
+                    oskar_mem_double_const(src_b, status),
+                    oskar_mem_double_const(src_c, status),
+                    oskar_mem_double_const(u, status),
+                    oskar_mem_double_const(v, status),
+                    oskar_mem_double_const(w, status),
+                    oskar_mem_double_const(x, status),
+                    oskar_mem_double_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_double4c(vis, status), status);
+            break;
+        case OSKAR_SINGLE_COMPLEX:
+            oskar_cross_correlate_scalar_phase_gaussian_omp_f(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_float2_const(J, status),
+                    oskar_mem_float_const(src_I, status),
+                    oskar_mem_float_const(src_l, status),
+                    oskar_mem_float_const(src_m, status),
+                    oskar_mem_float_const(src_n, status),
+                    oskar_mem_float_const(src_a, status),
+                    oskar_mem_float_const(src_b, status),
+                    oskar_mem_float_const(src_c, status),
+                    oskar_mem_float_const(u, status),
+                    oskar_mem_float_const(v, status),
+                    oskar_mem_float_const(w, status),
+                    oskar_mem_float_const(x, status),
+                    oskar_mem_float_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_float2(vis, status), status);
+            break;
+        case OSKAR_DOUBLE_COMPLEX:
+            oskar_cross_correlate_scalar_phase_gaussian_omp_d(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_double2_const(J, status),
+                    oskar_mem_double_const(src_I, status),
+                    oskar_mem_double_const(src_l, status),
+                    oskar_mem_double_const(src_m, status),
+                    oskar_mem_double_const(src_n, status),
+                    oskar_mem_double_const(src_a, status),
+                    oskar_mem_double_const(src_b, status),
+                    oskar_mem_double_const(src_c, status),
+                    oskar_mem_double_const(u, status),
+                    oskar_mem_double_const(v, status),
+                    oskar_mem_double_const(w, status),
+                    oskar_mem_double_const(x, status),
+                    oskar_mem_double_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_double2(vis, status), status);
+            break;
+        default:
+            *status = OSKAR_ERR_BAD_DATA_TYPE;
+            return;
+        }
+    }
+    else
+    {
+        switch (oskar_mem_type(vis))
+        {
+        case OSKAR_SINGLE_COMPLEX_MATRIX:
+            oskar_cross_correlate_phase_point_omp_f(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_float4c_const(J, status),
+                    oskar_mem_float_const(src_I, status),
+                    oskar_mem_float_const(src_Q, status),
+                    oskar_mem_float_const(src_U, status),
+                    oskar_mem_float_const(src_V, status),
+                    oskar_mem_float_const(src_l, status),
+                    oskar_mem_float_const(src_m, status),
+                    oskar_mem_float_const(src_n, status),
+                    oskar_mem_float_const(u, status),
+                    oskar_mem_float_const(v, status),
+                    oskar_mem_float_const(w, status),
+                    oskar_mem_float_const(x, status),
+                    oskar_mem_float_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_float4c(vis, status), status);
+            break;
+        case OSKAR_DOUBLE_COMPLEX_MATRIX:
+            oskar_cross_correlate_phase_point_omp_d(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_double4c_const(J, status),
+                    oskar_mem_double_const(src_I, status),
+                    oskar_mem_double_const(src_Q, status),
+                    oskar_mem_double_const(src_U, status),
+                    oskar_mem_double_const(src_V, status),
+                    oskar_mem_double_const(src_l, status),
+                    oskar_mem_double_const(src_m, status),
+                    oskar_mem_double_const(src_n, status),
+                    oskar_mem_double_const(u, status),
+                    oskar_mem_double_const(v, status),
+                    oskar_mem_double_const(w, status),
+                    oskar_mem_double_const(x, status),
+                    oskar_mem_double_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_double4c(vis, status), status);
+            break;
+        case OSKAR_SINGLE_COMPLEX:
+            oskar_cross_correlate_scalar_phase_point_omp_f(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_float2_const(J, status),
+                    oskar_mem_float_const(src_I, status),
+                    oskar_mem_float_const(src_l, status),
+                    oskar_mem_float_const(src_m, status),
+                    oskar_mem_float_const(src_n, status),
+                    oskar_mem_float_const(u, status),
+                    oskar_mem_float_const(v, status),
+                    oskar_mem_float_const(w, status),
+                    oskar_mem_float_const(x, status),
+                    oskar_mem_float_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_float2(vis, status), status);
+            break;
+        case OSKAR_DOUBLE_COMPLEX:
+            oskar_cross_correlate_scalar_phase_point_omp_d(
+                    num_sources, num_stations, offset_out,
+                    oskar_mem_double2_const(J, status),
+                    oskar_mem_double_const(src_I, status),
+                    oskar_mem_double_const(src_l, status),
+                    oskar_mem_double_const(src_m, status),
+                    oskar_mem_double_const(src_n, status),
+                    oskar_mem_double_const(u, status),
+                    oskar_mem_double_const(v, status),
+                    oskar_mem_double_const(w, status),
+                    oskar_mem_double_const(x, status),
+                    oskar_mem_double_const(y, status),
+                    uv_filter_min, uv_filter_max, inv_wavelength,
+                    frac_bandwidth, time_avg, gha0, dec0,
+                    oskar_mem_double2(vis, status), status);
+            break;
+        default:
+            *status = OSKAR_ERR_BAD_DATA_TYPE;
+            return;
+        }
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
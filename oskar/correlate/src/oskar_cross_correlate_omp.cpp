@@ -25,35 +25,120 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
-
 #include "correlate/define_correlate_utils.h"
 #include "correlate/oskar_cross_correlate_omp.h"
+#include "correlate/private_correlate_omp.h"
 #include "math/define_multiply.h"
-#include "math/oskar_kahan_sum.h"
 #include "utility/oskar_kernel_macros.h"
 #include "utility/oskar_vector_types.h"
 
-template<typename T1, typename T2>
-struct is_same
+// Loads a Jones matrix for source J from the planes of a tile.
+#define XCORR_LOAD_MATRIX(M, PTR, J) {\
+        const int t__ = XCORR_TILE_SOURCES;\
+        M.a.x = PTR[J];         M.a.y = PTR[J + t__];\
+        M.b.x = PTR[J + 2*t__]; M.b.y = PTR[J + 3*t__];\
+        M.c.x = PTR[J + 4*t__]; M.c.y = PTR[J + 5*t__];\
+        M.d.x = PTR[J + 6*t__]; M.d.y = PTR[J + 7*t__]; }\
+
+// Multiplies the Jones matrices for a tile of sources at one station with
+// the source brightness matrices, and stores the results as planes.
+// This is done once for each station p, as it does not depend on station q.
+// The input Jones matrices are either interleaved, or already in planes.
+template<bool PLANES, typename REAL, typename REAL2, typename REAL4c>
+XCORR_INLINE void xcorr_jones_brightness(
+        const int                i_start,
+        const int                num_in_tile,
+        const REAL* const        RESTRICT jones,
+        const REAL* const        RESTRICT source_I,
+        const REAL* const        RESTRICT source_Q,
+        const REAL* const        RESTRICT source_U,
+        const REAL* const        RESTRICT source_V,
+        REAL* const              RESTRICT out)
 {
-    enum { value = false }; // is_same represents a bool.
-    typedef is_same<T1,T2> type; // to qualify as a metafunction.
-};
+    const int t = XCORR_TILE_SOURCES;
+    XCORR_SIMD
+    for (int j = 0; j < num_in_tile; ++j)
+    {
+        REAL4c m1, m2;
+        const int i = i_start + j;
+        const int k = PLANES ? t : 1;
+        const REAL* const p = PLANES ? &jones[j] : &jones[8 * j];
+        OSKAR_CONSTRUCT_B(REAL, m2,
+                source_I[i], source_Q[i], source_U[i], source_V[i])
+        m1.a.x = p[0];     m1.a.y = p[k];     m1.b.x = p[2 * k];
+        m1.b.y = p[3 * k]; m1.c.x = p[4 * k]; m1.c.y = p[5 * k];
+        m1.d.x = p[6 * k]; m1.d.y = p[7 * k];
+        OSKAR_MUL_COMPLEX_MATRIX_HERMITIAN_IN_PLACE(REAL2, m1, m2)
+        out[j]         = m1.a.x; out[j + t]     = m1.a.y;
+        out[j + 2 * t] = m1.b.x; out[j + 3 * t] = m1.b.y;
+        out[j + 4 * t] = m1.c.x; out[j + 5 * t] = m1.c.y;
+        out[j + 6 * t] = m1.d.x; out[j + 7 * t] = m1.d.y;
+    }
+}
 
-template<typename T>
-struct is_same<T,T>
+// Correlates one tile of sources on one baseline, and accumulates the
+// result into the eight double-precision values at sum.
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+XCORR_INLINE void xcorr_tile(
+        const int                         i_start,
+        const int                         num_in_tile,
+        const REAL*   const      RESTRICT station_p,
+        const REAL*   const      RESTRICT station_q,
+        const REAL*   const      RESTRICT source_l,
+        const REAL*   const      RESTRICT source_m,
+        const REAL*   const      RESTRICT source_n,
+        const REAL*   const      RESTRICT source_a,
+        const REAL*   const      RESTRICT source_b,
+        const REAL*   const      RESTRICT source_c,
+        const XcorrBaseline<REAL>&        t,
+        double*                  RESTRICT sum)
 {
-    enum { value = true };
-    typedef is_same<T,T> type;
-};
+    REAL s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0, s6 = 0, s7 = 0;
+
+    // Loop over sources in the tile.
+    XCORR_SIMD_REDUCTION(s0, s1, s2, s3, s4, s5, s6, s7)
+    for (int j = 0; j < num_in_tile; ++j)
+    {
+        const int i = i_start + j;
+        REAL smearing;
+        XCORR_SOURCE_FACTOR(BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                REAL, i, t, smearing)
 
+        // Multiply the product of the first Jones matrix and the source
+        // brightness matrix with the second (Hermitian transposed) one.
+        REAL4c m1, m2;
+        XCORR_LOAD_MATRIX(m1, station_p, j)
+        XCORR_LOAD_MATRIX(m2, station_q, j)
+        OSKAR_MUL_COMPLEX_MATRIX_CONJUGATE_TRANSPOSE_IN_PLACE(REAL2, m1, m2)
+
+        // Multiply result by smearing term and accumulate.
+        s0 += m1.a.x * smearing; s1 += m1.a.y * smearing;
+        s2 += m1.b.x * smearing; s3 += m1.b.y * smearing;
+        s4 += m1.c.x * smearing; s5 += m1.c.y * smearing;
+        s6 += m1.d.x * smearing; s7 += m1.d.y * smearing;
+    }
+
+    // Partial sums are accumulated in double precision, so there is
+    // no need for compensated summation in single precision.
+    sum[0] += s0; sum[1] += s1; sum[2] += s2; sum[3] += s3;
+    sum[4] += s4; sum[5] += s5; sum[6] += s6; sum[7] += s7;
+}
+
+// Correlates all baselines that have station q in the given block.
 template
 <
 // Compile-time parameters.
 bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
 typename REAL, typename REAL2, typename REAL4c
 >
-void oskar_xcorr_omp(
+XCORR_INLINE void xcorr_block(
+        const int                    block,
+        const int                    block_size,
         const int                    num_sources,
         const int                    num_stations,
         const int                    offset_out,
@@ -80,117 +165,478 @@ void oskar_xcorr_omp(
         const REAL                   time_int_sec,
         const REAL                   gha0_rad,
         const REAL                   dec0_rad,
+        XcorrBaseline<REAL>*         terms,
+        double*                      sums,
+        REAL*                        tile,
         REAL4c*             RESTRICT vis)
 {
-    // Loop over stations.
-#pragma omp parallel for schedule(dynamic, 1)
-    for (int SQ = 0; SQ < num_stations; ++SQ)
+    const int q_start = block * block_size;
+    const int q_end = (q_start + block_size < num_stations) ?
+            q_start + block_size : num_stations;
+
+    // Get common baseline values for all baselines in the block.
+    xcorr_baseline_terms<TIME_SMEARING, REAL>(q_start, q_end,
+            num_stations, station_u, station_v, station_w,
+            station_x, station_y, uv_min_lambda, uv_max_lambda,
+            inv_wavelength, frac_bandwidth, time_int_sec, gha0_rad, dec0_rad,
+            terms);
+    memset(sums, 0, 8 * block_size * num_stations * sizeof(double));
+
+    // Scratch space for the tiles of station p and the stations in the block.
+    const REAL* const jones_ = (const REAL*) jones;
+    REAL* const tile_p = tile;
+    REAL* const tile_q = tile + 8 * XCORR_TILE_SOURCES;
+
+    // Loop over tiles of sources.
+    for (int i_start = 0; i_start < num_sources;
+            i_start += XCORR_TILE_SOURCES)
     {
-        // Pointer to source vector for station q.
-        const REAL4c* const station_q = &jones[SQ * num_sources];
+        const int num_in_tile = (i_start + XCORR_TILE_SOURCES < num_sources) ?
+                XCORR_TILE_SOURCES : num_sources - i_start;
 
-        // Loop over baselines for this station.
-        for (int SP = SQ + 1; SP < num_stations; ++SP)
+        // Copy the tile for each station q in the block, to reuse it.
+        for (int SQ = q_start; SQ < q_end; ++SQ)
+            xcorr_load_tile<8, REAL>(num_in_tile,
+                    &jones_[8 * ((size_t) SQ * num_sources + i_start)],
+                    &tile_q[8 * XCORR_TILE_SOURCES * (SQ - q_start)]);
+
+        // Loop over stations p, and over stations q in the block.
+        for (int SP = q_start + 1; SP < num_stations; ++SP)
         {
-            REAL uv_len, uu, vv, ww, uu2, vv2, uuvv, du, dv, dw;
-            REAL4c m1, m2, sum, guard;
-            OSKAR_CLEAR_COMPLEX_MATRIX(REAL, sum)
-            if (is_same<REAL, float>::value)
-                OSKAR_CLEAR_COMPLEX_MATRIX(REAL, guard)
+            xcorr_jones_brightness<false, REAL, REAL2, REAL4c>(
+                    i_start, num_in_tile,
+                    &jones_[8 * ((size_t) SP * num_sources + i_start)],
+                    source_I, source_Q, source_U, source_V, tile_p);
+            for (int SQ = q_start; SQ < q_end && SQ < SP; ++SQ)
+            {
+                const int j = (SQ - q_start) * num_stations + SP;
 
-            // Pointer to source vector for station p.
-            const REAL4c* const station_p = &jones[SP * num_sources];
+                // Apply the baseline length filter.
+                if (!terms[j].use) continue;
+                xcorr_tile<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                        REAL, REAL2, REAL4c>(i_start, num_in_tile, tile_p,
+                        &tile_q[8 * XCORR_TILE_SOURCES * (SQ - q_start)],
+                        source_l, source_m, source_n,
+                        source_a, source_b, source_c, terms[j], &sums[8 * j]);
+            }
+        }
+    }
 
-            // Get common baseline values.
-            OSKAR_BASELINE_TERMS(REAL, station_u[SP], station_u[SQ],
-                    station_v[SP], station_v[SQ], station_w[SP], station_w[SQ],
-                    uu, vv, ww, uu2, vv2, uuvv, uv_len);
+    // Add results to the baseline visibilities.
+    for (int SQ = q_start; SQ < q_end; ++SQ)
+    {
+        for (int SP = SQ + 1; SP < num_stations; ++SP)
+        {
+            const int j = (SQ - q_start) * num_stations + SP;
+            if (!terms[j].use) continue;
+            const double* s = &sums[8 * j];
+            REAL* v = (REAL*) &vis[OSKAR_BASELINE_INDEX(num_stations, SP, SQ) +
+                    offset_out];
+            for (int k = 0; k < 8; ++k) v[k] += (REAL) s[k];
+        }
+    }
+}
 
-            // Apply the baseline length filter.
-            if (uv_len < uv_min_lambda || uv_len > uv_max_lambda) continue;
+// Correlates a single baseline using tiles on the stack.
+// This is used only if the scratch space for the blocks can't be allocated.
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+XCORR_INLINE void xcorr_baseline(
+        const int                    SP,
+        const int                    SQ,
+        const int                    num_sources,
+        const int                    num_stations,
+        const int                    offset_out,
+        const REAL4c* const RESTRICT jones,
+        const REAL*   const RESTRICT source_I,
+        const REAL*   const RESTRICT source_Q,
+        const REAL*   const RESTRICT source_U,
+        const REAL*   const RESTRICT source_V,
+        const REAL*   const RESTRICT source_l,
+        const REAL*   const RESTRICT source_m,
+        const REAL*   const RESTRICT source_n,
+        const REAL*   const RESTRICT source_a,
+        const REAL*   const RESTRICT source_b,
+        const REAL*   const RESTRICT source_c,
+        const REAL*   const RESTRICT station_u,
+        const REAL*   const RESTRICT station_v,
+        const REAL*   const RESTRICT station_w,
+        const REAL*   const RESTRICT station_x,
+        const REAL*   const RESTRICT station_y,
+        const REAL                   uv_min_lambda,
+        const REAL                   uv_max_lambda,
+        const REAL                   inv_wavelength,
+        const REAL                   frac_bandwidth,
+        const REAL                   time_int_sec,
+        const REAL                   gha0_rad,
+        const REAL                   dec0_rad,
+        REAL4c*             RESTRICT vis)
+{
+    XcorrBaseline<REAL> t;
+    xcorr_baseline_term<TIME_SMEARING, REAL>(SP, SQ,
+            station_u, station_v, station_w, station_x, station_y,
+            uv_min_lambda, uv_max_lambda, inv_wavelength, frac_bandwidth,
+            time_int_sec, gha0_rad, dec0_rad, t);
+    if (!t.use) return;
+    REAL tile_p[8 * XCORR_TILE_SOURCES], tile_q[8 * XCORR_TILE_SOURCES];
+    double sum[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    const REAL* const jones_ = (const REAL*) jones;
+    for (int i_start = 0; i_start < num_sources;
+            i_start += XCORR_TILE_SOURCES)
+    {
+        const int num_in_tile = (i_start + XCORR_TILE_SOURCES < num_sources) ?
+                XCORR_TILE_SOURCES : num_sources - i_start;
+        xcorr_load_tile<8, REAL>(num_in_tile,
+                &jones_[8 * ((size_t) SQ * num_sources + i_start)], tile_q);
+        xcorr_jones_brightness<false, REAL, REAL2, REAL4c>(
+                i_start, num_in_tile,
+                &jones_[8 * ((size_t) SP * num_sources + i_start)],
+                source_I, source_Q, source_U, source_V, tile_p);
+        xcorr_tile<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                REAL, REAL2, REAL4c>(i_start, num_in_tile, tile_p, tile_q,
+                source_l, source_m, source_n,
+                source_a, source_b, source_c, t, sum);
+    }
+    REAL* v = (REAL*) &vis[OSKAR_BASELINE_INDEX(num_stations, SP, SQ) +
+            offset_out];
+    for (int k = 0; k < 8; ++k) v[k] += (REAL) sum[k];
+}
 
-            // Compute the deltas for time-average smearing.
-            if (TIME_SMEARING)
-                OSKAR_BASELINE_DELTAS(REAL, station_x[SP], station_x[SQ],
-                        station_y[SP], station_y[SQ], du, dv, dw);
+// Applies the interferometer phase to the Jones matrices for a tile of
+// sources at one station, and multiplies the result with the source
+// brightness matrices. Both products are stored as planes.
+template<typename REAL, typename REAL2, typename REAL4c>
+XCORR_INLINE void xcorr_station_phase(
+        const int                    s,
+        const int                    i_start,
+        const int                    num_in_tile,
+        const int                    num_sources,
+        const REAL                   wavenumber,
+        const REAL4c* const RESTRICT jones,
+        const REAL*   const RESTRICT source_I,
+        const REAL*   const RESTRICT source_Q,
+        const REAL*   const RESTRICT source_U,
+        const REAL*   const RESTRICT source_V,
+        const REAL*   const RESTRICT source_l,
+        const REAL*   const RESTRICT source_m,
+        const REAL*   const RESTRICT source_n,
+        const REAL*   const RESTRICT station_u,
+        const REAL*   const RESTRICT station_v,
+        const REAL*   const RESTRICT station_w,
+        REAL*               RESTRICT planes_p,
+        REAL*               RESTRICT planes_q)
+{
+    const size_t n = 8 * XCORR_TILE_SOURCES;
+    const REAL* const jones_ = (const REAL*) jones;
+    xcorr_load_tile_phase<8, REAL>(i_start, num_in_tile, wavenumber,
+            station_u[s], station_v[s], station_w[s],
+            source_l, source_m, source_n,
+            &jones_[8 * ((size_t) s * num_sources + i_start)],
+            &planes_q[n * s]);
+    xcorr_jones_brightness<true, REAL, REAL2, REAL4c>(i_start, num_in_tile,
+            &planes_q[n * s], source_I, source_Q, source_U, source_V,
+            &planes_p[n * s]);
+}
 
-            // Loop over sources.
-            for (int i = 0; i < num_sources; ++i)
-            {
-                REAL smearing;
-                if (GAUSSIAN)
-                {
-                    const REAL t = source_a[i] * uu2 + source_b[i] * uuvv +
-                            source_c[i] * vv2;
-                    smearing = exp((REAL) -t);
-                }
-                else smearing = (REAL) 1;
-                if (BANDWIDTH_SMEARING || TIME_SMEARING)
-                {
-                    const REAL l = source_l[i];
-                    const REAL m = source_m[i];
-                    const REAL n = source_n[i] - (REAL) 1;
-                    if (BANDWIDTH_SMEARING)
-                    {
-                        const REAL t = uu * l + vv * m + ww * n;
-                        smearing *= OSKAR_SINC(REAL, t);
-                    }
-                    if (TIME_SMEARING)
-                    {
-                        const REAL t = du * l + dv * m + dw * n;
-                        smearing *= OSKAR_SINC(REAL, t);
-                    }
-                }
-
-                // Construct source brightness matrix.
-                OSKAR_CONSTRUCT_B(REAL, m2,
-                        source_I[i], source_Q[i], source_U[i], source_V[i])
-
-                // Multiply first Jones matrix with source brightness matrix.
-                OSKAR_LOAD_MATRIX(m1, station_p[i])
-                OSKAR_MUL_COMPLEX_MATRIX_HERMITIAN_IN_PLACE(REAL2, m1, m2)
-
-                // Multiply result with second (Hermitian transposed) Jones matrix.
-                OSKAR_LOAD_MATRIX(m2, station_q[i])
-                OSKAR_MUL_COMPLEX_MATRIX_CONJUGATE_TRANSPOSE_IN_PLACE(REAL2, m1, m2)
-
-                // Multiply result by smearing term and accumulate.
-                if (is_same<REAL, float>::value)
-                {
-                    OSKAR_KAHAN_SUM_MULTIPLY_COMPLEX_MATRIX(
-                            REAL, sum, m1, smearing, guard)
-                }
-                else
-                {
-                    OSKAR_MUL_ADD_COMPLEX_MATRIX_SCALAR(sum, m1, smearing)
-                }
-            }
+// Correlates one tile of sources on all baselines that have station q in
+// the given block, using the planes from xcorr_station_phase().
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+XCORR_INLINE void xcorr_block_phase(
+        const int                                block,
+        const int                                block_size,
+        const int                                num_stations,
+        const int                                i_start,
+        const int                                num_in_tile,
+        const REAL*                const RESTRICT planes_p,
+        const REAL*                const RESTRICT planes_q,
+        const REAL*                const RESTRICT source_l,
+        const REAL*                const RESTRICT source_m,
+        const REAL*                const RESTRICT source_n,
+        const REAL*                const RESTRICT source_a,
+        const REAL*                const RESTRICT source_b,
+        const REAL*                const RESTRICT source_c,
+        const XcorrBaseline<REAL>* const RESTRICT terms,
+        double*                          RESTRICT sums)
+{
+    const size_t n = 8 * XCORR_TILE_SOURCES;
+    const int q_start = block * block_size;
+    const int q_end = (q_start + block_size < num_stations) ?
+            q_start + block_size : num_stations;
+    for (int SP = q_start + 1; SP < num_stations; ++SP)
+    {
+        for (int SQ = q_start; SQ < q_end && SQ < SP; ++SQ)
+        {
+            const int j = OSKAR_BASELINE_INDEX(num_stations, SP, SQ);
 
-            // Add result to the baseline visibility.
-            int i = OSKAR_BASELINE_INDEX(num_stations, SP, SQ) + offset_out;
-            OSKAR_ADD_COMPLEX_MATRIX_IN_PLACE(vis[i], sum);
+            // Apply the baseline length filter.
+            if (!terms[j].use) continue;
+            xcorr_tile<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                    REAL, REAL2, REAL4c>(i_start, num_in_tile,
+                    &planes_p[n * SP], &planes_q[n * SQ],
+                    source_l, source_m, source_n,
+                    source_a, source_b, source_c, terms[j], &sums[8 * j]);
         }
     }
 }
 
-#define XCORR_KERNEL(BS, TS, GAUSSIAN, REAL, REAL2, REAL4c)                 \
-        oskar_xcorr_omp<BS, TS, GAUSSIAN, REAL, REAL2, REAL4c>              \
+// The parallel region must be in the function that has the target
+// attribute, so that the compiler uses it for the outlined thread function.
+// If any thread can't allocate its scratch space, all threads correlate
+// single baselines instead, so that no error needs to be returned.
+#define XCORR_PARALLEL_BODY                                                 \
+        const int block_size = xcorr_block_size(num_stations);              \
+        const int num_blocks = (num_stations + block_size - 1) / block_size;\
+        int alloc_failed = 0;                                               \
+        DO_PRAGMA(omp parallel)                                             \
+        {                                                                   \
+            const size_t n = (size_t) block_size * num_stations;            \
+            XcorrBaseline<REAL>* terms = (XcorrBaseline<REAL>*)             \
+                    malloc(n * sizeof(XcorrBaseline<REAL>));                \
+            double* sums = (double*) malloc(8 * n * sizeof(double));        \
+            REAL* tile = (REAL*) malloc(8 * XCORR_TILE_SOURCES *            \
+                    (block_size + 1) * sizeof(REAL));                       \
+            if (!terms || !sums || !tile)                                   \
+            {                                                               \
+                DO_PRAGMA(omp atomic)                                       \
+                alloc_failed++;                                             \
+            }                                                               \
+            DO_PRAGMA(omp barrier)                                          \
+            if (!alloc_failed)                                              \
+            {                                                               \
+                DO_PRAGMA(omp for schedule(dynamic, 1))                     \
+                for (int b = 0; b < num_blocks; ++b)                        \
+                    xcorr_block<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,\
+                            REAL, REAL2, REAL4c>(b, block_size,             \
+                            num_sources, num_stations, offset_out, jones,   \
+                            source_I, source_Q, source_U, source_V,         \
+                            source_l, source_m, source_n,                   \
+                            source_a, source_b, source_c,                   \
+                            station_u, station_v, station_w,                \
+                            station_x, station_y,                           \
+                            uv_min_lambda, uv_max_lambda, inv_wavelength,   \
+                            frac_bandwidth, time_int_sec,                   \
+                            gha0_rad, dec0_rad, terms, sums, tile, vis);    \
+            }                                                               \
+            else                                                            \
+            {                                                               \
+                DO_PRAGMA(omp for schedule(dynamic, 1))                     \
+                for (int SQ = 0; SQ < num_stations; ++SQ)                   \
+                    for (int SP = SQ + 1; SP < num_stations; ++SP)          \
+                        xcorr_baseline<BANDWIDTH_SMEARING, TIME_SMEARING,   \
+                                GAUSSIAN, REAL, REAL2, REAL4c>(SP, SQ,      \
+                                num_sources, num_stations, offset_out,      \
+                                jones, source_I, source_Q, source_U,        \
+                                source_V, source_l, source_m, source_n,     \
+                                source_a, source_b, source_c,               \
+                                station_u, station_v, station_w,            \
+                                station_x, station_y,                       \
+                                uv_min_lambda, uv_max_lambda,               \
+                                inv_wavelength, frac_bandwidth,             \
+                                time_int_sec, gha0_rad, dec0_rad, vis);     \
+            }                                                               \
+            free(tile);                                                     \
+            free(sums);                                                     \
+            free(terms);                                                    \
+        }
+
+// With the interferometer phase applied here, the Jones matrices for each
+// tile of sources are multiplied by the phase once per station, and the
+// results are shared by all threads before the baselines are correlated.
+#define XCORR_PHASE_PARALLEL_BODY                                           \
+        const int block_size = xcorr_block_size(num_stations);              \
+        const int num_blocks = (num_stations + block_size - 1) / block_size;\
+        const int num_baselines = num_stations * (num_stations - 1) / 2;    \
+        const size_t n = (size_t) 8 * XCORR_TILE_SOURCES * num_stations;    \
+        const REAL wavenumber = (REAL) (2.0 * M_PI) * inv_wavelength;       \
+        if (num_baselines == 0) return;                                     \
+        XcorrBaseline<REAL>* terms = (XcorrBaseline<REAL>*)                 \
+                malloc(num_baselines * sizeof(XcorrBaseline<REAL>));        \
+        double* sums = (double*) calloc(8 * (size_t) num_baselines,         \
+                sizeof(double));                                            \
+        REAL* planes = (REAL*) malloc(2 * n * sizeof(REAL));                \
+        if (!terms || !sums || !planes)                                     \
+        {                                                                   \
+            free(planes);                                                   \
+            free(sums);                                                     \
+            free(terms);                                                    \
+            *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;                       \
+            return;                                                         \
+        }                                                                   \
+        DO_PRAGMA(omp parallel)                                             \
+        {                                                                   \
+            DO_PRAGMA(omp for schedule(dynamic, 1))                         \
+            for (int SQ = 0; SQ < num_stations; ++SQ)                       \
+                for (int SP = SQ + 1; SP < num_stations; ++SP)              \
+                    xcorr_baseline_term<TIME_SMEARING, REAL>(SP, SQ,        \
+                            station_u, station_v, station_w,                \
+                            station_x, station_y,                           \
+                            uv_min_lambda, uv_max_lambda, inv_wavelength,   \
+                            frac_bandwidth, time_int_sec,                   \
+                            gha0_rad, dec0_rad,                             \
+                            terms[OSKAR_BASELINE_INDEX(num_stations, SP, SQ)]);\
+            for (int i_start = 0; i_start < num_sources;                    \
+                    i_start += XCORR_TILE_SOURCES)                          \
+            {                                                               \
+                const int num_in_tile =                                     \
+                        (i_start + XCORR_TILE_SOURCES < num_sources) ?      \
+                        XCORR_TILE_SOURCES : num_sources - i_start;         \
+                DO_PRAGMA(omp for)                                          \
+                for (int s = 0; s < num_stations; ++s)                      \
+                    xcorr_station_phase<REAL, REAL2, REAL4c>(s, i_start,    \
+                            num_in_tile, num_sources, wavenumber, jones,    \
+                            source_I, source_Q, source_U, source_V,         \
+                            source_l, source_m, source_n,                   \
+                            station_u, station_v, station_w,                \
+                            planes, planes + n);                            \
+                DO_PRAGMA(omp for schedule(dynamic, 1))                     \
+                for (int b = 0; b < num_blocks; ++b)                        \
+                    xcorr_block_phase<BANDWIDTH_SMEARING, TIME_SMEARING,    \
+                            GAUSSIAN, REAL, REAL2, REAL4c>(b, block_size,   \
+                            num_stations, i_start, num_in_tile,             \
+                            planes, planes + n,                             \
+                            source_l, source_m, source_n,                   \
+                            source_a, source_b, source_c, terms, sums);     \
+            }                                                               \
+            DO_PRAGMA(omp for)                                              \
+            for (int j = 0; j < num_baselines; ++j)                         \
+            {                                                               \
+                if (!terms[j].use) continue;                                \
+                REAL* v = (REAL*) &vis[j + offset_out];                     \
+                for (int k = 0; k < 8; ++k) v[k] += (REAL) sums[8 * j + k]; \
+            }                                                               \
+        }                                                                   \
+        free(planes);                                                       \
+        free(sums);                                                         \
+        free(terms);
+
+#define XCORR_ARGS(REAL, REAL4c)                                            \
+        const int                    num_sources,                           \
+        const int                    num_stations,                          \
+        const int                    offset_out,                            \
+        const REAL4c* const RESTRICT jones,                                 \
+        const REAL*   const RESTRICT source_I,                              \
+        const REAL*   const RESTRICT source_Q,                              \
+        const REAL*   const RESTRICT source_U,                              \
+        const REAL*   const RESTRICT source_V,                              \
+        const REAL*   const RESTRICT source_l,                              \
+        const REAL*   const RESTRICT source_m,                              \
+        const REAL*   const RESTRICT source_n,                              \
+        const REAL*   const RESTRICT source_a,                              \
+        const REAL*   const RESTRICT source_b,                              \
+        const REAL*   const RESTRICT source_c,                              \
+        const REAL*   const RESTRICT station_u,                             \
+        const REAL*   const RESTRICT station_v,                             \
+        const REAL*   const RESTRICT station_w,                             \
+        const REAL*   const RESTRICT station_x,                             \
+        const REAL*   const RESTRICT station_y,                             \
+        const REAL                   uv_min_lambda,                         \
+        const REAL                   uv_max_lambda,                         \
+        const REAL                   inv_wavelength,                        \
+        const REAL                   frac_bandwidth,                        \
+        const REAL                   time_int_sec,                          \
+        const REAL                   gha0_rad,                              \
+        const REAL                   dec0_rad,                              \
+        REAL4c*             RESTRICT vis
+
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+void oskar_xcorr_omp(XCORR_ARGS(REAL, REAL4c))
+{
+    XCORR_PARALLEL_BODY
+}
+
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+void oskar_xcorr_phase_omp(XCORR_ARGS(REAL, REAL4c), int* status)
+{
+    XCORR_PHASE_PARALLEL_BODY
+}
+
+#ifdef XCORR_HAVE_AVX2
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+XCORR_TARGET_AVX2
+void oskar_xcorr_omp_avx2(XCORR_ARGS(REAL, REAL4c))
+{
+    XCORR_PARALLEL_BODY
+}
+
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2, typename REAL4c
+>
+XCORR_TARGET_AVX2
+void oskar_xcorr_phase_omp_avx2(XCORR_ARGS(REAL, REAL4c), int* status)
+{
+    XCORR_PHASE_PARALLEL_BODY
+}
+
+#define XCORR_KERNEL(NAME, BS, TS, GAUSSIAN, REAL, REAL2, REAL4c, ...) {    \
+        if (xcorr_use_avx2())                                               \
+            NAME##_avx2<BS, TS, GAUSSIAN, REAL, REAL2, REAL4c>              \
+            (num_sources, num_stations, offset_out, d_jones,                \
+                d_I, d_Q, d_U, d_V, d_l, d_m, d_n, d_a, d_b, d_c,           \
+                d_station_u, d_station_v, d_station_w,                      \
+                d_station_x, d_station_y, uv_min_lambda, uv_max_lambda,     \
+                inv_wavelength, frac_bandwidth, time_int_sec,               \
+                gha0_rad, dec0_rad, __VA_ARGS__);                           \
+        else                                                                \
+            NAME<BS, TS, GAUSSIAN, REAL, REAL2, REAL4c>                     \
+            (num_sources, num_stations, offset_out, d_jones,                \
+                d_I, d_Q, d_U, d_V, d_l, d_m, d_n, d_a, d_b, d_c,           \
+                d_station_u, d_station_v, d_station_w,                      \
+                d_station_x, d_station_y, uv_min_lambda, uv_max_lambda,     \
+                inv_wavelength, frac_bandwidth, time_int_sec,               \
+                gha0_rad, dec0_rad, __VA_ARGS__); }
+#else
+#define XCORR_KERNEL(NAME, BS, TS, GAUSSIAN, REAL, REAL2, REAL4c, ...)      \
+        NAME<BS, TS, GAUSSIAN, REAL, REAL2, REAL4c>                         \
         (num_sources, num_stations, offset_out, d_jones,                    \
                 d_I, d_Q, d_U, d_V, d_l, d_m, d_n, d_a, d_b, d_c,           \
                 d_station_u, d_station_v, d_station_w,                      \
                 d_station_x, d_station_y, uv_min_lambda, uv_max_lambda,     \
                 inv_wavelength, frac_bandwidth, time_int_sec,               \
-                gha0_rad, dec0_rad, d_vis);
+                gha0_rad, dec0_rad, __VA_ARGS__);
+#endif
 
-#define XCORR_SELECT(GAUSSIAN, REAL, REAL2, REAL4c)                         \
+// Selects the kernel NAME for the smearing options in use.
+// The remaining arguments are passed after the common ones.
+#define XCORR_SELECT(NAME, GAUSSIAN, REAL, REAL2, REAL4c, ...)              \
         if (frac_bandwidth == (REAL)0 && time_int_sec == (REAL)0)           \
-            XCORR_KERNEL(false, false, GAUSSIAN, REAL, REAL2, REAL4c)       \
+            XCORR_KERNEL(NAME, false, false, GAUSSIAN,                      \
+                    REAL, REAL2, REAL4c, __VA_ARGS__)                       \
         else if (frac_bandwidth != (REAL)0 && time_int_sec == (REAL)0)      \
-            XCORR_KERNEL(true, false, GAUSSIAN, REAL, REAL2, REAL4c)        \
+            XCORR_KERNEL(NAME, true, false, GAUSSIAN,                       \
+                    REAL, REAL2, REAL4c, __VA_ARGS__)                       \
         else if (frac_bandwidth == (REAL)0 && time_int_sec != (REAL)0)      \
-            XCORR_KERNEL(false, true, GAUSSIAN, REAL, REAL2, REAL4c)        \
+            XCORR_KERNEL(NAME, false, true, GAUSSIAN,                       \
+                    REAL, REAL2, REAL4c, __VA_ARGS__)                       \
         else if (frac_bandwidth != (REAL)0 && time_int_sec != (REAL)0)      \
-            XCORR_KERNEL(true, true, GAUSSIAN, REAL, REAL2, REAL4c)
+            XCORR_KERNEL(NAME, true, true, GAUSSIAN,                        \
+                    REAL, REAL2, REAL4c, __VA_ARGS__)
 
 void oskar_cross_correlate_point_omp_f(
         int num_sources, int num_stations, int offset_out,
@@ -205,7 +651,7 @@ void oskar_cross_correlate_point_omp_f(
         float dec0_rad, float4c* d_vis)
 {
     const float *d_a = 0, *d_b = 0, *d_c = 0;
-    XCORR_SELECT(false, float, float2, float4c)
+    XCORR_SELECT(oskar_xcorr_omp, false, float, float2, float4c, d_vis)
 }
 
 void oskar_cross_correlate_point_omp_d(
@@ -221,7 +667,7 @@ void oskar_cross_correlate_point_omp_d(
         double dec0_rad, double4c* d_vis)
 {
     const double *d_a = 0, *d_b = 0, *d_c = 0;
-    XCORR_SELECT(false, double, double2, double4c)
+    XCORR_SELECT(oskar_xcorr_omp, false, double, double2, double4c, d_vis)
 }
 
 void oskar_cross_correlate_gaussian_omp_f(
@@ -236,7 +682,7 @@ void oskar_cross_correlate_gaussian_omp_f(
         float inv_wavelength, float frac_bandwidth, float time_int_sec,
         float gha0_rad, float dec0_rad, float4c* d_vis)
 {
-    XCORR_SELECT(true, float, float2, float4c)
+    XCORR_SELECT(oskar_xcorr_omp, true, float, float2, float4c, d_vis)
 }
 
 void oskar_cross_correlate_gaussian_omp_d(
@@ -251,5 +697,73 @@ void oskar_cross_correlate_gaussian_omp_d(
         double inv_wavelength, double frac_bandwidth, double time_int_sec,
         double gha0_rad, double dec0_rad, double4c* d_vis)
 {
-    XCORR_SELECT(true, double, double2, double4c)
+    XCORR_SELECT(oskar_xcorr_omp, true, double, double2, double4c, d_vis)
+}
+
+void oskar_cross_correlate_phase_point_omp_f(
+        int num_sources, int num_stations, int offset_out,
+        const float4c* d_jones, const float* d_I, const float* d_Q,
+        const float* d_U, const float* d_V,
+        const float* d_l, const float* d_m, const float* d_n,
+        const float* d_station_u, const float* d_station_v,
+        const float* d_station_w,
+        const float* d_station_x, const float* d_station_y,
+        float uv_min_lambda, float uv_max_lambda, float inv_wavelength,
+        float frac_bandwidth, float time_int_sec, float gha0_rad,
+        float dec0_rad, float4c* d_vis, int* status)
+{
+    const float *d_a = 0, *d_b = 0, *d_c = 0;
+    XCORR_SELECT(oskar_xcorr_phase_omp, false, float, float2, float4c,
+            d_vis, status)
+}
+
+void oskar_cross_correlate_phase_point_omp_d(
+        int num_sources, int num_stations, int offset_out,
+        const double4c* d_jones, const double* d_I, const double* d_Q,
+        const double* d_U, const double* d_V,
+        const double* d_l, const double* d_m, const double* d_n,
+        const double* d_station_u, const double* d_station_v,
+        const double* d_station_w,
+        const double* d_station_x, const double* d_station_y,
+        double uv_min_lambda, double uv_max_lambda, double inv_wavelength,
+        double frac_bandwidth, double time_int_sec, double gha0_rad,
+        double dec0_rad, double4c* d_vis, int* status)
+{
+    const double *d_a = 0, *d_b = 0, *d_c = 0;
+    XCORR_SELECT(oskar_xcorr_phase_omp, false, double, double2, double4c,
+            d_vis, status)
+}
+
+void oskar_cross_correlate_phase_gaussian_omp_f(
+        int num_sources, int num_stations, int offset_out,
+        const float4c* d_jones, const float* d_I, const float* d_Q,
+        const float* d_U, const float* d_V,
+        const float* d_l, const float* d_m, const float* d_n,
+        const float* d_a, const float* d_b, const float* d_c,
+        const float* d_station_u, const float* d_station_v,
+        const float* d_station_w,
+        const float* d_station_x, const float* d_station_y,
+        float uv_min_lambda, float uv_max_lambda, float inv_wavelength,
+        float frac_bandwidth, float time_int_sec, float gha0_rad,
+        float dec0_rad, float4c* d_vis, int* status)
+{
+    XCORR_SELECT(oskar_xcorr_phase_omp, true, float, float2, float4c,
+            d_vis, status)
+}
+
+void oskar_cross_correlate_phase_gaussian_omp_d(
+        int num_sources, int num_stations, int offset_out,
+        const double4c* d_jones, const double* d_I, const double* d_Q,
+        const double* d_U, const double* d_V,
+        const double* d_l, const double* d_m, const double* d_n,
+        const double* d_a, const double* d_b, const double* d_c,
+        const double* d_station_u, const double* d_station_v,
+        const double* d_station_w,
+        const double* d_station_x, const double* d_station_y,
+        double uv_min_lambda, double uv_max_lambda, double inv_wavelength,
+        double frac_bandwidth, double time_int_sec, double gha0_rad,
+        double dec0_rad, double4c* d_vis, int* status)
+{
+    XCORR_SELECT(oskar_xcorr_phase_omp, true, double, double2, double4c,
+            d_vis, status)
 }
@@ -28,33 +28,93 @@
 
 #include "correlate/define_correlate_utils.h"
 #include "correlate/oskar_cross_correlate_scalar_omp.h"
+#include "correlate/private_correlate_omp.h"
 #include "math/define_multiply.h"
-#include "math/oskar_kahan_sum.h"
 #include "utility/oskar_kernel_macros.h"
 #include "utility/oskar_vector_types.h"
-#include <stdio.h>
 
-template<typename T1, typename T2>
-struct is_same
+// Multiplies the Jones scalars for a tile of sources at one station with
+// the source brightness, and stores the results as planes.
+// This is done once for each station p, as it does not depend on station q.
+// The input Jones scalars are either interleaved, or already in planes.
+template<bool PLANES, typename REAL>
+XCORR_INLINE void xcorr_jones_brightness_scalar(
+        const int                i_start,
+        const int                num_in_tile,
+        const REAL* const        RESTRICT jones,
+        const REAL* const        RESTRICT source_I,
+        REAL* const              RESTRICT out)
 {
-    enum { value = false }; // is_same represents a bool.
-    typedef is_same<T1,T2> type; // to qualify as a metafunction.
-};
+    XCORR_SIMD
+    for (int j = 0; j < num_in_tile; ++j)
+    {
+        const REAL I = source_I[i_start + j];
+        const REAL* const p = PLANES ? &jones[j] : &jones[2 * j];
+        out[j]                      = p[0] * I;
+        out[j + XCORR_TILE_SOURCES] = p[PLANES ? XCORR_TILE_SOURCES : 1] * I;
+    }
+}
 
-template<typename T>
-struct is_same<T,T>
+// Correlates one tile of sources on one baseline, and accumulates the
+// result into the two double-precision values at sum.
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+XCORR_INLINE void xcorr_tile_scalar(
+        const int                         i_start,
+        const int                         num_in_tile,
+        const REAL*   const      RESTRICT station_p,
+        const REAL*   const      RESTRICT station_q,
+        const REAL*   const      RESTRICT source_l,
+        const REAL*   const      RESTRICT source_m,
+        const REAL*   const      RESTRICT source_n,
+        const REAL*   const      RESTRICT source_a,
+        const REAL*   const      RESTRICT source_b,
+        const REAL*   const      RESTRICT source_c,
+        const XcorrBaseline<REAL>&        t,
+        double*                  RESTRICT sum)
 {
-    enum { value = true };
-    typedef is_same<T,T> type;
-};
+    REAL s0 = 0, s1 = 0;
+
+    // Loop over sources in the tile.
+    XCORR_SIMD_REDUCTION(s0, s1)
+    for (int j = 0; j < num_in_tile; ++j)
+    {
+        const int i = i_start + j;
+        REAL smearing;
+        XCORR_SOURCE_FACTOR(BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                REAL, i, t, smearing)
 
+        // Multiply Jones scalars.
+        REAL2 t1, t2;
+        t1.x = station_p[j]; t1.y = station_p[j + XCORR_TILE_SOURCES];
+        t2.x = station_q[j]; t2.y = station_q[j + XCORR_TILE_SOURCES];
+        OSKAR_MUL_COMPLEX_CONJUGATE_IN_PLACE(REAL2, t1, t2)
+
+        // Multiply result by smearing term and accumulate.
+        s0 += t1.x * smearing;
+        s1 += t1.y * smearing;
+    }
+
+    // Partial sums are accumulated in double precision, so there is
+    // no need for compensated summation in single precision.
+    sum[0] += s0;
+    sum[1] += s1;
+}
+
+// Correlates all baselines that have station q in the given block.
 template
 <
 // Compile-time parameters.
 bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
 typename REAL, typename REAL2
 >
-void oskar_xcorr_scalar_omp(
+XCORR_INLINE void xcorr_block_scalar(
+        const int                   block,
+        const int                   block_size,
         const int                   num_sources,
         const int                   num_stations,
         const int                   offset_out,
@@ -78,115 +138,463 @@ void oskar_xcorr_scalar_omp(
         const REAL                  time_int_sec,
         const REAL                  gha0_rad,
         const REAL                  dec0_rad,
+        XcorrBaseline<REAL>*        terms,
+        double*                     sums,
+        REAL*                       tile,
         REAL2*             RESTRICT vis)
 {
-    // Loop over stations.
-#pragma omp parallel for schedule(dynamic, 1)
-    for (int SQ = 0; SQ < num_stations; ++SQ)
+    const int q_start = block * block_size;
+    const int q_end = (q_start + block_size < num_stations) ?
+            q_start + block_size : num_stations;
+
+    // Get common baseline values for all baselines in the block.
+    xcorr_baseline_terms<TIME_SMEARING, REAL>(q_start, q_end,
+            num_stations, station_u, station_v, station_w,
+            station_x, station_y, uv_min_lambda, uv_max_lambda,
+            inv_wavelength, frac_bandwidth, time_int_sec, gha0_rad, dec0_rad,
+            terms);
+    memset(sums, 0, 2 * block_size * num_stations * sizeof(double));
+
+    // Scratch space for the tiles of station p and the stations in the block.
+    const REAL* const jones_ = (const REAL*) jones;
+    REAL* const tile_p = tile;
+    REAL* const tile_q = tile + 2 * XCORR_TILE_SOURCES;
+
+    // Loop over tiles of sources.
+    for (int i_start = 0; i_start < num_sources;
+            i_start += XCORR_TILE_SOURCES)
     {
-        // Pointer to source vector for station q.
-        const REAL2* const station_q = &jones[SQ * num_sources];
+        const int num_in_tile = (i_start + XCORR_TILE_SOURCES < num_sources) ?
+                XCORR_TILE_SOURCES : num_sources - i_start;
 
-        // Loop over baselines for this station.
-        for (int SP = SQ + 1; SP < num_stations; ++SP)
+        // Copy the tile for each station q in the block, to reuse it.
+        for (int SQ = q_start; SQ < q_end; ++SQ)
+            xcorr_load_tile<2, REAL>(num_in_tile,
+                    &jones_[2 * ((size_t) SQ * num_sources + i_start)],
+                    &tile_q[2 * XCORR_TILE_SOURCES * (SQ - q_start)]);
+
+        // Loop over stations p, and over stations q in the block.
+        for (int SP = q_start + 1; SP < num_stations; ++SP)
         {
-            REAL uv_len, uu, vv, ww, uu2, vv2, uuvv, du, dv, dw;
-            REAL2 t1, t2, sum, guard;
-            sum.x = sum.y = (REAL) 0;
-            if (is_same<REAL, float>::value)
-                guard.x = guard.y = (REAL) 0;
+            xcorr_jones_brightness_scalar<false, REAL>(i_start, num_in_tile,
+                    &jones_[2 * ((size_t) SP * num_sources + i_start)],
+                    source_I, tile_p);
+            for (int SQ = q_start; SQ < q_end && SQ < SP; ++SQ)
+            {
+                const int j = (SQ - q_start) * num_stations + SP;
 
-            // Pointer to source vector for station p.
-            const REAL2* const station_p = &jones[SP * num_sources];
+                // Apply the baseline length filter.
+                if (!terms[j].use) continue;
+                xcorr_tile_scalar<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                        REAL, REAL2>(i_start, num_in_tile, tile_p,
+                        &tile_q[2 * XCORR_TILE_SOURCES * (SQ - q_start)],
+                        source_l, source_m, source_n,
+                        source_a, source_b, source_c, terms[j], &sums[2 * j]);
+            }
+        }
+    }
 
-            // Get common baseline values.
-            OSKAR_BASELINE_TERMS(REAL, station_u[SP], station_u[SQ],
-                    station_v[SP], station_v[SQ], station_w[SP], station_w[SQ],
-                    uu, vv, ww, uu2, vv2, uuvv, uv_len);
+    // Add results to the baseline visibilities.
+    for (int SQ = q_start; SQ < q_end; ++SQ)
+    {
+        for (int SP = SQ + 1; SP < num_stations; ++SP)
+        {
+            const int j = (SQ - q_start) * num_stations + SP;
+            if (!terms[j].use) continue;
+            const int i = OSKAR_BASELINE_INDEX(num_stations, SP, SQ) +
+                    offset_out;
+            vis[i].x += (REAL) sums[2 * j];
+            vis[i].y += (REAL) sums[2 * j + 1];
+        }
+    }
+}
 
-            // Apply the baseline length filter.
-            if (uv_len < uv_min_lambda || uv_len > uv_max_lambda) continue;
+// Correlates a single baseline using tiles on the stack.
+// This is used only if the scratch space for the blocks can't be allocated.
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+XCORR_INLINE void xcorr_baseline_scalar(
+        const int                   SP,
+        const int                   SQ,
+        const int                   num_sources,
+        const int                   num_stations,
+        const int                   offset_out,
+        const REAL2* const RESTRICT jones,
+        const REAL*  const RESTRICT source_I,
+        const REAL*  const RESTRICT source_l,
+        const REAL*  const RESTRICT source_m,
+        const REAL*  const RESTRICT source_n,
+        const REAL*  const RESTRICT source_a,
+        const REAL*  const RESTRICT source_b,
+        const REAL*  const RESTRICT source_c,
+        const REAL*  const RESTRICT station_u,
+        const REAL*  const RESTRICT station_v,
+        const REAL*  const RESTRICT station_w,
+        const REAL*  const RESTRICT station_x,
+        const REAL*  const RESTRICT station_y,
+        const REAL                  uv_min_lambda,
+        const REAL                  uv_max_lambda,
+        const REAL                  inv_wavelength,
+        const REAL                  frac_bandwidth,
+        const REAL                  time_int_sec,
+        const REAL                  gha0_rad,
+        const REAL                  dec0_rad,
+        REAL2*             RESTRICT vis)
+{
+    XcorrBaseline<REAL> t;
+    xcorr_baseline_term<TIME_SMEARING, REAL>(SP, SQ,
+            station_u, station_v, station_w, station_x, station_y,
+            uv_min_lambda, uv_max_lambda, inv_wavelength, frac_bandwidth,
+            time_int_sec, gha0_rad, dec0_rad, t);
+    if (!t.use) return;
+    REAL tile_p[2 * XCORR_TILE_SOURCES], tile_q[2 * XCORR_TILE_SOURCES];
+    double sum[2] = {0.0, 0.0};
+    const REAL* const jones_ = (const REAL*) jones;
+    for (int i_start = 0; i_start < num_sources;
+            i_start += XCORR_TILE_SOURCES)
+    {
+        const int num_in_tile = (i_start + XCORR_TILE_SOURCES < num_sources) ?
+                XCORR_TILE_SOURCES : num_sources - i_start;
+        xcorr_load_tile<2, REAL>(num_in_tile,
+                &jones_[2 * ((size_t) SQ * num_sources + i_start)], tile_q);
+        xcorr_jones_brightness_scalar<false, REAL>(i_start, num_in_tile,
+                &jones_[2 * ((size_t) SP * num_sources + i_start)],
+                source_I, tile_p);
+        xcorr_tile_scalar<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                REAL, REAL2>(i_start, num_in_tile, tile_p, tile_q,
+                source_l, source_m, source_n,
+                source_a, source_b, source_c, t, sum);
+    }
+    const int i = OSKAR_BASELINE_INDEX(num_stations, SP, SQ) + offset_out;
+    vis[i].x += (REAL) sum[0];
+    vis[i].y += (REAL) sum[1];
+}
 
-            // Compute the deltas for time-average smearing.
-            if (TIME_SMEARING)
-                OSKAR_BASELINE_DELTAS(REAL, station_x[SP], station_x[SQ],
-                        station_y[SP], station_y[SQ], du, dv, dw);
+// Applies the interferometer phase to the Jones scalars for a tile of
+// sources at one station, and multiplies the result with the source
+// brightness. Both products are stored as planes.
+template<typename REAL, typename REAL2>
+XCORR_INLINE void xcorr_station_phase_scalar(
+        const int                   s,
+        const int                   i_start,
+        const int                   num_in_tile,
+        const int                   num_sources,
+        const REAL                  wavenumber,
+        const REAL2* const RESTRICT jones,
+        const REAL*  const RESTRICT source_I,
+        const REAL*  const RESTRICT source_l,
+        const REAL*  const RESTRICT source_m,
+        const REAL*  const RESTRICT source_n,
+        const REAL*  const RESTRICT station_u,
+        const REAL*  const RESTRICT station_v,
+        const REAL*  const RESTRICT station_w,
+        REAL*              RESTRICT planes_p,
+        REAL*              RESTRICT planes_q)
+{
+    const size_t n = 2 * XCORR_TILE_SOURCES;
+    const REAL* const jones_ = (const REAL*) jones;
+    xcorr_load_tile_phase<2, REAL>(i_start, num_in_tile, wavenumber,
+            station_u[s], station_v[s], station_w[s],
+            source_l, source_m, source_n,
+            &jones_[2 * ((size_t) s * num_sources + i_start)],
+            &planes_q[n * s]);
+    xcorr_jones_brightness_scalar<true, REAL>(i_start, num_in_tile,
+            &planes_q[n * s], source_I, &planes_p[n * s]);
+}
 
-            // Loop over sources.
-            for (int i = 0; i < num_sources; ++i)
-            {
-                REAL smearing;
-                if (GAUSSIAN)
-                {
-                    const REAL t = source_a[i] * uu2 + source_b[i] * uuvv +
-                            source_c[i] * vv2;
-                    smearing = exp((REAL) -t);
-                }
-                else
-                {
-                    smearing = (REAL) 1;
-                }
-                smearing *= source_I[i];
-                if (BANDWIDTH_SMEARING || TIME_SMEARING)
-                {
-                    const REAL l = source_l[i];
-                    const REAL m = source_m[i];
-                    const REAL n = source_n[i] - (REAL) 1;
-                    if (BANDWIDTH_SMEARING)
-                    {
-                        const REAL t = uu * l + vv * m + ww * n;
-                        smearing *= OSKAR_SINC(REAL, t);
-                    }
-                    if (TIME_SMEARING)
-                    {
-                        const REAL t = du * l + dv * m + dw * n;
-                        smearing *= OSKAR_SINC(REAL, t);
-                    }
-                }
-
-                // Multiply Jones scalars.
-                t1 = station_p[i];
-                t2 = station_q[i];
-                OSKAR_MUL_COMPLEX_CONJUGATE_IN_PLACE(REAL2, t1, t2)
-
-                // Multiply result by smearing term and accumulate.
-                if (is_same<REAL, float>::value)
-                {
-                    OSKAR_KAHAN_SUM_MULTIPLY_COMPLEX(
-                            REAL, sum, t1, smearing, guard)
-                }
-                else
-                {
-                    sum.x += t1.x * smearing;
-                    sum.y += t1.y * smearing;
-                }
-            }
+// Correlates one tile of sources on all baselines that have station q in
+// the given block, using the planes from xcorr_station_phase_scalar().
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+XCORR_INLINE void xcorr_block_phase_scalar(
+        const int                                block,
+        const int                                block_size,
+        const int                                num_stations,
+        const int                                i_start,
+        const int                                num_in_tile,
+        const REAL*                const RESTRICT planes_p,
+        const REAL*                const RESTRICT planes_q,
+        const REAL*                const RESTRICT source_l,
+        const REAL*                const RESTRICT source_m,
+        const REAL*                const RESTRICT source_n,
+        const REAL*                const RESTRICT source_a,
+        const REAL*                const RESTRICT source_b,
+        const REAL*                const RESTRICT source_c,
+        const XcorrBaseline<REAL>* const RESTRICT terms,
+        double*                          RESTRICT sums)
+{
+    const size_t n = 2 * XCORR_TILE_SOURCES;
+    const int q_start = block * block_size;
+    const int q_end = (q_start + block_size < num_stations) ?
+            q_start + block_size : num_stations;
+    for (int SP = q_start + 1; SP < num_stations; ++SP)
+    {
+        for (int SQ = q_start; SQ < q_end && SQ < SP; ++SQ)
+        {
+            const int j = OSKAR_BASELINE_INDEX(num_stations, SP, SQ);
 
-            // Add result to the baseline visibility.
-            int i = OSKAR_BASELINE_INDEX(num_stations, SP, SQ) + offset_out;
-            vis[i].x += sum.x;
-            vis[i].y += sum.y;
+            // Apply the baseline length filter.
+            if (!terms[j].use) continue;
+            xcorr_tile_scalar<BANDWIDTH_SMEARING, TIME_SMEARING, GAUSSIAN,
+                    REAL, REAL2>(i_start, num_in_tile,
+                    &planes_p[n * SP], &planes_q[n * SQ],
+                    source_l, source_m, source_n,
+                    source_a, source_b, source_c, terms[j], &sums[2 * j]);
         }
     }
 }
 
-#define XCORR_KERNEL(BS, TS, GAUSSIAN, REAL, REAL2)                         \
-        oskar_xcorr_scalar_omp<BS, TS, GAUSSIAN, REAL, REAL2>               \
+// The parallel region must be in the function that has the target
+// attribute, so that the compiler uses it for the outlined thread function.
+// If any thread can't allocate its scratch space, all threads correlate
+// single baselines instead, so that no error needs to be returned.
+#define XCORR_PARALLEL_BODY                                                 \
+        const int block_size = xcorr_block_size(num_stations);              \
+        const int num_blocks = (num_stations + block_size - 1) / block_size;\
+        int alloc_failed = 0;                                               \
+        DO_PRAGMA(omp parallel)                                             \
+        {                                                                   \
+            const size_t n = (size_t) block_size * num_stations;            \
+            XcorrBaseline<REAL>* terms = (XcorrBaseline<REAL>*)             \
+                    malloc(n * sizeof(XcorrBaseline<REAL>));                \
+            double* sums = (double*) malloc(2 * n * sizeof(double));        \
+            REAL* tile = (REAL*) malloc(2 * XCORR_TILE_SOURCES *            \
+                    (block_size + 1) * sizeof(REAL));                       \
+            if (!terms || !sums || !tile)                                   \
+            {                                                               \
+                DO_PRAGMA(omp atomic)                                       \
+                alloc_failed++;                                             \
+            }                                                               \
+            DO_PRAGMA(omp barrier)                                          \
+            if (!alloc_failed)                                              \
+            {                                                               \
+                DO_PRAGMA(omp for schedule(dynamic, 1))                     \
+                for (int b = 0; b < num_blocks; ++b)                        \
+                    xcorr_block_scalar<BANDWIDTH_SMEARING, TIME_SMEARING,   \
+                            GAUSSIAN, REAL, REAL2>(b, block_size,           \
+                            num_sources, num_stations, offset_out, jones,   \
+                            source_I, source_l, source_m, source_n,         \
+                            source_a, source_b, source_c,                   \
+                            station_u, station_v, station_w,                \
+                            station_x, station_y,                           \
+                            uv_min_lambda, uv_max_lambda, inv_wavelength,   \
+                            frac_bandwidth, time_int_sec,                   \
+                            gha0_rad, dec0_rad, terms, sums, tile, vis);    \
+            }                                                               \
+            else                                                            \
+            {                                                               \
+                DO_PRAGMA(omp for schedule(dynamic, 1))                     \
+                for (int SQ = 0; SQ < num_stations; ++SQ)                   \
+                    for (int SP = SQ + 1; SP < num_stations; ++SP)          \
+                        xcorr_baseline_scalar<BANDWIDTH_SMEARING,           \
+                                TIME_SMEARING, GAUSSIAN, REAL, REAL2>(      \
+                                SP, SQ, num_sources, num_stations,          \
+                                offset_out, jones, source_I,                \
+                                source_l, source_m, source_n,               \
+                                source_a, source_b, source_c,               \
+                                station_u, station_v, station_w,            \
+                                station_x, station_y,                       \
+                                uv_min_lambda, uv_max_lambda,               \
+                                inv_wavelength, frac_bandwidth,             \
+                                time_int_sec, gha0_rad, dec0_rad, vis);     \
+            }                                                               \
+            free(tile);                                                     \
+            free(sums);                                                     \
+            free(terms);                                                    \
+        }
+
+// With the interferometer phase applied here, the Jones scalars for each
+// tile of sources are multiplied by the phase once per station, and the
+// results are shared by all threads before the baselines are correlated.
+#define XCORR_PHASE_PARALLEL_BODY                                           \
+        const int block_size = xcorr_block_size(num_stations);              \
+        const int num_blocks = (num_stations + block_size - 1) / block_size;\
+        const int num_baselines = num_stations * (num_stations - 1) / 2;    \
+        const size_t n = (size_t) 2 * XCORR_TILE_SOURCES * num_stations;    \
+        const REAL wavenumber = (REAL) (2.0 * M_PI) * inv_wavelength;       \
+        if (num_baselines == 0) return;                                     \
+        XcorrBaseline<REAL>* terms = (XcorrBaseline<REAL>*)                 \
+                malloc(num_baselines * sizeof(XcorrBaseline<REAL>));        \
+        double* sums = (double*) calloc(2 * (size_t) num_baselines,         \
+                sizeof(double));                                            \
+        REAL* planes = (REAL*) malloc(2 * n * sizeof(REAL));                \
+        if (!terms || !sums || !planes)                                     \
+        {                                                                   \
+            free(planes);                                                   \
+            free(sums);                                                     \
+            free(terms);                                                    \
+            *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;                       \
+            return;                                                         \
+        }                                                                   \
+        DO_PRAGMA(omp parallel)                                             \
+        {                                                                   \
+            DO_PRAGMA(omp for schedule(dynamic, 1))                         \
+            for (int SQ = 0; SQ < num_stations; ++SQ)                       \
+                for (int SP = SQ + 1; SP < num_stations; ++SP)              \
+                    xcorr_baseline_term<TIME_SMEARING, REAL>(SP, SQ,        \
+                            station_u, station_v, station_w,                \
+                            station_x, station_y,                           \
+                            uv_min_lambda, uv_max_lambda, inv_wavelength,   \
+                            frac_bandwidth, time_int_sec,                   \
+                            gha0_rad, dec0_rad,                             \
+                            terms[OSKAR_BASELINE_INDEX(num_stations, SP, SQ)]);\
+            for (int i_start = 0; i_start < num_sources;                    \
+                    i_start += XCORR_TILE_SOURCES)                          \
+            {                                                               \
+                const int num_in_tile =                                     \
+                        (i_start + XCORR_TILE_SOURCES < num_sources) ?      \
+                        XCORR_TILE_SOURCES : num_sources - i_start;         \
+                DO_PRAGMA(omp for)                                          \
+                for (int s = 0; s < num_stations; ++s)                      \
+                    xcorr_station_phase_scalar<REAL, REAL2>(s, i_start,     \
+                            num_in_tile, num_sources, wavenumber, jones,    \
+                            source_I, source_l, source_m, source_n,         \
+                            station_u, station_v, station_w,                \
+                            planes, planes + n);                            \
+                DO_PRAGMA(omp for schedule(dynamic, 1))                     \
+                for (int b = 0; b < num_blocks; ++b)                        \
+                    xcorr_block_phase_scalar<BANDWIDTH_SMEARING,            \
+                            TIME_SMEARING, GAUSSIAN, REAL, REAL2>(b,        \
+                            block_size, num_stations, i_start, num_in_tile, \
+                            planes, planes + n,                             \
+                            source_l, source_m, source_n,                   \
+                            source_a, source_b, source_c, terms, sums);     \
+            }                                                               \
+            DO_PRAGMA(omp for)                                              \
+            for (int j = 0; j < num_baselines; ++j)                         \
+            {                                                               \
+                if (!terms[j].use) continue;                                \
+                vis[j + offset_out].x += (REAL) sums[2 * j];                \
+                vis[j + offset_out].y += (REAL) sums[2 * j + 1];            \
+            }                                                               \
+        }                                                                   \
+        free(planes);                                                       \
+        free(sums);                                                         \
+        free(terms);
+
+#define XCORR_ARGS(REAL, REAL2)                                             \
+        const int                   num_sources,                            \
+        const int                   num_stations,                           \
+        const int                   offset_out,                             \
+        const REAL2* const RESTRICT jones,                                  \
+        const REAL*  const RESTRICT source_I,                               \
+        const REAL*  const RESTRICT source_l,                               \
+        const REAL*  const RESTRICT source_m,                               \
+        const REAL*  const RESTRICT source_n,                               \
+        const REAL*  const RESTRICT source_a,                               \
+        const REAL*  const RESTRICT source_b,                               \
+        const REAL*  const RESTRICT source_c,                               \
+        const REAL*  const RESTRICT station_u,                              \
+        const REAL*  const RESTRICT station_v,                              \
+        const REAL*  const RESTRICT station_w,                              \
+        const REAL*  const RESTRICT station_x,                              \
+        const REAL*  const RESTRICT station_y,                              \
+        const REAL                  uv_min_lambda,                          \
+        const REAL                  uv_max_lambda,                          \
+        const REAL                  inv_wavelength,                         \
+        const REAL                  frac_bandwidth,                         \
+        const REAL                  time_int_sec,                           \
+        const REAL                  gha0_rad,                               \
+        const REAL                  dec0_rad,                               \
+        REAL2*             RESTRICT vis
+
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+void oskar_xcorr_scalar_omp(XCORR_ARGS(REAL, REAL2))
+{
+    XCORR_PARALLEL_BODY
+}
+
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+void oskar_xcorr_scalar_phase_omp(XCORR_ARGS(REAL, REAL2), int* status)
+{
+    XCORR_PHASE_PARALLEL_BODY
+}
+
+#ifdef XCORR_HAVE_AVX2
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+XCORR_TARGET_AVX2
+void oskar_xcorr_scalar_omp_avx2(XCORR_ARGS(REAL, REAL2))
+{
+    XCORR_PARALLEL_BODY
+}
+
+template
+<
+// Compile-time parameters.
+bool BANDWIDTH_SMEARING, bool TIME_SMEARING, bool GAUSSIAN,
+typename REAL, typename REAL2
+>
+XCORR_TARGET_AVX2
+void oskar_xcorr_scalar_phase_omp_avx2(XCORR_ARGS(REAL, REAL2), int* status)
+{
+    XCORR_PHASE_PARALLEL_BODY
+}
+
+#define XCORR_KERNEL(NAME, BS, TS, GAUSSIAN, REAL, REAL2, ...) {            \
+        if (xcorr_use_avx2())                                               \
+            NAME##_avx2<BS, TS, GAUSSIAN, REAL, REAL2>                      \
+            (num_sources, num_stations, offset_out, d_jones, d_I,           \
+                d_l, d_m, d_n, d_a, d_b, d_c,                               \
+                d_station_u, d_station_v, d_station_w,                      \
+                d_station_x, d_station_y, uv_min_lambda, uv_max_lambda,     \
+                inv_wavelength, frac_bandwidth, time_int_sec,               \
+                gha0_rad, dec0_rad, __VA_ARGS__);                           \
+        else                                                                \
+            NAME<BS, TS, GAUSSIAN, REAL, REAL2>                             \
+            (num_sources, num_stations, offset_out, d_jones, d_I,           \
+                d_l, d_m, d_n, d_a, d_b, d_c,                               \
+                d_station_u, d_station_v, d_station_w,                      \
+                d_station_x, d_station_y, uv_min_lambda, uv_max_lambda,     \
+                inv_wavelength, frac_bandwidth, time_int_sec,               \
+                gha0_rad, dec0_rad, __VA_ARGS__); }
+#else
+#define XCORR_KERNEL(NAME, BS, TS, GAUSSIAN, REAL, REAL2, ...)              \
+        NAME<BS, TS, GAUSSIAN, REAL, REAL2>                                 \
         (num_sources, num_stations, offset_out, d_jones, d_I, d_l, d_m, d_n,\
                 d_a, d_b, d_c, d_station_u, d_station_v, d_station_w,       \
                 d_station_x, d_station_y, uv_min_lambda, uv_max_lambda,     \
                 inv_wavelength, frac_bandwidth, time_int_sec,               \
-                gha0_rad, dec0_rad, d_vis);
+                gha0_rad, dec0_rad, __VA_ARGS__);
+#endif
 
-#define XCORR_SELECT(GAUSSIAN, REAL, REAL2)                                 \
+// Selects the kernel NAME for the smearing options in use.
+// The remaining arguments are passed after the common ones.
+#define XCORR_SELECT(NAME, GAUSSIAN, REAL, REAL2, ...)                      \
         if (frac_bandwidth == (REAL)0 && time_int_sec == (REAL)0)           \
-            XCORR_KERNEL(false, false, GAUSSIAN, REAL, REAL2)               \
+            XCORR_KERNEL(NAME, false, false, GAUSSIAN, REAL, REAL2,         \
+                    __VA_ARGS__)                                            \
         else if (frac_bandwidth != (REAL)0 && time_int_sec == (REAL)0)      \
-            XCORR_KERNEL(true, false, GAUSSIAN, REAL, REAL2)                \
+            XCORR_KERNEL(NAME, true, false, GAUSSIAN, REAL, REAL2,          \
+                    __VA_ARGS__)                                            \
         else if (frac_bandwidth == (REAL)0 && time_int_sec != (REAL)0)      \
-            XCORR_KERNEL(false, true, GAUSSIAN, REAL, REAL2)                \
+            XCORR_KERNEL(NAME, false, true, GAUSSIAN, REAL, REAL2,          \
+                    __VA_ARGS__)                                            \
         else if (frac_bandwidth != (REAL)0 && time_int_sec != (REAL)0)      \
-            XCORR_KERNEL(true, true, GAUSSIAN, REAL, REAL2)
+            XCORR_KERNEL(NAME, true, true, GAUSSIAN, REAL, REAL2,           \
+                    __VA_ARGS__)
 
 void oskar_cross_correlate_scalar_point_omp_f(
         int num_sources, int num_stations, int offset_out,
@@ -199,7 +607,7 @@ void oskar_cross_correlate_scalar_point_omp_f(
         const float gha0_rad, const float dec0_rad, float2* d_vis)
 {
     const float *d_a = 0, *d_b = 0, *d_c = 0;
-    XCORR_SELECT(false, float, float2)
+    XCORR_SELECT(oskar_xcorr_scalar_omp, false, float, float2, d_vis)
 }
 
 void oskar_cross_correlate_scalar_point_omp_d(
@@ -213,7 +621,7 @@ void oskar_cross_correlate_scalar_point_omp_d(
         const double gha0_rad, const double dec0_rad, double2* d_vis)
 {
     const double *d_a = 0, *d_b = 0, *d_c = 0;
-    XCORR_SELECT(false, double, double2)
+    XCORR_SELECT(oskar_xcorr_scalar_omp, false, double, double2, d_vis)
 }
 
 void oskar_cross_correlate_scalar_gaussian_omp_f(
@@ -228,7 +636,7 @@ void oskar_cross_correlate_scalar_gaussian_omp_f(
         float frac_bandwidth, float time_int_sec, float gha0_rad,
         float dec0_rad, float2* d_vis)
 {
-    XCORR_SELECT(true, float, float2)
+    XCORR_SELECT(oskar_xcorr_scalar_omp, true, float, float2, d_vis)
 }
 
 void oskar_cross_correlate_scalar_gaussian_omp_d(
@@ -243,5 +651,65 @@ void oskar_cross_correlate_scalar_gaussian_omp_d(
         double frac_bandwidth, double time_int_sec, double gha0_rad,
         double dec0_rad, double2* d_vis)
 {
-    XCORR_SELECT(true, double, double2)
+    XCORR_SELECT(oskar_xcorr_scalar_omp, true, double, double2, d_vis)
+}
+
+void oskar_cross_correlate_scalar_phase_point_omp_f(
+        int num_sources, int num_stations, int offset_out,
+        const float2* d_jones, const float* d_I, const float* d_l,
+        const float* d_m, const float* d_n,
+        const float* d_station_u, const float* d_station_v,
+        const float* d_station_w, const float* d_station_x,
+        const float* d_station_y, float uv_min_lambda, float uv_max_lambda,
+        float inv_wavelength, float frac_bandwidth, float time_int_sec,
+        float gha0_rad, float dec0_rad, float2* d_vis, int* status)
+{
+    const float *d_a = 0, *d_b = 0, *d_c = 0;
+    XCORR_SELECT(oskar_xcorr_scalar_phase_omp, false, float, float2,
+            d_vis, status)
+}
+
+void oskar_cross_correlate_scalar_phase_point_omp_d(
+        int num_sources, int num_stations, int offset_out,
+        const double2* d_jones, const double* d_I, const double* d_l,
+        const double* d_m, const double* d_n,
+        const double* d_station_u, const double* d_station_v,
+        const double* d_station_w, const double* d_station_x,
+        const double* d_station_y, double uv_min_lambda, double uv_max_lambda,
+        double inv_wavelength, double frac_bandwidth, double time_int_sec,
+        double gha0_rad, double dec0_rad, double2* d_vis, int* status)
+{
+    const double *d_a = 0, *d_b = 0, *d_c = 0;
+    XCORR_SELECT(oskar_xcorr_scalar_phase_omp, false, double, double2,
+            d_vis, status)
+}
+
+void oskar_cross_correlate_scalar_phase_gaussian_omp_f(
+        int num_sources, int num_stations, int offset_out,
+        const float2* d_jones, const float* d_I, const float* d_l,
+        const float* d_m, const float* d_n,
+        const float* d_a, const float* d_b, const float* d_c,
+        const float* d_station_u, const float* d_station_v,
+        const float* d_station_w, const float* d_station_x,
+        const float* d_station_y, float uv_min_lambda, float uv_max_lambda,
+        float inv_wavelength, float frac_bandwidth, float time_int_sec,
+        float gha0_rad, float dec0_rad, float2* d_vis, int* status)
+{
+    XCORR_SELECT(oskar_xcorr_scalar_phase_omp, true, float, float2,
+            d_vis, status)
+}
+
+void oskar_cross_correlate_scalar_phase_gaussian_omp_d(
+        int num_sources, int num_stations, int offset_out,
+        const double2* d_jones, const double* d_I, const double* d_l,
+        const double* d_m, const double* d_n,
+        const double* d_a, const double* d_b, const double* d_c,
+        const double* d_station_u, const double* d_station_v,
+        const double* d_station_w, const double* d_station_x,
+        const double* d_station_y, double uv_min_lambda, double uv_max_lambda,
+        double inv_wavelength, double frac_bandwidth, double time_int_sec,
+        double gha0_rad, double dec0_rad, double2* d_vis, int* status)
+{
+    XCORR_SELECT(oskar_xcorr_scalar_phase_omp, true, double, double2,
+            d_vis, status)
 }
@@ -31,8 +31,11 @@
 #include "utility/oskar_timer.h"
 
 #include "correlate/oskar_cross_correlate.h"
+#include "interferometer/oskar_evaluate_jones_K.h"
 #include "utility/oskar_get_error_string.h"
 #include "math/oskar_kahan_sum.h"
+#include <cfloat>
+#include <cmath>
 #include <cstdlib>
 
 // Comment out this line to disable benchmark timer printing.
@@ -223,10 +226,85 @@ protected:
                 time2 * 1000.0);
 #endif
     }
+
+    void runPhaseTest(int prec, int matrix, int extended, double time_average)
+    {
+        int num_baselines, status = 0, type;
+        oskar_Mem *vis1, *vis2;
+        oskar_Jones *K, *J;
+        double frequency = 100e6;
+
+        // Evaluate Jones K and join it with the other Jones terms.
+        createTestData(prec, OSKAR_CPU, matrix);
+        num_baselines = oskar_telescope_num_baselines(tel);
+        type = prec | OSKAR_COMPLEX;
+        if (matrix) type |= OSKAR_MATRIX;
+        K = oskar_jones_create(prec | OSKAR_COMPLEX, OSKAR_CPU,
+                num_stations, num_sources, &status);
+        J = oskar_jones_create(type, OSKAR_CPU,
+                num_stations, num_sources, &status);
+        oskar_evaluate_jones_K(K, num_sources, oskar_sky_l_const(sky),
+                oskar_sky_m_const(sky), oskar_sky_n_const(sky),
+                u_, v_, w_, frequency, oskar_sky_I_const(sky),
+                -DBL_MAX, DBL_MAX, &status);
+        oskar_jones_join(J, K, jones, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        // Correlate the joined Jones matrices.
+        vis1 = oskar_mem_create(type, OSKAR_CPU, num_baselines, &status);
+        vis2 = oskar_mem_create(type, OSKAR_CPU, num_baselines, &status);
+        oskar_mem_clear_contents(vis1, &status);
+        oskar_mem_clear_contents(vis2, &status);
+        oskar_sky_set_use_extended(sky, extended);
+        oskar_telescope_set_channel_bandwidth(tel, bandwidth);
+        oskar_telescope_set_time_average(tel, time_average);
+        oskar_cross_correlate(num_sources, J, sky,
+                tel, u_, v_, w_, 1.0, frequency, 0, vis1, &status);
+
+        // Correlate without Jones K, applying the phase per baseline.
+        oskar_cross_correlate_with_phase(num_sources, jones, sky,
+                tel, u_, v_, w_, 1.0, frequency, 0, vis2, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        // Compare results.
+        check_values(vis2, vis1);
+
+        // Free memory.
+        oskar_jones_free(K, &status);
+        oskar_jones_free(J, &status);
+        oskar_mem_free(vis1, &status);
+        oskar_mem_free(vis2, &status);
+        destroyTestData();
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    }
 };
 
 const double cross_correlate::bandwidth = 1e4;
 
+TEST_F(cross_correlate, with_phase_matrix_point)
+{
+    runPhaseTest(OSKAR_DOUBLE, 1, 0, 0.0);
+    runPhaseTest(OSKAR_SINGLE, 1, 0, 0.0);
+}
+
+TEST_F(cross_correlate, with_phase_matrix_gaussian_timeSmearing)
+{
+    runPhaseTest(OSKAR_DOUBLE, 1, 1, 10.0);
+    runPhaseTest(OSKAR_SINGLE, 1, 1, 10.0);
+}
+
+TEST_F(cross_correlate, with_phase_scalar_point)
+{
+    runPhaseTest(OSKAR_DOUBLE, 0, 0, 0.0);
+    runPhaseTest(OSKAR_SINGLE, 0, 0, 0.0);
+}
+
+TEST_F(cross_correlate, with_phase_scalar_gaussian_timeSmearing)
+{
+    runPhaseTest(OSKAR_DOUBLE, 0, 1, 10.0);
+    runPhaseTest(OSKAR_SINGLE, 0, 1, 10.0);
+}
+
 // CPU only.
 TEST_F(cross_correlate, matrix_point_singleCPU_doubleCPU)
 {
@@ -542,6 +620,107 @@ TEST_F(cross_correlate, scalar_gaussian_timeSmearing_singleCPU_doubleGPU)
 }
 #endif
 
+// A source at the phase centre is not smeared, so the visibilities must be
+// the same with and without bandwidth and time smearing.
+static void run_phase_centre_test(int prec, int matrix, int extended)
+{
+    int status = 0;
+    const int num_sources = 3, num_stations = 10;
+    const double frequency = 100e6;
+    oskar_Mem* vis[2];
+    int type = prec | OSKAR_COMPLEX;
+    if (matrix) type |= OSKAR_MATRIX;
+    oskar_Jones* jones = oskar_jones_create(type, OSKAR_CPU,
+            num_stations, num_sources, &status);
+    oskar_Mem* u = oskar_mem_create(prec, OSKAR_CPU, num_stations, &status);
+    oskar_Mem* v = oskar_mem_create(prec, OSKAR_CPU, num_stations, &status);
+    oskar_Mem* w = oskar_mem_create(prec, OSKAR_CPU, num_stations, &status);
+    oskar_Sky* sky = oskar_sky_create(prec, OSKAR_CPU, num_sources, &status);
+    oskar_Telescope* tel = oskar_telescope_create(prec, OSKAR_CPU,
+            num_stations, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    srand(3);
+    oskar_mem_random_range(oskar_jones_mem(jones), 1.0, 5.0, &status);
+    oskar_mem_random_range(u, 1.0, 500.0, &status);
+    oskar_mem_random_range(v, 1.0, 500.0, &status);
+    oskar_mem_random_range(w, 1.0, 50.0, &status);
+    oskar_mem_random_range(
+            oskar_telescope_station_true_x_offset_ecef_metres(tel),
+            0.1, 1000.0, &status);
+    oskar_mem_random_range(
+            oskar_telescope_station_true_y_offset_ecef_metres(tel),
+            0.1, 1000.0, &status);
+    oskar_mem_random_range(oskar_sky_I(sky), 1.0, 2.0, &status);
+    oskar_mem_random_range(oskar_sky_Q(sky), 0.1, 1.0, &status);
+    oskar_mem_random_range(oskar_sky_U(sky), 0.1, 0.5, &status);
+    oskar_mem_random_range(oskar_sky_V(sky), 0.1, 0.2, &status);
+    oskar_mem_random_range(oskar_sky_gaussian_a(sky), 0.1e-6, 0.2e-6,
+            &status);
+    oskar_mem_random_range(oskar_sky_gaussian_b(sky), 0.1e-6, 0.2e-6,
+            &status);
+    oskar_mem_random_range(oskar_sky_gaussian_c(sky), 0.1e-6, 0.2e-6,
+            &status);
+    oskar_mem_clear_contents(oskar_sky_l(sky), &status);
+    oskar_mem_clear_contents(oskar_sky_m(sky), &status);
+    oskar_mem_set_value_real(oskar_sky_n(sky), 1.0, 0, num_sources, &status);
+    oskar_sky_set_use_extended(sky, extended);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    for (int i = 0; i < 2; ++i)
+    {
+        vis[i] = oskar_mem_create(type, OSKAR_CPU,
+                oskar_telescope_num_baselines(tel), &status);
+        oskar_mem_clear_contents(vis[i], &status);
+        oskar_telescope_set_channel_bandwidth(tel, i ? 1e6 : 0.0);
+        oskar_telescope_set_time_average(tel, i ? 10.0 : 0.0);
+        oskar_cross_correlate(num_sources, jones, sky, tel, u, v, w,
+                1.0, frequency, 0, vis[i], &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    }
+
+    // Check the values are finite, and the same in both cases.
+    const double tol = (prec == OSKAR_DOUBLE) ? 1e-12 : 1e-5;
+    const size_t n = oskar_mem_length(vis[0]) *
+            oskar_mem_element_size(oskar_mem_type(vis[0])) /
+            oskar_mem_element_size(prec);
+    for (size_t i = 0; i < n; ++i)
+    {
+        double a, b;
+        if (prec == OSKAR_DOUBLE)
+        {
+            a = oskar_mem_double(vis[0], &status)[i];
+            b = oskar_mem_double(vis[1], &status)[i];
+        }
+        else
+        {
+            a = oskar_mem_float(vis[0], &status)[i];
+            b = oskar_mem_float(vis[1], &status)[i];
+        }
+        ASSERT_TRUE(std::isfinite(b)) << "Index " << i;
+        ASSERT_NEAR(a, b, tol * fabs(a)) << "Index " << i;
+    }
+    oskar_mem_free(vis[0], &status);
+    oskar_mem_free(vis[1], &status);
+    oskar_jones_free(jones, &status);
+    oskar_mem_free(u, &status);
+    oskar_mem_free(v, &status);
+    oskar_mem_free(w, &status);
+    oskar_sky_free(sky, &status);
+    oskar_telescope_free(tel, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+}
+
+TEST(cross_correlate_smearing, phase_centre)
+{
+    for (int matrix = 0; matrix < 2; ++matrix)
+    {
+        for (int extended = 0; extended < 2; ++extended)
+        {
+            run_phase_centre_test(OSKAR_SINGLE, matrix, extended);
+            run_phase_centre_test(OSKAR_DOUBLE, matrix, extended);
+        }
+    }
+}
+
 #if 0
 TEST(KahanSum, sum)
 {
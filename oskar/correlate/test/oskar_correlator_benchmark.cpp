@@ -28,6 +28,7 @@
 
 #include "settings/oskar_option_parser.h"
 #include "correlate/oskar_cross_correlate.h"
+#include "interferometer/oskar_evaluate_jones_K.h"
 #include "interferometer/oskar_jones.h"
 #include "sky/oskar_sky.h"
 #include "telescope/oskar_telescope.h"
@@ -36,6 +37,7 @@
 #include "utility/oskar_device.h"
 #include "oskar_version.h"
 
+#include <cfloat>
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
@@ -44,10 +46,17 @@
 
 static void benchmark(int num_stations, int num_sources, int type,
         int jones_type, int location, int use_extended,
-        int use_bandwidth_smearing, int use_time_smearing,
+        int use_bandwidth_smearing, int use_time_smearing, int phase_mode,
         int niter, std::vector<double>& times, const std::string& ascii_file,
         int* status);
 
+enum PHASE_MODE
+{
+    PHASE_NONE,  // Correlate the supplied Jones matrices only.
+    PHASE_JOIN,  // Evaluate Jones K and join it before correlating.
+    PHASE_FUSED  // Apply the interferometer phase inside the correlator.
+};
+
 int main(int argc, char** argv)
 {
     oskar::OptionParser opt("oskar_correlator_benchmark", OSKAR_VERSION_STR);
@@ -61,6 +70,10 @@ int main(int argc, char** argv)
     opt.add_flag("-e", "Use Gaussian sources (default: point sources).");
     opt.add_flag("-b", "Use bandwidth smearing (default: no bandwidth smearing).");
     opt.add_flag("-t", "Use time smearing (default: no time smearing).");
+    opt.add_flag("-k", "Include Jones K: evaluate and join it before "
+            "correlating.");
+    opt.add_flag("-f", "Include Jones K: apply the interferometer phase "
+            "inside the correlator (CPU only).");
     opt.add_flag("-r", "Dump raw iteration data to this file.", 1);
     opt.add_flag("-a", "Dump ASCII visibility data to this file.", 1);
     opt.add_flag("-std", "Discard values greater than this number of standard "
@@ -82,6 +95,11 @@ int main(int argc, char** argv)
     int use_extended = opt.is_set("-e") ? OSKAR_TRUE : OSKAR_FALSE;
     int use_bandwidth_smearing = opt.is_set("-b") ? OSKAR_TRUE : OSKAR_FALSE;
     int use_time_smearing = opt.is_set("-t") ? OSKAR_TRUE : OSKAR_FALSE;
+    int phase_mode = PHASE_NONE;
+    if (opt.is_set("-k"))
+        phase_mode = PHASE_JOIN;
+    if (opt.is_set("-f"))
+        phase_mode = PHASE_FUSED;
     std::string raw_file, ascii_file;
     if (opt.is_set("-r"))
         raw_file = opt.get_string("-r");
@@ -113,6 +131,8 @@ int main(int argc, char** argv)
                 "true" : "false");
         printf("- Time smearing: %s\n", (use_time_smearing) ?
                 "true" : "false");
+        printf("- Jones K: %s\n", phase_mode == PHASE_JOIN ? "joined" :
+                (phase_mode == PHASE_FUSED ? "fused" : "none"));
         printf("- Number of iterations: %i\n", niter);
         if (max_std_dev > 0.0)
             printf("- Max standard deviations: %f\n", max_std_dev);
@@ -127,7 +147,7 @@ int main(int argc, char** argv)
     std::vector<double> times;
     benchmark(num_stations, num_sources, type, jones_type, location,
             use_extended, use_bandwidth_smearing, use_time_smearing,
-            niter, times, ascii_file, &status);
+            phase_mode, niter, times, ascii_file, &status);
 
     // Compute total time taken.
     for (int i = 0; i < niter; ++i)
@@ -215,7 +235,7 @@ int main(int argc, char** argv)
 
 void benchmark(int num_stations, int num_sources, int type,
         int jones_type, int location, int use_extended,
-        int use_bandwidth_smearing, int use_time_smearing,
+        int use_bandwidth_smearing, int use_time_smearing, int phase_mode,
         int niter, std::vector<double>& times, const std::string& ascii_file,
         int* status)
 {
@@ -227,6 +247,10 @@ void benchmark(int num_stations, int num_sources, int type,
     oskar_Sky* sky = oskar_sky_create(type, location, num_sources, status);
     oskar_Jones* J = oskar_jones_create(jones_type, location, num_stations,
             num_sources, status);
+    oskar_Jones* E = oskar_jones_create(jones_type, location, num_stations,
+            num_sources, status);
+    oskar_Jones* K = oskar_jones_create(type | OSKAR_COMPLEX, location,
+            num_stations, num_sources, status);
 
     // Allocate memory for visibility coordinates and output visibility slice.
     oskar_Mem* vis = oskar_mem_create(jones_type, location,
@@ -237,7 +261,7 @@ void benchmark(int num_stations, int num_sources, int type,
 
     // Fill data structures with random data in sensible ranges.
     srand(2);
-    oskar_mem_random_range(oskar_jones_mem(J), 1.0, 5.0, status);
+    oskar_mem_random_range(oskar_jones_mem(E), 1.0, 5.0, status);
     oskar_mem_random_range(u, 1.0, 5.0, status);
     oskar_mem_random_range(v, 1.0, 5.0, status);
     oskar_mem_random_range(w, 1.0, 5.0, status);
@@ -275,8 +299,26 @@ void benchmark(int num_stations, int num_sources, int type,
     {
         oskar_mem_clear_contents(vis, status);
         oskar_timer_start(timer);
-        oskar_cross_correlate(oskar_sky_num_sources(sky), J, sky, tel,
-                u, v, w, 0.0, 100e6, 0, vis, status);
+        if (phase_mode == PHASE_FUSED)
+        {
+            oskar_cross_correlate_with_phase(oskar_sky_num_sources(sky), E,
+                    sky, tel, u, v, w, 0.0, 100e6, 0, vis, status);
+        }
+        else if (phase_mode == PHASE_JOIN)
+        {
+            oskar_evaluate_jones_K(K, oskar_sky_num_sources(sky),
+                    oskar_sky_l_const(sky), oskar_sky_m_const(sky),
+                    oskar_sky_n_const(sky), u, v, w, 100e6,
+                    oskar_sky_I_const(sky), -DBL_MAX, DBL_MAX, status);
+            oskar_jones_join(J, K, E, status);
+            oskar_cross_correlate(oskar_sky_num_sources(sky), J, sky, tel,
+                    u, v, w, 0.0, 100e6, 0, vis, status);
+        }
+        else
+        {
+            oskar_cross_correlate(oskar_sky_num_sources(sky), E, sky, tel,
+                    u, v, w, 0.0, 100e6, 0, vis, status);
+        }
         times[i] = oskar_timer_elapsed(timer);
     }
 
@@ -298,6 +340,8 @@ void benchmark(int num_stations, int num_sources, int type,
     oskar_mem_free(w, status);
     oskar_mem_free(vis, status);
     oskar_jones_free(J, status);
+    oskar_jones_free(E, status);
+    oskar_jones_free(K, status);
     oskar_telescope_free(tel, status);
     oskar_sky_free(sky, status);
     oskar_timer_free(timer);
@@ -47,6 +47,9 @@ extern "C" {
  * @details
  * Gridding function for W-projection.
  *
+ * The visibilities are sorted into tiles of the grid, and tiles that
+ * cannot overlap are gridded in parallel by different threads.
+ *
  * @param[in] num_w_planes   Number of W-projection planes.
  * @param[in] support        GCF support size per W-plane.
  * @param[in] oversample     GCF oversample factor.
@@ -92,6 +95,9 @@ void oskar_grid_wproj2_d(
  * @details
  * Gridding function for W-projection.
  *
+ * The visibilities are sorted into tiles of the grid, and tiles that
+ * cannot overlap are gridded in parallel by different threads.
+ *
  * @param[in] num_w_planes   Number of W-projection planes.
  * @param[in] support        GCF support size per W-plane.
  * @param[in] oversample     GCF oversample factor.
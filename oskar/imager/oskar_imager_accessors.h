@@ -34,6 +34,7 @@
  */
 
 #include <oskar_global.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -75,6 +76,18 @@ double oskar_imager_cellsize(const oskar_Imager* h);
 OSKAR_EXPORT
 int oskar_imager_channel_snapshots(const oskar_Imager* h);
 
+/**
+ * @brief
+ * Returns the maximum size of the coordinate cache held in memory.
+ *
+ * @details
+ * Returns the maximum size of the coordinate cache held in memory, in bytes.
+ *
+ * @param[in] h  Handle to imager.
+ */
+OSKAR_EXPORT
+size_t oskar_imager_coord_cache_max_bytes(const oskar_Imager* h);
+
 /**
  * @brief
  * Returns the flag specifying whether the imager is in coordinate-only mode.
@@ -336,6 +349,26 @@ void oskar_imager_set_cellsize(oskar_Imager* h, double cellsize_arcsec);
 OSKAR_EXPORT
 void oskar_imager_set_channel_snapshots(oskar_Imager* h, int value);
 
+/**
+ * @brief
+ * Sets the maximum size of the coordinate cache held in memory.
+ *
+ * @details
+ * When using uniform weighting or W-projection, oskar_imager_run() saves
+ * the baseline coordinates and weights read in its first pass over the
+ * input files, so they are not read again in the second pass.
+ * The cache is moved to a temporary file if it would grow larger than
+ * this size.
+ *
+ * The default is OSKAR_IMAGER_COORD_CACHE_MAX_BYTES (2 GiB).
+ * A value of 0 disables the cache.
+ *
+ * @param[in,out] h          Handle to imager.
+ * @param[in]     value      Maximum size of the cache in memory, in bytes.
+ */
+OSKAR_EXPORT
+void oskar_imager_set_coord_cache_max_bytes(oskar_Imager* h, size_t value);
+
 /**
  * @brief
  * Sets the imager to ignore visibility data and only update weights grids.
@@ -31,6 +31,7 @@
 #include <mem/oskar_mem.h>
 #include <utility/oskar_thread.h>
 #include <utility/oskar_timer.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,11 +79,28 @@ struct oskar_Imager
     /* Scratch data. */
     oskar_Mem *uu_im, *vv_im, *ww_im, *vis_im, *weight_im, *time_im;
     oskar_Mem *uu_tmp, *vv_tmp, *ww_tmp, *stokes, *weight_tmp;
+    oskar_Mem *block_weight, *block_time_centroid; /* For vis blocks. */
     int coords_only; /* Set if doing a first pass for uniform weighting. */
     int num_planes; /* For each output channel and polarisation. */
     double *plane_norm, delta_l, delta_m, delta_n, M[9];
     oskar_Mem **planes, **weights_grids;
 
+    /* Data selected for every image plane in a single scan of each block.
+     * Coordinates are stored per image channel, and visibilities and
+     * weights per image plane. */
+    int num_sel_channels, num_sel_planes;
+    size_t* num_sel;
+    oskar_Mem **uu_sel, **vv_sel, **ww_sel;
+    oskar_Mem **vis_sel, **weight_sel, **weight_sel_tmp;
+
+    /* Coordinates and weights saved in the first pass over the data,
+     * so they don't need to be read again in the second pass. */
+    int coord_cache_mode; /* 'w' if writing, 'r' if reading, else 0. */
+    char* coord_cache;
+    size_t coord_cache_size, coord_cache_capacity, coord_cache_pos;
+    size_t coord_cache_max_bytes; /* Zero to disable the cache. */
+    FILE* coord_cache_file; /* Used if the cache gets too big for memory. */
+
     /* DFT imager data. */
     oskar_Mem *l, *m, *n;
 
@@ -0,0 +1,40 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_IMAGER_COORD_CACHE_H_
+#define OSKAR_IMAGER_COORD_CACHE_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum size of the cache held in memory before it is moved to a file. */
+#define OSKAR_IMAGER_COORD_CACHE_MAX_BYTES ((size_t)2 << 30)
+
+/* Frees the cache and stops using it. */
+void oskar_imager_coord_cache_clear(oskar_Imager* h);
+
+/* Starts writing a new cache (mode 'w'), or reading it from the start
+ * (mode 'r'). */
+void oskar_imager_coord_cache_start(oskar_Imager* h, int mode, int* status);
+
+/* Appends a block of coordinates and weights to the cache, in the
+ * precision of the imager. Does nothing if the cache is not being written. */
+void oskar_imager_coord_cache_write(oskar_Imager* h, size_t num_rows,
+        int num_pols, const oskar_Mem* uu, const oskar_Mem* vv,
+        const oskar_Mem* ww, const oskar_Mem* weight,
+        const oskar_Mem* time_centroid, int* status);
+
+/* Reads the next block of coordinates and weights from the cache into
+ * the supplied arrays, which are resized as needed. The number of rows
+ * and polarisations must match those written. */
+void oskar_imager_coord_cache_read(oskar_Imager* h, size_t num_rows,
+        int num_pols, oskar_Mem* uu, oskar_Mem* vv, oskar_Mem* ww,
+        oskar_Mem* weight, oskar_Mem* time_centroid, int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_IMAGER_COORD_CACHE_H_ */
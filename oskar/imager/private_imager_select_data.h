@@ -36,12 +36,15 @@
 extern "C" {
 #endif
 
+/* Visibilities are in (time, channel, baseline, polarisation) order,
+ * or in (row, channel, polarisation) order if num_baselines is 1. */
 void oskar_imager_select_data(
         const oskar_Imager* h,
         size_t num_rows,
         int start_chan,
         int end_chan,
         int num_pols,
+        int num_baselines,
         const oskar_Mem* uu_in,
         const oskar_Mem* vv_in,
         const oskar_Mem* ww_in,
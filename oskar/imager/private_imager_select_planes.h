@@ -0,0 +1,53 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_IMAGER_SELECT_PLANES_H_
+#define OSKAR_IMAGER_SELECT_PLANES_H_
+
+#include <mem/oskar_mem.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Selects the data needed to update every image plane, in one scan of
+ * the block for each image channel.
+ *
+ * The baseline coordinates are scaled to wavelengths and stored once per
+ * image channel (in h->uu_sel, h->vv_sel, h->ww_sel), and the visibilities
+ * and weights for each image plane are stored in h->vis_sel and
+ * h->weight_sel. Stokes parameters are formed if required, PSF
+ * visibilities are set to 1, and the time and baseline length filters
+ * are applied during the scan. The number of points selected for each
+ * image channel is returned in h->num_sel.
+ *
+ * All inputs must be in the imager precision, and the visibilities
+ * (which may be NULL in coordinate-only mode) must be linear
+ * polarisations. The phase centre must not be rotated.
+ *
+ * Visibilities are in (time, channel, baseline, polarisation) order, as in
+ * a visibility block, or in (row, channel, polarisation) order if
+ * num_baselines is 1. */
+void oskar_imager_select_planes(
+        oskar_Imager* h,
+        size_t num_rows,
+        int start_chan,
+        int end_chan,
+        int num_pols,
+        int num_baselines,
+        const oskar_Mem* uu_in,
+        const oskar_Mem* vv_in,
+        const oskar_Mem* ww_in,
+        const oskar_Mem* vis_in,
+        const oskar_Mem* weight_in,
+        const oskar_Mem* time_in,
+        int* status);
+
+/* Frees the arrays used by oskar_imager_select_planes(). */
+void oskar_imager_select_planes_free(oskar_Imager* h, int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_IMAGER_SELECT_PLANES_H_ */
@@ -27,6 +27,7 @@
  */
 
 #include "imager/oskar_grid_wproj2.h"
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 
@@ -34,36 +35,192 @@
 extern "C" {
 #endif
 
-void oskar_grid_wproj2_d(
+/* Minimum side length of a grid tile, in grid cells. */
+#define GRID_TILE_MIN_SIZE 64
+
+/*
+ * Visibilities are bucket-sorted by the grid tile that contains their
+ * centre, and the tiles are gridded in four phases so that tiles in the
+ * same phase are always at least one tile apart. As tiles are at least
+ * twice as large as the largest kernel support, kernels centred in
+ * different tiles of the same phase never overlap, so each thread can
+ * update the part of the grid covered by its tile without atomics,
+ * and the result does not depend on the number of threads.
+ */
+typedef struct GridTiles
+{
+    int tile_size, num_tiles_u, num_tiles, phase_start[5];
+    int* tile_list;     /* Tiles to grid, ordered by phase. */
+    size_t* tile_start; /* Start of each tile in the sorted order. */
+    size_t* order;      /* Visibility indices, sorted by tile. */
+    double* tile_norm;  /* Normalisation factor for each tile. */
+} GridTiles;
+
+typedef struct GridTileCount
+{
+    size_t count;
+    int tile;
+} GridTileCount;
+
+static int grid_tile_count_compare(const void* a, const void* b)
+{
+    const size_t count_a = ((const GridTileCount*)a)->count;
+    const size_t count_b = ((const GridTileCount*)b)->count;
+    return (count_a < count_b) - (count_a > count_b);
+}
+
+static void grid_tiles_init(GridTiles* t, const size_t num_w_planes,
+        const int* support, const int grid_size)
+{
+    size_t i;
+    int max_support = 0;
+    for (i = 0; i < num_w_planes; ++i)
+        if (support[i] > max_support) max_support = support[i];
+    t->tile_size = 2 * max_support + 1;
+    if (t->tile_size < GRID_TILE_MIN_SIZE) t->tile_size = GRID_TILE_MIN_SIZE;
+    t->num_tiles_u = (grid_size + t->tile_size - 1) / t->tile_size;
+    t->num_tiles = t->num_tiles_u * t->num_tiles_u;
+    t->tile_list = 0;
+    t->tile_start = 0;
+    t->order = 0;
+    t->tile_norm = 0;
+}
+
+/* Sorts visibilities by W-plane and then (stably) by tile, so that
+ * visibilities in each tile are grouped by W-plane, and puts the tiles
+ * of each phase in order of decreasing work to balance the load.
+ * Returns 0 if memory could not be allocated. */
+static int grid_tiles_sort(GridTiles* t, const size_t num_points,
+        const int* tile_index, const int* plane, const size_t num_w_planes)
+{
+    size_t i, num_valid = 0, *plane_start, *by_plane = 0, *pos = 0;
+    GridTileCount* counts = 0;
+    int phase, tile, num_in_phase;
+
+    /* Counting sort by W-plane. */
+    plane_start = (size_t*) calloc(num_w_planes + 1, sizeof(size_t));
+    if (!plane_start) return 0;
+    for (i = 0; i < num_points; ++i)
+        if (tile_index[i] >= 0) plane_start[plane[i] + 1]++;
+    for (i = 0; i < num_w_planes; ++i)
+        plane_start[i + 1] += plane_start[i];
+    num_valid = plane_start[num_w_planes];
+    by_plane = (size_t*) malloc((num_valid + 1) * sizeof(size_t));
+    t->tile_start = (size_t*) calloc(t->num_tiles + 1, sizeof(size_t));
+    pos = (size_t*) malloc(t->num_tiles * sizeof(size_t));
+    t->order = (size_t*) malloc((num_valid + 1) * sizeof(size_t));
+    counts = (GridTileCount*) malloc(t->num_tiles * sizeof(GridTileCount));
+    t->tile_list = (int*) malloc(t->num_tiles * sizeof(int));
+    t->tile_norm = (double*) calloc(t->num_tiles, sizeof(double));
+    if (!by_plane || !t->tile_start || !pos || !t->order || !counts ||
+            !t->tile_list || !t->tile_norm)
+    {
+        free(plane_start);
+        free(by_plane);
+        free(pos);
+        free(counts);
+        return 0;
+    }
+    for (i = 0; i < num_points; ++i)
+        if (tile_index[i] >= 0) by_plane[plane_start[plane[i]]++] = i;
+    free(plane_start);
+
+    /* Stable counting sort by tile. */
+    for (i = 0; i < num_valid; ++i)
+        t->tile_start[tile_index[by_plane[i]] + 1]++;
+    for (tile = 0; tile < t->num_tiles; ++tile)
+        t->tile_start[tile + 1] += t->tile_start[tile];
+    for (tile = 0; tile < t->num_tiles; ++tile)
+        pos[tile] = t->tile_start[tile];
+    for (i = 0; i < num_valid; ++i)
+        t->order[pos[tile_index[by_plane[i]]]++] = by_plane[i];
+    free(pos);
+    free(by_plane);
+
+    /* List the non-empty tiles in each phase, busiest first. */
+    t->phase_start[0] = 0;
+    for (phase = 0; phase < 4; ++phase)
+    {
+        num_in_phase = 0;
+        for (tile = 0; tile < t->num_tiles; ++tile)
+        {
+            const int tile_u = tile % t->num_tiles_u;
+            const int tile_v = tile / t->num_tiles_u;
+            const size_t count = t->tile_start[tile + 1] - t->tile_start[tile];
+            if (count == 0 || phase != ((tile_u & 1) | ((tile_v & 1) << 1)))
+                continue;
+            counts[num_in_phase].count = count;
+            counts[num_in_phase++].tile = tile;
+        }
+        qsort(counts, num_in_phase, sizeof(GridTileCount),
+                grid_tile_count_compare);
+        for (tile = 0; tile < num_in_phase; ++tile)
+            t->tile_list[t->phase_start[phase] + tile] = counts[tile].tile;
+        t->phase_start[phase + 1] = t->phase_start[phase] + num_in_phase;
+    }
+    free(counts);
+    return 1;
+}
+
+static void grid_tiles_free(GridTiles* t)
+{
+    free(t->tile_list);
+    free(t->tile_start);
+    free(t->order);
+    free(t->tile_norm);
+}
+
+/* Returns the tile containing the centre of a visibility and sets its
+ * W-plane index, or returns -1 if its kernel would lie outside the grid. */
+static int grid_point_d(const GridTiles* t, const size_t num_w_planes,
+        const int* RESTRICT support, const double uu, const double vv,
+        const double ww, const double grid_scale, const double w_scale,
+        const int grid_size, int* plane)
+{
+    const int grid_centre = grid_size / 2;
+    const double pos_u = -uu * grid_scale;
+    const double pos_v = vv * grid_scale;
+    const size_t grid_w = (size_t)round(sqrt(fabs(ww * w_scale)));
+    const int grid_u = (int)round(pos_u) + grid_centre;
+    const int grid_v = (int)round(pos_v) + grid_centre;
+    const int w_plane = grid_w < num_w_planes ?
+            (int) grid_w : (int) num_w_planes - 1;
+    const int w_support = support[w_plane];
+    *plane = w_plane;
+    if (grid_u + w_support >= grid_size || grid_u - w_support < 0 ||
+            grid_v + w_support >= grid_size || grid_v - w_support < 0)
+        return -1;
+    return (grid_v / t->tile_size) * t->num_tiles_u + grid_u / t->tile_size;
+}
+
+/* Grids the visibilities in one tile, and returns their normalisation. */
+static double grid_tile_d(
+        const size_t num_in_tile,
+        const size_t* RESTRICT order,
         const size_t num_w_planes,
         const int* RESTRICT support,
         const int oversample,
         const int* wkernel_start,
         const double* RESTRICT wkernel,
-        const size_t num_points,
         const double* RESTRICT uu,
         const double* RESTRICT vv,
         const double* RESTRICT ww,
         const double* RESTRICT vis,
         const double* RESTRICT weight,
-        const double cell_size_rad,
+        const double grid_scale,
         const double w_scale,
         const int grid_size,
-        size_t* RESTRICT num_skipped,
-        double* RESTRICT norm,
         double* RESTRICT grid)
 {
-    size_t i;
+    size_t n;
+    double norm = 0.0;
     const int grid_centre = grid_size / 2;
     const int oversample_h = oversample / 2;
-    const double grid_scale = grid_size * cell_size_rad;
-
-    /* Loop over visibilities. */
-    *num_skipped = 0;
-    for (i = 0; i < num_points; ++i)
+    for (n = 0; n < num_in_tile; ++n)
     {
         double sum = 0.0;
         int j, k;
+        const size_t i = order[n];
 
         /* Convert UV coordinates to grid coordinates. */
         const double pos_u = -uu[i] * grid_scale;
@@ -84,20 +241,12 @@ void oskar_grid_wproj2_d(
         const int off_v = (int)round((round(pos_v) - pos_v) * oversample);
 
         /* Get kernel support size and start offset. */
-        const int w_support = grid_w < num_w_planes ?
-                support[grid_w] : support[num_w_planes - 1];
-        const int kernel_start = grid_w < num_w_planes ?
-                wkernel_start[grid_w] : wkernel_start[num_w_planes - 1];
-
-        /* Catch points that would lie outside the grid. */
-        if (grid_u + w_support >= grid_size || grid_u - w_support < 0 ||
-                grid_v + w_support >= grid_size || grid_v - w_support < 0)
-        {
-            *num_skipped += 1;
-            continue;
-        }
+        const int w_plane = grid_w < num_w_planes ?
+                (int) grid_w : (int) num_w_planes - 1;
+        const int w_support = support[w_plane];
+        const int kernel_start = wkernel_start[w_plane];
 
-        /* Convolve this point onto the grid. */
+        /* Convolve this point onto the grid, vectorising along each row. */
         const int conv_len = 2 * w_support + 1;
         const int width = (oversample_h * conv_len + 1) * conv_len;
         const int mid = kernel_start + (abs(off_u) + 1) * width - 1 - w_support;
@@ -105,55 +254,190 @@ void oskar_grid_wproj2_d(
         for (j = -w_support; j <= w_support; ++j)
         {
             const int t = mid - abs(off_v + j * oversample) * conv_len;
+            const double* RESTRICT c = wkernel + 2 * (t - stride * w_support);
             size_t p1 = grid_v + j;
             p1 *= grid_size; /* Tested to avoid int overflow. */
-            p1 += grid_u;
-            for (k = -w_support; k <= w_support; ++k)
+            p1 += grid_u - w_support;
+            double* RESTRICT g = grid + 2 * p1;
+            if (stride > 0)
+            {
+#pragma omp simd reduction(+:sum)
+                for (k = 0; k < conv_len; ++k)
+                {
+                    const double c_re = c[2 * k];
+                    const double c_im = c[2 * k + 1] * conv_conj;
+                    g[2 * k]     += (v_re * c_re - v_im * c_im);
+                    g[2 * k + 1] += (v_im * c_re + v_re * c_im);
+                    sum += c_re; /* Real part only. */
+                }
+            }
+            else
             {
-                const int p = (t + stride * k) << 1;
-                const double c_re = wkernel[p];
-                const double c_im = wkernel[p + 1] * conv_conj;
-                const size_t p2 = (p1 + k) << 1;
-                grid[p2]     += (v_re * c_re - v_im * c_im);
-                grid[p2 + 1] += (v_im * c_re + v_re * c_im);
-                sum += c_re; /* Real part only. */
+#pragma omp simd reduction(+:sum)
+                for (k = 0; k < conv_len; ++k)
+                {
+                    const double c_re = c[-2 * k];
+                    const double c_im = c[-2 * k + 1] * conv_conj;
+                    g[2 * k]     += (v_re * c_re - v_im * c_im);
+                    g[2 * k + 1] += (v_im * c_re + v_re * c_im);
+                    sum += c_re; /* Real part only. */
+                }
             }
         }
-        *norm += sum * weight_i;
+        norm += sum * weight_i;
     }
+    return norm;
 }
 
 
-void oskar_grid_wproj2_f(
+void oskar_grid_wproj2_d(
         const size_t num_w_planes,
         const int* RESTRICT support,
         const int oversample,
         const int* wkernel_start,
-        const float* RESTRICT wkernel,
+        const double* RESTRICT wkernel,
         const size_t num_points,
+        const double* RESTRICT uu,
+        const double* RESTRICT vv,
+        const double* RESTRICT ww,
+        const double* RESTRICT vis,
+        const double* RESTRICT weight,
+        const double cell_size_rad,
+        const double w_scale,
+        const int grid_size,
+        size_t* RESTRICT num_skipped,
+        double* RESTRICT norm,
+        double* RESTRICT grid)
+{
+    GridTiles tiles;
+    size_t skipped = 0;
+    int i, k, phase, ok = 0;
+    int *tile_index = 0, *plane = 0;
+    const double grid_scale = grid_size * cell_size_rad;
+
+    /* Find the tile and W-plane of each visibility. */
+    grid_tiles_init(&tiles, num_w_planes, support, grid_size);
+    if (num_points <= INT_MAX)
+    {
+        tile_index = (int*) malloc(num_points * sizeof(int));
+        plane = (int*) malloc(num_points * sizeof(int));
+    }
+    if (tile_index && plane)
+    {
+#pragma omp parallel for reduction(+:skipped)
+        for (i = 0; i < (int) num_points; ++i)
+        {
+            tile_index[i] = grid_point_d(&tiles, num_w_planes, support,
+                    uu[i], vv[i], ww[i], grid_scale, w_scale, grid_size,
+                    &plane[i]);
+            if (tile_index[i] < 0) skipped++;
+        }
+        ok = grid_tiles_sort(&tiles, num_points, tile_index, plane,
+                num_w_planes);
+    }
+    free(tile_index);
+    free(plane);
+
+    /* If there are too many visibilities to index, or not enough memory
+     * to sort them, grid them one at a time instead. */
+    if (!ok)
+    {
+        size_t n;
+        int w_plane;
+        grid_tiles_free(&tiles);
+        *num_skipped = 0;
+        for (n = 0; n < num_points; ++n)
+        {
+            if (grid_point_d(&tiles, num_w_planes, support, uu[n], vv[n],
+                    ww[n], grid_scale, w_scale, grid_size, &w_plane) < 0)
+            {
+                (*num_skipped)++;
+                continue;
+            }
+            *norm += grid_tile_d(1, &n, num_w_planes, support, oversample,
+                    wkernel_start, wkernel, uu, vv, ww, vis, weight,
+                    grid_scale, w_scale, grid_size, grid);
+        }
+        return;
+    }
+    *num_skipped = skipped;
+
+    /* Grid the visibilities in each tile, one phase at a time. */
+#pragma omp parallel private(phase, k)
+    for (phase = 0; phase < 4; ++phase)
+    {
+#pragma omp for schedule(dynamic, 1)
+        for (k = tiles.phase_start[phase];
+                k < tiles.phase_start[phase + 1]; ++k)
+        {
+            const int tile = tiles.tile_list[k];
+            const size_t start = tiles.tile_start[tile];
+            tiles.tile_norm[tile] = grid_tile_d(
+                    tiles.tile_start[tile + 1] - start, tiles.order + start,
+                    num_w_planes, support, oversample, wkernel_start, wkernel,
+                    uu, vv, ww, vis, weight, grid_scale, w_scale,
+                    grid_size, grid);
+        }
+    }
+
+    /* Sum the normalisation factors in a fixed order. */
+    for (k = 0; k < tiles.phase_start[4]; ++k)
+        *norm += tiles.tile_norm[tiles.tile_list[k]];
+    grid_tiles_free(&tiles);
+}
+
+
+/* Returns the tile containing the centre of a visibility and sets its
+ * W-plane index, or returns -1 if its kernel would lie outside the grid. */
+static int grid_point_f(const GridTiles* t, const size_t num_w_planes,
+        const int* RESTRICT support, const float uu, const float vv,
+        const float ww, const float grid_scale, const float w_scale,
+        const int grid_size, int* plane)
+{
+    const int grid_centre = grid_size / 2;
+    const float pos_u = -uu * grid_scale;
+    const float pos_v = vv * grid_scale;
+    const size_t grid_w = (size_t)roundf(sqrtf(fabsf(ww * w_scale)));
+    const int grid_u = (int)roundf(pos_u) + grid_centre;
+    const int grid_v = (int)roundf(pos_v) + grid_centre;
+    const int w_plane = grid_w < num_w_planes ?
+            (int) grid_w : (int) num_w_planes - 1;
+    const int w_support = support[w_plane];
+    *plane = w_plane;
+    if (grid_u + w_support >= grid_size || grid_u - w_support < 0 ||
+            grid_v + w_support >= grid_size || grid_v - w_support < 0)
+        return -1;
+    return (grid_v / t->tile_size) * t->num_tiles_u + grid_u / t->tile_size;
+}
+
+/* Grids the visibilities in one tile, and returns their normalisation. */
+static double grid_tile_f(
+        const size_t num_in_tile,
+        const size_t* RESTRICT order,
+        const size_t num_w_planes,
+        const int* RESTRICT support,
+        const int oversample,
+        const int* wkernel_start,
+        const float* RESTRICT wkernel,
         const float* RESTRICT uu,
         const float* RESTRICT vv,
         const float* RESTRICT ww,
         const float* RESTRICT vis,
         const float* RESTRICT weight,
-        const float cell_size_rad,
+        const float grid_scale,
         const float w_scale,
         const int grid_size,
-        size_t* RESTRICT num_skipped,
-        double* RESTRICT norm,
         float* RESTRICT grid)
 {
-    size_t i;
+    size_t n;
+    double norm = 0.0;
     const int grid_centre = grid_size / 2;
     const int oversample_h = oversample / 2;
-    const float grid_scale = grid_size * cell_size_rad;
-
-    /* Loop over visibilities. */
-    *num_skipped = 0;
-    for (i = 0; i < num_points; ++i)
+    for (n = 0; n < num_in_tile; ++n)
     {
         double sum = 0.0;
         int j, k;
+        const size_t i = order[n];
 
         /* Convert UV coordinates to grid coordinates. */
         const float pos_u = -uu[i] * grid_scale;
@@ -174,20 +458,12 @@ void oskar_grid_wproj2_f(
         const int off_v = (int)roundf((roundf(pos_v) - pos_v) * oversample);
 
         /* Get kernel support size and start offset. */
-        const int w_support = grid_w < num_w_planes ?
-                support[grid_w] : support[num_w_planes - 1];
-        const int kernel_start = grid_w < num_w_planes ?
-                wkernel_start[grid_w] : wkernel_start[num_w_planes - 1];
-
-        /* Catch points that would lie outside the grid. */
-        if (grid_u + w_support >= grid_size || grid_u - w_support < 0 ||
-                grid_v + w_support >= grid_size || grid_v - w_support < 0)
-        {
-            *num_skipped += 1;
-            continue;
-        }
+        const int w_plane = grid_w < num_w_planes ?
+                (int) grid_w : (int) num_w_planes - 1;
+        const int w_support = support[w_plane];
+        const int kernel_start = wkernel_start[w_plane];
 
-        /* Convolve this point onto the grid. */
+        /* Convolve this point onto the grid, vectorising along each row. */
         const int conv_len = 2 * w_support + 1;
         const int width = (oversample_h * conv_len + 1) * conv_len;
         const int mid = kernel_start + (abs(off_u) + 1) * width - 1 - w_support;
@@ -195,22 +471,136 @@ void oskar_grid_wproj2_f(
         for (j = -w_support; j <= w_support; ++j)
         {
             const int t = mid - abs(off_v + j * oversample) * conv_len;
+            const float* RESTRICT c = wkernel + 2 * (t - stride * w_support);
             size_t p1 = grid_v + j;
             p1 *= grid_size; /* Tested to avoid int overflow. */
-            p1 += grid_u;
-            for (k = -w_support; k <= w_support; ++k)
+            p1 += grid_u - w_support;
+            float* RESTRICT g = grid + 2 * p1;
+            if (stride > 0)
+            {
+#pragma omp simd reduction(+:sum)
+                for (k = 0; k < conv_len; ++k)
+                {
+                    const float c_re = c[2 * k];
+                    const float c_im = c[2 * k + 1] * conv_conj;
+                    g[2 * k]     += (v_re * c_re - v_im * c_im);
+                    g[2 * k + 1] += (v_im * c_re + v_re * c_im);
+                    sum += c_re; /* Real part only. */
+                }
+            }
+            else
             {
-                const int p = (t + stride * k) << 1;
-                const float c_re = wkernel[p];
-                const float c_im = wkernel[p + 1] * conv_conj;
-                const size_t p2 = (p1 + k) << 1;
-                grid[p2]     += (v_re * c_re - v_im * c_im);
-                grid[p2 + 1] += (v_im * c_re + v_re * c_im);
-                sum += c_re; /* Real part only. */
+#pragma omp simd reduction(+:sum)
+                for (k = 0; k < conv_len; ++k)
+                {
+                    const float c_re = c[-2 * k];
+                    const float c_im = c[-2 * k + 1] * conv_conj;
+                    g[2 * k]     += (v_re * c_re - v_im * c_im);
+                    g[2 * k + 1] += (v_im * c_re + v_re * c_im);
+                    sum += c_re; /* Real part only. */
+                }
             }
         }
-        *norm += sum * weight_i;
+        norm += sum * weight_i;
     }
+    return norm;
+}
+
+
+void oskar_grid_wproj2_f(
+        const size_t num_w_planes,
+        const int* RESTRICT support,
+        const int oversample,
+        const int* wkernel_start,
+        const float* RESTRICT wkernel,
+        const size_t num_points,
+        const float* RESTRICT uu,
+        const float* RESTRICT vv,
+        const float* RESTRICT ww,
+        const float* RESTRICT vis,
+        const float* RESTRICT weight,
+        const float cell_size_rad,
+        const float w_scale,
+        const int grid_size,
+        size_t* RESTRICT num_skipped,
+        double* RESTRICT norm,
+        float* RESTRICT grid)
+{
+    GridTiles tiles;
+    size_t skipped = 0;
+    int i, k, phase, ok = 0;
+    int *tile_index = 0, *plane = 0;
+    const float grid_scale = grid_size * cell_size_rad;
+
+    /* Find the tile and W-plane of each visibility. */
+    grid_tiles_init(&tiles, num_w_planes, support, grid_size);
+    if (num_points <= INT_MAX)
+    {
+        tile_index = (int*) malloc(num_points * sizeof(int));
+        plane = (int*) malloc(num_points * sizeof(int));
+    }
+    if (tile_index && plane)
+    {
+#pragma omp parallel for reduction(+:skipped)
+        for (i = 0; i < (int) num_points; ++i)
+        {
+            tile_index[i] = grid_point_f(&tiles, num_w_planes, support,
+                    uu[i], vv[i], ww[i], grid_scale, w_scale, grid_size,
+                    &plane[i]);
+            if (tile_index[i] < 0) skipped++;
+        }
+        ok = grid_tiles_sort(&tiles, num_points, tile_index, plane,
+                num_w_planes);
+    }
+    free(tile_index);
+    free(plane);
+
+    /* If there are too many visibilities to index, or not enough memory
+     * to sort them, grid them one at a time instead. */
+    if (!ok)
+    {
+        size_t n;
+        int w_plane;
+        grid_tiles_free(&tiles);
+        *num_skipped = 0;
+        for (n = 0; n < num_points; ++n)
+        {
+            if (grid_point_f(&tiles, num_w_planes, support, uu[n], vv[n],
+                    ww[n], grid_scale, w_scale, grid_size, &w_plane) < 0)
+            {
+                (*num_skipped)++;
+                continue;
+            }
+            *norm += grid_tile_f(1, &n, num_w_planes, support, oversample,
+                    wkernel_start, wkernel, uu, vv, ww, vis, weight,
+                    grid_scale, w_scale, grid_size, grid);
+        }
+        return;
+    }
+    *num_skipped = skipped;
+
+    /* Grid the visibilities in each tile, one phase at a time. */
+#pragma omp parallel private(phase, k)
+    for (phase = 0; phase < 4; ++phase)
+    {
+#pragma omp for schedule(dynamic, 1)
+        for (k = tiles.phase_start[phase];
+                k < tiles.phase_start[phase + 1]; ++k)
+        {
+            const int tile = tiles.tile_list[k];
+            const size_t start = tiles.tile_start[tile];
+            tiles.tile_norm[tile] = grid_tile_f(
+                    tiles.tile_start[tile + 1] - start, tiles.order + start,
+                    num_w_planes, support, oversample, wkernel_start, wkernel,
+                    uu, vv, ww, vis, weight, grid_scale, w_scale,
+                    grid_size, grid);
+        }
+    }
+
+    /* Sum the normalisation factors in a fixed order. */
+    for (k = 0; k < tiles.phase_start[4]; ++k)
+        *norm += tiles.tile_norm[tiles.tile_list[k]];
+    grid_tiles_free(&tiles);
 }
 
 #ifdef __cplusplus
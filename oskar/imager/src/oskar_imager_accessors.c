@@ -74,6 +74,12 @@ int oskar_imager_channel_snapshots(const oskar_Imager* h)
 }
 
 
+size_t oskar_imager_coord_cache_max_bytes(const oskar_Imager* h)
+{
+    return h->coord_cache_max_bytes;
+}
+
+
 int oskar_imager_coords_only(const oskar_Imager* h)
 {
     return h->coords_only;
@@ -262,6 +268,12 @@ void oskar_imager_set_channel_snapshots(oskar_Imager* h, int value)
 }
 
 
+void oskar_imager_set_coord_cache_max_bytes(oskar_Imager* h, size_t value)
+{
+    h->coord_cache_max_bytes = value;
+}
+
+
 void oskar_imager_set_coords_only(oskar_Imager* h, int flag)
 {
     h->coords_only = flag;
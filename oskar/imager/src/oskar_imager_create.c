@@ -27,6 +27,7 @@
  */
 
 #include "imager/private_imager.h"
+#include "imager/private_imager_coord_cache.h"
 
 #include "imager/oskar_imager_accessors.h"
 #include "imager/oskar_imager_create.h"
@@ -66,6 +67,9 @@ oskar_Imager* oskar_imager_create(int imager_precision, int* status)
     h->weight_im   = oskar_mem_create(imager_precision, OSKAR_CPU, 0, status);
     h->weight_tmp  = oskar_mem_create(imager_precision, OSKAR_CPU, 0, status);
     h->time_im     = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    h->block_weight = oskar_mem_create(imager_precision, OSKAR_CPU, 0, status);
+    h->block_time_centroid = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0,
+            status);
 
     /* Check data type. */
     if (imager_precision != OSKAR_SINGLE && imager_precision != OSKAR_DOUBLE)
@@ -90,6 +94,8 @@ oskar_Imager* oskar_imager_create(int imager_precision, int* status)
     oskar_imager_set_fov(h, 1.0);
     oskar_imager_set_size(h, 256, status);
     oskar_imager_set_uv_filter_max(h, DBL_MAX);
+    oskar_imager_set_coord_cache_max_bytes(h,
+            OSKAR_IMAGER_COORD_CACHE_MAX_BYTES);
     return h;
 }
 
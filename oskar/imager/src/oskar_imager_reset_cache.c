@@ -28,7 +28,9 @@
 
 #include "imager/private_imager.h"
 #include "imager/oskar_imager_reset_cache.h"
+#include "imager/private_imager_coord_cache.h"
 #include "imager/private_imager_free_device_data.h"
+#include "imager/private_imager_select_planes.h"
 #include "math/oskar_fft.h"
 #include <fitsio.h>
 
@@ -89,7 +91,10 @@ void oskar_imager_reset_cache(oskar_Imager* h, int* status)
     oskar_mem_realloc(h->weight_im, 0, status);
     oskar_mem_realloc(h->weight_tmp, 0, status);
     oskar_mem_realloc(h->time_im, 0, status);
+    oskar_mem_realloc(h->block_weight, 0, status);
+    oskar_mem_realloc(h->block_time_centroid, 0, status);
     oskar_mem_free(h->stokes, status); h->stokes = 0;
+    oskar_imager_select_planes_free(h, status);
 
     /* Close any open FITS files. */
     for (i = 0; i < h->num_im_pols; ++i)
@@ -100,6 +105,9 @@ void oskar_imager_reset_cache(oskar_Imager* h, int* status)
         free(h->output_name[i]); h->output_name[i] = 0;
     }
 
+    /* Free the coordinate cache. */
+    oskar_imager_coord_cache_clear(h);
+
     /* Clear the number of image planes. */
     h->num_planes = 0;
 }
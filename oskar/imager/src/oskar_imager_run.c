@@ -27,6 +27,7 @@
  */
 
 #include "imager/private_imager.h"
+#include "imager/private_imager_coord_cache.h"
 #include "imager/private_imager_read_coords.h"
 #include "imager/private_imager_read_data.h"
 #include "imager/private_imager_read_dims.h"
@@ -101,6 +102,8 @@ void oskar_imager_run(oskar_Imager* h,
             h->algorithm == OSKAR_ALGORITHM_WPROJ)
     {
         oskar_imager_set_coords_only(h, 1);
+        if (h->coord_cache_max_bytes > 0)
+            oskar_imager_coord_cache_start(h, 'w', status);
         oskar_log_section('M', "Reading coordinates...");
 
         /* Loop over input files. */
@@ -118,6 +121,10 @@ void oskar_imager_run(oskar_Imager* h,
                         &percent_done, &percent_next, status);
         }
         oskar_imager_set_coords_only(h, 0);
+
+        /* Use the saved coordinates when reading the visibility data. */
+        if (h->coord_cache_max_bytes > 0)
+            oskar_imager_coord_cache_start(h, 'r', status);
     }
 
     /* Check for errors. */
@@ -161,6 +168,7 @@ void oskar_imager_run(oskar_Imager* h,
             oskar_imager_read_data_vis(h, filename, i, num_files,
                     &percent_done, &percent_next, status);
     }
+    oskar_imager_coord_cache_clear(h);
 
     /* Check for errors. */
     if (*status)
@@ -35,6 +35,7 @@
 #include "imager/private_imager_filter_uv.h"
 #include "imager/private_imager_set_num_planes.h"
 #include "imager/private_imager_select_data.h"
+#include "imager/private_imager_select_planes.h"
 #include "imager/private_imager_update_plane_dft.h"
 #include "imager/private_imager_update_plane_fft.h"
 #include "imager/private_imager_update_plane_wproj.h"
@@ -51,6 +52,17 @@ extern "C" {
 #endif
 
 static void oskar_imager_allocate_planes(oskar_Imager* h, int *status);
+static void oskar_imager_update_data(oskar_Imager* h, size_t num_rows,
+        int start_chan, int end_chan, int num_pols, int num_baselines,
+        const oskar_Mem* uu, const oskar_Mem* vv, const oskar_Mem* ww,
+        const oskar_Mem* amps, const oskar_Mem* weight,
+        const oskar_Mem* time_centroid, int* status);
+static void oskar_imager_update_selected_planes(oskar_Imager* h,
+        int* status);
+static const oskar_Mem* oskar_imager_apply_weighting(oskar_Imager* h,
+        size_t num_vis, const oskar_Mem* uu, const oskar_Mem* vv,
+        const oskar_Mem* weight, oskar_Mem* weight_tmp,
+        const oskar_Mem* weights_grid, int* status);
 static void oskar_imager_update_weights_grid(oskar_Imager* h,
         size_t num_points, const oskar_Mem* uu, const oskar_Mem* vv,
         const oskar_Mem* ww, const oskar_Mem* weight, oskar_Mem* weights_grid,
@@ -62,9 +74,6 @@ void oskar_imager_update_from_block(oskar_Imager* h,
 {
     int t;
     double time_start_mjd, time_inc_sec;
-    oskar_Mem *weight = 0, *weight_ptr = 0, *time_centroid;
-    oskar_Mem *scratch = 0;
-    const oskar_Mem* ptr;
     if (*status) return;
 
     /* Check that cross-correlations exist. */
@@ -80,6 +89,7 @@ void oskar_imager_update_from_block(oskar_Imager* h,
     const int num_times     = oskar_vis_block_num_times(block);
     const int end_chan      = start_chan + num_channels - 1;
     const size_t num_rows   = num_baselines * num_times;
+    const size_t num_weights = num_rows * num_pols;
 
     /* Get visibility meta-data. */
     time_start_mjd = oskar_vis_header_time_start_mjd_utc(hdr) * 86400.0;
@@ -92,77 +102,28 @@ void oskar_imager_update_from_block(oskar_Imager* h,
             oskar_vis_header_phase_centre_ra_deg(hdr),
             oskar_vis_header_phase_centre_dec_deg(hdr));
 
-    /* Create scratch arrays. Weights are all 1. */
-    if (num_channels > 1)
-        scratch = oskar_mem_create(oskar_mem_type(
-                oskar_vis_block_cross_correlations_const(block)),
-                OSKAR_CPU, num_rows * num_channels, status);
-    if (!weight)
+    /* Weights are all 1. The array is only filled when it grows. */
+    if (oskar_mem_length(h->block_weight) < num_weights)
     {
-        size_t num_weights = num_rows * num_pols;
-        weight = oskar_mem_create(oskar_mem_precision(
-                oskar_vis_block_cross_correlations_const(block)),
-                OSKAR_CPU, num_weights, status);
-        oskar_mem_set_value_real(weight, 1.0, 0, num_weights, status);
-        weight_ptr = weight;
+        oskar_mem_ensure(h->block_weight, num_weights, status);
+        oskar_mem_set_value_real(h->block_weight, 1.0, 0, num_weights, status);
     }
 
     /* Fill in the time centroid values. */
-    time_centroid = oskar_mem_create(OSKAR_DOUBLE,
-            OSKAR_CPU, num_rows, status);
+    oskar_mem_ensure(h->block_time_centroid, num_rows, status);
     for (t = 0; t < num_times; ++t)
-        oskar_mem_set_value_real(time_centroid,
+        oskar_mem_set_value_real(h->block_time_centroid,
                 time_start_mjd + (start_time + t + 0.5) * time_inc_sec,
                 t * num_baselines, num_baselines, status);
 
-    /* Swap baseline and channel dimensions. */
-    ptr = oskar_vis_block_cross_correlations_const(block);
-#define SWAP_LOOP \
-        for (t = 0; t < num_times; ++t)                                  \
-            for (c = 0; c < num_channels; ++c)                           \
-                for (b = 0; b < num_baselines; ++b)                      \
-                    for (p = 0; p < num_pols; ++p)                       \
-                    {                                                    \
-                        k = (num_pols * (num_baselines *                 \
-                                (num_channels * t + c) + b) + p) << 1;   \
-                        l = (num_pols * (num_channels *                  \
-                                (num_baselines * t + b) + c) + p) << 1;  \
-                        out[l] = in[k];                                  \
-                        out[l + 1] = in[k + 1];                          \
-                    }
-        if (num_channels != 1)
-        {
-            int b, c, p;
-            size_t k, l;
-            if (oskar_mem_precision(ptr) == OSKAR_SINGLE)
-            {
-                const float *in;
-                float *out;
-                in  = oskar_mem_float_const(ptr, status);
-                out = oskar_mem_float(scratch, status);
-                SWAP_LOOP
-            }
-            else
-            {
-                const double *in;
-                double *out;
-                in  = oskar_mem_double_const(ptr, status);
-                out = oskar_mem_double(scratch, status);
-                SWAP_LOOP
-            }
-            ptr = scratch;
-        }
-#undef SWAP_LOOP
-
-    /* Update the imager with the data. */
-    oskar_imager_update(h, num_rows, start_chan, end_chan, num_pols,
+    /* Update the imager with the data in the order it is in the block. */
+    oskar_imager_update_data(h, num_rows, start_chan, end_chan, num_pols,
+            num_baselines,
             oskar_vis_block_baseline_uu_metres_const(block),
             oskar_vis_block_baseline_vv_metres_const(block),
             oskar_vis_block_baseline_ww_metres_const(block),
-            ptr, weight_ptr, time_centroid, status);
-    oskar_mem_free(weight, status);
-    oskar_mem_free(scratch, status);
-    oskar_mem_free(time_centroid, status);
+            oskar_vis_block_cross_correlations_const(block),
+            h->block_weight, h->block_time_centroid, status);
 }
 
 
@@ -170,6 +131,17 @@ void oskar_imager_update(oskar_Imager* h, size_t num_rows, int start_chan,
         int end_chan, int num_pols, const oskar_Mem* uu, const oskar_Mem* vv,
         const oskar_Mem* ww, const oskar_Mem* amps, const oskar_Mem* weight,
         const oskar_Mem* time_centroid, int* status)
+{
+    oskar_imager_update_data(h, num_rows, start_chan, end_chan, num_pols, 1,
+            uu, vv, ww, amps, weight, time_centroid, status);
+}
+
+
+void oskar_imager_update_data(oskar_Imager* h, size_t num_rows,
+        int start_chan, int end_chan, int num_pols, int num_baselines,
+        const oskar_Mem* uu, const oskar_Mem* vv, const oskar_Mem* ww,
+        const oskar_Mem* amps, const oskar_Mem* weight,
+        const oskar_Mem* time_centroid, int* status)
 {
     int c, p, i_plane;
     size_t max_num_vis;
@@ -210,13 +182,6 @@ void oskar_imager_update(oskar_Imager* h, size_t num_rows, int start_chan,
             ta = oskar_mem_convert_precision(amps, h->imager_prec, status);
             amp_in = ta;
         }
-
-        /* Convert linear polarisations to Stokes parameters if required. */
-        if (h->use_stokes)
-        {
-            oskar_imager_linear_to_stokes(amp_in, &h->stokes, status);
-            amp_in = h->stokes;
-        }
     }
     if (oskar_mem_precision(uu) != h->imager_prec)
     {
@@ -239,6 +204,29 @@ void oskar_imager_update(oskar_Imager* h, size_t num_rows, int start_chan,
         weight_in = th;
     }
 
+    /* Unless the phase centre is rotated, select the data for all image
+     * planes in a single scan of the block, and update the planes. */
+    if (h->direction_type != 'R')
+    {
+        oskar_imager_select_planes(h, num_rows, start_chan, end_chan,
+                num_pols, num_baselines, u_in, v_in, w_in, amp_in, weight_in,
+                time_centroid, status);
+        oskar_imager_update_selected_planes(h, status);
+        oskar_mem_free(tu, status);
+        oskar_mem_free(tv, status);
+        oskar_mem_free(tw, status);
+        oskar_mem_free(ta, status);
+        oskar_mem_free(th, status);
+        return;
+    }
+
+    /* Convert linear polarisations to Stokes parameters if required. */
+    if (!h->coords_only && h->use_stokes)
+    {
+        oskar_imager_linear_to_stokes(amp_in, &h->stokes, status);
+        amp_in = h->stokes;
+    }
+
     /* Ensure work arrays are large enough. */
     max_num_vis = num_rows;
     if (!h->chan_snaps) max_num_vis *= (1 + end_chan - start_chan);
@@ -270,7 +258,8 @@ void oskar_imager_update(oskar_Imager* h, size_t num_rows, int start_chan,
                 pu = h->uu_tmp; pv = h->vv_tmp; pw = h->ww_tmp;
             }
             oskar_imager_select_data(h, num_rows, start_chan, end_chan,
-                    num_pols, u_in, v_in, w_in, amp_in, weight_in,
+                    num_pols, num_baselines, u_in, v_in, w_in,
+                    amp_in, weight_in,
                     time_centroid, h->im_freqs[c], p,
                     &num_vis, pu, pv, pw, h->vis_im, h->weight_im,
                     h->time_im, status);
@@ -381,26 +370,8 @@ void oskar_imager_update_plane(oskar_Imager* h, size_t num_vis,
         oskar_imager_check_init(h, status);
 
         /* Re-weight visibilities if required. */
-        switch (h->weighting)
-        {
-        case OSKAR_WEIGHTING_NATURAL:
-            /* Nothing to do. */
-            break;
-        case OSKAR_WEIGHTING_RADIAL:
-            oskar_imager_weight_radial(num_vis, pu, pv, ph, h->weight_tmp,
-                    status);
-            ph = h->weight_tmp;
-            break;
-        case OSKAR_WEIGHTING_UNIFORM:
-            oskar_imager_weight_uniform(num_vis, pu, pv, ph, h->weight_tmp,
-                    h->cellsize_rad, oskar_imager_plane_size(h), weights_grid,
-                    status);
-            ph = h->weight_tmp;
-            break;
-        default:
-            *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
-            break;
-        }
+        ph = oskar_imager_apply_weighting(h, num_vis, pu, pv, ph,
+                h->weight_tmp, weights_grid, status);
 
         /* Update the supplied plane with the supplied visibilities. */
         switch (h->algorithm)
@@ -438,6 +409,96 @@ void oskar_imager_update_plane(oskar_Imager* h, size_t num_vis,
 }
 
 
+void oskar_imager_update_selected_planes(oskar_Imager* h, int* status)
+{
+    int i;
+    size_t num_skipped = 0;
+    const int num_planes = h->num_planes;
+    const int num_im_pols = h->num_im_pols;
+    if (*status) return;
+
+    /* Other algorithms are either already parallel or update shared
+     * state, so update their planes in turn. */
+    if (h->coords_only || h->algorithm != OSKAR_ALGORITHM_FFT)
+    {
+        for (i = 0; i < num_planes; ++i)
+        {
+            const int c = i / num_im_pols;
+            if (h->num_sel[c] == 0) continue;
+            if (h->coords_only)
+                oskar_imager_update_plane(h, h->num_sel[c], h->uu_sel[c],
+                        h->vv_sel[c], h->ww_sel[c], 0, h->weight_sel[i],
+                        0, 0, h->weights_grids[i], status);
+            else
+                oskar_imager_update_plane(h, h->num_sel[c], h->uu_sel[c],
+                        h->vv_sel[c], h->ww_sel[c], h->vis_sel[i],
+                        h->weight_sel[i], h->planes[i], &h->plane_norm[i],
+                        h->weights_grids[i], status);
+        }
+        return;
+    }
+
+    /* Gridding a single plane is serial, so grid one plane per thread. */
+    oskar_timer_resume(h->tmr_grid_update);
+    oskar_imager_check_init(h, status);
+    if (!*status)
+    {
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:num_skipped)
+        for (i = 0; i < num_planes; ++i)
+        {
+            int status_plane = 0;
+            size_t num_skipped_plane = 0;
+            const oskar_Mem* weight;
+            const int c = i / num_im_pols;
+            if (h->num_sel[c] == 0) continue;
+            weight = oskar_imager_apply_weighting(h, h->num_sel[c],
+                    h->uu_sel[c], h->vv_sel[c], h->weight_sel[i],
+                    h->weight_sel_tmp[i], h->weights_grids[i],
+                    &status_plane);
+            oskar_imager_update_plane_fft(h, h->num_sel[c], h->uu_sel[c],
+                    h->vv_sel[c], h->vis_sel[i], weight, h->planes[i],
+                    &h->plane_norm[i], &num_skipped_plane, &status_plane);
+            num_skipped += num_skipped_plane;
+            if (status_plane)
+            {
+#pragma omp critical (imager_update_status)
+                *status = status_plane;
+            }
+        }
+    }
+    oskar_timer_pause(h->tmr_grid_update);
+    if (num_skipped > 0)
+        oskar_log_warning("Skipped %lu visibility points.",
+                (unsigned long) num_skipped);
+}
+
+
+const oskar_Mem* oskar_imager_apply_weighting(oskar_Imager* h,
+        size_t num_vis, const oskar_Mem* uu, const oskar_Mem* vv,
+        const oskar_Mem* weight, oskar_Mem* weight_tmp,
+        const oskar_Mem* weights_grid, int* status)
+{
+    switch (h->weighting)
+    {
+    case OSKAR_WEIGHTING_NATURAL:
+        /* Nothing to do. */
+        return weight;
+    case OSKAR_WEIGHTING_RADIAL:
+        oskar_imager_weight_radial(num_vis, uu, vv, weight, weight_tmp,
+                status);
+        return weight_tmp;
+    case OSKAR_WEIGHTING_UNIFORM:
+        oskar_imager_weight_uniform(num_vis, uu, vv, weight, weight_tmp,
+                h->cellsize_rad, oskar_imager_plane_size(h), weights_grid,
+                status);
+        return weight_tmp;
+    default:
+        *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
+        return weight;
+    }
+}
+
+
 void oskar_imager_update_weights_grid(oskar_Imager* h, size_t num_points,
         const oskar_Mem* uu, const oskar_Mem* vv, const oskar_Mem* ww,
         const oskar_Mem* weight, oskar_Mem* weights_grid, int* status)
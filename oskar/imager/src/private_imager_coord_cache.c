@@ -0,0 +1,168 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "imager/private_imager.h"
+#include "imager/private_imager_coord_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void cache_put(oskar_Imager* h, const void* data, size_t num_bytes,
+        int* status)
+{
+    const size_t max_bytes = h->coord_cache_max_bytes;
+    if (*status) return;
+    if (!h->coord_cache_file && h->coord_cache_size + num_bytes > max_bytes)
+    {
+        /* Move the cache to a temporary file. */
+        h->coord_cache_file = tmpfile();
+        if (!h->coord_cache_file || fwrite(h->coord_cache, 1,
+                h->coord_cache_size, h->coord_cache_file) !=
+                h->coord_cache_size)
+        {
+            *status = OSKAR_ERR_FILE_IO;
+            return;
+        }
+        free(h->coord_cache);
+        h->coord_cache = 0;
+        h->coord_cache_capacity = 0;
+    }
+    if (h->coord_cache_file)
+    {
+        if (fwrite(data, 1, num_bytes, h->coord_cache_file) != num_bytes)
+            *status = OSKAR_ERR_FILE_IO;
+    }
+    else
+    {
+        if (h->coord_cache_size + num_bytes > h->coord_cache_capacity)
+        {
+            size_t capacity = 2 * h->coord_cache_capacity;
+            if (capacity < h->coord_cache_size + num_bytes)
+                capacity = h->coord_cache_size + num_bytes;
+            if (capacity > max_bytes)
+                capacity = max_bytes;
+            char* t = (char*) realloc(h->coord_cache, capacity);
+            if (!t)
+            {
+                *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+                return;
+            }
+            h->coord_cache = t;
+            h->coord_cache_capacity = capacity;
+        }
+        memcpy(h->coord_cache + h->coord_cache_size, data, num_bytes);
+    }
+    h->coord_cache_size += num_bytes;
+}
+
+static void cache_get(oskar_Imager* h, void* data, size_t num_bytes,
+        int* status)
+{
+    if (*status) return;
+    if (h->coord_cache_pos + num_bytes > h->coord_cache_size)
+    {
+        *status = OSKAR_ERR_OUT_OF_RANGE;
+        return;
+    }
+    if (h->coord_cache_file)
+    {
+        if (fread(data, 1, num_bytes, h->coord_cache_file) != num_bytes)
+            *status = OSKAR_ERR_FILE_IO;
+    }
+    else
+        memcpy(data, h->coord_cache + h->coord_cache_pos, num_bytes);
+    h->coord_cache_pos += num_bytes;
+}
+
+static void cache_put_mem(oskar_Imager* h, const oskar_Mem* mem,
+        size_t num_elements, int prec, int* status)
+{
+    oskar_Mem* t = 0;
+    if (*status) return;
+    if (oskar_mem_precision(mem) != prec)
+    {
+        t = oskar_mem_convert_precision(mem, prec, status);
+        mem = t;
+    }
+    cache_put(h, oskar_mem_void_const(mem),
+            num_elements * oskar_mem_element_size(prec), status);
+    oskar_mem_free(t, status);
+}
+
+static void cache_get_mem(oskar_Imager* h, oskar_Mem* mem,
+        size_t num_elements, int* status)
+{
+    if (*status) return;
+    oskar_mem_realloc(mem, num_elements, status);
+    cache_get(h, oskar_mem_void(mem),
+            num_elements * oskar_mem_element_size(oskar_mem_type(mem)),
+            status);
+}
+
+void oskar_imager_coord_cache_clear(oskar_Imager* h)
+{
+    free(h->coord_cache);
+    if (h->coord_cache_file) fclose(h->coord_cache_file);
+    h->coord_cache = 0;
+    h->coord_cache_file = 0;
+    h->coord_cache_mode = 0;
+    h->coord_cache_size = 0;
+    h->coord_cache_capacity = 0;
+    h->coord_cache_pos = 0;
+}
+
+void oskar_imager_coord_cache_start(oskar_Imager* h, int mode, int* status)
+{
+    if (*status) return;
+    if (mode == 'w')
+        oskar_imager_coord_cache_clear(h);
+    else if (h->coord_cache_file)
+        rewind(h->coord_cache_file);
+    h->coord_cache_pos = 0;
+    h->coord_cache_mode = mode;
+}
+
+void oskar_imager_coord_cache_write(oskar_Imager* h, size_t num_rows,
+        int num_pols, const oskar_Mem* uu, const oskar_Mem* vv,
+        const oskar_Mem* ww, const oskar_Mem* weight,
+        const oskar_Mem* time_centroid, int* status)
+{
+    const int prec = h->imager_prec;
+    size_t dims[2];
+    if (*status || h->coord_cache_mode != 'w') return;
+    dims[0] = num_rows;
+    dims[1] = (size_t) num_pols;
+    cache_put(h, dims, sizeof(dims), status);
+    cache_put_mem(h, uu, num_rows, prec, status);
+    cache_put_mem(h, vv, num_rows, prec, status);
+    cache_put_mem(h, ww, num_rows, prec, status);
+    cache_put_mem(h, weight, num_rows * num_pols, prec, status);
+    cache_put_mem(h, time_centroid, num_rows, OSKAR_DOUBLE, status);
+}
+
+void oskar_imager_coord_cache_read(oskar_Imager* h, size_t num_rows,
+        int num_pols, oskar_Mem* uu, oskar_Mem* vv, oskar_Mem* ww,
+        oskar_Mem* weight, oskar_Mem* time_centroid, int* status)
+{
+    size_t dims[2];
+    if (*status) return;
+    cache_get(h, dims, sizeof(dims), status);
+    if (*status) return;
+    if (dims[0] != num_rows || dims[1] != (size_t) num_pols)
+    {
+        *status = OSKAR_ERR_DIMENSION_MISMATCH;
+        return;
+    }
+    cache_get_mem(h, uu, num_rows, status);
+    cache_get_mem(h, vv, num_rows, status);
+    cache_get_mem(h, ww, num_rows, status);
+    cache_get_mem(h, weight, num_rows * num_pols, status);
+    cache_get_mem(h, time_centroid, num_rows, status);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -183,7 +183,6 @@ void oskar_imager_init_wproj(oskar_Imager* h, int* status)
         screen_ptr = screen_gpu;
     }
     fft = oskar_fft_create(h->imager_prec, fft_loc, 2, conv_size, 0, status);
-    oskar_fft_set_ensure_consistent_norm(fft, 0);
 
     /* Generate 1D spheroidal tapering function to cover the inner region. */
     taper = oskar_mem_create(prec, OSKAR_CPU, inner, status);
@@ -27,6 +27,7 @@
  */
 
 #include "imager/private_imager.h"
+#include "imager/private_imager_coord_cache.h"
 #include "imager/private_imager_read_coords.h"
 #include "imager/oskar_imager.h"
 #include "binary/oskar_binary.h"
@@ -121,7 +122,9 @@ void oskar_imager_read_coords_ms(oskar_Imager* h, const char* filename,
             w_[i] = uvw_[3*i + 2];
         }
 
-        /* Update the imager with the data. */
+        /* Save and update the imager with the data. */
+        oskar_imager_coord_cache_write(h, block_size, num_pols,
+                u, v, w, weight, time_centroid, status);
         oskar_timer_pause(h->tmr_read);
         oskar_imager_update(h, block_size, 0, num_channels - 1,
                 num_pols, u, v, w, 0, weight, time_centroid, status);
@@ -142,12 +145,13 @@ void oskar_imager_read_coords_ms(oskar_Imager* h, const char* filename,
     oskar_mem_free(time_centroid, status);
     oskar_ms_close(ms);
 #else
+    (void) h;
     (void) filename;
     (void) i_file;
     (void) num_files;
     (void) percent_done;
     (void) percent_next;
-    oskar_log_error(h->log, "OSKAR was compiled without Measurement Set support.");
+    oskar_log_error("OSKAR was compiled without Measurement Set support.");
     *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
 #endif
 }
@@ -240,7 +244,9 @@ void oskar_imager_read_coords_vis(oskar_Imager* h, const char* filename,
         oskar_binary_read_mem(vis_file, ww, OSKAR_TAG_GROUP_VIS_BLOCK,
                 OSKAR_VIS_BLOCK_TAG_BASELINE_WW, i_block, status);
 
-        /* Update the imager with the data. */
+        /* Save and update the imager with the data. */
+        oskar_imager_coord_cache_write(h, num_rows, num_pols,
+                uu, vv, ww, weight, time_centroid, status);
         oskar_timer_pause(h->tmr_read);
         oskar_imager_update(h, num_rows, start_chan, end_chan,
                 num_pols, uu, vv, ww, 0, weight, time_centroid, status);
@@ -27,6 +27,7 @@
  */
 
 #include "imager/private_imager.h"
+#include "imager/private_imager_coord_cache.h"
 #include "imager/private_imager_read_data.h"
 #include "imager/oskar_imager.h"
 #include "binary/oskar_binary.h"
@@ -35,132 +36,126 @@
 #include "ms/oskar_measurement_set.h"
 #include "vis/oskar_vis_block.h"
 #include "vis/oskar_vis_header.h"
+#include "utility/oskar_thread.h"
 #include "utility/oskar_timer.h"
 
 #include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
-
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* A block of visibility data, converted to the imager precision. */
+struct DataBlock
+{
+    oskar_Mem *uu, *vv, *ww, *amp, *weight, *time_centroid;
+    size_t num_rows;
+    int start_chan, end_chan;
+    double fraction_done;
+};
+typedef struct DataBlock DataBlock;
+
+/* State of the reader, used by the read-ahead thread. */
+struct DataReader
+{
+    oskar_Imager* h;
+    int use_cache, num_pols, num_blocks, i_block, status;
+    DataBlock blocks[2];
+
+    /* Measurement Set input. */
+    oskar_MeasurementSet* ms;
+    size_t ms_num_rows, ms_block_rows;
+    int ms_num_channels;
+    oskar_Mem *ms_uvw, *ms_weight;
+
+    /* OSKAR visibility file input. */
+    oskar_Binary* vis_file;
+    oskar_VisHeader* hdr;
+    oskar_VisBlock* vis_block;
+    int num_baselines;
+    double time_start_mjd, time_inc_sec;
+
+    /* Visibility amplitudes, as read from the file. */
+    oskar_Mem *amp_in, *scratch;
+};
+typedef struct DataReader DataReader;
+
+static void copy_convert(const oskar_Mem* in, oskar_Mem* out,
+        size_t num_elements, int* status);
+static void* read_block(void* arg);
+static void read_block_ms(DataReader* r, DataBlock* b, int* status);
+static void read_block_vis(DataReader* r, DataBlock* b, int* status);
+static void reader_create_blocks(DataReader* r, int amp_type,
+        size_t num_weights, int* status);
+static void reader_free_blocks(DataReader* r, int* status);
+static void reader_run(DataReader* r, int i_file, int num_files,
+        int* percent_done, int* percent_next, int* status);
+
 void oskar_imager_read_data_ms(oskar_Imager* h, const char* filename,
         int i_file, int num_files, int* percent_done, int* percent_next,
         int* status)
 {
 #ifndef OSKAR_NO_MS
-    oskar_MeasurementSet* ms;
-    oskar_Mem *uvw, *u, *v, *w, *data, *weight, *time_centroid;
+    DataReader r;
     int type;
-    size_t start_row;
-    double *uvw_, *u_, *v_, *w_;
     if (*status) return;
 
     /* Read the header. */
-    ms = oskar_ms_open(filename);
-    if (!ms)
+    memset(&r, 0, sizeof(DataReader));
+    r.ms = oskar_ms_open(filename);
+    if (!r.ms)
     {
         *status = OSKAR_ERR_FILE_IO;
         return;
     }
-    const size_t num_rows = (size_t) oskar_ms_num_rows(ms);
-    const size_t num_stations = (size_t) oskar_ms_num_stations(ms);
-    const size_t num_baselines = num_stations * (num_stations - 1) / 2;
-    const int num_pols = (int) oskar_ms_num_pols(ms);
-    const int num_channels = (int) oskar_ms_num_channels(ms);
+    const size_t num_stations = (size_t) oskar_ms_num_stations(r.ms);
+    r.h = h;
+    r.use_cache = (h->coord_cache_mode == 'r');
+    r.ms_num_rows = (size_t) oskar_ms_num_rows(r.ms);
+    r.ms_block_rows = num_stations * (num_stations - 1) / 2;
+    r.ms_num_channels = (int) oskar_ms_num_channels(r.ms);
+    r.num_pols = (int) oskar_ms_num_pols(r.ms);
+    r.num_blocks = r.ms_block_rows == 0 ? 0 : (int) ((r.ms_num_rows +
+            r.ms_block_rows - 1) / r.ms_block_rows);
 
     /* Set visibility meta-data. */
     oskar_imager_set_vis_frequency(h,
-            oskar_ms_freq_start_hz(ms),
-            oskar_ms_freq_inc_hz(ms), num_channels);
+            oskar_ms_freq_start_hz(r.ms),
+            oskar_ms_freq_inc_hz(r.ms), r.ms_num_channels);
     oskar_imager_set_vis_phase_centre(h,
-            oskar_ms_phase_centre_ra_rad(ms) * 180/M_PI,
-            oskar_ms_phase_centre_dec_rad(ms) * 180/M_PI);
-
-    /* Create arrays. */
-    uvw = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 3 * num_baselines, status);
-    u = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_baselines, status);
-    v = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_baselines, status);
-    w = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_baselines, status);
-    weight = oskar_mem_create(OSKAR_SINGLE, OSKAR_CPU,
-            num_baselines * num_pols, status);
-    time_centroid = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_baselines,
-            status);
-    uvw_ = oskar_mem_double(uvw, status);
-    u_ = oskar_mem_double(u, status);
-    v_ = oskar_mem_double(v, status);
-    w_ = oskar_mem_double(w, status);
-    type = OSKAR_SINGLE | OSKAR_COMPLEX;
-    if (num_pols == 4) type |= OSKAR_MATRIX;
-    data = oskar_mem_create(type, OSKAR_CPU,
-            num_baselines * num_channels, status);
+            oskar_ms_phase_centre_ra_rad(r.ms) * 180/M_PI,
+            oskar_ms_phase_centre_dec_rad(r.ms) * 180/M_PI);
 
-    /* Loop over visibility blocks. */
-    for (start_row = 0; start_row < num_rows; start_row += num_baselines)
+    /* Create arrays for the data as stored in the Measurement Set. */
+    type = OSKAR_SINGLE | OSKAR_COMPLEX;
+    if (r.num_pols == 4) type |= OSKAR_MATRIX;
+    r.amp_in = oskar_mem_create(type, OSKAR_CPU,
+            r.ms_block_rows * r.ms_num_channels, status);
+    if (!r.use_cache)
     {
-        size_t allocated, required, block_size, i;
-        if (*status) break;
-
-        /* Read rows from Measurement Set. */
-        oskar_timer_resume(h->tmr_read);
-        block_size = num_rows - start_row;
-        if (block_size > num_baselines) block_size = num_baselines;
-        allocated = oskar_mem_length(uvw) *
-                oskar_mem_element_size(oskar_mem_type(uvw));
-        oskar_ms_read_column(ms, "UVW", start_row, block_size,
-                allocated, oskar_mem_void(uvw), &required, status);
-        allocated = oskar_mem_length(weight) *
-                oskar_mem_element_size(oskar_mem_type(weight));
-        oskar_ms_read_column(ms, "WEIGHT", start_row, block_size,
-                allocated, oskar_mem_void(weight), &required, status);
-        allocated = oskar_mem_length(time_centroid) *
-                oskar_mem_element_size(oskar_mem_type(time_centroid));
-        oskar_ms_read_column(ms, "TIME_CENTROID", start_row, block_size,
-                allocated, oskar_mem_void(time_centroid), &required, status);
-        allocated = oskar_mem_length(data) *
-                oskar_mem_element_size(oskar_mem_type(data));
-        oskar_ms_read_column(ms, h->ms_column, start_row, block_size,
-                allocated, oskar_mem_void(data), &required, status);
-        if (*status) break;
-
-        /* Split up baseline coordinates. */
-        for (i = 0; i < block_size; ++i)
-        {
-            u_[i] = uvw_[3*i + 0];
-            v_[i] = uvw_[3*i + 1];
-            w_[i] = uvw_[3*i + 2];
-        }
-
-        /* Update the imager with the data. */
-        oskar_timer_pause(h->tmr_read);
-        oskar_imager_update(h, block_size, 0, num_channels - 1,
-                num_pols, u, v, w, data, weight, time_centroid, status);
-        *percent_done = (int) round(100.0 * (
-                (start_row + block_size) / (double)(num_rows * num_files) +
-                i_file / (double)num_files));
-        if (percent_next && *percent_done >= *percent_next)
-        {
-            oskar_log_message('S', -2, "%3d%% ...", *percent_done);
-            *percent_next = 10 + 10 * (*percent_done / 10);
-        }
+        r.ms_uvw = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+                3 * r.ms_block_rows, status);
+        r.ms_weight = oskar_mem_create(OSKAR_SINGLE, OSKAR_CPU,
+                r.ms_block_rows * r.num_pols, status);
     }
-    oskar_mem_free(uvw, status);
-    oskar_mem_free(u, status);
-    oskar_mem_free(v, status);
-    oskar_mem_free(w, status);
-    oskar_mem_free(data, status);
-    oskar_mem_free(weight, status);
-    oskar_mem_free(time_centroid, status);
-    oskar_ms_close(ms);
+    reader_create_blocks(&r, type, r.ms_block_rows * r.num_pols, status);
+
+    /* Read and grid the visibility blocks. */
+    reader_run(&r, i_file, num_files, percent_done, percent_next, status);
+    reader_free_blocks(&r, status);
+    oskar_mem_free(r.ms_uvw, status);
+    oskar_mem_free(r.ms_weight, status);
+    oskar_ms_close(r.ms);
 #else
+    (void) h;
     (void) filename;
     (void) i_file;
     (void) num_files;
     (void) percent_done;
     (void) percent_next;
-    oskar_log_error(h->log, "OSKAR was compiled without Measurement Set support.");
+    oskar_log_error("OSKAR was compiled without Measurement Set support.");
     *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
 #endif
 }
@@ -170,138 +165,390 @@ void oskar_imager_read_data_vis(oskar_Imager* h, const char* filename,
         int i_file, int num_files, int* percent_done, int* percent_next,
         int* status)
 {
-    oskar_Binary* vis_file;
-    oskar_VisBlock* block;
-    oskar_VisHeader* hdr;
-    oskar_Mem *weight, *time_centroid, *scratch = 0, *ptr;
-    int i_block;
-    double time_start_mjd, time_inc_sec;
+    DataReader r;
     if (*status) return;
 
     /* Read the header. */
-    vis_file = oskar_binary_create(filename, 'r', status);
-    hdr = oskar_vis_header_read(vis_file, status);
+    memset(&r, 0, sizeof(DataReader));
+    r.vis_file = oskar_binary_create(filename, 'r', status);
+    r.hdr = oskar_vis_header_read(r.vis_file, status);
     if (*status)
     {
-        oskar_vis_header_free(hdr, status);
-        oskar_binary_free(vis_file);
+        oskar_vis_header_free(r.hdr, status);
+        oskar_binary_free(r.vis_file);
         return;
     }
-    const int max_times_per_block = oskar_vis_header_max_times_per_block(hdr);
-    const int tags_per_block = oskar_vis_header_num_tags_per_block(hdr);
-    const int num_times_tot = oskar_vis_header_num_times_total(hdr);
-    const int num_channels_tot = oskar_vis_header_num_channels_total(hdr);
-    const int num_stations = oskar_vis_header_num_stations(hdr);
-    const int num_baselines = num_stations * (num_stations - 1) / 2;
-    const int num_pols =
-            oskar_type_is_matrix(oskar_vis_header_amp_type(hdr)) ? 4 : 1;
-    const int num_weights = num_baselines * num_pols * max_times_per_block;
-    const int num_blocks = (num_times_tot + max_times_per_block - 1) /
+    const int max_times_per_block =
+            oskar_vis_header_max_times_per_block(r.hdr);
+    const int num_times_tot = oskar_vis_header_num_times_total(r.hdr);
+    const int num_channels_tot = oskar_vis_header_num_channels_total(r.hdr);
+    const int num_stations = oskar_vis_header_num_stations(r.hdr);
+    const int amp_type = oskar_vis_header_amp_type(r.hdr);
+    r.h = h;
+    r.use_cache = (h->coord_cache_mode == 'r');
+    r.num_baselines = num_stations * (num_stations - 1) / 2;
+    r.num_pols = oskar_type_is_matrix(amp_type) ? 4 : 1;
+    r.num_blocks = (num_times_tot + max_times_per_block - 1) /
             max_times_per_block;
-    time_start_mjd = oskar_vis_header_time_start_mjd_utc(hdr) * 86400.0;
-    time_inc_sec = oskar_vis_header_time_inc_sec(hdr);
+    r.time_start_mjd = oskar_vis_header_time_start_mjd_utc(r.hdr) * 86400.0;
+    r.time_inc_sec = oskar_vis_header_time_inc_sec(r.hdr);
 
     /* Set visibility meta-data. */
     oskar_imager_set_vis_frequency(h,
-            oskar_vis_header_freq_start_hz(hdr),
-            oskar_vis_header_freq_inc_hz(hdr), num_channels_tot);
+            oskar_vis_header_freq_start_hz(r.hdr),
+            oskar_vis_header_freq_inc_hz(r.hdr), num_channels_tot);
     oskar_imager_set_vis_phase_centre(h,
-            oskar_vis_header_phase_centre_ra_deg(hdr),
-            oskar_vis_header_phase_centre_dec_deg(hdr));
-
-    /* Create scratch arrays. Weights are all 1. */
-    time_centroid = oskar_mem_create(OSKAR_DOUBLE,
-            OSKAR_CPU, num_baselines * max_times_per_block, status);
-    weight = oskar_mem_create(h->imager_prec, OSKAR_CPU, num_weights, status);
-    oskar_mem_set_value_real(weight, 1.0, 0, num_weights, status);
+            oskar_vis_header_phase_centre_ra_deg(r.hdr),
+            oskar_vis_header_phase_centre_dec_deg(r.hdr));
+
+    /* Create arrays. If coordinates are cached, only the
+     * cross-correlations are read from the file. */
+    if (r.use_cache)
+        r.amp_in = oskar_mem_create(amp_type, OSKAR_CPU, 0, status);
+    else
+        r.vis_block = oskar_vis_block_create_from_header(OSKAR_CPU,
+                r.hdr, status);
     if (num_channels_tot > 1)
-        scratch = oskar_mem_create(oskar_vis_header_amp_type(hdr), OSKAR_CPU,
-                num_baselines * num_channels_tot * max_times_per_block, status);
+        r.scratch = oskar_mem_create(amp_type, OSKAR_CPU,
+                r.num_baselines * num_channels_tot * max_times_per_block,
+                status);
+    reader_create_blocks(&r, amp_type,
+            r.num_baselines * r.num_pols * max_times_per_block, status);
+
+    /* Read and grid the visibility blocks. */
+    reader_run(&r, i_file, num_files, percent_done, percent_next, status);
+    reader_free_blocks(&r, status);
+    oskar_vis_block_free(r.vis_block, status);
+    oskar_vis_header_free(r.hdr, status);
+    oskar_binary_free(r.vis_file);
+}
+
+
+static void reader_run(DataReader* r, int i_file, int num_files,
+        int* percent_done, int* percent_next, int* status)
+{
+    int i;
+    oskar_Thread* thread = 0;
+    oskar_Imager* h = r->h;
+    if (*status) return;
+
+    /* Read the first block on this thread. */
+    oskar_timer_resume(h->tmr_read);
+    r->i_block = 0;
+    if (r->num_blocks > 0) read_block(r);
+    oskar_timer_pause(h->tmr_read);
 
     /* Loop over visibility blocks. */
-    block = oskar_vis_block_create_from_header(OSKAR_CPU, hdr, status);
-    for (i_block = 0; i_block < num_blocks; ++i_block)
+    for (i = 0; i < r->num_blocks; ++i)
     {
-        int t;
-        if (*status) break;
+        DataBlock* b = &r->blocks[i % 2];
 
-        /* Read the visibility data. */
+        /* Wait for the block to be read.
+         * Only the time spent waiting counts as reading time. */
         oskar_timer_resume(h->tmr_read);
-        oskar_binary_set_query_search_start(vis_file,
-                i_block * tags_per_block, status);
-        oskar_vis_block_read(block, hdr, vis_file, i_block, status);
-        const int start_time   = oskar_vis_block_start_time_index(block);
-        const int start_chan   = oskar_vis_block_start_channel_index(block);
-        const int num_times    = oskar_vis_block_num_times(block);
-        const int num_channels = oskar_vis_block_num_channels(block);
-        const int end_chan     = start_chan + num_channels - 1;
-        const size_t num_rows  = num_times * num_baselines;
-
-        /* Fill in the time centroid values. */
-        for (t = 0; t < num_times; ++t)
-            oskar_mem_set_value_real(time_centroid,
-                    time_start_mjd + (start_time + t + 0.5) * time_inc_sec,
-                    t * num_baselines, num_baselines, status);
+        if (thread)
+        {
+            oskar_thread_join(thread);
+            oskar_thread_free(thread);
+            thread = 0;
+        }
+        oskar_timer_pause(h->tmr_read);
+        if (r->status)
+        {
+            *status = r->status;
+            break;
+        }
 
-        /* Swap baseline and channel dimensions. */
-        ptr = oskar_vis_block_cross_correlations(block);
-#define SWAP_LOOP \
-        for (t = 0; t < num_times; ++t)                                  \
-            for (c = 0; c < num_channels; ++c)                           \
-                for (b = 0; b < num_baselines; ++b)                      \
-                    for (p = 0; p < num_pols; ++p)                       \
-                    {                                                    \
-                        k = (num_pols * (num_baselines *                 \
-                                (num_channels * t + c) + b) + p) << 1;   \
-                        l = (num_pols * (num_channels *                  \
-                                (num_baselines * t + b) + c) + p) << 1;  \
-                        out[l] = in[k];                                  \
-                        out[l + 1] = in[k + 1];                          \
-                    }
-        if (num_channels != 1)
+        /* Start reading the next block into the other buffer. */
+        if (i + 1 < r->num_blocks)
         {
-            int b, c, p;
-            size_t k, l;
-            if (oskar_mem_precision(ptr) == OSKAR_SINGLE)
-            {
-                float *in, *out;
-                in  = oskar_mem_float(ptr, status);
-                out = oskar_mem_float(scratch, status);
-                SWAP_LOOP
-            }
-            else
-            {
-                double *in, *out;
-                in  = oskar_mem_double(ptr, status);
-                out = oskar_mem_double(scratch, status);
-                SWAP_LOOP
-            }
-            ptr = scratch;
+            r->i_block = i + 1;
+            thread = oskar_thread_create(read_block, (void*)r, 0);
         }
-#undef SWAP_LOOP
 
         /* Update the imager with the data. */
-        oskar_timer_pause(h->tmr_read);
-        oskar_imager_update(h, num_rows, start_chan, end_chan, num_pols,
-                oskar_vis_block_baseline_uu_metres(block),
-                oskar_vis_block_baseline_vv_metres(block),
-                oskar_vis_block_baseline_ww_metres(block),
-                ptr, weight, time_centroid, status);
+        oskar_imager_update(h, b->num_rows, b->start_chan, b->end_chan,
+                r->num_pols, b->uu, b->vv, b->ww, b->amp, b->weight,
+                b->time_centroid, status);
+        if (*status) break;
         *percent_done = (int) round(100.0 * (
-                (i_block + 1) / (double)(num_blocks * num_files) +
-                i_file / (double)num_files));
+                b->fraction_done / num_files + i_file / (double)num_files));
         if (percent_next && *percent_done >= *percent_next)
         {
             oskar_log_message('S', -2, "%3d%% ...", *percent_done);
             *percent_next = 10 + 10 * (*percent_done / 10);
         }
     }
-    oskar_mem_free(scratch, status);
-    oskar_mem_free(weight, status);
-    oskar_mem_free(time_centroid, status);
-    oskar_vis_block_free(block, status);
-    oskar_vis_header_free(hdr, status);
-    oskar_binary_free(vis_file);
+    if (thread)
+    {
+        oskar_thread_join(thread);
+        oskar_thread_free(thread);
+    }
+}
+
+
+static void* read_block(void* arg)
+{
+    DataReader* r = (DataReader*) arg;
+    DataBlock* b = &r->blocks[r->i_block % 2];
+    if (r->ms)
+        read_block_ms(r, b, &r->status);
+    else
+        read_block_vis(r, b, &r->status);
+    return 0;
+}
+
+
+static void read_block_ms(DataReader* r, DataBlock* b, int* status)
+{
+#ifndef OSKAR_NO_MS
+    size_t allocated, required, i;
+    if (*status) return;
+    const size_t start_row = r->i_block * r->ms_block_rows;
+    size_t block_size = r->ms_num_rows - start_row;
+    if (block_size > r->ms_block_rows) block_size = r->ms_block_rows;
+    b->num_rows = block_size;
+    b->start_chan = 0;
+    b->end_chan = r->ms_num_channels - 1;
+    b->fraction_done = (start_row + block_size) / (double)r->ms_num_rows;
+
+    /* Read rows from Measurement Set. */
+    if (r->use_cache)
+    {
+        /* Coordinates and weights were saved in the first pass. */
+        oskar_imager_coord_cache_read(r->h, block_size, r->num_pols,
+                b->uu, b->vv, b->ww, b->weight, b->time_centroid, status);
+    }
+    else
+    {
+        allocated = oskar_mem_length(r->ms_uvw) *
+                oskar_mem_element_size(oskar_mem_type(r->ms_uvw));
+        oskar_ms_read_column(r->ms, "UVW", start_row, block_size,
+                allocated, oskar_mem_void(r->ms_uvw), &required, status);
+        allocated = oskar_mem_length(r->ms_weight) *
+                oskar_mem_element_size(oskar_mem_type(r->ms_weight));
+        oskar_ms_read_column(r->ms, "WEIGHT", start_row, block_size,
+                allocated, oskar_mem_void(r->ms_weight), &required, status);
+        allocated = oskar_mem_length(b->time_centroid) *
+                oskar_mem_element_size(oskar_mem_type(b->time_centroid));
+        oskar_ms_read_column(r->ms, "TIME_CENTROID", start_row, block_size,
+                allocated, oskar_mem_void(b->time_centroid), &required,
+                status);
+    }
+    allocated = oskar_mem_length(r->amp_in) *
+            oskar_mem_element_size(oskar_mem_type(r->amp_in));
+    oskar_ms_read_column(r->ms, r->h->ms_column, start_row, block_size,
+            allocated, oskar_mem_void(r->amp_in), &required, status);
+    copy_convert(r->amp_in, b->amp, block_size * r->ms_num_channels, status);
+    if (*status || r->use_cache) return;
+
+    /* Split up baseline coordinates, converting to the imager precision. */
+    const double* uvw = oskar_mem_double_const(r->ms_uvw, status);
+    if (oskar_mem_precision(b->uu) == OSKAR_DOUBLE)
+    {
+        double *u, *v, *w;
+        u = oskar_mem_double(b->uu, status);
+        v = oskar_mem_double(b->vv, status);
+        w = oskar_mem_double(b->ww, status);
+        for (i = 0; i < block_size; ++i)
+        {
+            u[i] = uvw[3*i + 0];
+            v[i] = uvw[3*i + 1];
+            w[i] = uvw[3*i + 2];
+        }
+    }
+    else
+    {
+        float *u, *v, *w;
+        u = oskar_mem_float(b->uu, status);
+        v = oskar_mem_float(b->vv, status);
+        w = oskar_mem_float(b->ww, status);
+        for (i = 0; i < block_size; ++i)
+        {
+            u[i] = (float) uvw[3*i + 0];
+            v[i] = (float) uvw[3*i + 1];
+            w[i] = (float) uvw[3*i + 2];
+        }
+    }
+    copy_convert(r->ms_weight, b->weight, block_size * r->num_pols, status);
+#else
+    (void) r;
+    (void) b;
+    (void) status;
+#endif
+}
+
+
+static void read_block_vis(DataReader* r, DataBlock* b, int* status)
+{
+    int t, dim[6];
+    oskar_Mem* ptr;
+    if (*status) return;
+
+    /* Read the block dimensions and visibility data. */
+    oskar_binary_set_query_search_start(r->vis_file,
+            r->i_block * oskar_vis_header_num_tags_per_block(r->hdr), status);
+    if (r->use_cache)
+    {
+        oskar_binary_read(r->vis_file, OSKAR_INT,
+                OSKAR_TAG_GROUP_VIS_BLOCK,
+                OSKAR_VIS_BLOCK_TAG_DIM_START_AND_SIZE, r->i_block,
+                sizeof(dim), dim, status);
+        oskar_binary_read_mem(r->vis_file, r->amp_in,
+                OSKAR_TAG_GROUP_VIS_BLOCK,
+                OSKAR_VIS_BLOCK_TAG_CROSS_CORRELATIONS, r->i_block, status);
+        ptr = r->amp_in;
+    }
+    else
+    {
+        oskar_vis_block_read(r->vis_block, r->hdr, r->vis_file,
+                r->i_block, status);
+        dim[0] = oskar_vis_block_start_time_index(r->vis_block);
+        dim[1] = oskar_vis_block_start_channel_index(r->vis_block);
+        dim[2] = oskar_vis_block_num_times(r->vis_block);
+        dim[3] = oskar_vis_block_num_channels(r->vis_block);
+        ptr = oskar_vis_block_cross_correlations(r->vis_block);
+    }
+    if (*status) return;
+    const int start_time   = dim[0];
+    const int num_times    = dim[2];
+    const int num_channels = dim[3];
+    const int num_baselines = r->num_baselines;
+    const int num_pols     = r->num_pols;
+    const size_t num_rows  = num_times * num_baselines;
+    b->num_rows = num_rows;
+    b->start_chan = dim[1];
+    b->end_chan = dim[1] + num_channels - 1;
+    b->fraction_done = (r->i_block + 1) / (double)r->num_blocks;
+
+    if (r->use_cache)
+    {
+        /* Coordinates and weights were saved in the first pass. */
+        oskar_imager_coord_cache_read(r->h, num_rows, num_pols,
+                b->uu, b->vv, b->ww, b->weight, b->time_centroid, status);
+    }
+    else
+    {
+        /* Fill in the time centroid values. */
+        for (t = 0; t < num_times; ++t)
+            oskar_mem_set_value_real(b->time_centroid,
+                    r->time_start_mjd + (start_time + t + 0.5) *
+                    r->time_inc_sec, t * num_baselines, num_baselines,
+                    status);
+        copy_convert(oskar_vis_block_baseline_uu_metres(r->vis_block),
+                b->uu, num_rows, status);
+        copy_convert(oskar_vis_block_baseline_vv_metres(r->vis_block),
+                b->vv, num_rows, status);
+        copy_convert(oskar_vis_block_baseline_ww_metres(r->vis_block),
+                b->ww, num_rows, status);
+    }
+
+    /* Swap baseline and channel dimensions. */
+#define SWAP_LOOP \
+    for (t = 0; t < num_times; ++t)                                  \
+        for (c = 0; c < num_channels; ++c)                           \
+            for (bl = 0; bl < num_baselines; ++bl)                   \
+                for (p = 0; p < num_pols; ++p)                       \
+                {                                                    \
+                    k = (num_pols * (num_baselines *                 \
+                            (num_channels * t + c) + bl) + p) << 1;  \
+                    l = (num_pols * (num_channels *                  \
+                            (num_baselines * t + bl) + c) + p) << 1; \
+                    out[l] = in[k];                                  \
+                    out[l + 1] = in[k + 1];                          \
+                }
+    if (num_channels != 1)
+    {
+        int bl, c, p;
+        size_t k, l;
+        if (oskar_mem_precision(ptr) == OSKAR_SINGLE)
+        {
+            const float* in = oskar_mem_float_const(ptr, status);
+            float* out = oskar_mem_float(r->scratch, status);
+            SWAP_LOOP
+        }
+        else
+        {
+            const double* in = oskar_mem_double_const(ptr, status);
+            double* out = oskar_mem_double(r->scratch, status);
+            SWAP_LOOP
+        }
+        ptr = r->scratch;
+    }
+#undef SWAP_LOOP
+    copy_convert(ptr, b->amp, num_rows * num_channels, status);
+}
+
+
+static void copy_convert(const oskar_Mem* in, oskar_Mem* out,
+        size_t num_elements, int* status)
+{
+    size_t i;
+    if (*status) return;
+    oskar_mem_ensure(out, num_elements, status);
+    if (*status) return;
+    if (oskar_mem_type(in) == oskar_mem_type(out))
+    {
+        oskar_mem_copy_contents(out, in, 0, 0, num_elements, status);
+        return;
+    }
+    const int prec_in = oskar_mem_precision(in);
+    const size_t num_values = num_elements *
+            oskar_mem_element_size(oskar_mem_type(in)) /
+            oskar_mem_element_size(prec_in);
+    if (prec_in == OSKAR_SINGLE)
+    {
+        const float* p_in = (const float*) oskar_mem_void_const(in);
+        double* p_out = (double*) oskar_mem_void(out);
+        for (i = 0; i < num_values; ++i) p_out[i] = (double) p_in[i];
+    }
+    else
+    {
+        const double* p_in = (const double*) oskar_mem_void_const(in);
+        float* p_out = (float*) oskar_mem_void(out);
+        for (i = 0; i < num_values; ++i) p_out[i] = (float) p_in[i];
+    }
+}
+
+
+static void reader_create_blocks(DataReader* r, int amp_type,
+        size_t num_weights, int* status)
+{
+    int i;
+    const int prec = r->h->imager_prec;
+    amp_type = prec | (amp_type & ~(OSKAR_SINGLE | OSKAR_DOUBLE));
+    for (i = 0; i < 2; ++i)
+    {
+        DataBlock* b = &r->blocks[i];
+        b->uu = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+        b->vv = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+        b->ww = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+        b->amp = oskar_mem_create(amp_type, OSKAR_CPU, 0, status);
+        b->time_centroid = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+                num_weights / r->num_pols, status);
+
+        /* Weights in OSKAR visibility files are all 1. */
+        b->weight = oskar_mem_create(prec, OSKAR_CPU, num_weights, status);
+        oskar_mem_set_value_real(b->weight, 1.0, 0, num_weights, status);
+    }
+}
+
+
+static void reader_free_blocks(DataReader* r, int* status)
+{
+    int i;
+    for (i = 0; i < 2; ++i)
+    {
+        DataBlock* b = &r->blocks[i];
+        oskar_mem_free(b->uu, status);
+        oskar_mem_free(b->vv, status);
+        oskar_mem_free(b->ww, status);
+        oskar_mem_free(b->amp, status);
+        oskar_mem_free(b->weight, status);
+        oskar_mem_free(b->time_centroid, status);
+    }
+    oskar_mem_free(r->amp_in, status);
+    oskar_mem_free(r->scratch, status);
 }
 
 #ifdef __cplusplus
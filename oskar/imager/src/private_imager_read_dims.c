@@ -59,8 +59,9 @@ void oskar_imager_read_dims_ms(oskar_Imager* h, const char* filename,
             (int) oskar_ms_num_channels(ms));
     oskar_ms_close(ms);
 #else
+    (void) h;
     (void) filename;
-    oskar_log_error(h->log, "OSKAR was compiled without Measurement Set support.");
+    oskar_log_error("OSKAR was compiled without Measurement Set support.");
     *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
 #endif
 }
@@ -40,7 +40,8 @@ extern "C" {
 
 static
 void copy_vis_pol(size_t num_rows, int num_channels, int num_pols,
-        int c, int p, const oskar_Mem* vis_in, const oskar_Mem* weight_in,
+        int num_baselines, int c, int p,
+        const oskar_Mem* vis_in, const oskar_Mem* weight_in,
         oskar_Mem* vis_out, oskar_Mem* weight_out, size_t out_offset,
         int* status);
 
@@ -50,6 +51,7 @@ void oskar_imager_select_data(
         int start_chan,
         int end_chan,
         int num_pols,
+        int num_baselines,
         const oskar_Mem* uu_in,
         const oskar_Mem* vv_in,
         const oskar_Mem* ww_in,
@@ -102,7 +104,7 @@ void oskar_imager_select_data(
         oskar_mem_scale_real(ww_out, inv_wavelength, 0, num_rows, status);
 
         /* Copy visibility data and weights if present. */
-        copy_vis_pol(num_rows, num_channels, num_pols,
+        copy_vis_pol(num_rows, num_channels, num_pols, num_baselines,
                 c - start_chan, p, vis_in, weight_in,
                 vis_out, weight_out, 0, status);
 
@@ -138,7 +140,7 @@ void oskar_imager_select_data(
                     *num_out, num_rows, status);
 
             /* Copy visibility data and weights if present. */
-            copy_vis_pol(num_rows, num_channels, num_pols,
+            copy_vis_pol(num_rows, num_channels, num_pols, num_baselines,
                     c - start_chan, p, vis_in, weight_in,
                     vis_out, weight_out, *num_out, status);
 
@@ -156,11 +158,14 @@ void oskar_imager_select_data(
 
 
 void copy_vis_pol(size_t num_rows, int num_channels, int num_pols,
-        int c, int p, const oskar_Mem* vis_in, const oskar_Mem* weight_in,
+        int num_baselines, int c, int p,
+        const oskar_Mem* vis_in, const oskar_Mem* weight_in,
         oskar_Mem* vis_out, oskar_Mem* weight_out, size_t out_offset,
         int* status)
 {
-    size_t r;
+    size_t b, r, t;
+    const size_t nb = (size_t) num_baselines;
+    const size_t num_times = nb > 0 ? num_rows / nb : 0;
     if (*status) return;
     if (oskar_mem_precision(vis_out) == OSKAR_SINGLE)
     {
@@ -177,8 +182,13 @@ void copy_vis_pol(size_t num_rows, int num_channels, int num_pols,
             const float2* v_in;
             v_out = oskar_mem_float2(vis_out, status) + out_offset;
             v_in = oskar_mem_float2_const(vis_in, status);
-            for (r = 0; r < num_rows; ++r)
-                v_out[r] = v_in[num_pols * (num_channels * r + c) + p];
+            for (t = 0, r = 0; t < num_times; ++t)
+            {
+                const float2* v_t = v_in + num_pols * nb *
+                        (num_channels * t + c) + p;
+                for (b = 0; b < nb; ++b, ++r)
+                    v_out[r] = v_t[num_pols * b];
+            }
         }
     }
     else
@@ -196,8 +206,13 @@ void copy_vis_pol(size_t num_rows, int num_channels, int num_pols,
             const double2* v_in;
             v_out = oskar_mem_double2(vis_out, status) + out_offset;
             v_in = oskar_mem_double2_const(vis_in, status);
-            for (r = 0; r < num_rows; ++r)
-                v_out[r] = v_in[num_pols * (num_channels * r + c) + p];
+            for (t = 0, r = 0; t < num_times; ++t)
+            {
+                const double2* v_t = v_in + num_pols * nb *
+                        (num_channels * t + c) + p;
+                for (b = 0; b < nb; ++b, ++r)
+                    v_out[r] = v_t[num_pols * b];
+            }
         }
     }
 }
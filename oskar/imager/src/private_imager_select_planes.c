@@ -0,0 +1,454 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "imager/private_imager.h"
+#include "imager/oskar_imager.h"
+
+#include "imager/private_imager_select_planes.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define C0 299792458.0
+
+/* What to write to the selected visibility arrays. */
+enum { VIS_NONE, VIS_PSF, VIS_LINEAR, VIS_STOKES };
+
+/* Filter ranges. The time centroids are NULL if not filtering by time. */
+struct SelectFilters
+{
+    const double* time_in;
+    double time_range[2], uv_range[2];
+    int use_uv_filter;
+};
+typedef struct SelectFilters SelectFilters;
+
+static int select_channel(const oskar_Imager* h, double freq_hz,
+        int start_chan, int end_chan, double* inv_wavelength);
+static void select_d(const oskar_Imager* h, size_t num_rows,
+        int num_channels, int num_pols, int num_baselines, int c,
+        double inv_wavelength,
+        int vis_mode, const int* pol, const SelectFilters* f,
+        const double* uu, const double* vv, const double* ww,
+        const double2* vis, const double* weight, size_t* num_out,
+        double* uu_out, double* vv_out, double* ww_out,
+        double2** vis_out, double** weight_out);
+static void select_f(const oskar_Imager* h, size_t num_rows,
+        int num_channels, int num_pols, int num_baselines, int c,
+        double inv_wavelength,
+        int vis_mode, const int* pol, const SelectFilters* f,
+        const float* uu, const float* vv, const float* ww,
+        const float2* vis, const float* weight, size_t* num_out,
+        float* uu_out, float* vv_out, float* ww_out,
+        float2** vis_out, float** weight_out);
+
+void oskar_imager_select_planes(
+        oskar_Imager* h,
+        size_t num_rows,
+        int start_chan,
+        int end_chan,
+        int num_pols,
+        int num_baselines,
+        const oskar_Mem* uu_in,
+        const oskar_Mem* vv_in,
+        const oskar_Mem* ww_in,
+        const oskar_Mem* vis_in,
+        const oskar_Mem* weight_in,
+        const oskar_Mem* time_in,
+        int* status)
+{
+    int c, i, p, vis_mode, pol[4];
+    SelectFilters f;
+    if (*status) return;
+    const int num_channels = 1 + end_chan - start_chan;
+    const int num_im_channels = h->num_im_channels;
+    const int num_im_pols = h->num_im_pols;
+    const int num_planes = h->num_planes;
+    const int prec = h->imager_prec;
+
+    /* Create the arrays for each image channel and plane if required. */
+    if (h->num_sel_channels != num_im_channels ||
+            h->num_sel_planes != num_planes)
+    {
+        oskar_imager_select_planes_free(h, status);
+        h->num_sel_channels = num_im_channels;
+        h->num_sel_planes = num_planes;
+        h->num_sel = (size_t*) calloc(num_im_channels, sizeof(size_t));
+        h->uu_sel = (oskar_Mem**) calloc(num_im_channels, sizeof(oskar_Mem*));
+        h->vv_sel = (oskar_Mem**) calloc(num_im_channels, sizeof(oskar_Mem*));
+        h->ww_sel = (oskar_Mem**) calloc(num_im_channels, sizeof(oskar_Mem*));
+        for (c = 0; c < num_im_channels; ++c)
+        {
+            h->uu_sel[c] = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+            h->vv_sel[c] = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+            h->ww_sel[c] = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+        }
+        h->vis_sel = (oskar_Mem**) calloc(num_planes, sizeof(oskar_Mem*));
+        h->weight_sel = (oskar_Mem**) calloc(num_planes, sizeof(oskar_Mem*));
+        h->weight_sel_tmp = (oskar_Mem**)
+                calloc(num_planes, sizeof(oskar_Mem*));
+        for (i = 0; i < num_planes; ++i)
+        {
+            h->vis_sel[i] = oskar_mem_create(prec | OSKAR_COMPLEX,
+                    OSKAR_CPU, 0, status);
+            h->weight_sel[i] = oskar_mem_create(prec, OSKAR_CPU, 0, status);
+            h->weight_sel_tmp[i] = oskar_mem_create(prec,
+                    OSKAR_CPU, 0, status);
+        }
+    }
+
+    /* Get the input polarisation index for each image polarisation. */
+    for (p = 0; p < num_im_pols; ++p)
+    {
+        pol[p] = h->pol_offset;
+        if (h->im_type == OSKAR_IMAGE_TYPE_STOKES ||
+                h->im_type == OSKAR_IMAGE_TYPE_LINEAR)
+            pol[p] = p;
+        if (num_pols == 1) pol[p] = 0;
+    }
+    vis_mode = VIS_LINEAR;
+    if (h->coords_only || !vis_in)
+        vis_mode = VIS_NONE;
+    else if (h->im_type == OSKAR_IMAGE_TYPE_PSF)
+        vis_mode = VIS_PSF;
+    else if (h->use_stokes && num_pols == 4)
+        vis_mode = VIS_STOKES;
+
+    /* Get the filter ranges. */
+    f.time_in = 0;
+    if ((h->time_min_utc > 0.0 || h->time_max_utc > 0.0) &&
+            time_in && oskar_mem_length(time_in) > 0)
+    {
+        f.time_in = oskar_mem_double_const(time_in, status);
+        f.time_range[0] = h->time_min_utc;
+        f.time_range[1] = (h->time_max_utc <= 0.0) ?
+                (double) FLT_MAX : h->time_max_utc;
+    }
+    f.use_uv_filter = !(h->uv_filter_min <= 0.0 && h->uv_filter_max < 0.0);
+    f.uv_range[0] = h->uv_filter_min;
+    f.uv_range[1] = (h->uv_filter_max < 0.0) ?
+            (double) FLT_MAX : h->uv_filter_max;
+    f.uv_range[0] *= f.uv_range[0];
+    f.uv_range[1] *= f.uv_range[1];
+
+    /* Make sure there is enough space for each image channel. */
+    for (c = 0; c < num_im_channels; ++c)
+    {
+        size_t num_sel_max = 0;
+        double inv_wavelength;
+        h->num_sel[c] = 0;
+        if (h->chan_snaps)
+        {
+            if (select_channel(h, h->im_freqs[c], start_chan, end_chan,
+                    &inv_wavelength) >= 0)
+                num_sel_max = num_rows;
+        }
+        else
+        {
+            for (i = 0; i < h->num_sel_freqs; ++i)
+                if (select_channel(h, h->sel_freqs[i], start_chan, end_chan,
+                        &inv_wavelength) >= 0)
+                    num_sel_max += num_rows;
+        }
+        if (num_sel_max == 0) continue;
+        oskar_mem_ensure(h->uu_sel[c], num_sel_max, status);
+        oskar_mem_ensure(h->vv_sel[c], num_sel_max, status);
+        oskar_mem_ensure(h->ww_sel[c], num_sel_max, status);
+        for (p = 0; p < num_im_pols; ++p)
+        {
+            i = num_im_pols * c + p;
+            oskar_mem_ensure(h->weight_sel[i], num_sel_max, status);
+            oskar_mem_ensure(h->weight_sel_tmp[i], num_sel_max, status);
+            if (vis_mode != VIS_NONE)
+                oskar_mem_ensure(h->vis_sel[i], num_sel_max, status);
+        }
+    }
+    if (*status) return;
+
+    /* Scan the block for each image channel. */
+#pragma omp parallel for private(i, p) schedule(dynamic, 1)
+    for (c = 0; c < num_im_channels; ++c)
+    {
+        int j, s = 0;
+        const int num_freqs = h->chan_snaps ? 1 : h->num_sel_freqs;
+        for (j = 0; j < num_freqs; ++j)
+        {
+            double inv_wavelength;
+            const int c_in = select_channel(h,
+                    h->chan_snaps ? h->im_freqs[c] : h->sel_freqs[j],
+                    start_chan, end_chan, &inv_wavelength);
+            if (c_in < 0) continue;
+            if (prec == OSKAR_DOUBLE)
+            {
+                double2* vis_out[4];
+                double* weight_out[4];
+                for (p = 0; p < num_im_pols; ++p)
+                {
+                    i = num_im_pols * c + p;
+                    vis_out[p] = oskar_mem_double2(h->vis_sel[i], &s);
+                    weight_out[p] = oskar_mem_double(h->weight_sel[i], &s);
+                }
+                select_d(h, num_rows, num_channels, num_pols,
+                        num_baselines, c_in - start_chan, inv_wavelength,
+                        vis_mode, pol, &f,
+                        oskar_mem_double_const(uu_in, &s),
+                        oskar_mem_double_const(vv_in, &s),
+                        oskar_mem_double_const(ww_in, &s),
+                        vis_mode >= VIS_LINEAR ?
+                                (const double2*) oskar_mem_void_const(vis_in) :
+                                0,
+                        oskar_mem_double_const(weight_in, &s),
+                        &h->num_sel[c],
+                        oskar_mem_double(h->uu_sel[c], &s),
+                        oskar_mem_double(h->vv_sel[c], &s),
+                        oskar_mem_double(h->ww_sel[c], &s),
+                        vis_out, weight_out);
+            }
+            else
+            {
+                float2* vis_out[4];
+                float* weight_out[4];
+                for (p = 0; p < num_im_pols; ++p)
+                {
+                    i = num_im_pols * c + p;
+                    vis_out[p] = oskar_mem_float2(h->vis_sel[i], &s);
+                    weight_out[p] = oskar_mem_float(h->weight_sel[i], &s);
+                }
+                select_f(h, num_rows, num_channels, num_pols,
+                        num_baselines, c_in - start_chan, inv_wavelength,
+                        vis_mode, pol, &f,
+                        oskar_mem_float_const(uu_in, &s),
+                        oskar_mem_float_const(vv_in, &s),
+                        oskar_mem_float_const(ww_in, &s),
+                        vis_mode >= VIS_LINEAR ?
+                                (const float2*) oskar_mem_void_const(vis_in) :
+                                0,
+                        oskar_mem_float_const(weight_in, &s),
+                        &h->num_sel[c],
+                        oskar_mem_float(h->uu_sel[c], &s),
+                        oskar_mem_float(h->vv_sel[c], &s),
+                        oskar_mem_float(h->ww_sel[c], &s),
+                        vis_out, weight_out);
+            }
+        }
+    }
+}
+
+
+void oskar_imager_select_planes_free(oskar_Imager* h, int* status)
+{
+    int i;
+    for (i = 0; i < h->num_sel_channels; ++i)
+    {
+        oskar_mem_free(h->uu_sel[i], status);
+        oskar_mem_free(h->vv_sel[i], status);
+        oskar_mem_free(h->ww_sel[i], status);
+    }
+    for (i = 0; i < h->num_sel_planes; ++i)
+    {
+        oskar_mem_free(h->vis_sel[i], status);
+        oskar_mem_free(h->weight_sel[i], status);
+        oskar_mem_free(h->weight_sel_tmp[i], status);
+    }
+    free(h->num_sel); h->num_sel = 0;
+    free(h->uu_sel); h->uu_sel = 0;
+    free(h->vv_sel); h->vv_sel = 0;
+    free(h->ww_sel); h->ww_sel = 0;
+    free(h->vis_sel); h->vis_sel = 0;
+    free(h->weight_sel); h->weight_sel = 0;
+    free(h->weight_sel_tmp); h->weight_sel_tmp = 0;
+    h->num_sel_channels = 0;
+    h->num_sel_planes = 0;
+}
+
+
+int select_channel(const oskar_Imager* h, double freq_hz,
+        int start_chan, int end_chan, double* inv_wavelength)
+{
+    const double s = 0.05;
+    const double df = h->freq_inc_hz != 0.0 ? h->freq_inc_hz : 1.0;
+    const double f0 = h->vis_freq_start_hz;
+    const int c = (int) round((freq_hz - f0) / df);
+    if (c < start_chan || c > end_chan) return -1;
+    if (fabs((freq_hz - f0) - c * df) > s * df) return -1;
+    *inv_wavelength = (f0 + c * df) / C0;
+    return c;
+}
+
+
+void select_d(const oskar_Imager* h, size_t num_rows,
+        int num_channels, int num_pols, int num_baselines, int c,
+        double inv_wavelength,
+        int vis_mode, const int* pol, const SelectFilters* f,
+        const double* uu, const double* vv, const double* ww,
+        const double2* vis, const double* weight, size_t* num_out,
+        double* uu_out, double* vv_out, double* ww_out,
+        double2** vis_out, double** weight_out)
+{
+    size_t r, k = *num_out, bl = 0;
+    int p;
+    const int num_im_pols = h->num_im_pols;
+    const size_t nb = (size_t) num_baselines;
+    size_t t_offset = nb * c; /* Start of this channel at the current time. */
+    for (r = 0; r < num_rows; ++r, ++bl)
+    {
+        if (bl == nb)
+        {
+            bl = 0;
+            t_offset += nb * num_channels;
+        }
+        if (f->time_in)
+        {
+            const double t = f->time_in[r];
+            if (!(t >= f->time_range[0] && t <= f->time_range[1])) continue;
+        }
+        const double u = uu[r] * inv_wavelength;
+        const double v = vv[r] * inv_wavelength;
+        if (f->use_uv_filter)
+        {
+            const double uv = u * u + v * v;
+            if (!(uv >= f->uv_range[0] && uv <= f->uv_range[1])) continue;
+        }
+        uu_out[k] = u;
+        vv_out[k] = v;
+        ww_out[k] = ww[r] * inv_wavelength;
+        const size_t b = num_pols * (t_offset + bl);
+        for (p = 0; p < num_im_pols; ++p)
+        {
+            weight_out[p][k] = weight[num_pols * r + pol[p]];
+            switch (vis_mode)
+            {
+            case VIS_PSF:
+                vis_out[p][k].x = 1.0;
+                vis_out[p][k].y = 0.0;
+                break;
+            case VIS_LINEAR:
+                vis_out[p][k] = vis[b + pol[p]];
+                break;
+            case VIS_STOKES:
+            {
+                const double2 xx = vis[b], xy = vis[b + 1];
+                const double2 yx = vis[b + 2], yy = vis[b + 3];
+                double2* out = &vis_out[p][k];
+                switch (pol[p])
+                {
+                case 0: /* I = 0.5 (XX + YY) */
+                    out->x =  0.5 * (xx.x + yy.x);
+                    out->y =  0.5 * (xx.y + yy.y);
+                    break;
+                case 1: /* Q = 0.5 (XX - YY) */
+                    out->x =  0.5 * (xx.x - yy.x);
+                    out->y =  0.5 * (xx.y - yy.y);
+                    break;
+                case 2: /* U = 0.5 (XY + YX) */
+                    out->x =  0.5 * (xy.x + yx.x);
+                    out->y =  0.5 * (xy.y + yx.y);
+                    break;
+                default: /* V = -0.5i (XY - YX) */
+                    out->x =  0.5 * (xy.y - yx.y);
+                    out->y = -0.5 * (xy.x - yx.x);
+                    break;
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        k++;
+    }
+    *num_out = k;
+}
+
+
+void select_f(const oskar_Imager* h, size_t num_rows,
+        int num_channels, int num_pols, int num_baselines, int c,
+        double inv_wavelength,
+        int vis_mode, const int* pol, const SelectFilters* f,
+        const float* uu, const float* vv, const float* ww,
+        const float2* vis, const float* weight, size_t* num_out,
+        float* uu_out, float* vv_out, float* ww_out,
+        float2** vis_out, float** weight_out)
+{
+    size_t r, k = *num_out, bl = 0;
+    int p;
+    const int num_im_pols = h->num_im_pols;
+    const size_t nb = (size_t) num_baselines;
+    size_t t_offset = nb * c; /* Start of this channel at the current time. */
+    const float inv_wavelength_f = (float) inv_wavelength;
+    for (r = 0; r < num_rows; ++r, ++bl)
+    {
+        if (bl == nb)
+        {
+            bl = 0;
+            t_offset += nb * num_channels;
+        }
+        if (f->time_in)
+        {
+            const double t = f->time_in[r];
+            if (!(t >= f->time_range[0] && t <= f->time_range[1])) continue;
+        }
+        const float u = uu[r] * inv_wavelength_f;
+        const float v = vv[r] * inv_wavelength_f;
+        if (f->use_uv_filter)
+        {
+            const double uv = u * u + v * v;
+            if (!(uv >= f->uv_range[0] && uv <= f->uv_range[1])) continue;
+        }
+        uu_out[k] = u;
+        vv_out[k] = v;
+        ww_out[k] = ww[r] * inv_wavelength_f;
+        const size_t b = num_pols * (t_offset + bl);
+        for (p = 0; p < num_im_pols; ++p)
+        {
+            weight_out[p][k] = weight[num_pols * r + pol[p]];
+            switch (vis_mode)
+            {
+            case VIS_PSF:
+                vis_out[p][k].x = 1.0f;
+                vis_out[p][k].y = 0.0f;
+                break;
+            case VIS_LINEAR:
+                vis_out[p][k] = vis[b + pol[p]];
+                break;
+            case VIS_STOKES:
+            {
+                const float2 xx = vis[b], xy = vis[b + 1];
+                const float2 yx = vis[b + 2], yy = vis[b + 3];
+                float2* out = &vis_out[p][k];
+                switch (pol[p])
+                {
+                case 0: /* I = 0.5 (XX + YY) */
+                    out->x =  0.5 * (xx.x + yy.x);
+                    out->y =  0.5 * (xx.y + yy.y);
+                    break;
+                case 1: /* Q = 0.5 (XX - YY) */
+                    out->x =  0.5 * (xx.x - yy.x);
+                    out->y =  0.5 * (xx.y - yy.y);
+                    break;
+                case 2: /* U = 0.5 (XY + YX) */
+                    out->x =  0.5 * (xy.x + yx.x);
+                    out->y =  0.5 * (xy.y + yx.y);
+                    break;
+                default: /* V = -0.5i (XY - YX) */
+                    out->x =  0.5 * (xy.y - yx.y);
+                    out->y = -0.5 * (xy.x - yx.x);
+                    break;
+                }
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        k++;
+    }
+    *num_out = k;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,174 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "imager/oskar_grid_wproj2.h"
+#include "mem/oskar_mem.h"
+#include "utility/oskar_timer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/* Serial reference version, gridding one visibility at a time. */
+template<typename FP>
+static void grid_wproj_ref(const size_t num_w_planes, const int* support,
+        const int oversample, const int* wkernel_start, const FP* wkernel,
+        const size_t num_points, const FP* uu, const FP* vv,
+        const FP* ww, const FP* vis, const FP* weight,
+        const FP cell_size_rad, const FP w_scale,
+        const int grid_size, size_t* num_skipped, double* norm, FP* grid)
+{
+    const int grid_centre = grid_size / 2;
+    const int oversample_h = oversample / 2;
+    const FP grid_scale = grid_size * cell_size_rad;
+    *num_skipped = 0;
+    for (size_t i = 0; i < num_points; ++i)
+    {
+        double sum = 0.0;
+        const FP pos_u = -uu[i] * grid_scale;
+        const FP pos_v = vv[i] * grid_scale;
+        const FP conv_conj = (ww[i] > (FP) 0) ? (FP) -1 : (FP) 1;
+        const size_t grid_w = (size_t)std::round(
+                std::sqrt(std::fabs(ww[i] * w_scale)));
+        const int grid_u = (int)std::round(pos_u) + grid_centre;
+        const int grid_v = (int)std::round(pos_v) + grid_centre;
+        const FP v_re = weight[i] * vis[2 * i];
+        const FP v_im = weight[i] * vis[2 * i + 1];
+        const int off_u = (int)std::round((std::round(pos_u) - pos_u) *
+                oversample);
+        const int off_v = (int)std::round((std::round(pos_v) - pos_v) *
+                oversample);
+        const size_t w_plane = grid_w < num_w_planes ?
+                grid_w : num_w_planes - 1;
+        const int w_support = support[w_plane];
+        if (grid_u + w_support >= grid_size || grid_u - w_support < 0 ||
+                grid_v + w_support >= grid_size || grid_v - w_support < 0)
+        {
+            *num_skipped += 1;
+            continue;
+        }
+        const int conv_len = 2 * w_support + 1;
+        const int width = (oversample_h * conv_len + 1) * conv_len;
+        const int mid = wkernel_start[w_plane] + (abs(off_u) + 1) * width -
+                1 - w_support;
+        const int stride = (off_u >= 0) ? 1 : -1;
+        for (int j = -w_support; j <= w_support; ++j)
+        {
+            const int t = mid - abs(off_v + j * oversample) * conv_len;
+            const size_t p1 = (size_t)(grid_v + j) * grid_size + grid_u;
+            for (int k = -w_support; k <= w_support; ++k)
+            {
+                const int p = (t + stride * k) << 1;
+                const FP c_re = wkernel[p];
+                const FP c_im = wkernel[p + 1] * conv_conj;
+                const size_t p2 = (p1 + k) << 1;
+                grid[p2]     += (v_re * c_re - v_im * c_im);
+                grid[p2 + 1] += (v_im * c_re + v_re * c_im);
+                sum += c_re;
+            }
+        }
+        *norm += sum * weight[i];
+    }
+}
+
+static double rand_uniform(double min_val, double max_val)
+{
+    return min_val + (max_val - min_val) * rand() / (double)RAND_MAX;
+}
+
+TEST(grid_wproj2, compare_serial)
+{
+    const int grid_size = 1024, oversample = 4, num_w_planes = 8;
+    const size_t num_points = 200000;
+    const double cell_size_rad = 4e-5, w_scale = 0.02;
+
+    /* Generate kernels in the rearranged layout, with random values. */
+    std::vector<int> support(num_w_planes), start(num_w_planes);
+    int kernel_size = 0;
+    for (int w = 0; w < num_w_planes; ++w)
+    {
+        const int conv_len = 2 * (support[w] = 3 + 2 * w) + 1;
+        start[w] = kernel_size;
+        kernel_size += ((oversample / 2) * conv_len + 1) * conv_len *
+                (oversample / 2 + 1);
+    }
+    std::vector<double> kernels(2 * kernel_size);
+    for (size_t i = 0; i < kernels.size(); ++i)
+        kernels[i] = rand_uniform(-1.0, 1.0);
+
+    /* Generate visibilities, some of which lie off the grid. */
+    std::vector<double> uu(num_points), vv(num_points), ww(num_points);
+    std::vector<double> vis(2 * num_points), weight(num_points);
+    const double max_uv = 0.55 / cell_size_rad;
+    for (size_t i = 0; i < num_points; ++i)
+    {
+        uu[i] = rand_uniform(-max_uv, max_uv) * rand_uniform(0.0, 1.0);
+        vv[i] = rand_uniform(-max_uv, max_uv) * rand_uniform(0.0, 1.0);
+        ww[i] = rand_uniform(-3000.0, 3000.0);
+        vis[2 * i] = rand_uniform(-1.0, 1.0);
+        vis[2 * i + 1] = rand_uniform(-1.0, 1.0);
+        weight[i] = rand_uniform(0.5, 1.0);
+    }
+
+    /* Grid the visibilities using both versions. */
+    const size_t num_cells = (size_t) grid_size * grid_size;
+    std::vector<double> grid(2 * num_cells, 0.0), grid_ref(2 * num_cells, 0.0);
+    size_t num_skipped = 0, num_skipped_ref = 0;
+    double norm = 0.0, norm_ref = 0.0;
+    oskar_Timer* tmr = oskar_timer_create(OSKAR_CPU);
+    oskar_timer_start(tmr);
+    grid_wproj_ref(num_w_planes, &support[0], oversample, &start[0],
+            &kernels[0], num_points, &uu[0], &vv[0], &ww[0], &vis[0],
+            &weight[0], cell_size_rad, w_scale, grid_size,
+            &num_skipped_ref, &norm_ref, &grid_ref[0]);
+    printf("Serial gridding: %.3f sec\n", oskar_timer_elapsed(tmr));
+    oskar_timer_start(tmr);
+    oskar_grid_wproj2_d(num_w_planes, &support[0], oversample, &start[0],
+            &kernels[0], num_points, &uu[0], &vv[0], &ww[0], &vis[0],
+            &weight[0], cell_size_rad, w_scale, grid_size,
+            &num_skipped, &norm, &grid[0]);
+    printf("Tiled gridding: %.3f sec\n", oskar_timer_elapsed(tmr));
+    oskar_timer_free(tmr);
+
+    /* Check results are consistent. */
+    EXPECT_GT(num_skipped_ref, 0u);
+    EXPECT_LT(num_skipped_ref, num_points / 2);
+    EXPECT_EQ(num_skipped_ref, num_skipped);
+    EXPECT_NEAR(norm_ref, norm, 1e-10 * fabs(norm_ref));
+    double max_err = 0.0, max_val = 0.0;
+    for (size_t i = 0; i < 2 * num_cells; ++i)
+    {
+        max_err = std::max(max_err, fabs(grid[i] - grid_ref[i]));
+        max_val = std::max(max_val, fabs(grid_ref[i]));
+    }
+    EXPECT_LT(max_err, 1e-12 * max_val);
+
+    /* Check single precision versions. */
+    std::vector<float> kernels_f(kernels.begin(), kernels.end());
+    std::vector<float> uu_f(uu.begin(), uu.end()), vv_f(vv.begin(), vv.end());
+    std::vector<float> ww_f(ww.begin(), ww.end());
+    std::vector<float> vis_f(vis.begin(), vis.end());
+    std::vector<float> weight_f(weight.begin(), weight.end());
+    std::vector<float> grid_f(2 * num_cells, 0.0f);
+    std::vector<float> grid_ref_f(2 * num_cells, 0.0f);
+    norm = norm_ref = 0.0;
+    grid_wproj_ref(num_w_planes, &support[0], oversample, &start[0],
+            &kernels_f[0], num_points, &uu_f[0], &vv_f[0], &ww_f[0],
+            &vis_f[0], &weight_f[0], (float) cell_size_rad, (float) w_scale,
+            grid_size, &num_skipped_ref, &norm_ref, &grid_ref_f[0]);
+    oskar_grid_wproj2_f(num_w_planes, &support[0], oversample, &start[0],
+            &kernels_f[0], num_points, &uu_f[0], &vv_f[0], &ww_f[0],
+            &vis_f[0], &weight_f[0], (float) cell_size_rad, (float) w_scale,
+            grid_size, &num_skipped, &norm, &grid_f[0]);
+    EXPECT_EQ(num_skipped_ref, num_skipped);
+    EXPECT_NEAR(norm_ref, norm, 1e-10 * fabs(norm_ref));
+    max_err = max_val = 0.0;
+    for (size_t i = 0; i < 2 * num_cells; ++i)
+    {
+        max_err = std::max(max_err, (double) fabs(grid_f[i] - grid_ref_f[i]));
+        max_val = std::max(max_val, (double) fabs(grid_ref_f[i]));
+    }
+    EXPECT_LT(max_err, 1e-5 * max_val);
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "imager/oskar_imager.h"
+#include "imager/test/imager_test_utils.h"
+#include "utility/oskar_get_error_string.h"
+
+#include <cstdio>
+
+static oskar_Imager* create_cache_imager(int prec, const char* filename,
+        const char* algorithm, int* status)
+{
+    oskar_Imager* h = create_imager(prec, "I", "Uniform", 64, status);
+    oskar_imager_set_input_files(h, 1, &filename, status);
+    oskar_imager_set_algorithm(h, algorithm, status);
+    return h;
+}
+
+/* Images the file with the coordinate cache disabled, held in memory
+ * (the default size), moved to a file part-way through, and held in a file
+ * from the start, and checks that the images are the same. The imager with
+ * the cache in memory is run twice, to check that the cache is rewritten. */
+static void run_test(int prec, const char* algorithm, double tol)
+{
+    int status = 0;
+    const char* filename = "temp_test_imager_coord_cache.vis";
+    const size_t cache_max_bytes[] = {0, 0, 16384, 1};
+    const int num_runs = sizeof(cache_max_bytes) / sizeof(size_t);
+    oskar_Mem* image[sizeof(cache_max_bytes) / sizeof(size_t) + 1];
+    write_vis(filename, 7, 2, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    for (int i = 0; i < num_runs; ++i)
+    {
+        image[i] = 0;
+        oskar_Imager* h = create_cache_imager(prec, filename, algorithm,
+                &status);
+        if (i == 1)
+            ASSERT_EQ((size_t)2 << 30, oskar_imager_coord_cache_max_bytes(h));
+        else
+            oskar_imager_set_coord_cache_max_bytes(h, cache_max_bytes[i]);
+        oskar_imager_run(h, 1, &image[i], 0, 0, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        if (i == 1)
+        {
+            image[num_runs] = 0;
+            oskar_imager_run(h, 1, &image[num_runs], 0, 0, &status);
+            ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        }
+        oskar_imager_free(h, &status);
+    }
+    for (int i = 1; i <= num_runs; ++i)
+    {
+        EXPECT_LT(max_abs_diff(image[0], image[i], &status), tol) << i;
+        oskar_mem_free(image[i], &status);
+    }
+    oskar_mem_free(image[0], &status);
+    remove(filename);
+}
+
+TEST(imager, coord_cache_fft_single)
+{
+    run_test(OSKAR_SINGLE, "FFT", 1e-5);
+}
+
+TEST(imager, coord_cache_fft_double)
+{
+    run_test(OSKAR_DOUBLE, "FFT", 1e-12);
+}
+
+TEST(imager, coord_cache_wproj_double)
+{
+    run_test(OSKAR_DOUBLE, "W-projection", 1e-12);
+}
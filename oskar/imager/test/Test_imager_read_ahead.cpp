@@ -0,0 +1,111 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "binary/oskar_binary.h"
+#include "imager/oskar_imager.h"
+#include "imager/test/imager_test_utils.h"
+#include "utility/oskar_get_error_string.h"
+#include "vis/oskar_vis_block.h"
+#include "vis/oskar_vis_header.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char* filename = "temp_test_imager_read_ahead.vis";
+
+/* Images the file one block at a time on this thread, using
+ * oskar_imager_update_from_block(). */
+static oskar_Mem* image_serial(int prec, const char* weighting, int* status)
+{
+    oskar_Mem* image = 0;
+    oskar_Imager* h = create_imager(prec, "I", weighting, 64, status);
+    oskar_Binary* file = oskar_binary_create(filename, 'r', status);
+    oskar_VisHeader* hdr = oskar_vis_header_read(file, status);
+    oskar_VisBlock* blk = oskar_vis_block_create_from_header(OSKAR_CPU,
+            hdr, status);
+    const int max_times = oskar_vis_header_max_times_per_block(hdr);
+    const int num_blocks = (oskar_vis_header_num_times_total(hdr) +
+            max_times - 1) / max_times;
+    const int num_passes = !strcmp(weighting, "Uniform") ? 2 : 1;
+    for (int pass = 0; pass < num_passes; ++pass)
+    {
+        oskar_imager_set_coords_only(h, pass < num_passes - 1);
+        for (int i = 0; i < num_blocks; ++i)
+        {
+            oskar_vis_block_read(blk, hdr, file, i, status);
+            oskar_imager_update_from_block(h, hdr, blk, status);
+        }
+    }
+    oskar_imager_finalise(h, 1, &image, 0, 0, status);
+    oskar_vis_block_free(blk, status);
+    oskar_vis_header_free(hdr, status);
+    oskar_binary_free(file);
+    oskar_imager_free(h, status);
+    return image;
+}
+
+/* Images the file using oskar_imager_run(), which reads each block
+ * on another thread while the previous one is gridded. */
+static oskar_Mem* image_run(int prec, const char* weighting, int* status)
+{
+    oskar_Mem* image = 0;
+    oskar_Imager* h = create_imager(prec, "I", weighting, 64, status);
+    oskar_imager_set_input_files(h, 1, &filename, status);
+    oskar_imager_run(h, 1, &image, 0, 0, status);
+    oskar_imager_free(h, status);
+    return image;
+}
+
+static void run_test(int prec, const char* weighting, double tol)
+{
+    int status = 0;
+    ASSERT_GT(write_vis(filename, 10, 3, &status), 2);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    oskar_Mem* image1 = image_serial(prec, weighting, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    oskar_Mem* image2 = image_run(prec, weighting, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    ASSERT_EQ(oskar_mem_length(image1), oskar_mem_length(image2));
+    EXPECT_LT(max_abs_diff(image1, image2, &status), tol);
+    oskar_mem_free(image1, &status);
+    oskar_mem_free(image2, &status);
+    remove(filename);
+}
+
+TEST(imager, read_ahead_natural_single)
+{
+    run_test(OSKAR_SINGLE, "Natural", 1e-5);
+}
+
+TEST(imager, read_ahead_natural_double)
+{
+    run_test(OSKAR_DOUBLE, "Natural", 1e-12);
+}
+
+TEST(imager, read_ahead_uniform_double)
+{
+    run_test(OSKAR_DOUBLE, "Uniform", 1e-12);
+}
+
+TEST(imager, read_ahead_error)
+{
+    int status = 0;
+    ASSERT_GT(write_vis(filename, 10, 3, &status), 2);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Corrupt the last block, which is read on the read-ahead thread. */
+    FILE* f = fopen(filename, "r+b");
+    ASSERT_TRUE(f != NULL);
+    fseek(f, -64, SEEK_END);
+    const int c = fgetc(f);
+    fseek(f, -64, SEEK_END);
+    fputc(c ^ 0xFF, f);
+    fclose(f);
+
+    /* Check the error is returned to the caller. */
+    oskar_Mem* image = image_run(OSKAR_DOUBLE, "Natural", &status);
+    EXPECT_EQ((int) OSKAR_ERR_BINARY_CRC_FAIL, status);
+    oskar_mem_free(image, &status);
+    remove(filename);
+}
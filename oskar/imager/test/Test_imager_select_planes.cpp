@@ -0,0 +1,125 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "imager/oskar_imager.h"
+#include "imager/test/imager_test_utils.h"
+#include "utility/oskar_get_error_string.h"
+#include "vis/oskar_vis_block.h"
+#include "vis/oskar_vis_header.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static const double time_start_mjd = 51544.5, time_inc_sec = 10.0;
+
+/* Setting the image centre to the phase centre leaves the data unchanged,
+ * but makes the imager select the data for each plane in turn using
+ * oskar_imager_select_data(), instead of oskar_imager_select_planes(). */
+static oskar_Imager* create_select_imager(int prec, const char* image_type,
+        const char* weighting, int chan_snaps, int select, int per_plane,
+        int* status)
+{
+    oskar_Imager* h = create_imager(prec, image_type, weighting, 64, status);
+    oskar_imager_set_channel_snapshots(h, chan_snaps);
+    if (select)
+    {
+        oskar_imager_set_freq_min_hz(h, 101e6);
+        oskar_imager_set_freq_max_hz(h, 103e6);
+        oskar_imager_set_time_min_utc(h,
+                time_start_mjd + 1.0 * time_inc_sec / 86400.0);
+        oskar_imager_set_time_max_utc(h,
+                time_start_mjd + 3.0 * time_inc_sec / 86400.0);
+    }
+    if (per_plane) oskar_imager_set_direction(h, 0.0, -30.0);
+    return h;
+}
+
+static void run_test(int prec, const char* image_type, const char* weighting,
+        int chan_snaps, int select, double tol)
+{
+    int status = 0;
+    const int num_times = 4, num_channels = 5, num_stations = 10;
+
+    /* Create a visibility block with random data. */
+    srand(3);
+    oskar_VisHeader* hdr = oskar_vis_header_create(prec | OSKAR_COMPLEX |
+            OSKAR_MATRIX, prec, num_times, num_times, num_channels,
+            num_channels, num_stations, 0, 1, &status);
+    oskar_vis_header_set_freq_start_hz(hdr, 100e6);
+    oskar_vis_header_set_freq_inc_hz(hdr, 1e6);
+    oskar_vis_header_set_time_start_mjd_utc(hdr, time_start_mjd);
+    oskar_vis_header_set_time_inc_sec(hdr, time_inc_sec);
+    oskar_vis_header_set_phase_centre(hdr, 0, 0.0, -30.0);
+    oskar_VisBlock* block = oskar_vis_block_create_from_header(OSKAR_CPU,
+            hdr, &status);
+    fill_random(oskar_vis_block_baseline_uu_metres(block), 500.0, &status);
+    fill_random(oskar_vis_block_baseline_vv_metres(block), 500.0, &status);
+    fill_random(oskar_vis_block_baseline_ww_metres(block), 50.0, &status);
+    fill_random(oskar_vis_block_cross_correlations(block), 1.0, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Make the images both ways. */
+    const int num_passes = !strcmp(weighting, "Uniform") ? 2 : 1;
+    oskar_Imager* h[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        h[i] = create_select_imager(prec, image_type, weighting,
+                chan_snaps, select, i, &status);
+        for (int pass = 0; pass < num_passes; ++pass)
+        {
+            oskar_imager_set_coords_only(h[i], pass < num_passes - 1);
+            oskar_imager_update_from_block(h[i], hdr, block, &status);
+        }
+    }
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    const int num_planes = (chan_snaps ? (select ? 3 : num_channels) : 1) *
+            (strlen(image_type) > 3 ? 4 : 1);
+    ASSERT_EQ(num_planes, oskar_imager_num_image_planes(h[0]));
+    ASSERT_EQ(num_planes, oskar_imager_num_image_planes(h[1]));
+    oskar_Mem *images1[20] = {0}, *images2[20] = {0};
+    oskar_imager_finalise(h[0], num_planes, images1, 0, 0, &status);
+    oskar_imager_finalise(h[1], num_planes, images2, 0, 0, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Check the images are the same. */
+    for (int i = 0; i < num_planes; ++i)
+    {
+        ASSERT_TRUE(images1[i] != 0);
+        ASSERT_TRUE(images2[i] != 0);
+        double max_val = 0.0, max_diff = 0.0;
+        const size_t n = oskar_mem_length(images1[i]);
+        for (size_t j = 0; j < n; ++j)
+        {
+            const double a = oskar_mem_get_element(images1[i], j, &status);
+            const double b = oskar_mem_get_element(images2[i], j, &status);
+            max_val = std::max(max_val, std::fabs(a));
+            max_diff = std::max(max_diff, std::fabs(a - b));
+        }
+        EXPECT_GT(max_val, 0.0) << "Plane " << i << " is empty";
+        EXPECT_LT(max_diff, tol * max_val) << "Plane " << i <<
+                " differs for image type " << image_type;
+        oskar_mem_free(images1[i], &status);
+        oskar_mem_free(images2[i], &status);
+    }
+
+    /* Clean up. */
+    oskar_imager_free(h[0], &status);
+    oskar_imager_free(h[1], &status);
+    oskar_vis_block_free(block, &status);
+    oskar_vis_header_free(hdr, &status);
+}
+
+TEST(imager, select_planes)
+{
+    run_test(OSKAR_DOUBLE, "I", "Natural", 0, 0, 1e-12);
+    run_test(OSKAR_DOUBLE, "I", "Natural", 1, 1, 1e-12);
+    run_test(OSKAR_DOUBLE, "Stokes", "Natural", 1, 0, 1e-12);
+    run_test(OSKAR_DOUBLE, "Linear", "Radial", 1, 1, 1e-12);
+    run_test(OSKAR_DOUBLE, "Stokes", "Uniform", 0, 1, 1e-12);
+    run_test(OSKAR_DOUBLE, "PSF", "Natural", 1, 1, 1e-12);
+    run_test(OSKAR_SINGLE, "Q", "Natural", 0, 1, 1e-5);
+    run_test(OSKAR_SINGLE, "Linear", "Uniform", 1, 0, 1e-5);
+}
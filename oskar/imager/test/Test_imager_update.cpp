@@ -0,0 +1,131 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "imager/oskar_imager.h"
+#include "imager/test/imager_test_utils.h"
+#include "utility/oskar_get_error_string.h"
+#include "vis/oskar_vis_block.h"
+#include "vis/oskar_vis_header.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static oskar_Imager* create_update_imager(int prec, const char* image_type,
+        int chan_snaps, int rotate, int* status)
+{
+    oskar_Imager* h = create_imager(prec, image_type, "Radial", 128, status);
+    oskar_imager_set_channel_snapshots(h, chan_snaps);
+    if (rotate) oskar_imager_set_direction(h, 0.2, -29.8);
+    return h;
+}
+
+/* Images a block using oskar_imager_update_from_block(), and with
+ * oskar_imager_update() after reordering the visibilities by baseline,
+ * and checks that the images are the same. */
+static void run_test(int prec, const char* image_type, int chan_snaps,
+        int rotate)
+{
+    int status = 0;
+    const int num_times = 3, num_channels = 4, num_stations = 10;
+    const int num_baselines = num_stations * (num_stations - 1) / 2;
+    const size_t num_rows = (size_t) num_times * num_baselines;
+    const double time_start_mjd = 51544.5, time_inc_sec = 10.0;
+
+    /* Create a visibility block with random data. */
+    oskar_VisHeader* hdr = oskar_vis_header_create(prec | OSKAR_COMPLEX |
+            OSKAR_MATRIX, prec, num_times, num_times, num_channels,
+            num_channels, num_stations, 0, 1, &status);
+    oskar_vis_header_set_freq_start_hz(hdr, 100e6);
+    oskar_vis_header_set_freq_inc_hz(hdr, 1e6);
+    oskar_vis_header_set_time_start_mjd_utc(hdr, time_start_mjd);
+    oskar_vis_header_set_time_inc_sec(hdr, time_inc_sec);
+    oskar_vis_header_set_phase_centre(hdr, 0, 0.0, -30.0);
+    oskar_VisBlock* block = oskar_vis_block_create_from_header(OSKAR_CPU,
+            hdr, &status);
+    fill_random(oskar_vis_block_baseline_uu_metres(block), 500.0, &status);
+    fill_random(oskar_vis_block_baseline_vv_metres(block), 500.0, &status);
+    fill_random(oskar_vis_block_baseline_ww_metres(block), 50.0, &status);
+    oskar_Mem* vis = oskar_vis_block_cross_correlations(block);
+    fill_random(vis, 1.0, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Reorder the visibilities by baseline, and create the other inputs
+     * needed by oskar_imager_update(). */
+    oskar_Mem* vis_rows = oskar_mem_create(oskar_mem_type(vis), OSKAR_CPU,
+            oskar_mem_length(vis), &status);
+    oskar_Mem* weight = oskar_mem_create(prec, OSKAR_CPU, 4 * num_rows,
+            &status);
+    oskar_Mem* time_centroid = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_rows, &status);
+    oskar_mem_set_value_real(weight, 1.0, 0, 4 * num_rows, &status);
+    const size_t elem_size = oskar_mem_element_size(oskar_mem_type(vis));
+    const char* in = (const char*) oskar_mem_void_const(vis);
+    char* out = (char*) oskar_mem_void(vis_rows);
+    for (int t = 0; t < num_times; ++t)
+    {
+        oskar_mem_set_value_real(time_centroid,
+                (time_start_mjd * 86400.0) + (t + 0.5) * time_inc_sec,
+                t * num_baselines, num_baselines, &status);
+        for (int c = 0; c < num_channels; ++c)
+            for (int b = 0; b < num_baselines; ++b)
+                memcpy(out + elem_size * (num_channels *
+                        (num_baselines * t + b) + c),
+                        in + elem_size * (num_baselines *
+                        (num_channels * t + c) + b), elem_size);
+    }
+
+    /* Make the images both ways. */
+    oskar_Imager* h1 = create_update_imager(prec, image_type, chan_snaps,
+            rotate, &status);
+    oskar_Imager* h2 = create_update_imager(prec, image_type, chan_snaps,
+            rotate, &status);
+    oskar_imager_update_from_block(h1, hdr, block, &status);
+    oskar_imager_set_vis_frequency(h2, 100e6, 1e6, num_channels);
+    oskar_imager_set_vis_phase_centre(h2, 0.0, -30.0);
+    oskar_imager_update(h2, num_rows, 0, num_channels - 1, 4,
+            oskar_vis_block_baseline_uu_metres(block),
+            oskar_vis_block_baseline_vv_metres(block),
+            oskar_vis_block_baseline_ww_metres(block),
+            vis_rows, weight, time_centroid, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    const int num_planes = (chan_snaps ? num_channels : 1) *
+            (strlen(image_type) > 2 ? 4 : 1);
+    oskar_Mem* images1[16] = {0}, *images2[16] = {0};
+    oskar_imager_finalise(h1, num_planes, images1, 0, 0, &status);
+    oskar_imager_finalise(h2, num_planes, images2, 0, 0, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Check the images are the same. */
+    for (int i = 0; i < num_planes; ++i)
+    {
+        ASSERT_TRUE(images1[i] != 0);
+        ASSERT_TRUE(images2[i] != 0);
+        EXPECT_EQ(0, memcmp(oskar_mem_void_const(images1[i]),
+                oskar_mem_void_const(images2[i]),
+                oskar_mem_length(images1[i]) *
+                oskar_mem_element_size(oskar_mem_type(images1[i]))))
+                << "Plane " << i << " differs for image type " << image_type;
+        oskar_mem_free(images1[i], &status);
+        oskar_mem_free(images2[i], &status);
+    }
+
+    /* Clean up. */
+    oskar_imager_free(h1, &status);
+    oskar_imager_free(h2, &status);
+    oskar_mem_free(vis_rows, &status);
+    oskar_mem_free(weight, &status);
+    oskar_mem_free(time_centroid, &status);
+    oskar_vis_block_free(block, &status);
+    oskar_vis_header_free(hdr, &status);
+}
+
+TEST(imager, update_from_block)
+{
+    run_test(OSKAR_DOUBLE, "I", 0, 0);
+    run_test(OSKAR_DOUBLE, "Stokes", 1, 0);
+    run_test(OSKAR_SINGLE, "Linear", 1, 0);
+    run_test(OSKAR_SINGLE, "Q", 0, 0);
+    run_test(OSKAR_DOUBLE, "Stokes", 1, 1);
+}
@@ -0,0 +1,97 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "imager/test/imager_test_utils.h"
+
+#include "binary/oskar_binary.h"
+#include "vis/oskar_vis_block.h"
+#include "vis/oskar_vis_header.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void fill_random(oskar_Mem* data, double scale, int* status)
+{
+    const size_t len = oskar_mem_length(data) *
+            oskar_mem_element_size(oskar_mem_type(data)) /
+            oskar_mem_element_size(oskar_mem_precision(data));
+    if (oskar_mem_precision(data) == OSKAR_DOUBLE)
+    {
+        double* p = oskar_mem_double(data, status);
+        for (size_t i = 0; i < len; ++i)
+            p[i] = scale * (2.0 * rand() / (double)RAND_MAX - 1.0);
+    }
+    else
+    {
+        float* p = oskar_mem_float(data, status);
+        for (size_t i = 0; i < len; ++i)
+            p[i] = (float) (scale * (2.0 * rand() / (double)RAND_MAX - 1.0));
+    }
+}
+
+oskar_Imager* create_imager(int prec, const char* image_type,
+        const char* weighting, int size, int* status)
+{
+    oskar_Imager* h = oskar_imager_create(prec, status);
+    oskar_imager_set_image_type(h, image_type, status);
+    oskar_imager_set_fov(h, 2.0);
+    oskar_imager_set_size(h, size, status);
+    oskar_imager_set_weighting(h, weighting, status);
+    return h;
+}
+
+int write_vis(const char* filename, int num_times, int num_channels,
+        int* status)
+{
+    const int max_times_per_block = 3, num_stations = 12;
+    int i_block = 0;
+    oskar_VisHeader* hdr = oskar_vis_header_create(
+            OSKAR_DOUBLE | OSKAR_COMPLEX | OSKAR_MATRIX, OSKAR_DOUBLE,
+            max_times_per_block, num_times, num_channels, num_channels,
+            num_stations, 0, 1, status);
+    oskar_vis_header_set_freq_start_hz(hdr, 100e6);
+    oskar_vis_header_set_freq_inc_hz(hdr, 1e6);
+    oskar_vis_header_set_time_start_mjd_utc(hdr, 51544.5);
+    oskar_vis_header_set_time_inc_sec(hdr, 10.0);
+    oskar_vis_header_set_phase_centre(hdr, 0, 0.0, -30.0);
+    oskar_Binary* h = oskar_vis_header_write(hdr, filename, status);
+    oskar_VisBlock* blk = oskar_vis_block_create_from_header(OSKAR_CPU,
+            hdr, status);
+    srand(1);
+    for (int t0 = 0; t0 < num_times; t0 += max_times_per_block, ++i_block)
+    {
+        const int nt = std::min(max_times_per_block, num_times - t0);
+        oskar_vis_block_set_num_times(blk, nt, status);
+        oskar_vis_block_set_start_time_index(blk, t0);
+        fill_random(oskar_vis_block_baseline_uu_metres(blk), 500.0, status);
+        fill_random(oskar_vis_block_baseline_vv_metres(blk), 500.0, status);
+        fill_random(oskar_vis_block_baseline_ww_metres(blk), 50.0, status);
+        fill_random(oskar_vis_block_cross_correlations(blk), 1.0, status);
+        oskar_vis_block_write(blk, h, i_block, status);
+    }
+    oskar_vis_block_free(blk, status);
+    oskar_vis_header_free(hdr, status);
+    oskar_binary_free(h);
+    return i_block;
+}
+
+double max_abs_diff(const oskar_Mem* a, const oskar_Mem* b, int* status)
+{
+    double max_diff = 0.0;
+    const size_t n = oskar_mem_length(a);
+    if (oskar_mem_precision(a) == OSKAR_DOUBLE)
+    {
+        const double *p = oskar_mem_double_const(a, status);
+        const double *q = oskar_mem_double_const(b, status);
+        for (size_t i = 0; i < n; ++i)
+            max_diff = std::max(max_diff, std::fabs(p[i] - q[i]));
+    }
+    else
+    {
+        const float *p = oskar_mem_float_const(a, status);
+        const float *q = oskar_mem_float_const(b, status);
+        for (size_t i = 0; i < n; ++i)
+            max_diff = std::max(max_diff, (double) std::fabs(p[i] - q[i]));
+    }
+    return max_diff;
+}
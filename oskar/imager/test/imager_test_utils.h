@@ -0,0 +1,29 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_IMAGER_TEST_UTILS_H_
+#define OSKAR_IMAGER_TEST_UTILS_H_
+
+#include "imager/oskar_imager.h"
+#include "mem/oskar_mem.h"
+
+/* Helper functions shared by the imager tests. */
+
+/* Fills a real or complex array with uniform random values in the range
+ * [-scale, scale]. */
+void fill_random(oskar_Mem* data, double scale, int* status);
+
+/* Creates an imager with a 2 degree field of view, and the given image type,
+ * weighting and image size. */
+oskar_Imager* create_imager(int prec, const char* image_type,
+        const char* weighting, int size, int* status);
+
+/* Writes a double-precision visibility file for 12 stations, with up to
+ * 3 times of random data in each block, and returns the number of blocks
+ * written. */
+int write_vis(const char* filename, int num_times, int num_channels,
+        int* status);
+
+/* Returns the largest absolute difference between two real arrays. */
+double max_abs_diff(const oskar_Mem* a, const oskar_Mem* b, int* status);
+
+#endif /* OSKAR_IMAGER_TEST_UTILS_H_ */
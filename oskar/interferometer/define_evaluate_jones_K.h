@@ -55,8 +55,9 @@ OSKAR_REGISTER_KERNEL(NAME)
 #define OSKAR_JONES_K_CPU(NAME, FP, FP2) KERNEL(NAME) (\
         OSKAR_JONES_K_ARGS(FP, FP2))\
 {\
-    KERNEL_LOOP_Y(int, a, 0, num_stations)\
-    KERNEL_LOOP_X(int, s, 0, num_sources)\
+    KERNEL_LOOP_PAR_X(int, a, 0, num_stations)\
+    int s;\
+    for (s = 0; s < num_sources; ++s) {\
     FP2 weight; weight.x = weight.y = (FP) 0;\
     if (source_filter[s] > source_filter_min &&\
                 source_filter[s] <= source_filter_max) {\
@@ -67,7 +68,7 @@ OSKAR_REGISTER_KERNEL(NAME)
         weight.x = re; weight.y = im;\
     }\
     jones[s + num_sources * a] = weight;\
-    KERNEL_LOOP_END\
+    }\
     KERNEL_LOOP_END\
 }\
 OSKAR_REGISTER_KERNEL(NAME)
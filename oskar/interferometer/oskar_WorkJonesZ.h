@@ -43,34 +43,36 @@
  * Jones matrices (Z Jones).
  *
  * @details
+ * All buffers are held in host memory, and all except the Jones matrices
+ * are in double precision. The TEC values are cached here
+ * between the evaluation of the pierce points (once per time step) and
+ * the evaluation of the Jones matrices (once per frequency channel).
  */
 struct oskar_WorkJonesZ
 {
-    oskar_Mem* hor_x;        /* Pierce point horizontal x coordinate */
-    oskar_Mem* hor_y;        /* Pierce point horizontal y coordinate */
-    oskar_Mem* hor_z;        /* Pierce point horizontal z coordinate */
-
-    oskar_Mem* pp_lon;       /* Pierce point longitude, in radians */
-    oskar_Mem* pp_lat;       /* Pierce point latitude, in radians */
-    oskar_Mem* pp_rel_path;  /* Pierce point relative path length.
-                                (the extra path, relative to the vertical for
-                                the ionospheric column defined by the pierce
-                                point) */
-
-    oskar_Mem* screen_TEC;    /* TEC screen values for each pierce point */
-    oskar_Mem* total_TEC;     /* Total TEC values for each pierce point */
+    int num_stations;        /* Number of stations in the TEC cache. */
+    int num_sources;         /* Number of sources in the TEC cache. */
+
+    oskar_Mem* l;            /* Host copy of source l-direction cosines. */
+    oskar_Mem* m;            /* Host copy of source m-direction cosines. */
+    oskar_Mem* n;            /* Host copy of source n-direction cosines. */
+    oskar_Mem* station_x;    /* Host copy of station ECEF x offsets. */
+    oskar_Mem* station_y;    /* Host copy of station ECEF y offsets. */
+    oskar_Mem* station_z;    /* Host copy of station ECEF z offsets. */
+
+    oskar_Mem* total_TEC;    /* Total TEC value for each station and source
+                                (zero below the minimum elevation). */
+    oskar_Mem* Z;            /* Host copy of Jones matrices, if needed. */
 };
 
 typedef struct oskar_WorkJonesZ oskar_WorkJonesZ;
 
-
-/* Utility functions -- TODO move to their own source files? */
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 OSKAR_EXPORT
-oskar_WorkJonesZ* oskar_work_jones_z_create(int type, int location, int* status);
+oskar_WorkJonesZ* oskar_work_jones_z_create(int type, int* status);
 
 OSKAR_EXPORT
 void oskar_work_jones_z_resize(oskar_WorkJonesZ* work, int n, int* status);
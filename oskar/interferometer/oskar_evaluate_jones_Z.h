@@ -44,12 +44,80 @@
 extern "C" {
 #endif
 
+/**
+ * @brief
+ * Evaluates the ionospheric phase (Z) Jones term.
+ *
+ * @details
+ * This function evaluates the scalar ionospheric phase screen for each
+ * station and source at the given time and frequency, by calling
+ * oskar_evaluate_jones_Z_tec() followed by
+ * oskar_evaluate_jones_Z_from_tec().
+ *
+ * If Jones matrices are needed at several frequencies for the same time,
+ * call those two functions separately instead, so that the pierce points
+ * and TEC values are evaluated only once.
+ *
+ * @param[out] Z             Output set of Jones matrices.
+ * @param[in]  sky           Sky model (relative direction cosines are used).
+ * @param[in]  telescope     Telescope model.
+ * @param[in]  settings      Ionosphere settings.
+ * @param[in]  gast          Greenwich apparent sidereal time, in radians.
+ * @param[in]  frequency_hz  Observing frequency, in Hz.
+ * @param[in]  work          Work buffers.
+ * @param[in,out] status     Status return code.
+ */
 OSKAR_EXPORT
 void oskar_evaluate_jones_Z(oskar_Jones* Z, const oskar_Sky* sky,
         const oskar_Telescope* telescope,
         const oskar_SettingsIonosphere* settings, double gast,
         double frequency_hz, oskar_WorkJonesZ* work, int* status);
 
+/**
+ * @brief
+ * Evaluates the total electron content for each station and source.
+ *
+ * @details
+ * Pierce points through every TID screen are evaluated for all station
+ * and source pairs in parallel, and the TEC contributions of all screens
+ * are summed and stored in the work buffer, ready for use by
+ * oskar_evaluate_jones_Z_from_tec().
+ *
+ * The TEC is set to zero for sources below the minimum elevation
+ * given in the settings, so that no phase is applied to them.
+ *
+ * Data may be in any location, but the evaluation is done on the host.
+ *
+ * @param[in]  sky           Sky model (relative direction cosines are used).
+ * @param[in]  telescope     Telescope model.
+ * @param[in]  settings      Ionosphere settings.
+ * @param[in]  gast          Greenwich apparent sidereal time, in radians.
+ * @param[in]  work          Work buffers, to hold the TEC values.
+ * @param[in,out] status     Status return code.
+ */
+OSKAR_EXPORT
+void oskar_evaluate_jones_Z_tec(const oskar_Sky* sky,
+        const oskar_Telescope* telescope,
+        const oskar_SettingsIonosphere* settings, double gast,
+        oskar_WorkJonesZ* work, int* status);
+
+/**
+ * @brief
+ * Evaluates the ionospheric phase (Z) Jones term from cached TEC values.
+ *
+ * @details
+ * Converts the TEC values previously evaluated by
+ * oskar_evaluate_jones_Z_tec() to a phase at the given frequency.
+ *
+ * @param[out] Z             Output set of Jones matrices.
+ * @param[in]  frequency_hz  Observing frequency, in Hz.
+ * @param[in]  work          Work buffers holding the TEC values.
+ * @param[in,out] status     Status return code.
+ */
+OSKAR_EXPORT
+void oskar_evaluate_jones_Z_from_tec(oskar_Jones* Z, double frequency_hz,
+        oskar_WorkJonesZ* work, int* status);
+
 #ifdef __cplusplus
 }
 #endif
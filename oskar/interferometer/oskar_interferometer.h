@@ -68,6 +68,10 @@ void oskar_interferometer_finalise(oskar_Interferometer* h, int* status);
 OSKAR_EXPORT
 void oskar_interferometer_free(oskar_Interferometer* h, int* status);
 
+OSKAR_EXPORT
+int oskar_interferometer_num_cpu_threads_per_device(
+        const oskar_Interferometer* h);
+
 OSKAR_EXPORT
 int oskar_interferometer_num_devices(const oskar_Interferometer* h);
 
@@ -109,6 +113,51 @@ void oskar_interferometer_set_gpus(oskar_Interferometer* h, int num_gpus,
 OSKAR_EXPORT
 void oskar_interferometer_set_horizon_clip(oskar_Interferometer* h, int value);
 
+/**
+ * @brief Sets the ionosphere model used to evaluate Jones Z.
+ *
+ * @details
+ * Enables or disables the ionospheric phase screen, and removes any
+ * TID screens added previously. If enabled, screens should then be added
+ * using oskar_interferometer_add_ionosphere_screen().
+ *
+ * Note that the ionosphere is not yet set from the simulator settings
+ * file by oskar_settings_to_interferometer(), so this function must be
+ * called directly to enable Jones Z.
+ *
+ * @param[in] h                  Handle to interferometer simulator.
+ * @param[in] enable             If set, evaluate Jones Z.
+ * @param[in] tec0               Zero offset TEC value.
+ * @param[in] min_elevation_rad  Minimum elevation at which to apply phase.
+ * @param[in,out] status         Status return code.
+ */
+OSKAR_EXPORT
+void oskar_interferometer_set_ionosphere(oskar_Interferometer* h,
+        int enable, double tec0, double min_elevation_rad, int* status);
+
+/**
+ * @brief Adds a travelling ionospheric disturbance (TID) screen.
+ *
+ * @details
+ * Adds a TID screen to the ionosphere model. The component arrays are
+ * copied. The ionosphere must have been enabled first using
+ * oskar_interferometer_set_ionosphere().
+ *
+ * @param[in] h               Handle to interferometer simulator.
+ * @param[in] height_km       Height of the screen, in km.
+ * @param[in] num_components  Number of TID components in the screen.
+ * @param[in] amp             Component amplitudes, relative to TEC0.
+ * @param[in] wavelength_km   Component wavelengths, in km.
+ * @param[in] speed_km_h      Component speeds, in km/h.
+ * @param[in] theta_deg       Component directions, in degrees.
+ * @param[in,out] status      Status return code.
+ */
+OSKAR_EXPORT
+void oskar_interferometer_add_ionosphere_screen(oskar_Interferometer* h,
+        double height_km, int num_components, const double* amp,
+        const double* wavelength_km, const double* speed_km_h,
+        const double* theta_deg, int* status);
+
 OSKAR_EXPORT
 void oskar_interferometer_set_max_sources_per_chunk(oskar_Interferometer* h,
 int value);
@@ -117,6 +166,28 @@ OSKAR_EXPORT
 void oskar_interferometer_set_max_times_per_block(oskar_Interferometer* h,
         int value);
 
+/**
+ * @brief Sets the number of CPU threads used by each CPU compute device.
+ *
+ * @details
+ * When more than one thread is used per CPU device, the Jones matrix
+ * evaluation and correlation within each work unit are shared between the
+ * threads, so fewer devices (and fewer visibility blocks) are needed to
+ * keep all cores busy.
+ *
+ * If \p value is less than 1, and no GPUs are in use, all available cores
+ * will be used by a single CPU device.
+ *
+ * This should be called before oskar_interferometer_set_num_devices(),
+ * as the automatic device count depends on it.
+ *
+ * @param[in,out] h     Handle to interferometer simulator.
+ * @param[in]     value Number of threads per CPU device.
+ */
+OSKAR_EXPORT
+void oskar_interferometer_set_num_cpu_threads_per_device(
+        oskar_Interferometer* h, int value);
+
 OSKAR_EXPORT
 void oskar_interferometer_set_num_devices(oskar_Interferometer* h, int value);
 
@@ -29,11 +29,13 @@
 #include "interferometer/oskar_WorkJonesZ.h"
 #include "mem/oskar_mem.h"
 
+#include <stdlib.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-oskar_WorkJonesZ* oskar_work_jones_z_create(int type, int location, int* status)
+oskar_WorkJonesZ* oskar_work_jones_z_create(int type, int* status)
 {
     oskar_WorkJonesZ* work = 0;
 
@@ -41,16 +43,16 @@ oskar_WorkJonesZ* oskar_work_jones_z_create(int type, int location, int* status)
     if (!(type == OSKAR_SINGLE || type == OSKAR_DOUBLE))
         *status = OSKAR_ERR_BAD_DATA_TYPE;
 
-    work = (oskar_WorkJonesZ*) malloc(sizeof(oskar_WorkJonesZ));
+    work = (oskar_WorkJonesZ*) calloc(1, sizeof(oskar_WorkJonesZ));
 
-    work->hor_x = oskar_mem_create(type, location, 0, status);
-    work->hor_y = oskar_mem_create(type, location, 0, status);
-    work->hor_z = oskar_mem_create(type, location, 0, status);
-    work->pp_lon = oskar_mem_create(type, location, 0, status);
-    work->pp_lat = oskar_mem_create(type, location, 0, status);
-    work->pp_rel_path = oskar_mem_create(type, location, 0, status);
-    work->screen_TEC = oskar_mem_create(type, location, 0, status);
-    work->total_TEC = oskar_mem_create(type, location, 0, status);
+    work->l = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->m = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->n = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->station_x = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->station_y = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->station_z = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->total_TEC = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, status);
+    work->Z = oskar_mem_create(type | OSKAR_COMPLEX, OSKAR_CPU, 0, status);
 
     return work;
 }
@@ -58,27 +60,21 @@ oskar_WorkJonesZ* oskar_work_jones_z_create(int type, int location, int* status)
 
 void oskar_work_jones_z_free(oskar_WorkJonesZ* work, int* status)
 {
-    oskar_mem_free(work->hor_x, status);
-    oskar_mem_free(work->hor_y, status);
-    oskar_mem_free(work->hor_z, status);
-    oskar_mem_free(work->pp_lon, status);
-    oskar_mem_free(work->pp_lat, status);
-    oskar_mem_free(work->pp_rel_path, status);
-    oskar_mem_free(work->screen_TEC, status);
+    if (!work) return;
+    oskar_mem_free(work->l, status);
+    oskar_mem_free(work->m, status);
+    oskar_mem_free(work->n, status);
+    oskar_mem_free(work->station_x, status);
+    oskar_mem_free(work->station_y, status);
+    oskar_mem_free(work->station_z, status);
     oskar_mem_free(work->total_TEC, status);
+    oskar_mem_free(work->Z, status);
     free(work);
 }
 
 void oskar_work_jones_z_resize(oskar_WorkJonesZ* work, int n, int* status)
 {
-    oskar_mem_realloc(work->hor_x, n, status);
-    oskar_mem_realloc(work->hor_y, n, status);
-    oskar_mem_realloc(work->hor_z, n, status);
-    oskar_mem_realloc(work->pp_lon, n, status);
-    oskar_mem_realloc(work->pp_lat, n, status);
-    oskar_mem_realloc(work->pp_rel_path, n, status);
-    oskar_mem_realloc(work->screen_TEC, n, status);
-    oskar_mem_realloc(work->total_TEC, n, status);
+    oskar_mem_ensure(work->total_TEC, (size_t) n, status);
 }
 
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2015, The University of Oxford
+ * Copyright (c) 2013-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -28,247 +28,398 @@
 
 #include "interferometer/oskar_evaluate_jones_Z.h"
 
-#include "convert/oskar_convert_relative_directions_to_enu_directions.h"
-#include "convert/oskar_convert_offset_ecef_to_ecef.h"
-#include "telescope/station/oskar_evaluate_pierce_points.h"
-#include "sky/oskar_evaluate_tec_tid.h"
+#include "convert/oskar_convert_geodetic_spherical_to_ecef.h"
+#include "convert/private_convert_ecef_to_geodetic_spherical_inline.h"
+#include "math/oskar_cmath.h"
 
-#include <math.h>
-#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-static void oskar_evaluate_TEC(oskar_WorkJonesZ* work, int num_pp,
-        const oskar_SettingsIonosphere* settings,
-        double gast, int* status);
-
-static void evaluate_station_ECEF_coords(
-        double* station_x, double* station_y, double* station_z,
-        int stationID, const oskar_Telescope* telescope);
-
-static void evaluate_jones_Z_station(double wavelength,
-        const oskar_Mem* TEC, const oskar_Mem* hor_z,
-        double min_elevation, int num_pp,
-        int offset_out, oskar_Mem* out, int* status);
+/* Geometry of one station, evaluated once per call. */
+struct StationGeometry
+{
+    double x, y, z;          /* Station ECEF coordinates, in metres. */
+    double sin_lon, cos_lon; /* Geocentric longitude of the station. */
+    double sin_lat, cos_lat; /* Geocentric latitude of the station. */
+    double norm_xyz;         /* Distance from the centre of the Earth. */
+    double radius;           /* Earth radius at the station position. */
+    double sin_ha0, cos_ha0; /* Hour angle of the sky reference direction. */
+    double sin_lat0, cos_lat0; /* Latitude of the station model. */
+};
+typedef struct StationGeometry StationGeometry;
+
+/* One TID component, with its time-dependent phase for this call. */
+struct TIDComponent
+{
+    double amp;              /* Amplitude, multiplied by TEC0. */
+    double k_lon, k_lat;     /* Wavenumbers along longitude and latitude. */
+    double phase;            /* Phase due to motion of the TID. */
+};
+typedef struct TIDComponent TIDComponent;
+
+/* One TID screen, and the range of its components. */
+struct TIDScreen
+{
+    double height_m;
+    int start, num_components;
+};
+typedef struct TIDScreen TIDScreen;
+
+static const double* host_copy_double(oskar_Mem* dst, const oskar_Mem* src,
+        int num, int* status);
+static void set_up_stations(const oskar_Telescope* telescope, double gast,
+        double ra0, const double* offset_x, const double* offset_y,
+        const double* offset_z, StationGeometry* st);
+static void set_up_screens(const oskar_SettingsIonosphere* settings,
+        double gast, TIDScreen* screens, TIDComponent* components);
+static double evaluate_tec(const StationGeometry* st,
+        const double l, const double m, const double n,
+        const double sin_dec0, const double cos_dec0,
+        const double sin_min_el, const double TEC0, const int num_screens,
+        const TIDScreen* screens, const TIDComponent* components);
+static void jones_Z_f(int num, const double* tec, double factor, float2* Z);
+static void jones_Z_d(int num, const double* tec, double factor, double2* Z);
 
 void oskar_evaluate_jones_Z(oskar_Jones* Z, const oskar_Sky* sky,
         const oskar_Telescope* telescope,
         const oskar_SettingsIonosphere* settings, double gast,
         double frequency_hz, oskar_WorkJonesZ* work, int* status)
 {
-    int i, num_sources, num_stations;
-    /* Station position in ECEF frame */
-    double station_x, station_y, station_z, wavelength;
-    oskar_Sky* sky_cpu; /* Copy of the sky model on the CPU */
+    oskar_evaluate_jones_Z_tec(sky, telescope, settings, gast, work, status);
+    oskar_evaluate_jones_Z_from_tec(Z, frequency_hz, work, status);
+}
+
+
+void oskar_evaluate_jones_Z_tec(const oskar_Sky* sky,
+        const oskar_Telescope* telescope,
+        const oskar_SettingsIonosphere* settings, double gast,
+        oskar_WorkJonesZ* work, int* status)
+{
+    int i, j, num_components = 0, num_pairs;
+    const double *l, *m, *n, *x, *y, *z;
+    double sin_dec0, cos_dec0, sin_min_el, TEC0;
+    double* tec;
+    StationGeometry* st;
+    TIDScreen* screens;
+    TIDComponent* components;
 
     /* Check if safe to proceed. */
     if (*status) return;
 
     /* Check data types. */
-    const int type = oskar_sky_precision(sky);
-    if (oskar_telescope_precision(telescope) != type ||
-            oskar_jones_type(Z) != (type | OSKAR_COMPLEX))
+    if (oskar_telescope_precision(telescope) != oskar_sky_precision(sky))
     {
-        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        *status = OSKAR_ERR_TYPE_MISMATCH;
         return;
     }
-
-    /* For now, this function requires data is on the CPU .. check this. */
-
-    /* Resize the work array (if needed) */
-    num_stations = oskar_telescope_num_stations(telescope);
-    num_sources = oskar_sky_num_sources(sky);
-    oskar_work_jones_z_resize(work, num_sources, status);
-
-    /* Copy the sky model to the CPU. */
-    sky_cpu = oskar_sky_create_copy(sky, OSKAR_CPU, status);
-
-    wavelength = 299792458.0 / frequency_hz;
-
-    /* Evaluate the ionospheric phase screen for each station at each
-     * source pierce point. */
-    for (i = 0; i < num_stations; ++i)
+    const int num_stations = oskar_telescope_num_stations(telescope);
+    const int num_sources = oskar_sky_num_sources(sky);
+    const int num_screens = settings->num_TID_screens;
+    num_pairs = num_stations * num_sources;
+    work->num_stations = num_stations;
+    work->num_sources = num_sources;
+    oskar_work_jones_z_resize(work, num_pairs, status);
+
+    /* Get host copies of the input coordinates, in double precision. */
+    l = host_copy_double(work->l, oskar_sky_l_const(sky), num_sources, status);
+    m = host_copy_double(work->m, oskar_sky_m_const(sky), num_sources, status);
+    n = host_copy_double(work->n, oskar_sky_n_const(sky), num_sources, status);
+    x = host_copy_double(work->station_x,
+            oskar_telescope_station_true_x_offset_ecef_metres_const(telescope),
+            num_stations, status);
+    y = host_copy_double(work->station_y,
+            oskar_telescope_station_true_y_offset_ecef_metres_const(telescope),
+            num_stations, status);
+    z = host_copy_double(work->station_z,
+            oskar_telescope_station_true_z_offset_ecef_metres_const(telescope),
+            num_stations, status);
+    tec = oskar_mem_double(work->total_TEC, status);
+    if (*status || num_pairs == 0) return;
+
+    /* Evaluate everything that does not depend on the source direction. */
+    for (i = 0; i < num_screens; ++i)
+        num_components += settings->TID[i].num_components;
+    st = (StationGeometry*) calloc(num_stations, sizeof(StationGeometry));
+    screens = (TIDScreen*) calloc(num_screens + 1, sizeof(TIDScreen));
+    components = (TIDComponent*) calloc(num_components + 1,
+            sizeof(TIDComponent));
+    if (!st || !screens || !components)
     {
-        double last, lon, lat;
-        const oskar_Station* station;
-        station = oskar_telescope_station_const(telescope, i);
-        lon = oskar_station_lon_rad(station);
-        lat = oskar_station_lat_rad(station);
-        last = gast + lon;
-
-        /* Evaluate horizontal x,y,z source positions (for which to evaluate
-         * pierce points) */
-        oskar_convert_relative_directions_to_enu_directions(0, 0, 0, num_sources,
-                oskar_sky_l_const(sky_cpu), oskar_sky_m_const(sky_cpu),
-                oskar_sky_n_const(sky_cpu), last - oskar_sky_reference_ra_rad(sky_cpu),
-                oskar_sky_reference_dec_rad(sky_cpu), lat,
-                0, work->hor_x, work->hor_y, work->hor_z, status);
-
-        /* Obtain station coordinates in the ECEF frame. */
-        evaluate_station_ECEF_coords(&station_x, &station_y, &station_z, i,
-                telescope);
-
-        /* Obtain the pierce points. */
-        /* FIXME(BM) this is current hard-coded to TID height screen 0
-         * this fix is only needed to support multiple screen heights. */
-        oskar_evaluate_pierce_points(work->pp_lon, work->pp_lat,
-                work->pp_rel_path, station_x, station_y,
-                station_z, settings->TID[0].height_km * 1000., num_sources,
-                work->hor_x, work->hor_y, work->hor_z, status);
-
-        /* Evaluate TEC values for the pierce points */
-        oskar_evaluate_TEC(work, num_sources, settings, gast, status);
-
-        /* Populate the Jones matrix with ionospheric phase */
-        const int offset_out = i * oskar_jones_num_sources(Z);
-        evaluate_jones_Z_station(wavelength,
-                work->total_TEC, work->hor_z, settings->min_elevation,
-                num_sources, offset_out, oskar_jones_mem(Z), status);
+        free(st);
+        free(screens);
+        free(components);
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
     }
-
-    oskar_sky_free(sky_cpu, status);
+    set_up_stations(telescope, gast, oskar_sky_reference_ra_rad(sky),
+            x, y, z, st);
+    set_up_screens(settings, gast, screens, components);
+    sin_dec0 = sin(oskar_sky_reference_dec_rad(sky));
+    cos_dec0 = cos(oskar_sky_reference_dec_rad(sky));
+    sin_min_el = sin(settings->min_elevation);
+    TEC0 = settings->TEC0;
+
+    /* Evaluate the TEC for all station and source pairs together. */
+#pragma omp parallel for private(i, j)
+    for (i = 0; i < num_pairs; ++i)
+    {
+        j = i % num_sources;
+        tec[i] = evaluate_tec(&st[i / num_sources], l[j], m[j], n[j],
+                sin_dec0, cos_dec0, sin_min_el, TEC0, num_screens,
+                screens, components);
+    }
+    free(st);
+    free(screens);
+    free(components);
 }
 
 
-/* Evaluate the TEC value for each pierce point - note: at the moment this is
- * just the accumulation of one or more TID screens.
- * TODO convert this to a stand-alone function.
- */
-static void oskar_evaluate_TEC(oskar_WorkJonesZ* work, int num_pp,
-        const oskar_SettingsIonosphere* settings,
-        double gast, int* status)
+void oskar_evaluate_jones_Z_from_tec(oskar_Jones* Z, double frequency_hz,
+        oskar_WorkJonesZ* work, int* status)
 {
-    int i;
-
-    /* FIXME(BM) For now limit number of screens to 1, this can be removed
-     * if a TEC model which is valid for multiple screens is implemented
-     */
-    if (settings->num_TID_screens > 1)
-        *status = OSKAR_ERR_INVALID_ARGUMENT;
+    oskar_Mem* out;
 
-    oskar_mem_clear_contents(work->total_TEC, status);
+    /* Check if safe to proceed. */
+    if (*status) return;
 
-    /* Loop over TID screens to evaluate TEC values */
-    for (i = 0; i < settings->num_TID_screens; ++i)
+    /* Check dimensions and data types. */
+    const int num_pairs = work->num_stations * work->num_sources;
+    if (oskar_jones_num_stations(Z) != work->num_stations ||
+            oskar_jones_num_sources(Z) != work->num_sources)
     {
-        oskar_mem_clear_contents(work->screen_TEC, status);
-
-        /* Evaluate TEC values for the screen */
-        oskar_evaluate_tec_tid(work->screen_TEC, num_pp, work->pp_lon,
-                work->pp_lat, work->pp_rel_path, settings->TEC0,
-                &settings->TID[i], gast);
-
-        /* Accumulate into total TEC */
-        /* FIXME(BM) addition is not physical for more than one TEC screen in
-         * the way TIDs are currently evaluated as TEC0 is added into both
-         * screens.
-         */
-        oskar_mem_add(work->total_TEC, work->total_TEC, work->screen_TEC,
-                0, 0, 0, oskar_mem_length(work->total_TEC), status);
+        *status = OSKAR_ERR_DIMENSION_MISMATCH;
+        return;
     }
+    if (oskar_jones_type(Z) != oskar_mem_type(work->Z))
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return;
+    }
+
+    /* Evaluate directly into the output, or into a host buffer first. */
+    const int on_host = (oskar_mem_location(oskar_jones_mem(Z)) == OSKAR_CPU);
+    out = on_host ? oskar_jones_mem(Z) : work->Z;
+    if (!on_host) oskar_mem_ensure(out, num_pairs, status);
+    if (*status) return;
+
+    /* Z phase == exp(i * lambda * 25 * tec) */
+    const double factor = 25.0 * 299792458.0 / frequency_hz;
+    const double* tec = oskar_mem_double_const(work->total_TEC, status);
+    if (oskar_mem_precision(out) == OSKAR_DOUBLE)
+        jones_Z_d(num_pairs, tec, factor, oskar_mem_double2(out, status));
+    else
+        jones_Z_f(num_pairs, tec, factor, oskar_mem_float2(out, status));
+    if (!on_host)
+        oskar_mem_copy_contents(oskar_jones_mem(Z), out, 0, 0, num_pairs,
+                status);
 }
 
 
-static void evaluate_station_ECEF_coords(
-        double* station_x, double* station_y, double* station_z,
-        int stationID, const oskar_Telescope* telescope)
+static const double* host_copy_double(oskar_Mem* dst, const oskar_Mem* src,
+        int num, int* status)
 {
-    double st_x, st_y, st_z;
-    double lon, lat, alt;
-    const oskar_Station* station;
-    const void *x_, *y_, *z_;
-
-    x_ = oskar_mem_void_const(
-            oskar_telescope_station_true_x_offset_ecef_metres_const(telescope));
-    y_ = oskar_mem_void_const(
-            oskar_telescope_station_true_y_offset_ecef_metres_const(telescope));
-    z_ = oskar_mem_void_const(
-            oskar_telescope_station_true_z_offset_ecef_metres_const(telescope));
-    station = oskar_telescope_station_const(telescope, stationID);
-    lon = oskar_station_lon_rad(station);
-    lat = oskar_station_lat_rad(station);
-    alt = oskar_station_alt_metres(station);
-
-    if (oskar_mem_type(
-            oskar_telescope_station_true_x_offset_ecef_metres_const(telescope)) ==
-            OSKAR_DOUBLE)
+    int i;
+    oskar_Mem* temp = 0;
+    if (*status) return 0;
+    if (oskar_mem_location(src) == OSKAR_CPU &&
+            oskar_mem_type(src) == OSKAR_DOUBLE)
+        return oskar_mem_double_const(src, status);
+    if (oskar_mem_location(src) != OSKAR_CPU)
     {
-        st_x = ((const double*)x_)[stationID];
-        st_y = ((const double*)y_)[stationID];
-        st_z = ((const double*)z_)[stationID];
+        temp = oskar_mem_create_copy(src, OSKAR_CPU, status);
+        src = temp;
     }
-    else
+    oskar_mem_ensure(dst, num, status);
+    if (!*status)
     {
-        st_x = (double)((const float*)x_)[stationID];
-        st_y = (double)((const float*)y_)[stationID];
-        st_z = (double)((const float*)z_)[stationID];
+        double* out = oskar_mem_double(dst, status);
+        if (oskar_mem_type(src) == OSKAR_DOUBLE)
+            memcpy(out, oskar_mem_void_const(src), num * sizeof(double));
+        else
+        {
+            const float* in = oskar_mem_float_const(src, status);
+            for (i = 0; i < num; ++i) out[i] = (double) in[i];
+        }
     }
-
-    oskar_convert_offset_ecef_to_ecef(1, &st_x, &st_y, &st_z, lon, lat, alt,
-            station_x, station_y, station_z);
+    oskar_mem_free(temp, status);
+    return oskar_mem_double_const(dst, status);
 }
 
-static void evaluate_jones_Z_station(double wavelength,
-        const oskar_Mem* TEC, const oskar_Mem* hor_z,
-        double min_elevation, int num_pp,
-        int offset_out, oskar_Mem* out, int* status)
+
+static void set_up_stations(const oskar_Telescope* telescope, double gast,
+        double ra0, const double* offset_x, const double* offset_y,
+        const double* offset_z, StationGeometry* st)
 {
-    int i, type;
-    double arg;
+    int i;
+    double lon, lat, alt, x_ref = 0.0, y_ref = 0.0, z_ref = 0.0;
+    const int num_stations = oskar_telescope_num_stations(telescope);
+
+    /* Station offsets are relative to the telescope reference position. */
+    lon = oskar_telescope_lon_rad(telescope);
+    lat = oskar_telescope_lat_rad(telescope);
+    alt = oskar_telescope_alt_metres(telescope);
+    oskar_convert_geodetic_spherical_to_ecef(1, &lon, &lat, &alt,
+            &x_ref, &y_ref, &z_ref);
+    for (i = 0; i < num_stations; ++i)
+    {
+        double ha0;
+        const oskar_Station* station =
+                oskar_telescope_station_const(telescope, i);
+        StationGeometry* s = &st[i];
+        s->x = offset_x[i] + x_ref;
+        s->y = offset_y[i] + y_ref;
+        s->z = offset_z[i] + z_ref;
+        oskar_convert_ecef_to_geodetic_spherical_inline_d(s->x, s->y, s->z,
+                &lon, &lat, &alt);
+        s->sin_lon = sin(lon);
+        s->cos_lon = cos(lon);
+        s->sin_lat = sin(lat);
+        s->cos_lat = cos(lat);
+        s->norm_xyz = sqrt(s->x * s->x + s->y * s->y + s->z * s->z);
+        s->radius = s->norm_xyz - alt;
+        ha0 = gast + oskar_station_lon_rad(station) - ra0;
+        s->sin_ha0 = sin(ha0);
+        s->cos_ha0 = cos(ha0);
+        s->sin_lat0 = sin(oskar_station_lat_rad(station));
+        s->cos_lat0 = cos(oskar_station_lat_rad(station));
+    }
+}
 
-    /* Check if safe to proceed. */
-    if (*status) return;
 
-    type = oskar_mem_type(out);
-    if (type == OSKAR_DOUBLE_COMPLEX)
+static void set_up_screens(const oskar_SettingsIonosphere* settings,
+        double gast, TIDScreen* screens, TIDComponent* components)
+{
+    int i, j, c = 0;
+    const double earth_radius_km = 6365.0;
+    const double time_sec = gast * 86400.0;
+    for (i = 0; i < settings->num_TID_screens; ++i)
     {
-        double2* Z_ = oskar_mem_double2(out, status) + offset_out;
-        for (i = 0; i < num_pp; ++i)
+        const oskar_SettingsTIDscreen* tid = &settings->TID[i];
+        const double radius_km = earth_radius_km + tid->height_km;
+        screens[i].height_m = tid->height_km * 1000.0;
+        screens[i].start = c;
+        screens[i].num_components = tid->num_components;
+        for (j = 0; j < tid->num_components; ++j, ++c)
         {
-            /* Initialise as an unit scalar Z = (1 + 0i) i.e. no phase change */
-            Z_[i].x = 1.0;
-            Z_[i].y = 0.0;
-
-            /* If the pierce point is below the minimum specified elevation
-             * don't evaluate a phase */
-            if (asin((oskar_mem_double_const(hor_z, status))[i]) <
-                    min_elevation)
-                continue;
-
-            arg = wavelength * 25. * oskar_mem_double_const(TEC, status)[i];
-
-            /* Z phase == exp(i * lambda * 25 * tec) */
-            Z_[i].x = cos(arg);
-            Z_[i].y = sin(arg);
+            /* Convert wavelength from km to radians,
+             * and speed from km/h to radians/s. */
+            const double k = 2.0 * M_PI / (tid->wavelength[j] / radius_km);
+            const double v = tid->speed[j] / radius_km / 3600.0;
+            const double th = tid->theta[j] * M_PI / 180.0;
+            components[c].amp = tid->amp[j] * settings->TEC0;
+            components[c].k_lon = k * cos(th);
+            components[c].k_lat = k * sin(th);
+            components[c].phase = k * v * time_sec;
         }
     }
-    else if (type == OSKAR_SINGLE_COMPLEX)
+}
+
+
+/* Returns the TEC along the line of sight from a station to a source,
+ * summed over all screens. The pierce point evaluation is based on
+ * the MeqTrees script Lions/PiercePoints.py. */
+static double evaluate_tec(const StationGeometry* st,
+        const double l, const double m, const double n,
+        const double sin_dec0, const double cos_dec0,
+        const double sin_min_el, const double TEC0, const int num_screens,
+        const TIDScreen* screens, const TIDComponent* components)
+{
+    int s, c;
+    double x, y, z, t, dx, dy, dz, cos_el, tec = 0.0;
+
+    /* Convert the relative direction to a horizontal (ENU) direction. */
+    x = l * st->cos_ha0 + m * st->sin_ha0 * sin_dec0 -
+            n * st->sin_ha0 * cos_dec0;
+    t = st->sin_lat0 * st->cos_ha0;
+    y = -l * st->sin_lat0 * st->sin_ha0 +
+            m * (st->cos_lat0 * cos_dec0 + t * sin_dec0) +
+            n * (st->cos_lat0 * sin_dec0 - t * cos_dec0);
+    t = st->cos_lat0 * st->cos_ha0;
+    z = l * st->cos_lat0 * st->sin_ha0 +
+            m * (st->sin_lat0 * cos_dec0 - t * sin_dec0) +
+            n * (st->sin_lat0 * sin_dec0 + t * cos_dec0);
+
+    /* No phase is applied below the minimum elevation. */
+    if (z < sin_min_el) return 0.0;
+
+    /* Convert the ENU unit vector to the ECEF frame. */
+    dx = -x * st->sin_lon - y * st->sin_lat * st->cos_lon +
+            z * st->cos_lat * st->cos_lon;
+    dy =  x * st->cos_lon - y * st->sin_lat * st->sin_lon +
+            z * st->cos_lat * st->sin_lon;
+    dz =  y * st->cos_lat + z * st->sin_lat;
+    cos_el = sqrt(1.0 - z * z);
+
+    /* Loop over screens. */
+    for (s = 0; s < num_screens; ++s)
     {
-        float2* Z_ = oskar_mem_float2(out, status) + offset_out;
-        for (i = 0; i < num_pp; ++i)
+        double pp_lon, pp_lat, pp_sec, scale;
+        const double height_m = screens[s].height_m;
+        const TIDComponent* comp = &components[screens[s].start];
+        if (screens[s].num_components == 0) continue;
+
+        /* Evaluate the distance from the station to the pierce point.
+         * If the direction is directly towards the zenith, this is simply
+         * the screen height. */
+        if (fabs(z - 1.0) > 1.0e-10)
         {
-            /* Initialise as an unit scalar Z = (1 + 0i) i.e. no phase change */
-            Z_[i].x = 1.0;
-            Z_[i].y = 0.0;
+            const double r = st->radius + height_m;
+            const double sin_a = (cos_el * st->norm_xyz) / r;
+            const double cos_a = sqrt(1.0 - sin_a * sin_a);
+            pp_sec = 1.0 / cos_a;
+            scale = r * (cos_el * cos_a - z * sin_a) / cos_el;
+        }
+        else
+        {
+            pp_sec = 1.0;
+            scale = height_m;
+        }
+
+        /* Convert the pierce point to geocentric longitude and latitude. */
+        {
+            const double px = st->x + dx * scale;
+            const double py = st->y + dy * scale;
+            const double pz = st->z + dz * scale;
+            pp_lon = atan2(py, px);
+            pp_lat = atan2(pz, sqrt(px * px + py * py));
+        }
 
-            /* If the pierce point is below the minimum specified elevation
-             * don't evaluate a phase */
-            if (asin((oskar_mem_float_const(hor_z, status))[i]) <
-                    min_elevation)
-                continue;
+        /* Sum the TID components of this screen. */
+        for (c = 0; c < screens[s].num_components; ++c)
+            tec += pp_sec * comp[c].amp * (
+                    cos(comp[c].k_lon * pp_lon - comp[c].phase) +
+                    cos(comp[c].k_lat * pp_lat - comp[c].phase));
+    }
+    return tec + TEC0;
+}
 
-            arg = wavelength * 25. * oskar_mem_float_const(TEC, status)[i];
 
-            /* Z phase == exp(i * lambda * 25 * tec) */
-            Z_[i].x = cos(arg);
-            Z_[i].y = sin(arg);
-        }
+static void jones_Z_f(int num, const double* tec, double factor, float2* Z)
+{
+    int i;
+#pragma omp parallel for private(i)
+    for (i = 0; i < num; ++i)
+    {
+        const double arg = factor * tec[i];
+        Z[i].x = (float) cos(arg);
+        Z[i].y = (float) sin(arg);
     }
-    else
+}
+
+
+static void jones_Z_d(int num, const double* tec, double factor, double2* Z)
+{
+    int i;
+#pragma omp parallel for private(i)
+    for (i = 0; i < num; ++i)
     {
-        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        const double arg = factor * tec[i];
+        Z[i].x = cos(arg);
+        Z[i].y = sin(arg);
     }
 }
 
@@ -39,6 +39,7 @@
 #include "interferometer/oskar_jones.h"
 #include "interferometer/oskar_interferometer.h"
 #include "log/oskar_log.h"
+#include "mem/oskar_mem.h"
 #include "sky/oskar_sky.h"
 #include "telescope/oskar_telescope.h"
 #include "utility/oskar_device.h"
@@ -51,6 +52,7 @@
 #include "vis/oskar_vis_header.h"
 #include "vis/oskar_vis_header_write_ms.h"
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -72,13 +74,15 @@ struct DeviceData
 
     /* Device memory. */
     int previous_chunk_index;
+    int block_index;            /* Index of block held in vis_block. */
     oskar_VisBlock* vis_block;  /* Device memory block. */
     oskar_Mem *u, *v, *w;
     oskar_Sky* chunk;           /* The unmodified sky chunk being processed. */
     oskar_Sky* chunk_clip;      /* Copy of the chunk after horizon clipping. */
     oskar_Telescope* tel;       /* Telescope model, created as a copy. */
-    oskar_Jones *J, *R, *E, *K, *Z;
+    oskar_Jones *J, *R, *E, *K, *K_inc, *Z;
     oskar_StationWork* station_work;
+    oskar_WorkJonesZ* work_Z;   /* TEC values cached across channels. */
 
     /* Timers. */
     oskar_Timer* tmr_compute;   /* Total time spent filling vis blocks. */
@@ -92,11 +96,27 @@ struct DeviceData
 typedef struct DeviceData DeviceData;
 
 
+/* Lock-free ring buffer of status messages from compute devices.
+ * Any thread may print the queued messages, but only one at a time. */
+#define STATUS_LOG_SLOTS 128
+#define STATUS_LOG_LENGTH 128
+struct StatusLog
+{
+    int head;                 /* Number of slots claimed by producers. */
+    int tail;                 /* Number of messages printed. */
+    int printing;             /* Set while a thread is printing messages. */
+    oskar_Mutex* mutex;       /* Held while calling oskar_log. */
+    int seq[STATUS_LOG_SLOTS]; /* Sequence number of each slot. */
+    char msg[STATUS_LOG_SLOTS][STATUS_LOG_LENGTH];
+};
+typedef struct StatusLog StatusLog;
+
+
 struct oskar_Interferometer
 {
     /* Settings. */
     int prec, num_devices, num_gpus_avail, dev_loc, num_gpus, *gpu_ids;
-    int num_channels, num_time_steps;
+    int num_channels, num_time_steps, num_cpu_threads_per_device;
     int max_sources_per_chunk, max_times_per_block;
     int apply_horizon_clip, force_polarised_ms, zero_failed_gaussians;
     int coords_only;
@@ -106,13 +126,16 @@ struct oskar_Interferometer
 
     /* State. */
     int init_sky, work_unit_index, status;
+    int *block_work_unit_index, *block_threads_done;
     oskar_Mutex* mutex;
     oskar_Barrier* barrier;
+    StatusLog status_log;
 
     /* Sky model and telescope model. */
     int num_sources_total, num_sky_chunks;
     oskar_Sky** sky_chunks;
     oskar_Telescope* tel;
+    oskar_SettingsIonosphere* ionosphere;
 
     /* Output data and file handles. */
     oskar_VisHeader* header;
@@ -133,10 +156,29 @@ typedef struct oskar_Interferometer oskar_Interferometer;
 
 /* Private method prototypes. */
 
+static void begin_block(oskar_Interferometer* h, DeviceData* d,
+        int block_index, int* status);
+static void end_block(oskar_Interferometer* h, DeviceData* d,
+        int block_index, int* status);
+static void sim_work_units(oskar_Interferometer* h, DeviceData* d,
+        int device_id, int block_index, int* work_unit_index,
+        int* threads_done, int* status);
+static void sim_geometry(oskar_Interferometer* h, DeviceData* d,
+        oskar_Sky* sky, int time_index_block, int time_index_simulation,
+        int* status);
 static void sim_baselines(oskar_Interferometer* h, DeviceData* d,
         oskar_Sky* sky, int channel_index_block, int time_index_block,
         int time_index_simulation, int* status);
+static int use_fused_phase(const oskar_Interferometer* h,
+        const DeviceData* d);
+static int use_phase_rotation(const oskar_Interferometer* h,
+        const DeviceData* d);
+static int phase_rotation_interval(const oskar_Interferometer* h);
+static void status_log_init(StatusLog* log, oskar_Mutex* mutex);
+static void status_log_push(StatusLog* log, const char* format, ...);
+static void status_log_flush(StatusLog* log);
 static void free_device_data(oskar_Interferometer* h, int* status);
+static void free_ionosphere(oskar_Interferometer* h);
 static void set_up_device_data(oskar_Interferometer* h, int* status);
 static void set_up_vis_header(oskar_Interferometer* h, int* status);
 static void record_timing(oskar_Interferometer* h);
@@ -218,6 +260,7 @@ oskar_Interferometer* oskar_interferometer_create(int precision, int* status)
     h->t_w       = oskar_mem_create(precision, OSKAR_CPU, 0, status);
     h->mutex     = oskar_mutex_create();
     h->barrier   = oskar_barrier_create(0);
+    status_log_init(&h->status_log, h->mutex);
 
     /* Get number of devices available, and device location. */
     oskar_device_set_require_double_precision(precision == OSKAR_DOUBLE);
@@ -225,6 +268,7 @@ oskar_Interferometer* oskar_interferometer_create(int precision, int* status)
 
     /* Set sensible defaults. */
     h->max_sources_per_chunk = 16384;
+    h->num_cpu_threads_per_device = 1;
     oskar_interferometer_set_gpus(h, -1, 0, status);
     oskar_interferometer_set_num_devices(h, -1);
     oskar_interferometer_set_correlation_type(h, "Cross-correlations", status);
@@ -309,6 +353,7 @@ void oskar_interferometer_free(oskar_Interferometer* h, int* status)
     for (i = 0; i < h->num_sky_chunks; ++i)
         oskar_sky_free(h->sky_chunks[i], status);
     oskar_telescope_free(h->tel, status);
+    free_ionosphere(h);
     oskar_mem_free(h->temp, status);
     oskar_mem_free(h->t_u, status);
     oskar_mem_free(h->t_v, status);
@@ -327,6 +372,13 @@ void oskar_interferometer_free(oskar_Interferometer* h, int* status)
 }
 
 
+int oskar_interferometer_num_cpu_threads_per_device(
+        const oskar_Interferometer* h)
+{
+    return h ? h->num_cpu_threads_per_device : 0;
+}
+
+
 int oskar_interferometer_num_devices(const oskar_Interferometer* h)
 {
     return h ? h->num_devices : 0;
@@ -362,16 +414,13 @@ void oskar_interferometer_reset_cache(oskar_Interferometer* h, int* status)
 
 void oskar_interferometer_reset_work_unit_index(oskar_Interferometer* h)
 {
-    h->work_unit_index = 0;
+    oskar_atomic_store(&h->work_unit_index, 0);
 }
 
 
 void oskar_interferometer_run_block(oskar_Interferometer* h, int block_index,
         int device_id, int* status)
 {
-    double obs_start_mjd, dt_dump_days;
-    int i_active, time_index_start, time_index_end;
-    int num_channels, num_times_block, total_chunks, total_times;
     DeviceData* d;
     if (*status) return;
 
@@ -389,88 +438,15 @@ void oskar_interferometer_run_block(oskar_Interferometer* h, int block_index,
     if (device_id >= 0 && device_id < h->num_gpus)
         oskar_device_set(h->dev_loc, h->gpu_ids[device_id], status);
 
-    /* Clear the visibility block. */
-    i_active = block_index % 2; /* Index of the active buffer. */
+    /* Simulate all work units in the block and copy it to host memory. */
     d = &(h->d[device_id]);
     oskar_timer_resume(d->tmr_compute);
-    oskar_vis_block_clear(d->vis_block, status);
-
-    /* Set the visibility block meta-data. */
-    total_chunks = h->num_sky_chunks;
-    num_channels = h->num_channels;
-    total_times = h->num_time_steps;
-    obs_start_mjd = h->time_start_mjd_utc;
-    dt_dump_days = h->time_inc_sec / 86400.0;
-    time_index_start = block_index * h->max_times_per_block;
-    time_index_end = time_index_start + h->max_times_per_block - 1;
-    if (time_index_end >= total_times)
-        time_index_end = total_times - 1;
-    num_times_block = 1 + time_index_end - time_index_start;
-
-    /* Set the number of active times in the block. */
-    oskar_vis_block_set_num_times(d->vis_block, num_times_block, status);
-    oskar_vis_block_set_start_time_index(d->vis_block, time_index_start);
-
-    /* Go though all possible work units in the block. A work unit is defined
-     * as the simulation for one time and one sky chunk. */
-    while (!h->coords_only)
-    {
-        oskar_Sky* sky;
-        int i_work_unit, i_chunk, i_time, i_channel, sim_time_idx;
-
-        oskar_mutex_lock(h->mutex);
-        i_work_unit = (h->work_unit_index)++;
-        oskar_mutex_unlock(h->mutex);
-        if ((i_work_unit >= num_times_block * total_chunks) || *status) break;
-
-        /* Convert slice index to chunk/time index. */
-        i_chunk      = i_work_unit / num_times_block;
-        i_time       = i_work_unit - i_chunk * num_times_block;
-        sim_time_idx = time_index_start + i_time;
-
-        /* Copy sky chunk to device only if different from the previous one. */
-        if (i_chunk != d->previous_chunk_index)
-        {
-            oskar_timer_resume(d->tmr_copy);
-            oskar_sky_copy(d->chunk, h->sky_chunks[i_chunk], status);
-            oskar_timer_pause(d->tmr_copy);
-        }
-        sky = h->apply_horizon_clip ? d->chunk_clip : d->chunk;
-
-        /* Apply horizon clip if required. */
-        if (h->apply_horizon_clip)
-        {
-            double gast, mjd;
-            mjd = obs_start_mjd + dt_dump_days * (sim_time_idx + 0.5);
-            gast = oskar_convert_mjd_to_gast_fast(mjd);
-            oskar_timer_resume(d->tmr_clip);
-            oskar_sky_horizon_clip(d->chunk_clip, d->chunk, d->tel, gast,
-                    d->station_work, status);
-            oskar_timer_pause(d->tmr_clip);
-        }
-
-        /* Simulate all baselines for all channels for this time and chunk. */
-        for (i_channel = 0; i_channel < num_channels; ++i_channel)
-        {
-            if (*status) break;
-            oskar_mutex_lock(h->mutex);
-            oskar_log_message('S', 1, "Time %*i/%i, "
-                    "Chunk %*i/%i, Channel %*i/%i [Device %i, %i sources]",
-                    disp_width(total_times), sim_time_idx + 1, total_times,
-                    disp_width(total_chunks), i_chunk + 1, total_chunks,
-                    disp_width(num_channels), i_channel + 1, num_channels,
-                    device_id, oskar_sky_num_sources(sky));
-            oskar_mutex_unlock(h->mutex);
-            sim_baselines(h, d, sky, i_channel, i_time, sim_time_idx, status);
-        }
-        d->previous_chunk_index = i_chunk;
-    }
-
-    /* Copy the visibility block to host memory. */
-    oskar_timer_resume(d->tmr_copy);
-    oskar_vis_block_copy(d->vis_block_cpu[i_active], d->vis_block, status);
-    oskar_timer_pause(d->tmr_copy);
+    begin_block(h, d, block_index, status);
+    sim_work_units(h, d, device_id, block_index, &h->work_unit_index, 0,
+            status);
+    end_block(h, d, block_index, status);
     oskar_timer_pause(d->tmr_compute);
+    status_log_flush(&h->status_log);
 }
 
 
@@ -494,11 +470,28 @@ static void* run_blocks(void* arg)
     status = &(h->status);
 
 #ifdef _OPENMP
-    /* Disable any nested parallelism. */
+    /* Disable any nested parallelism.
+     * CPU devices may use a team of threads within each work unit. */
     omp_set_nested(0);
-    omp_set_num_threads(1);
+    if (thread_id == 0)
+    {
+        /* Thread 0 finalises and writes each block while the devices
+         * compute the next one, so give it the cores not used by CPU
+         * devices. */
+        const int n = oskar_get_num_procs() -
+                (h->num_devices - h->num_gpus) * h->num_cpu_threads_per_device;
+        omp_set_num_threads(n > 1 ? n : 1);
+    }
+    else if (device_id >= h->num_gpus)
+        omp_set_num_threads(h->num_cpu_threads_per_device);
+    else
+        omp_set_num_threads(1);
 #endif
 
+    /* Set the GPU to use. */
+    if (device_id >= 0 && device_id < h->num_gpus)
+        oskar_device_set(h->dev_loc, h->gpu_ids[device_id], status);
+
     /* Loop over blocks of observation time, running simulation and file
      * writing one block at a time. Simulation and file output are overlapped
      * by using double buffering, and a dedicated thread is used for file
@@ -511,41 +504,79 @@ static void* run_blocks(void* arg)
      * data are ready yet) and no simulation is performed for the last loop
      * counter (which corresponds to the last block + 1) as this iteration
      * simply writes the last block.
+     *
+     * Work units are handed out using an atomic counter for each block.
+     * A compute device that runs out of work units in the current block
+     * starts on the next one, for as long as any other thread is still busy
+     * with the current block. Its results are copied out only after the
+     * barrier, once the host buffer it needs has been written to file.
      */
     num_blocks = oskar_interferometer_num_vis_blocks(h);
     for (b = 0; b < num_blocks + 1; ++b)
     {
         if ((thread_id > 0 || num_threads == 1) && b < num_blocks)
-            oskar_interferometer_run_block(h, b, device_id, status);
-        if (thread_id == 0 && b > 0)
         {
-            oskar_VisBlock* block;
-            block = oskar_interferometer_finalise_block(h, b - 1, status);
-            oskar_interferometer_write_block(h, block, b - 1, status);
+            DeviceData* d = &(h->d[device_id]);
+            oskar_timer_resume(d->tmr_compute);
+
+            /* Finish this block, which may already have been started. */
+            if (d->block_index != b)
+                begin_block(h, d, b, status);
+            sim_work_units(h, d, device_id, b,
+                    &h->block_work_unit_index[b], 0, status);
+            end_block(h, d, b, status);
+            oskar_atomic_fetch_add(&h->block_threads_done[b], 1);
+
+            /* Start the next block while other threads are still busy. */
+            if (b + 1 < num_blocks)
+            {
+                begin_block(h, d, b + 1, status);
+                sim_work_units(h, d, device_id, b + 1,
+                        &h->block_work_unit_index[b + 1],
+                        &h->block_threads_done[b], status);
+            }
+            oskar_timer_pause(d->tmr_compute);
+        }
+        if (thread_id == 0)
+        {
+            if (b > 0)
+            {
+                oskar_VisBlock* block;
+#ifdef _OPENMP
+                /* All devices are idle while the last block is written. */
+                if (b == num_blocks)
+                    omp_set_num_threads(oskar_get_num_procs());
+#endif
+                block = oskar_interferometer_finalise_block(h, b - 1, status);
+                oskar_interferometer_write_block(h, block, b - 1, status);
+            }
+            oskar_atomic_fetch_add(&h->block_threads_done[b], 1);
         }
 
-        /* Barrier 1: Reset work unit index and print status. */
+        /* Barrier: Synchronise before moving to the next block. */
         oskar_barrier_wait(h->barrier);
         if (thread_id == 0)
         {
-            oskar_interferometer_reset_work_unit_index(h);
+            status_log_flush(&h->status_log);
             if (b < num_blocks && !*status)
+            {
+                /* Devices may still be printing status messages. */
+                oskar_mutex_lock(h->mutex);
                 oskar_log_message('S', 0, "Block %*i/%i (%3.0f%%) "
                         "complete. Simulation time elapsed: %.3f s",
                         disp_width(num_blocks), b+1, num_blocks,
                         100.0 * (b+1) / (double)num_blocks,
                         oskar_timer_elapsed(h->tmr_sim));
+                oskar_mutex_unlock(h->mutex);
+            }
         }
-
-        /* Barrier 2: Synchronise before moving to the next block. */
-        oskar_barrier_wait(h->barrier);
     }
     return 0;
 }
 
 void oskar_interferometer_run(oskar_Interferometer* h, int* status)
 {
-    int i, num_threads;
+    int i, num_blocks, num_threads;
     oskar_Thread** threads = 0;
     ThreadArgs* args = 0;
     if (*status || !h) return;
@@ -570,8 +601,20 @@ void oskar_interferometer_run(oskar_Interferometer* h, int* status)
     /* Initialise if required. */
     oskar_interferometer_check_init(h, status);
 
-    /* Set up worker threads. */
+    /* Set up worker threads and the work unit counters for each block. */
     num_threads = h->num_devices + 1;
+    num_blocks = oskar_interferometer_num_vis_blocks(h);
+    h->block_work_unit_index = (int*) calloc(num_blocks + 1, sizeof(int));
+    h->block_threads_done = (int*) calloc(num_blocks + 1, sizeof(int));
+    if (!h->block_work_unit_index || !h->block_threads_done)
+    {
+        free(h->block_work_unit_index);
+        free(h->block_threads_done);
+        h->block_work_unit_index = 0;
+        h->block_threads_done = 0;
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
     oskar_barrier_set_num_threads(h->barrier, num_threads);
     threads = (oskar_Thread**) calloc(num_threads, sizeof(oskar_Thread*));
     args = (ThreadArgs*) calloc(num_threads, sizeof(ThreadArgs));
@@ -599,7 +642,6 @@ void oskar_interferometer_run(oskar_Interferometer* h, int* status)
     h->status = *status;
 
     /* Start the worker threads. */
-    oskar_interferometer_reset_work_unit_index(h);
     for (i = 0; i < num_threads; ++i)
         threads[i] = oskar_thread_create(run_blocks, (void*)&args[i], 0);
 
@@ -611,6 +653,10 @@ void oskar_interferometer_run(oskar_Interferometer* h, int* status)
     }
     free(threads);
     free(args);
+    free(h->block_work_unit_index);
+    free(h->block_threads_done);
+    h->block_work_unit_index = 0;
+    h->block_threads_done = 0;
 
     /* Get status code. */
     *status = h->status;
@@ -757,6 +803,71 @@ void oskar_interferometer_set_horizon_clip(oskar_Interferometer* h, int value)
 }
 
 
+void oskar_interferometer_set_ionosphere(oskar_Interferometer* h,
+        int enable, double tec0, double min_elevation_rad, int* status)
+{
+    if (*status) return;
+    free_ionosphere(h);
+    if (!enable) return;
+    h->ionosphere = (oskar_SettingsIonosphere*)
+            calloc(1, sizeof(oskar_SettingsIonosphere));
+    if (!h->ionosphere)
+    {
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+    h->ionosphere->enable = 1;
+    h->ionosphere->TEC0 = tec0;
+    h->ionosphere->min_elevation = min_elevation_rad;
+}
+
+
+void oskar_interferometer_add_ionosphere_screen(oskar_Interferometer* h,
+        double height_km, int num_components, const double* amp,
+        const double* wavelength_km, const double* speed_km_h,
+        const double* theta_deg, int* status)
+{
+    oskar_SettingsTIDscreen *t, *screen;
+    const size_t bytes = num_components * sizeof(double);
+    if (*status) return;
+    if (!h->ionosphere || num_components < 0)
+    {
+        *status = OSKAR_ERR_INVALID_ARGUMENT;
+        return;
+    }
+    t = (oskar_SettingsTIDscreen*) realloc(h->ionosphere->TID,
+            (h->ionosphere->num_TID_screens + 1) *
+            sizeof(oskar_SettingsTIDscreen));
+    if (!t)
+    {
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+    h->ionosphere->TID = t;
+    screen = &t[h->ionosphere->num_TID_screens++];
+    memset(screen, 0, sizeof(oskar_SettingsTIDscreen));
+    screen->height_km = height_km;
+    if (num_components > 0)
+    {
+        screen->amp = (double*) malloc(bytes);
+        screen->wavelength = (double*) malloc(bytes);
+        screen->speed = (double*) malloc(bytes);
+        screen->theta = (double*) malloc(bytes);
+        if (!screen->amp || !screen->wavelength ||
+                !screen->speed || !screen->theta)
+        {
+            *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+            return;
+        }
+        screen->num_components = num_components;
+        memcpy(screen->amp, amp, bytes);
+        memcpy(screen->wavelength, wavelength_km, bytes);
+        memcpy(screen->speed, speed_km_h, bytes);
+        memcpy(screen->theta, theta_deg, bytes);
+    }
+}
+
+
 void oskar_interferometer_set_max_sources_per_chunk(oskar_Interferometer* h,
         int value)
 {
@@ -771,12 +882,30 @@ void oskar_interferometer_set_max_times_per_block(oskar_Interferometer* h,
 }
 
 
+void oskar_interferometer_set_num_cpu_threads_per_device(
+        oskar_Interferometer* h, int value)
+{
+    if (value < 1)
+    {
+        value = 1;
+#ifdef _OPENMP
+        /* Use all cores for a single CPU device. */
+        if (h->num_gpus == 0)
+            value = oskar_get_num_procs();
+#endif
+    }
+    h->num_cpu_threads_per_device = value;
+}
+
+
 void oskar_interferometer_set_num_devices(oskar_Interferometer* h, int value)
 {
     int status = 0;
     free_device_data(h, &status);
     if (value < 1)
-        value = (h->num_gpus == 0) ? oskar_get_num_procs() : h->num_gpus;
+        value = (h->num_gpus == 0) ?
+                oskar_get_num_procs() / h->num_cpu_threads_per_device :
+                h->num_gpus;
     if (value < 1) value = 1;
     h->num_devices = value;
     h->d = (DeviceData*) realloc(h->d, h->num_devices * sizeof(DeviceData));
@@ -938,34 +1067,139 @@ void oskar_interferometer_write_block(oskar_Interferometer* h,
 
 /* Private methods. */
 
-static void sim_baselines(oskar_Interferometer* h, DeviceData* d,
-        oskar_Sky* sky, int channel_index_block, int time_index_block,
-        int time_index_simulation, int* status)
+static void begin_block(oskar_Interferometer* h, DeviceData* d,
+        int block_index, int* status)
 {
-    int num_baselines, num_stations, num_src, num_times_block, num_channels;
-    double dt_dump_days, t_start, t_dump, gast, frequency, ra0, dec0;
+    int time_index_start, time_index_end;
+
+    /* Clear the visibility block. */
+    oskar_vis_block_clear(d->vis_block, status);
+    d->block_index = block_index;
+
+    /* Set the number of active times in the block. */
+    time_index_start = block_index * h->max_times_per_block;
+    time_index_end = time_index_start + h->max_times_per_block - 1;
+    if (time_index_end >= h->num_time_steps)
+        time_index_end = h->num_time_steps - 1;
+    oskar_vis_block_set_num_times(d->vis_block,
+            1 + time_index_end - time_index_start, status);
+    oskar_vis_block_set_start_time_index(d->vis_block, time_index_start);
+}
+
+
+static void end_block(oskar_Interferometer* h, DeviceData* d,
+        int block_index, int* status)
+{
+    (void) h;
+
+    /* Copy the visibility block to host memory. */
+    oskar_timer_resume(d->tmr_copy);
+    oskar_vis_block_copy(d->vis_block_cpu[block_index % 2], d->vis_block,
+            status);
+    oskar_timer_pause(d->tmr_copy);
+}
+
+
+static void sim_work_units(oskar_Interferometer* h, DeviceData* d,
+        int device_id, int block_index, int* work_unit_index,
+        int* threads_done, int* status)
+{
+    double obs_start_mjd, dt_dump_days;
+    int time_index_start, num_channels, num_times_block;
+    int total_chunks, total_times;
+
+    /* Get the dimensions of the block. */
+    total_chunks = h->num_sky_chunks;
+    num_channels = h->num_channels;
+    total_times = h->num_time_steps;
+    obs_start_mjd = h->time_start_mjd_utc;
+    dt_dump_days = h->time_inc_sec / 86400.0;
+    time_index_start = block_index * h->max_times_per_block;
+    num_times_block = oskar_vis_block_num_times(d->vis_block);
+
+    /* Go though all possible work units in the block. A work unit is defined
+     * as the simulation for one time and one sky chunk.
+     * If a counter of finished threads is given, stop when all threads
+     * have finished with the previous block. */
+    while (!h->coords_only)
+    {
+        oskar_Sky* sky;
+        int i_work_unit, i_chunk, i_time, i_channel, sim_time_idx;
+
+        if (threads_done && oskar_atomic_load(threads_done) > h->num_devices)
+            break;
+        i_work_unit = oskar_atomic_fetch_add(work_unit_index, 1);
+        if ((i_work_unit >= num_times_block * total_chunks) || *status) break;
+
+        /* Convert slice index to chunk/time index. */
+        i_chunk      = i_work_unit / num_times_block;
+        i_time       = i_work_unit - i_chunk * num_times_block;
+        sim_time_idx = time_index_start + i_time;
+
+        /* Copy sky chunk to device only if different from the previous one. */
+        if (i_chunk != d->previous_chunk_index)
+        {
+            oskar_timer_resume(d->tmr_copy);
+            oskar_sky_copy(d->chunk, h->sky_chunks[i_chunk], status);
+            oskar_timer_pause(d->tmr_copy);
+        }
+        sky = h->apply_horizon_clip ? d->chunk_clip : d->chunk;
+
+        /* Apply horizon clip if required. */
+        if (h->apply_horizon_clip)
+        {
+            double gast, mjd;
+            mjd = obs_start_mjd + dt_dump_days * (sim_time_idx + 0.5);
+            gast = oskar_convert_mjd_to_gast_fast(mjd);
+            oskar_timer_resume(d->tmr_clip);
+            oskar_sky_horizon_clip(d->chunk_clip, d->chunk, d->tel, gast,
+                    d->station_work, status);
+            oskar_timer_pause(d->tmr_clip);
+        }
+
+        /* Evaluate frequency-independent terms for this time and chunk. */
+        sim_geometry(h, d, sky, i_time, sim_time_idx, status);
+
+        /* Simulate all baselines for all channels for this time and chunk. */
+        for (i_channel = 0; i_channel < num_channels; ++i_channel)
+        {
+            if (*status) break;
+            status_log_push(&h->status_log, "Time %*i/%i, "
+                    "Chunk %*i/%i, Channel %*i/%i [Device %i, %i sources]",
+                    disp_width(total_times), sim_time_idx + 1, total_times,
+                    disp_width(total_chunks), i_chunk + 1, total_chunks,
+                    disp_width(num_channels), i_channel + 1, num_channels,
+                    device_id, oskar_sky_num_sources(sky));
+            sim_baselines(h, d, sky, i_channel, i_time, sim_time_idx, status);
+        }
+        d->previous_chunk_index = i_chunk;
+    }
+}
+
+
+static void sim_geometry(oskar_Interferometer* h, DeviceData* d,
+        oskar_Sky* sky, int time_index_block, int time_index_simulation,
+        int* status)
+{
+    int num_stations, num_src;
+    double dt_dump_days, t_start, t_dump, gast, ra0, dec0;
     const oskar_Mem *x, *y, *z;
 
     /* Get dimensions. */
-    num_baselines   = oskar_telescope_num_baselines(d->tel);
-    num_stations    = oskar_telescope_num_stations(d->tel);
-    num_src         = oskar_sky_num_sources(sky);
-    num_times_block = oskar_vis_block_num_times(d->vis_block);
-    num_channels    = oskar_vis_block_num_channels(d->vis_block);
+    num_stations = oskar_telescope_num_stations(d->tel);
+    num_src      = oskar_sky_num_sources(sky);
 
     /* Return if there are no sources in the chunk,
      * or if block time index requested is outside the valid range. */
-    if (num_src == 0 || time_index_block >= num_times_block) return;
+    if (num_src == 0 ||
+            time_index_block >= oskar_vis_block_num_times(d->vis_block))
+        return;
 
-    /* Get the time and frequency of the visibility slice being simulated. */
+    /* Get the time of the visibility slice being simulated. */
     dt_dump_days = h->time_inc_sec / 86400.0;
     t_start = h->time_start_mjd_utc;
     t_dump = t_start + dt_dump_days * (time_index_simulation + 0.5);
     gast = oskar_convert_mjd_to_gast_fast(t_dump);
-    frequency = h->freq_start_hz + channel_index_block * h->freq_inc_hz;
-
-    /* Scale source fluxes with spectral index and rotation measure. */
-    oskar_sky_scale_flux_with_frequency(sky, frequency, status);
 
     /* Evaluate station u,v,w coordinates. */
     ra0 = oskar_telescope_phase_centre_ra_rad(d->tel);
@@ -984,6 +1218,68 @@ static void sim_baselines(oskar_Interferometer* h, DeviceData* d,
     oskar_jones_set_size(d->J, num_stations, num_src, status);
     oskar_jones_set_size(d->E, num_stations, num_src, status);
     oskar_jones_set_size(d->K, num_stations, num_src, status);
+    oskar_jones_set_size(d->K_inc, num_stations, num_src, status);
+
+    /* Evaluate parallactic angle (Jones R: matrix).
+     * TODO Move this into station beam evaluation instead. */
+    if (d->R)
+    {
+        oskar_timer_resume(d->tmr_E);
+        oskar_evaluate_jones_R(d->R, num_src, oskar_sky_ra_rad_const(sky),
+                oskar_sky_dec_rad_const(sky), d->tel, gast, status);
+        oskar_timer_pause(d->tmr_E);
+    }
+
+    /* Evaluate ionospheric pierce points and TEC values (for Jones Z),
+     * which are the same for all channels. */
+    if (d->Z)
+    {
+        oskar_timer_resume(d->tmr_E);
+        oskar_evaluate_jones_Z_tec(sky, d->tel, h->ionosphere, gast,
+                d->work_Z, status);
+        oskar_timer_pause(d->tmr_E);
+    }
+
+    /* Evaluate the phase increment between adjacent channels, if used. */
+    if (use_phase_rotation(h, d))
+    {
+        oskar_timer_resume(d->tmr_K);
+        oskar_evaluate_jones_K(d->K_inc, num_src, oskar_sky_l_const(sky),
+                oskar_sky_m_const(sky), oskar_sky_n_const(sky),
+                d->u, d->v, d->w, h->freq_inc_hz, oskar_sky_I_const(sky),
+                -DBL_MAX, DBL_MAX, status);
+        oskar_timer_pause(d->tmr_K);
+    }
+}
+
+
+static void sim_baselines(oskar_Interferometer* h, DeviceData* d,
+        oskar_Sky* sky, int channel_index_block, int time_index_block,
+        int time_index_simulation, int* status)
+{
+    int num_baselines, num_stations, num_src, num_times_block, num_channels;
+    double dt_dump_days, t_start, t_dump, gast, frequency;
+
+    /* Get dimensions. */
+    num_baselines   = oskar_telescope_num_baselines(d->tel);
+    num_stations    = oskar_telescope_num_stations(d->tel);
+    num_src         = oskar_sky_num_sources(sky);
+    num_times_block = oskar_vis_block_num_times(d->vis_block);
+    num_channels    = oskar_vis_block_num_channels(d->vis_block);
+
+    /* Return if there are no sources in the chunk,
+     * or if block time index requested is outside the valid range. */
+    if (num_src == 0 || time_index_block >= num_times_block) return;
+
+    /* Get the time and frequency of the visibility slice being simulated. */
+    dt_dump_days = h->time_inc_sec / 86400.0;
+    t_start = h->time_start_mjd_utc;
+    t_dump = t_start + dt_dump_days * (time_index_simulation + 0.5);
+    gast = oskar_convert_mjd_to_gast_fast(t_dump);
+    frequency = h->freq_start_hz + channel_index_block * h->freq_inc_hz;
+
+    /* Scale source fluxes with spectral index and rotation measure. */
+    oskar_sky_scale_flux_with_frequency(sky, frequency, status);
 
     /* Evaluate station beam (Jones E: may be matrix). */
     oskar_timer_resume(d->tmr_E);
@@ -992,48 +1288,65 @@ static void sim_baselines(oskar_Interferometer* h, DeviceData* d,
             gast, frequency, d->station_work, time_index_simulation, status);
     oskar_timer_pause(d->tmr_E);
 
-#if 0
-    /* Evaluate ionospheric phase (Jones Z: scalar) and join with Jones E.
-     * NOTE this is currently only a CPU implementation. */
+    /* Evaluate ionospheric phase (Jones Z: scalar) from the cached TEC
+     * values, and join with Jones E. */
     if (d->Z)
     {
-        oskar_evaluate_jones_Z(d->Z, num_src, sky, d->tel,
-                &settings->ionosphere, gast, frequency, &(d->workJonesZ),
-                status);
+        oskar_timer_resume(d->tmr_E);
+        oskar_evaluate_jones_Z_from_tec(d->Z, frequency, d->work_Z, status);
+        oskar_timer_pause(d->tmr_E);
         oskar_timer_resume(d->tmr_join);
         oskar_jones_join(d->E, d->Z, d->E, status);
         oskar_timer_pause(d->tmr_join);
     }
-#endif
 
-    /* Evaluate parallactic angle (Jones R: matrix), and join with Jones Z*E.
-     * TODO Move this into station beam evaluation instead. */
+    /* Join Jones Z*E with Jones R (evaluated once per time and chunk). */
     if (d->R)
     {
-        oskar_timer_resume(d->tmr_E);
-        oskar_evaluate_jones_R(d->R, num_src, oskar_sky_ra_rad_const(sky),
-                oskar_sky_dec_rad_const(sky), d->tel, gast, status);
-        oskar_timer_pause(d->tmr_E);
         oskar_timer_resume(d->tmr_join);
-        oskar_jones_join(d->R, d->E, d->R, status);
+        oskar_jones_join(d->E, d->E, d->R, status);
         oskar_timer_pause(d->tmr_join);
     }
 
-    /* Evaluate interferometer phase (Jones K: scalar). */
+    /* Calculate output offset. */
+    const int offset = num_channels * time_index_block + channel_index_block;
+
+    /* On the CPU, apply the interferometer phase inside the correlator.
+     * Jones K has unit amplitude, so the auto-correlations are unchanged. */
+    if (use_fused_phase(h, d))
+    {
+        oskar_timer_resume(d->tmr_correlate);
+        if (oskar_vis_block_has_auto_correlations(d->vis_block))
+            oskar_auto_correlate(num_src, d->E, sky, num_stations * offset,
+                    oskar_vis_block_auto_correlations(d->vis_block), status);
+        if (oskar_vis_block_has_cross_correlations(d->vis_block))
+            oskar_cross_correlate_with_phase(num_src, d->E, sky, d->tel,
+                    d->u, d->v, d->w, gast, frequency, num_baselines * offset,
+                    oskar_vis_block_cross_correlations(d->vis_block), status);
+        oskar_timer_pause(d->tmr_correlate);
+        return;
+    }
+
+    /* Evaluate interferometer phase (Jones K: scalar).
+     * Where possible, rotate the phases of the previous channel instead,
+     * but re-evaluate them periodically to limit accumulated rounding. */
     oskar_timer_resume(d->tmr_K);
-    oskar_evaluate_jones_K(d->K, num_src, oskar_sky_l_const(sky),
-            oskar_sky_m_const(sky), oskar_sky_n_const(sky), d->u, d->v, d->w,
-            frequency, oskar_sky_I_const(sky),
-            h->source_min_jy, h->source_max_jy, status);
+    if (use_phase_rotation(h, d) &&
+            channel_index_block % phase_rotation_interval(h) != 0)
+        oskar_mem_multiply(oskar_jones_mem(d->K), oskar_jones_mem(d->K),
+                oskar_jones_mem(d->K_inc), 0, 0, 0,
+                (size_t) num_stations * num_src, status);
+    else
+        oskar_evaluate_jones_K(d->K, num_src, oskar_sky_l_const(sky),
+                oskar_sky_m_const(sky), oskar_sky_n_const(sky),
+                d->u, d->v, d->w, frequency, oskar_sky_I_const(sky),
+                h->source_min_jy, h->source_max_jy, status);
     oskar_timer_pause(d->tmr_K);
 
-    /* Join Jones K with Jones Z*E. */
+    /* Join Jones K with Jones Z*E*R. */
     oskar_timer_resume(d->tmr_join);
-    oskar_jones_join(d->J, d->K, d->R ? d->R : d->E, status);
+    oskar_jones_join(d->J, d->K, d->E, status);
     oskar_timer_pause(d->tmr_join);
-
-    /* Calculate output offset. */
-    const int offset = num_channels * time_index_block + channel_index_block;
     oskar_timer_resume(d->tmr_correlate);
 
     /* Auto-correlate for this time and channel. */
@@ -1050,6 +1363,87 @@ static void sim_baselines(oskar_Interferometer* h, DeviceData* d,
 }
 
 
+static int use_fused_phase(const oskar_Interferometer* h,
+        const DeviceData* d)
+{
+    /* The correlator cannot apply the source flux filter of Jones K. */
+    return oskar_jones_mem_location(d->E) == OSKAR_CPU &&
+            h->source_min_jy == -DBL_MAX && h->source_max_jy == DBL_MAX;
+}
+
+
+static int use_phase_rotation(const oskar_Interferometer* h,
+        const DeviceData* d)
+{
+    /* The source flux filter depends on frequency, so the phases must be
+     * evaluated directly for every channel if it is in use. */
+    return !use_fused_phase(h, d) &&
+            oskar_vis_block_num_channels(d->vis_block) > 1 &&
+            h->source_min_jy == -DBL_MAX && h->source_max_jy == DBL_MAX;
+}
+
+
+static int phase_rotation_interval(const oskar_Interferometer* h)
+{
+    return (h->prec == OSKAR_DOUBLE) ? 256 : 32;
+}
+
+
+static void status_log_init(StatusLog* log, oskar_Mutex* mutex)
+{
+    int i;
+    memset(log, 0, sizeof(StatusLog));
+    log->mutex = mutex;
+    for (i = 0; i < STATUS_LOG_SLOTS; ++i)
+        log->seq[i] = i;
+}
+
+
+static void status_log_push(StatusLog* log, const char* format, ...)
+{
+    va_list args;
+
+    /* Claim a slot, and wait until its previous message has been printed.
+     * Help to print messages while waiting, in case the buffer is full. */
+    const int pos = oskar_atomic_fetch_add(&log->head, 1);
+    const int slot = pos % STATUS_LOG_SLOTS;
+    while (oskar_atomic_load(&log->seq[slot]) != pos)
+        status_log_flush(log);
+
+    /* Write the message and publish it. */
+    va_start(args, format);
+    vsnprintf(log->msg[slot], STATUS_LOG_LENGTH, format, args);
+    va_end(args);
+    oskar_atomic_store(&log->seq[slot], pos + 1);
+    status_log_flush(log);
+}
+
+
+static void status_log_flush(StatusLog* log)
+{
+    /* Return immediately if another thread is already printing. */
+    while (oskar_atomic_compare_and_swap(&log->printing, 0, 1) == 0)
+    {
+        int pos = oskar_atomic_load(&log->tail);
+        for (;; ++pos)
+        {
+            const int slot = pos % STATUS_LOG_SLOTS;
+            if (oskar_atomic_load(&log->seq[slot]) != pos + 1) break;
+            oskar_mutex_lock(log->mutex);
+            oskar_log_message('S', 1, "%s", log->msg[slot]);
+            oskar_mutex_unlock(log->mutex);
+            oskar_atomic_store(&log->seq[slot], pos + STATUS_LOG_SLOTS);
+        }
+        oskar_atomic_store(&log->tail, pos);
+        oskar_atomic_store(&log->printing, 0);
+
+        /* Check for a message published after the last check. */
+        if (oskar_atomic_load(&log->seq[pos % STATUS_LOG_SLOTS]) != pos + 1)
+            break;
+    }
+}
+
+
 static void set_up_vis_header(oskar_Interferometer* h, int* status)
 {
     int num_stations, vis_type;
@@ -1140,6 +1534,7 @@ static void set_up_device_data(oskar_Interferometer* h, int* status)
     {
         DeviceData* d = &h->d[i];
         d->previous_chunk_index = -1;
+        d->block_index = -1;
 
         /* Select the device. */
         if (i < h->num_gpus)
@@ -1195,10 +1590,26 @@ static void set_up_device_data(oskar_Interferometer* h, int* status)
                     status);
             d->K = oskar_jones_create(complx, dev_loc, num_stations, num_src,
                     status);
-            d->Z = 0;
+            d->K_inc = oskar_jones_create(complx, dev_loc, num_stations,
+                    num_src, status);
             d->station_work = oskar_station_work_create(h->prec, dev_loc,
                     status);
         }
+
+        /* Ionospheric phase screen (Jones Z: scalar), if enabled. */
+        if (h->ionosphere && !d->Z)
+        {
+            d->Z = oskar_jones_create(complx, dev_loc, num_stations, num_src,
+                    status);
+            d->work_Z = oskar_work_jones_z_create(h->prec, status);
+        }
+        else if (!h->ionosphere && d->Z)
+        {
+            oskar_jones_free(d->Z, status);
+            oskar_work_jones_z_free(d->work_Z, status);
+            d->Z = 0;
+            d->work_Z = 0;
+        }
     }
 }
 
@@ -1233,12 +1644,32 @@ static void free_device_data(oskar_Interferometer* h, int* status)
         oskar_jones_free(d->J, status);
         oskar_jones_free(d->E, status);
         oskar_jones_free(d->K, status);
+        oskar_jones_free(d->K_inc, status);
         oskar_jones_free(d->R, status);
+        oskar_jones_free(d->Z, status);
+        oskar_work_jones_z_free(d->work_Z, status);
         memset(d, 0, sizeof(DeviceData));
     }
 }
 
 
+static void free_ionosphere(oskar_Interferometer* h)
+{
+    int i;
+    if (!h->ionosphere) return;
+    for (i = 0; i < h->ionosphere->num_TID_screens; ++i)
+    {
+        free(h->ionosphere->TID[i].amp);
+        free(h->ionosphere->TID[i].wavelength);
+        free(h->ionosphere->TID[i].speed);
+        free(h->ionosphere->TID[i].theta);
+    }
+    free(h->ionosphere->TID);
+    free(h->ionosphere);
+    h->ionosphere = 0;
+}
+
+
 static void record_timing(oskar_Interferometer* h)
 {
     /* Obtain component times. */
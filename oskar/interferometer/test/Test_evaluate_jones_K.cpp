@@ -29,10 +29,13 @@
 #include <gtest/gtest.h>
 
 #include "interferometer/oskar_evaluate_jones_K.h"
+#include "mem/oskar_mem.h"
 #include "utility/oskar_get_error_string.h"
 #include "utility/oskar_timer.h"
 #include "utility/oskar_vector_types.h"
 
+#include <cfloat>
+#include <cmath>
 #include <cstdio>
 
 static void run_test(int type, double tol)
@@ -125,3 +128,97 @@ TEST(Jones_K, test_double)
 {
     run_test(OSKAR_DOUBLE, 1e-8);
 }
+
+template<typename T>
+static double max_abs_diff(const T* a, const T* b, int num)
+{
+    double max_err = 0.0;
+    for (int i = 0; i < num; ++i)
+    {
+        const double dx = a[i].x - b[i].x, dy = a[i].y - b[i].y;
+        const double err = sqrt(dx * dx + dy * dy);
+        if (err > max_err) max_err = err;
+    }
+    return max_err;
+}
+
+// Checks the drift of phases obtained by repeatedly rotating those of the
+// previous channel, as done by the interferometer simulator between
+// direct evaluations, against phases evaluated directly at each channel.
+static void run_rotation_test(int type, int num_channels, double tol)
+{
+    int num_sources = 500, num_stations = 50, status = 0;
+    double freq_start_hz = 100e6, freq_inc_hz = 0.1e6;
+    double max_err = 0.0;
+    oskar_Jones* K = oskar_jones_create(type | OSKAR_COMPLEX, OSKAR_CPU,
+            num_stations, num_sources, &status);
+    oskar_Jones* K_inc = oskar_jones_create(type | OSKAR_COMPLEX, OSKAR_CPU,
+            num_stations, num_sources, &status);
+    oskar_Jones* K_ref = oskar_jones_create(type | OSKAR_COMPLEX, OSKAR_CPU,
+            num_stations, num_sources, &status);
+    oskar_Mem* l = oskar_mem_create(type, OSKAR_CPU, num_sources, &status);
+    oskar_Mem* m = oskar_mem_create(type, OSKAR_CPU, num_sources, &status);
+    oskar_Mem* n = oskar_mem_create(type, OSKAR_CPU, num_sources, &status);
+    oskar_Mem* u = oskar_mem_create(type, OSKAR_CPU, num_stations, &status);
+    oskar_Mem* v = oskar_mem_create(type, OSKAR_CPU, num_stations, &status);
+    oskar_Mem* w = oskar_mem_create(type, OSKAR_CPU, num_stations, &status);
+    oskar_Mem* I = oskar_mem_create(type, OSKAR_CPU, num_sources, &status);
+    oskar_mem_set_value_real(I, 1.0, 0, num_sources, &status);
+    srand(3);
+    oskar_mem_random_range(l, -0.1, 0.1, &status);
+    oskar_mem_random_range(m, -0.1, 0.1, &status);
+    oskar_mem_random_range(n, -0.01, 0.0, &status);
+    oskar_mem_random_range(u, -1000.0, 1000.0, &status);
+    oskar_mem_random_range(v, -1000.0, 1000.0, &status);
+    oskar_mem_random_range(w, -100.0, 100.0, &status);
+
+    // Evaluate the first channel and the increment between channels.
+    oskar_evaluate_jones_K(K, num_sources, l, m, n, u, v, w,
+            freq_start_hz, I, -DBL_MAX, DBL_MAX, &status);
+    oskar_evaluate_jones_K(K_inc, num_sources, l, m, n, u, v, w,
+            freq_inc_hz, I, -DBL_MAX, DBL_MAX, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Rotate up to the last channel before the next direct evaluation.
+    for (int c = 1; c < num_channels; ++c)
+    {
+        oskar_mem_multiply(oskar_jones_mem(K), oskar_jones_mem(K),
+                oskar_jones_mem(K_inc), 0, 0, 0,
+                (size_t) num_stations * num_sources, &status);
+        oskar_evaluate_jones_K(K_ref, num_sources, l, m, n, u, v, w,
+                freq_start_hz + c * freq_inc_hz, I, -DBL_MAX, DBL_MAX, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        const double err = (type == OSKAR_DOUBLE) ?
+                max_abs_diff(oskar_jones_double2_const(K, &status),
+                        oskar_jones_double2_const(K_ref, &status),
+                        num_stations * num_sources) :
+                max_abs_diff(oskar_jones_float2_const(K, &status),
+                        oskar_jones_float2_const(K_ref, &status),
+                        num_stations * num_sources);
+        if (err > max_err) max_err = err;
+        ASSERT_LT(err, tol) << "Channel " << c;
+    }
+
+    printf("Jones K maximum drift after %d channels: %.3e\n",
+            num_channels - 1, max_err);
+    oskar_mem_free(l, &status);
+    oskar_mem_free(m, &status);
+    oskar_mem_free(n, &status);
+    oskar_mem_free(u, &status);
+    oskar_mem_free(v, &status);
+    oskar_mem_free(w, &status);
+    oskar_mem_free(I, &status);
+    oskar_jones_free(K, &status);
+    oskar_jones_free(K_inc, &status);
+    oskar_jones_free(K_ref, &status);
+}
+
+TEST(Jones_K, phase_rotation_drift_single)
+{
+    run_rotation_test(OSKAR_SINGLE, 32, 2e-4);
+}
+
+TEST(Jones_K, phase_rotation_drift_double)
+{
+    run_rotation_test(OSKAR_DOUBLE, 256, 1e-11);
+}
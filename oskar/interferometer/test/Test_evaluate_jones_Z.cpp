@@ -0,0 +1,265 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "convert/oskar_convert_geodetic_spherical_to_ecef.h"
+#include "convert/oskar_convert_relative_directions_to_enu_directions.h"
+#include "interferometer/oskar_evaluate_jones_Z.h"
+#include "math/oskar_cmath.h"
+#include "sky/oskar_evaluate_tec_tid.h"
+#include "telescope/station/oskar_evaluate_pierce_points.h"
+#include "utility/oskar_get_error_string.h"
+#include "utility/oskar_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static double rand_range(double min_val, double max_val)
+{
+    return min_val + (max_val - min_val) * rand() / (double)RAND_MAX;
+}
+
+/* Evaluates the TEC one station and one screen at a time, using the
+ * scalar pierce point and TID functions. */
+static void reference_tec(const oskar_Sky* sky, const oskar_Telescope* tel,
+        oskar_SettingsIonosphere* settings, double gast,
+        std::vector<double>& tec, int* status)
+{
+    const int num_sources = oskar_sky_num_sources(sky);
+    const int num_stations = oskar_telescope_num_stations(tel);
+    oskar_Mem *hor_x, *hor_y, *hor_z, *pp_lon, *pp_lat, *pp_path, *tec_s;
+    hor_x = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    hor_y = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    hor_z = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    pp_lon = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    pp_lat = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    pp_path = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    tec_s = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources, status);
+    double lon = oskar_telescope_lon_rad(tel);
+    double lat = oskar_telescope_lat_rad(tel);
+    double alt = oskar_telescope_alt_metres(tel);
+    double x_ref = 0.0, y_ref = 0.0, z_ref = 0.0;
+    oskar_convert_geodetic_spherical_to_ecef(1, &lon, &lat, &alt,
+            &x_ref, &y_ref, &z_ref);
+    const double* x = oskar_mem_double_const(
+            oskar_telescope_station_true_x_offset_ecef_metres_const(tel),
+            status);
+    const double* y = oskar_mem_double_const(
+            oskar_telescope_station_true_y_offset_ecef_metres_const(tel),
+            status);
+    const double* z = oskar_mem_double_const(
+            oskar_telescope_station_true_z_offset_ecef_metres_const(tel),
+            status);
+    tec.resize((size_t) num_stations * num_sources);
+    for (int s = 0; s < num_stations; ++s)
+    {
+        const oskar_Station* st = oskar_telescope_station_const(tel, s);
+        oskar_convert_relative_directions_to_enu_directions(0, 0, 0,
+                num_sources, oskar_sky_l_const(sky), oskar_sky_m_const(sky),
+                oskar_sky_n_const(sky), gast + oskar_station_lon_rad(st) -
+                oskar_sky_reference_ra_rad(sky),
+                oskar_sky_reference_dec_rad(sky), oskar_station_lat_rad(st),
+                0, hor_x, hor_y, hor_z, status);
+        double* t = &tec[(size_t) s * num_sources];
+        for (int j = 0; j < num_sources; ++j) t[j] = settings->TEC0;
+        for (int k = 0; k < settings->num_TID_screens; ++k)
+        {
+            oskar_SettingsTIDscreen* tid = &settings->TID[k];
+            oskar_evaluate_pierce_points(pp_lon, pp_lat, pp_path,
+                    x[s] + x_ref, y[s] + y_ref, z[s] + z_ref,
+                    tid->height_km * 1000.0, num_sources,
+                    hor_x, hor_y, hor_z, status);
+            oskar_evaluate_tec_tid(tec_s, num_sources, pp_lon, pp_lat,
+                    pp_path, settings->TEC0, tid, gast);
+            const double* p = oskar_mem_double_const(tec_s, status);
+            for (int j = 0; j < num_sources; ++j)
+                t[j] += p[j] - tid->num_components * settings->TEC0;
+        }
+        const double* h = oskar_mem_double_const(hor_z, status);
+        for (int j = 0; j < num_sources; ++j)
+            if (asin(h[j]) < settings->min_elevation) t[j] = 0.0;
+    }
+    oskar_mem_free(hor_x, status);
+    oskar_mem_free(hor_y, status);
+    oskar_mem_free(hor_z, status);
+    oskar_mem_free(pp_lon, status);
+    oskar_mem_free(pp_lat, status);
+    oskar_mem_free(pp_path, status);
+    oskar_mem_free(tec_s, status);
+}
+
+/* Creates a sky model covering the whole sky. */
+static oskar_Sky* create_sky(int prec, int num_sources, int* status)
+{
+    oskar_Sky* sky = oskar_sky_create(prec, OSKAR_CPU, num_sources, status);
+    srand(2);
+    for (int i = 0; i < num_sources; ++i)
+        oskar_sky_set_source(sky, i, rand_range(0.0, 2.0 * M_PI),
+                asin(rand_range(-1.0, 1.0)), 1.0, 0.0, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.0, 0.0, 0.0, status);
+    oskar_sky_evaluate_relative_directions(sky, 0.3, -0.5, status);
+    return sky;
+}
+
+/* Creates a telescope model with stations spread over 40 km. */
+static oskar_Telescope* create_telescope(int prec, int num_stations,
+        int* status)
+{
+    const double deg2rad = M_PI / 180.0;
+    oskar_Telescope* tel = oskar_telescope_create(prec, OSKAR_CPU, 0, status);
+    oskar_Mem *x = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_stations, status);
+    oskar_Mem *y = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_stations, status);
+    oskar_Mem *z = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_stations, status);
+    oskar_Mem *err = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_stations, status);
+    oskar_mem_clear_contents(err, status);
+    srand(3);
+    oskar_mem_random_range(x, -2e4, 2e4, status);
+    oskar_mem_random_range(y, -2e4, 2e4, status);
+    oskar_mem_random_range(z, -10.0, 10.0, status);
+    oskar_telescope_set_station_coords_enu(tel, 116.7 * deg2rad,
+            -26.8 * deg2rad, 300.0, num_stations, x, y, z,
+            err, err, err, status);
+    oskar_mem_free(x, status);
+    oskar_mem_free(y, status);
+    oskar_mem_free(z, status);
+    oskar_mem_free(err, status);
+    return tel;
+}
+
+/* Returns the maximum phase difference, in radians, between Z and the
+ * reference TEC values. */
+static double max_phase_error(const oskar_Jones* Z,
+        const std::vector<double>& tec, double frequency_hz, int* status)
+{
+    double max_err = 0.0;
+    oskar_Mem* z = oskar_mem_convert_precision(oskar_jones_mem_const(Z),
+            OSKAR_DOUBLE, status);
+    const double2* t = oskar_mem_double2_const(z, status);
+    const double factor = 25.0 * 299792458.0 / frequency_hz;
+    for (size_t i = 0; i < tec.size(); ++i)
+    {
+        const double re = cos(factor * tec[i]), im = sin(factor * tec[i]);
+        const double err = atan2(t[i].y * re - t[i].x * im,
+                t[i].x * re + t[i].y * im);
+        max_err = std::max(max_err, fabs(err));
+    }
+    oskar_mem_free(z, status);
+    return max_err;
+}
+
+TEST(evaluate_jones_Z, compare_reference)
+{
+    int status = 0;
+    const int num_sources = 2000, num_stations = 50;
+    const double deg2rad = M_PI / 180.0, gast = 1.2;
+    const double freq_hz[] = {100e6, 150e6};
+    srand(1);
+
+    /* Set up the ionosphere with two screens. */
+    oskar_SettingsIonosphere settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.enable = 1;
+    settings.min_elevation = 10.0 * deg2rad;
+    settings.TEC0 = 1.0;
+    settings.num_TID_screens = 2;
+    settings.TID = (oskar_SettingsTIDscreen*) calloc(2,
+            sizeof(oskar_SettingsTIDscreen));
+    const double height_km[] = {300.0, 450.0};
+    for (int k = 0; k < 2; ++k)
+    {
+        oskar_SettingsTIDscreen* tid = &settings.TID[k];
+        tid->height_km = height_km[k];
+        tid->num_components = 2 - k;
+        tid->amp = (double*) calloc(2, sizeof(double));
+        tid->wavelength = (double*) calloc(2, sizeof(double));
+        tid->speed = (double*) calloc(2, sizeof(double));
+        tid->theta = (double*) calloc(2, sizeof(double));
+        for (int c = 0; c < tid->num_components; ++c)
+        {
+            tid->amp[c] = rand_range(0.01, 0.1);
+            tid->wavelength[c] = rand_range(100.0, 500.0);
+            tid->speed[c] = rand_range(100.0, 300.0);
+            tid->theta[c] = rand_range(0.0, 360.0);
+        }
+    }
+
+    for (int p = 0; p < 2; ++p)
+    {
+        const int prec = p ? OSKAR_SINGLE : OSKAR_DOUBLE;
+
+        /* Create the models, and double precision copies for the
+         * reference. */
+        oskar_Sky* sky = create_sky(prec, num_sources, &status);
+        oskar_Sky* sky_d = create_sky(OSKAR_DOUBLE, num_sources, &status);
+        oskar_Telescope* tel = create_telescope(prec, num_stations, &status);
+        oskar_Telescope* tel_d = create_telescope(OSKAR_DOUBLE, num_stations,
+                &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        /* Evaluate the reference TEC. */
+        std::vector<double> tec;
+        oskar_Timer* tmr = oskar_timer_create(OSKAR_CPU);
+        oskar_timer_start(tmr);
+        reference_tec(sky_d, tel_d, &settings, gast, tec, &status);
+        const double t_ref = oskar_timer_elapsed(tmr);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        /* Check that some sources are masked, and some are not. */
+        size_t num_masked = 0;
+        for (size_t i = 0; i < tec.size(); ++i)
+            if (tec[i] == 0.0) num_masked++;
+        EXPECT_GT(num_masked, tec.size() / 4);
+        EXPECT_LT(num_masked, 3 * tec.size() / 4);
+
+        /* Evaluate the TEC once, and Jones Z at two frequencies. */
+        oskar_Jones* Z = oskar_jones_create(prec | OSKAR_COMPLEX, OSKAR_CPU,
+                num_stations, num_sources, &status);
+        oskar_WorkJonesZ* work = oskar_work_jones_z_create(prec, &status);
+        oskar_timer_start(tmr);
+        oskar_evaluate_jones_Z_tec(sky, tel, &settings, gast, work, &status);
+        printf("Pierce points and TEC (%s): %.3f sec (reference %.3f sec)\n",
+                p ? "single" : "double", oskar_timer_elapsed(tmr), t_ref);
+        const double tol = (prec == OSKAR_DOUBLE) ? 1e-10 : 1e-3;
+        for (int f = 0; f < 2; ++f)
+        {
+            oskar_evaluate_jones_Z_from_tec(Z, freq_hz[f], work, &status);
+            ASSERT_EQ(0, status) << oskar_get_error_string(status);
+            EXPECT_LT(max_phase_error(Z, tec, freq_hz[f], &status), tol);
+        }
+
+        /* Check the combined function gives the same result. */
+        oskar_Jones* Z2 = oskar_jones_create(prec | OSKAR_COMPLEX,
+                OSKAR_CPU, num_stations, num_sources, &status);
+        oskar_evaluate_jones_Z(Z2, sky, tel, &settings, gast, freq_hz[1],
+                work, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        EXPECT_EQ(0, memcmp(oskar_mem_void_const(oskar_jones_mem_const(Z)),
+                oskar_mem_void_const(oskar_jones_mem_const(Z2)),
+                oskar_mem_length(oskar_jones_mem_const(Z)) *
+                oskar_mem_element_size(prec | OSKAR_COMPLEX)));
+
+        /* Clean up. */
+        oskar_timer_free(tmr);
+        oskar_jones_free(Z, &status);
+        oskar_jones_free(Z2, &status);
+        oskar_work_jones_z_free(work, &status);
+        oskar_sky_free(sky, &status);
+        oskar_sky_free(sky_d, &status);
+        oskar_telescope_free(tel, &status);
+        oskar_telescope_free(tel_d, &status);
+    }
+    for (int k = 0; k < 2; ++k)
+    {
+        free(settings.TID[k].amp);
+        free(settings.TID[k].wavelength);
+        free(settings.TID[k].speed);
+        free(settings.TID[k].theta);
+    }
+    free(settings.TID);
+}
@@ -94,9 +94,6 @@ void oskar_fft_exec(oskar_FFT* h, oskar_Mem* data, int* status);
 OSKAR_EXPORT
 void oskar_fft_free(oskar_FFT* h);
 
-OSKAR_EXPORT
-void oskar_fft_set_ensure_consistent_norm(oskar_FFT* h, int value);
-
 #ifdef __cplusplus
 }
 #endif
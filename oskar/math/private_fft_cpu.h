@@ -0,0 +1,71 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_PRIVATE_FFT_CPU_H_
+#define OSKAR_PRIVATE_FFT_CPU_H_
+
+/**
+ * @file private_fft_cpu.h
+ *
+ * @details
+ * Multi-threaded complex-to-complex FFT for the CPU.
+ *
+ * One-dimensional transforms use a self-sorting (Stockham) mixed-radix
+ * algorithm, with dedicated butterflies for radix 2, 3, 4 and 5, so
+ * that all the sizes returned by oskar_imager_composite_nearest_even()
+ * are handled efficiently. Other prime factors fall back to a generic
+ * butterfly.
+ *
+ * Two-dimensional transforms are done by transforming rows in parallel,
+ * transposing the array in cache-sized blocks, transforming the rows
+ * again and transposing back, so that every 1D transform works on
+ * contiguous memory.
+ *
+ * All transforms are forward (negative exponent) and unnormalised.
+ */
+
+#include <oskar_global.h>
+#include <mem/oskar_mem.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct oskar_FFTCPU oskar_FFTCPU;
+
+/**
+ * @brief Creates a CPU FFT plan.
+ *
+ * @param[in] precision     Enumerated data type precision.
+ * @param[in] num_dim       Number of dimensions (1 or 2).
+ * @param[in] dim_size      The size of each dimension.
+ * @param[in] batch_size_1d Number of 1D transforms to do (if num_dim is 1).
+ * @param[in,out] status    Status return code.
+ */
+oskar_FFTCPU* oskar_fft_cpu_create(int precision, int num_dim, int dim_size,
+        int batch_size_1d, int* status);
+
+/**
+ * @brief Transforms data in-place using a CPU FFT plan.
+ *
+ * @details
+ * For 1D transforms, the data contain \p batch_size_1d consecutive
+ * transforms of length \p dim_size.
+ *
+ * @param[in] h          Handle to CPU FFT plan.
+ * @param[in,out] data   Complex data to transform, in CPU memory.
+ * @param[in,out] status Status return code.
+ */
+void oskar_fft_cpu_exec(oskar_FFTCPU* h, oskar_Mem* data, int* status);
+
+/**
+ * @brief Frees resources used by a CPU FFT plan.
+ *
+ * @param[in] h  Handle to CPU FFT plan.
+ */
+void oskar_fft_cpu_free(oskar_FFTCPU* h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_PRIVATE_FFT_CPU_H_ */
@@ -0,0 +1,223 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_PRIVATE_VECTOR_MATH_INLINE_H_
+#define OSKAR_PRIVATE_VECTOR_MATH_INLINE_H_
+
+/**
+ * @file private_vector_math_inline.h
+ *
+ * @details
+ * Branch-free versions of sin, cos and exp for use in CPU loops that
+ * should be vectorised by the compiler. Calls to the C library versions
+ * of these functions prevent vectorisation of the loop that contains them.
+ *
+ * The range reduction and polynomials follow the Cephes library. They are
+ * accurate to a few units in the last place over the ranges of arguments
+ * encountered in practice (for sin/cos, |x| < 1e8 in double precision,
+ * and |x| < 8192 in single precision). Results below the normal range
+ * of exp are flushed to zero.
+ */
+
+#include <oskar_global.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * These are written without calls to floor() and without conditional
+ * branches that guard floating-point operations: both would stop the
+ * compiler vectorising the loop unless -fno-trapping-math is used.
+ * Numbers are rounded to the nearest integer by adding and subtracting
+ * 1.5 * 2^52 (or 1.5 * 2^23), which also leaves the integer in the low
+ * bits of the sum.
+ */
+
+/* Double precision. */
+
+OSKAR_INLINE
+void oskar_vector_sincos_d(const double x, double* s, double* c)
+{
+    const double ax = x < 0.0 ? -x : x;
+    double y, z, zz, ps, pc, t;
+    unsigned long long q, bs, bc, bt, bx, swap;
+
+    /* Reduce to a quadrant: x = q * (pi/2) + z, with |z| <= pi/4. */
+    t = ax * 6.36619772367581343076E-1 + 6755399441055744.0; /* 2/pi */
+    memcpy(&q, &t, sizeof(double));
+    y = 2.0 * (t - 6755399441055744.0);
+    z = ((ax - y * 7.85398125648498535156E-1) -
+            y * 3.77489470793079817668E-8) - y * 2.69515142907905952645E-15;
+    zz = z * z;
+
+    /* Evaluate the polynomials for sin and cos in the first octant. */
+    ps = 1.58962301576546568060E-10;
+    ps = ps * zz - 2.50507477628578072866E-8;
+    ps = ps * zz + 2.75573136213857245213E-6;
+    ps = ps * zz - 1.98412698295895385996E-4;
+    ps = ps * zz + 8.33333333332211858878E-3;
+    ps = ps * zz - 1.66666666666666307295E-1;
+    ps = z + z * zz * ps;
+    pc = -1.13585365213876817300E-11;
+    pc = pc * zz + 2.08757008419747316778E-9;
+    pc = pc * zz - 2.75573141792967388112E-7;
+    pc = pc * zz + 2.48015872888517045348E-5;
+    pc = pc * zz - 1.38888888888730564116E-3;
+    pc = pc * zz + 4.16666666666665929218E-2;
+    pc = 1.0 - 0.5 * zz + zz * zz * pc;
+
+    /* Swap and correct signs according to the quadrant, using bit masks
+     * so that neither result is computed only under a condition. */
+    memcpy(&bs, &ps, sizeof(double));
+    memcpy(&bc, &pc, sizeof(double));
+    memcpy(&bx, &x, sizeof(double));
+    swap = 0ull - (q & 1);
+    bt = (bs & ~swap) | (bc & swap);
+    bc = (bc & ~swap) | (bs & swap);
+    bs = bt ^ ((q & 2) << 62) ^ (bx & 0x8000000000000000ull);
+    bc ^= ((q + 1) & 2) << 62;
+    memcpy(s, &bs, sizeof(double));
+    memcpy(c, &bc, sizeof(double));
+}
+
+OSKAR_INLINE
+double oskar_vector_sin_d(const double x)
+{
+    double s, c;
+    oskar_vector_sincos_d(x, &s, &c);
+    return s;
+}
+
+OSKAR_INLINE
+double oskar_vector_exp_d(const double x)
+{
+    double g, gg, n, p, q, t;
+    unsigned long long bits, mask;
+
+    /* Express exp(x) as exp(g + n * log(2)). */
+    t = x * 1.4426950408889634073599 + 6755399441055744.0; /* log2(e) */
+    n = t - 6755399441055744.0;
+    g = x - n * 6.93145751953125E-1;
+    g -= n * 1.42860682030941723212E-6;
+
+    /* Rational approximation for exp(g). */
+    gg = g * g;
+    p = 1.26177193074810590878E-4;
+    p = p * gg + 3.02994407707441961300E-2;
+    p = p * gg + 9.99999999999999999910E-1;
+    p *= g;
+    q = 3.00198505138664455042E-6;
+    q = q * gg + 2.52448340349684104192E-3;
+    q = q * gg + 2.27265548208155028766E-1;
+    q = q * gg + 2.00000000000000000009E0;
+    g = 1.0 + 2.0 * (p / (q - p));
+
+    /* Multiply by 2^n, placing n + 1023 in the exponent bits. */
+    t = n + (1023.0 + 6755399441055744.0);
+    memcpy(&bits, &t, sizeof(double));
+    bits <<= 52;
+    memcpy(&t, &bits, sizeof(double));
+    g *= t;
+
+    /* Flush to zero below the normal range, and overflow to infinity. */
+    memcpy(&bits, &g, sizeof(double));
+    mask = 0ull - (unsigned long long) (x >= -708.0);
+    bits &= mask;
+    mask = 0ull - (unsigned long long) (x > 709.0);
+    bits = (bits & ~mask) | (0x7FF0000000000000ull & mask);
+    memcpy(&g, &bits, sizeof(double));
+    return g;
+}
+
+/* Single precision. */
+
+OSKAR_INLINE
+void oskar_vector_sincos_f(const float x, float* s, float* c)
+{
+    const float ax = x < 0.0f ? -x : x;
+    float y, z, zz, ps, pc;
+    unsigned int q, bs, bc, bt, bx, swap;
+
+    /* Reduce to a quadrant: x = q * (pi/2) + z, with |z| <= pi/4. */
+    q = (unsigned int) (ax * 6.36619772367581343076E-1f + 0.5f); /* 2/pi */
+    y = (float) (2 * q);
+    z = ((ax - y * 0.78515625f) - y * 2.4187564849853515625e-4f) -
+            y * 3.77489497744594108e-8f;
+    zz = z * z;
+
+    /* Evaluate the polynomials for sin and cos in the first octant. */
+    ps = -1.9515295891E-4f;
+    ps = ps * zz + 8.3321608736E-3f;
+    ps = ps * zz - 1.6666654611E-1f;
+    ps = z + z * zz * ps;
+    pc = 2.443315711809948E-005f;
+    pc = pc * zz - 1.388731625493765E-003f;
+    pc = pc * zz + 4.166664568298827E-002f;
+    pc = 1.0f - 0.5f * zz + zz * zz * pc;
+
+    /* Swap and correct signs according to the quadrant. */
+    memcpy(&bs, &ps, sizeof(float));
+    memcpy(&bc, &pc, sizeof(float));
+    memcpy(&bx, &x, sizeof(float));
+    swap = 0u - (q & 1);
+    bt = (bs & ~swap) | (bc & swap);
+    bc = (bc & ~swap) | (bs & swap);
+    bs = bt ^ ((q & 2) << 30) ^ (bx & 0x80000000u);
+    bc ^= ((q + 1) & 2) << 30;
+    memcpy(s, &bs, sizeof(float));
+    memcpy(c, &bc, sizeof(float));
+}
+
+OSKAR_INLINE
+float oskar_vector_sin_f(const float x)
+{
+    float s, c;
+    oskar_vector_sincos_f(x, &s, &c);
+    return s;
+}
+
+OSKAR_INLINE
+float oskar_vector_exp_f(const float x)
+{
+    float g, gg, n, p, t;
+    unsigned int bits, mask;
+
+    /* Express exp(x) as exp(g + n * log(2)). */
+    t = x * 1.44269504088896341f + 12582912.0f; /* log2(e) */
+    n = t - 12582912.0f;
+    g = x - n * 0.693359375f;
+    g -= n * -2.12194440e-4f;
+
+    /* Polynomial approximation for exp(g). */
+    gg = g * g;
+    p = 1.9875691500E-4f;
+    p = p * g + 1.3981999507E-3f;
+    p = p * g + 8.3334519073E-3f;
+    p = p * g + 4.1665795894E-2f;
+    p = p * g + 1.6666665459E-1f;
+    p = p * g + 5.0000001201E-1f;
+    g = p * gg + g + 1.0f;
+
+    /* Multiply by 2^n, placing n + 127 in the exponent bits. */
+    t = n + (127.0f + 12582912.0f);
+    memcpy(&bits, &t, sizeof(float));
+    bits <<= 23;
+    memcpy(&t, &bits, sizeof(float));
+    g *= t;
+
+    /* Flush to zero below the normal range, and overflow to infinity. */
+    memcpy(&bits, &g, sizeof(float));
+    mask = 0u - (unsigned int) (x >= -87.0f);
+    bits &= mask;
+    mask = 0u - (unsigned int) (x > 88.0f);
+    bits = (bits & ~mask) | (0x7F800000u & mask);
+    memcpy(&g, &bits, sizeof(float));
+    return g;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_PRIVATE_VECTOR_MATH_INLINE_H_ */
@@ -29,12 +29,16 @@
 #ifdef OSKAR_HAVE_CUDA
 #include <cufft.h>
 #endif
+#ifdef OSKAR_HAVE_FFTW
+#include <fftw3.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#endif
 
 #include "math/oskar_fft.h"
-#include "math/oskar_fftpack_cfft.h"
-#include "math/oskar_fftpack_cfft_f.h"
+#include "math/private_fft_cpu.h"
 
-#include <math.h>
 #include <stdlib.h>
 
 #ifdef __cplusplus
@@ -43,18 +47,79 @@ extern "C" {
 
 struct oskar_FFT
 {
-    size_t num_cells_total;
-    oskar_Mem *fftpack_work, *fftpack_wsave;
-    int precision, location, num_dim, dim_size, ensure_consistent_norm;
+    int precision, location, num_dim, dim_size;
+    oskar_FFTCPU* cpu_plan;
+#ifdef OSKAR_HAVE_FFTW
+    fftw_plan fftw_plan_d;
+    fftwf_plan fftw_plan_f;
+#endif
 #ifdef OSKAR_HAVE_CUDA
     cufftHandle cufft_plan;
 #endif
 };
 
+#ifdef OSKAR_HAVE_FFTW
+static void fft_create_fftw(oskar_FFT* h, int batch_size_1d, int* status)
+{
+#if defined(OSKAR_HAVE_FFTW_THREADS) && defined(_OPENMP)
+    static int threads_initialised = 0;
+#endif
+    int dims[2], num_transforms;
+    size_t num_cells;
+    if (h->dim_size < 1 || (h->num_dim == 1 && batch_size_1d < 1))
+    {
+        *status = OSKAR_ERR_INVALID_ARGUMENT;
+        return;
+    }
+    num_transforms = (h->num_dim == 1) ? batch_size_1d : 1;
+    num_cells = (size_t) num_transforms * (size_t) h->dim_size *
+            (h->num_dim == 2 ? (size_t) h->dim_size : 1);
+    dims[0] = dims[1] = h->dim_size;
+
+    /* Only the FFTW execute functions are thread-safe, so set-up and
+     * planning must not happen in more than one thread at once. */
+#pragma omp critical (fft_create_fftw)
+    {
+#if defined(OSKAR_HAVE_FFTW_THREADS) && defined(_OPENMP)
+        if (!threads_initialised)
+        {
+            fftw_init_threads();
+            fftwf_init_threads();
+            threads_initialised = 1;
+        }
+        fftw_plan_with_nthreads(omp_get_max_threads());
+        fftwf_plan_with_nthreads(omp_get_max_threads());
+#endif
+
+        /* Plan an in-place transform. Planning with FFTW_ESTIMATE does not
+         * touch the data, so the array is only needed to set the layout. */
+        if (h->precision == OSKAR_DOUBLE)
+        {
+            fftw_complex* t = fftw_alloc_complex(num_cells);
+            h->fftw_plan_d = fftw_plan_many_dft(h->num_dim, dims,
+                    num_transforms, t, 0, 1, (int) (num_cells / num_transforms),
+                    t, 0, 1, (int) (num_cells / num_transforms),
+                    FFTW_FORWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+            fftw_free(t);
+        }
+        else
+        {
+            fftwf_complex* t = fftwf_alloc_complex(num_cells);
+            h->fftw_plan_f = fftwf_plan_many_dft(h->num_dim, dims,
+                    num_transforms, t, 0, 1, (int) (num_cells / num_transforms),
+                    t, 0, 1, (int) (num_cells / num_transforms),
+                    FFTW_FORWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+            fftwf_free(t);
+        }
+    }
+    if (!h->fftw_plan_d && !h->fftw_plan_f)
+        *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
+}
+#endif
+
 oskar_FFT* oskar_fft_create(int precision, int location, int num_dim,
         int dim_size, int batch_size_1d, int* status)
 {
-    int i;
     oskar_FFT* h = (oskar_FFT*) calloc(1, sizeof(oskar_FFT));
 #ifndef OSKAR_HAVE_CUDA
     if (location == OSKAR_GPU) location = OSKAR_CPU;
@@ -66,32 +131,17 @@ oskar_FFT* oskar_fft_create(int precision, int location, int num_dim,
     h->location = location;
     h->num_dim = num_dim;
     h->dim_size = dim_size;
-    h->ensure_consistent_norm = 1;
-    h->num_cells_total = (size_t) dim_size;
-    for (i = 1; i < num_dim; ++i) h->num_cells_total *= (size_t) dim_size;
     if (location == OSKAR_CPU)
     {
-        int len = 4 * dim_size +
-                2 * (int)(log((double)dim_size) / log(2.0)) + 8;
-        h->fftpack_wsave = oskar_mem_create(precision, location, len, status);
-        if (num_dim == 1)
-        {
-            (void) batch_size_1d;
-            *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
-        }
-        else if (num_dim == 2)
-        {
-            if (precision == OSKAR_DOUBLE)
-                oskar_fftpack_cfft2i(dim_size, dim_size,
-                        oskar_mem_double(h->fftpack_wsave, status));
-            else
-                oskar_fftpack_cfft2i_f(dim_size, dim_size,
-                        oskar_mem_float(h->fftpack_wsave, status));
-        }
+#ifdef OSKAR_HAVE_FFTW
+        if (num_dim == 1 || num_dim == 2)
+            fft_create_fftw(h, batch_size_1d, status);
         else
             *status = OSKAR_ERR_INVALID_ARGUMENT;
-        h->fftpack_work = oskar_mem_create(precision, location,
-                2 * h->num_cells_total, status);
+#else
+        h->cpu_plan = oskar_fft_cpu_create(precision, num_dim, dim_size,
+                batch_size_1d, status);
+#endif
     }
     else if (location == OSKAR_GPU)
     {
@@ -128,27 +178,20 @@ void oskar_fft_exec(oskar_FFT* h, oskar_Mem* data, int* status)
     }
     if (h->location == OSKAR_CPU)
     {
-        if (h->num_dim == 1)
-        {
-            *status = OSKAR_ERR_FUNCTION_NOT_AVAILABLE;
-        }
-        else if (h->num_dim == 2)
-        {
-            if (h->precision == OSKAR_DOUBLE)
-                oskar_fftpack_cfft2f(h->dim_size, h->dim_size, h->dim_size,
-                        oskar_mem_double(data_ptr, status),
-                        oskar_mem_double(h->fftpack_wsave, status),
-                        oskar_mem_double(h->fftpack_work, status));
-            else
-                oskar_fftpack_cfft2f_f(h->dim_size, h->dim_size, h->dim_size,
-                        oskar_mem_float(data_ptr, status),
-                        oskar_mem_float(h->fftpack_wsave, status),
-                        oskar_mem_float(h->fftpack_work, status));
-            /* This step not needed for W-kernel generation, so turn it off. */
-            if (h->ensure_consistent_norm)
-                oskar_mem_scale_real(data_ptr, (double)h->num_cells_total,
-                        0, h->num_cells_total, status);
-        }
+        /* CPU transforms are unnormalised, as with cuFFT, so the
+         * normalisation is consistent without any further scaling. */
+#ifdef OSKAR_HAVE_FFTW
+        if (h->precision == OSKAR_DOUBLE && h->fftw_plan_d)
+            fftw_execute_dft(h->fftw_plan_d,
+                    (fftw_complex*) oskar_mem_void(data_ptr),
+                    (fftw_complex*) oskar_mem_void(data_ptr));
+        else if (h->precision == OSKAR_SINGLE && h->fftw_plan_f)
+            fftwf_execute_dft(h->fftw_plan_f,
+                    (fftwf_complex*) oskar_mem_void(data_ptr),
+                    (fftwf_complex*) oskar_mem_void(data_ptr));
+#else
+        oskar_fft_cpu_exec(h->cpu_plan, data_ptr, status);
+#endif
     }
     else if (h->location == OSKAR_GPU)
     {
@@ -174,10 +217,12 @@ void oskar_fft_exec(oskar_FFT* h, oskar_Mem* data, int* status)
 
 void oskar_fft_free(oskar_FFT* h)
 {
-    int status = 0;
     if (!h) return;
-    oskar_mem_free(h->fftpack_work, &status);
-    oskar_mem_free(h->fftpack_wsave, &status);
+    oskar_fft_cpu_free(h->cpu_plan);
+#ifdef OSKAR_HAVE_FFTW
+    if (h->fftw_plan_d) fftw_destroy_plan(h->fftw_plan_d);
+    if (h->fftw_plan_f) fftwf_destroy_plan(h->fftw_plan_f);
+#endif
 #ifdef OSKAR_HAVE_CUDA
     if (h->location == OSKAR_GPU)
         cufftDestroy(h->cufft_plan);
@@ -185,11 +230,6 @@ void oskar_fft_free(oskar_FFT* h)
     free(h);
 }
 
-void oskar_fft_set_ensure_consistent_norm(oskar_FFT* h, int value)
-{
-    h->ensure_consistent_norm = value;
-}
-
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,472 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "math/private_fft_cpu.h"
+#include "utility/oskar_kernel_macros.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327950288
+#endif
+
+/* Vectorise the loops of butterflies using OpenMP 4.0, if available. */
+#if defined(_OPENMP) && _OPENMP >= 201307
+#define FFT_SIMD DO_PRAGMA(omp simd)
+#else
+#define FFT_SIMD
+#endif
+
+/* Maximum number of stages: one per factor of the transform size. */
+#define FFT_MAX_STAGES 32
+
+/* Side length of the blocks at which the recursive transpose stops. */
+#define FFT_TRANSPOSE_LEAF 16
+
+/* Side length of the blocks shared out between threads in the transpose. */
+#define FFT_TRANSPOSE_TILE 256
+
+struct oskar_FFTCPU
+{
+    int precision, num_dim, dim_size, batch_size_1d, num_stages;
+    int radix[FFT_MAX_STAGES];
+    size_t twiddle_offset[FFT_MAX_STAGES];
+    oskar_Mem* twiddles;
+};
+
+template<typename REAL>
+struct FFTComplex
+{
+    REAL re, im;
+};
+
+/*
+ * Each stage of the Stockham algorithm takes a set of s interleaved
+ * transforms of length (radix * m) from x, does a butterfly of the given
+ * radix on each, and writes s * radix interleaved transforms of length m
+ * to y, applying the twiddle factors. Element (q, p) of the butterfly
+ * with inputs x[q + s * (p + k * m)] writes its outputs to
+ * y[q + s * (radix * p + j)]. Complex numbers are stored as pairs of reals,
+ * so indices below are in units of REAL.
+ */
+template<int RADIX, typename REAL>
+static inline void fft_butterfly(const int in, const int in_step,
+        const int out, const int out_step, const REAL* RESTRICT w,
+        const REAL* RESTRICT x, REAL* RESTRICT y)
+{
+    if (RADIX == 2)
+    {
+        const REAL a0r = x[in], a0i = x[in + 1];
+        const REAL a1r = x[in + in_step], a1i = x[in + in_step + 1];
+        const REAL b1r = a0r - a1r, b1i = a0i - a1i;
+        y[out]                = a0r + a1r;
+        y[out + 1]            = a0i + a1i;
+        y[out + out_step]     = b1r * w[0] - b1i * w[1];
+        y[out + out_step + 1] = b1r * w[1] + b1i * w[0];
+    }
+    else if (RADIX == 3)
+    {
+        const REAL c = (REAL) -0.5;
+        const REAL s = (REAL) -0.86602540378443864676; /* -sin(2 pi / 3) */
+        const REAL a0r = x[in], a0i = x[in + 1];
+        const REAL a1r = x[in + in_step], a1i = x[in + in_step + 1];
+        const REAL a2r = x[in + 2 * in_step], a2i = x[in + 2 * in_step + 1];
+        const REAL tr = a1r + a2r, ti = a1i + a2i;
+        const REAL dr = s * (a1r - a2r), di = s * (a1i - a2i);
+        const REAL ur = a0r + c * tr, ui = a0i + c * ti;
+        const REAL b1r = ur - di, b1i = ui + dr;
+        const REAL b2r = ur + di, b2i = ui - dr;
+        y[out]                    = a0r + tr;
+        y[out + 1]                = a0i + ti;
+        y[out + out_step]         = b1r * w[0] - b1i * w[1];
+        y[out + out_step + 1]     = b1r * w[1] + b1i * w[0];
+        y[out + 2 * out_step]     = b2r * w[2] - b2i * w[3];
+        y[out + 2 * out_step + 1] = b2r * w[3] + b2i * w[2];
+    }
+    else if (RADIX == 4)
+    {
+        const REAL a0r = x[in], a0i = x[in + 1];
+        const REAL a1r = x[in + in_step], a1i = x[in + in_step + 1];
+        const REAL a2r = x[in + 2 * in_step], a2i = x[in + 2 * in_step + 1];
+        const REAL a3r = x[in + 3 * in_step], a3i = x[in + 3 * in_step + 1];
+        const REAL t0r = a0r + a2r, t0i = a0i + a2i;
+        const REAL t1r = a0r - a2r, t1i = a0i - a2i;
+        const REAL t2r = a1r + a3r, t2i = a1i + a3i;
+        const REAL t3r = a1i - a3i, t3i = a3r - a1r; /* -i * (a1 - a3) */
+        const REAL b1r = t1r + t3r, b1i = t1i + t3i;
+        const REAL b2r = t0r - t2r, b2i = t0i - t2i;
+        const REAL b3r = t1r - t3r, b3i = t1i - t3i;
+        y[out]                    = t0r + t2r;
+        y[out + 1]                = t0i + t2i;
+        y[out + out_step]         = b1r * w[0] - b1i * w[1];
+        y[out + out_step + 1]     = b1r * w[1] + b1i * w[0];
+        y[out + 2 * out_step]     = b2r * w[2] - b2i * w[3];
+        y[out + 2 * out_step + 1] = b2r * w[3] + b2i * w[2];
+        y[out + 3 * out_step]     = b3r * w[4] - b3i * w[5];
+        y[out + 3 * out_step + 1] = b3r * w[5] + b3i * w[4];
+    }
+    else if (RADIX == 5)
+    {
+        const REAL c1 = (REAL) 0.30901699437494742410;  /* cos(2 pi / 5) */
+        const REAL c2 = (REAL) -0.80901699437494742410; /* cos(4 pi / 5) */
+        const REAL s1 = (REAL) 0.95105651629515357212;  /* sin(2 pi / 5) */
+        const REAL s2 = (REAL) 0.58778525229247312917;  /* sin(4 pi / 5) */
+        const REAL a0r = x[in], a0i = x[in + 1];
+        const REAL a1r = x[in + in_step], a1i = x[in + in_step + 1];
+        const REAL a2r = x[in + 2 * in_step], a2i = x[in + 2 * in_step + 1];
+        const REAL a3r = x[in + 3 * in_step], a3i = x[in + 3 * in_step + 1];
+        const REAL a4r = x[in + 4 * in_step], a4i = x[in + 4 * in_step + 1];
+        const REAL t1r = a1r + a4r, t1i = a1i + a4i;
+        const REAL t2r = a2r + a3r, t2i = a2i + a3i;
+        const REAL t3r = a1r - a4r, t3i = a1i - a4i;
+        const REAL t4r = a2r - a3r, t4i = a2i - a3i;
+        const REAL u1r = a0r + c1 * t1r + c2 * t2r;
+        const REAL u1i = a0i + c1 * t1i + c2 * t2i;
+        const REAL u2r = a0r + c2 * t1r + c1 * t2r;
+        const REAL u2i = a0i + c2 * t1i + c1 * t2i;
+        const REAL v1r = s1 * t3r + s2 * t4r, v1i = s1 * t3i + s2 * t4i;
+        const REAL v2r = s2 * t3r - s1 * t4r, v2i = s2 * t3i - s1 * t4i;
+        const REAL b1r = u1r + v1i, b1i = u1i - v1r; /* u1 - i * v1 */
+        const REAL b2r = u2r + v2i, b2i = u2i - v2r; /* u2 - i * v2 */
+        const REAL b3r = u2r - v2i, b3i = u2i + v2r; /* u2 + i * v2 */
+        const REAL b4r = u1r - v1i, b4i = u1i + v1r; /* u1 + i * v1 */
+        y[out]                    = a0r + t1r + t2r;
+        y[out + 1]                = a0i + t1i + t2i;
+        y[out + out_step]         = b1r * w[0] - b1i * w[1];
+        y[out + out_step + 1]     = b1r * w[1] + b1i * w[0];
+        y[out + 2 * out_step]     = b2r * w[2] - b2i * w[3];
+        y[out + 2 * out_step + 1] = b2r * w[3] + b2i * w[2];
+        y[out + 3 * out_step]     = b3r * w[4] - b3i * w[5];
+        y[out + 3 * out_step + 1] = b3r * w[5] + b3i * w[4];
+        y[out + 4 * out_step]     = b4r * w[6] - b4i * w[7];
+        y[out + 4 * out_step + 1] = b4r * w[7] + b4i * w[6];
+    }
+}
+
+template<int RADIX, typename REAL>
+static void fft_stage(const int m, const int s, const REAL* RESTRICT tw,
+        const REAL* RESTRICT x, REAL* RESTRICT y)
+{
+    const int in_step = 2 * s * m, out_step = 2 * s;
+    if (s >= 4)
+    {
+        /* Vectorise over the interleaved transforms. */
+        for (int p = 0; p < m; ++p)
+        {
+            const REAL* RESTRICT w = tw + 2 * (RADIX - 1) * p;
+            FFT_SIMD
+            for (int q = 0; q < s; ++q)
+                fft_butterfly<RADIX, REAL>(2 * (q + s * p), in_step,
+                        2 * (q + s * RADIX * p), out_step, w, x, y);
+        }
+    }
+    else
+    {
+        /* Vectorise over the butterflies in each transform. */
+        for (int q = 0; q < s; ++q)
+        {
+            FFT_SIMD
+            for (int p = 0; p < m; ++p)
+                fft_butterfly<RADIX, REAL>(2 * (q + s * p), in_step,
+                        2 * (q + s * RADIX * p), out_step,
+                        tw + 2 * (RADIX - 1) * p, x, y);
+        }
+    }
+}
+
+/* Butterfly for any other radix, using the radix-th roots of unity
+ * stored after the twiddle factors. */
+template<typename REAL>
+static void fft_stage_generic(const int radix, const int m, const int s,
+        const REAL* RESTRICT tw, const REAL* RESTRICT x, REAL* RESTRICT y)
+{
+    const REAL* RESTRICT roots = tw + 2 * (radix - 1) * m;
+    for (int p = 0; p < m; ++p)
+    {
+        const REAL* RESTRICT w = tw + 2 * (radix - 1) * p;
+        for (int q = 0; q < s; ++q)
+        {
+            for (int j = 0; j < radix; ++j)
+            {
+                REAL br = (REAL) 0, bi = (REAL) 0;
+                for (int k = 0; k < radix; ++k)
+                {
+                    const int i = 2 * (q + s * (p + k * m));
+                    const int r = 2 * ((j * k) % radix);
+                    br += x[i] * roots[r] - x[i + 1] * roots[r + 1];
+                    bi += x[i] * roots[r + 1] + x[i + 1] * roots[r];
+                }
+                const int o = 2 * (q + s * (radix * p + j));
+                if (j == 0)
+                {
+                    y[o] = br;
+                    y[o + 1] = bi;
+                }
+                else
+                {
+                    y[o]     = br * w[2 * (j - 1)] - bi * w[2 * (j - 1) + 1];
+                    y[o + 1] = br * w[2 * (j - 1) + 1] + bi * w[2 * (j - 1)];
+                }
+            }
+        }
+    }
+}
+
+/* Transforms one contiguous array of length n, using work of the same size. */
+template<typename REAL>
+static void fft_1d(const oskar_FFTCPU* h, const REAL* RESTRICT tw,
+        REAL* RESTRICT data, REAL* RESTRICT work)
+{
+    REAL *x = data, *y = work, *t;
+    int m = h->dim_size, s = 1;
+    for (int i = 0; i < h->num_stages; ++i)
+    {
+        const int radix = h->radix[i];
+        const REAL* w = tw + 2 * h->twiddle_offset[i];
+        m /= radix;
+        switch (radix)
+        {
+        case 2:  fft_stage<2, REAL>(m, s, w, x, y); break;
+        case 3:  fft_stage<3, REAL>(m, s, w, x, y); break;
+        case 4:  fft_stage<4, REAL>(m, s, w, x, y); break;
+        case 5:  fft_stage<5, REAL>(m, s, w, x, y); break;
+        default: fft_stage_generic<REAL>(radix, m, s, w, x, y); break;
+        }
+        s *= radix;
+        t = x; x = y; y = t;
+    }
+    if (x != data)
+        memcpy(data, x, 2 * h->dim_size * sizeof(REAL));
+}
+
+/*
+ * Swaps block a[i0:i1, j0:j1] with the transpose of block a[j0:j1, i0:i1]
+ * by recursively halving the longer side, so the blocks fit in cache
+ * at some level whatever its size. If the blocks are on the diagonal,
+ * only one triangle is swapped with the other.
+ */
+template<typename T>
+static void fft_transpose_block(T* RESTRICT a, const size_t n,
+        const int i0, const int i1, const int j0, const int j1)
+{
+    const int di = i1 - i0, dj = j1 - j0;
+    if (i0 == j0 && i1 == j1)
+    {
+        if (di <= FFT_TRANSPOSE_LEAF)
+        {
+            for (int i = i0; i < i1; ++i)
+                for (int j = i + 1; j < j1; ++j)
+                {
+                    const T t = a[i * n + j];
+                    a[i * n + j] = a[j * n + i];
+                    a[j * n + i] = t;
+                }
+            return;
+        }
+        const int mid = i0 + di / 2;
+        fft_transpose_block(a, n, i0, mid, i0, mid);
+        fft_transpose_block(a, n, i0, mid, mid, i1);
+        fft_transpose_block(a, n, mid, i1, mid, i1);
+    }
+    else if (di <= FFT_TRANSPOSE_LEAF && dj <= FFT_TRANSPOSE_LEAF)
+    {
+        for (int i = i0; i < i1; ++i)
+            for (int j = j0; j < j1; ++j)
+            {
+                const T t = a[i * n + j];
+                a[i * n + j] = a[j * n + i];
+                a[j * n + i] = t;
+            }
+    }
+    else if (di >= dj)
+    {
+        fft_transpose_block(a, n, i0, i0 + di / 2, j0, j1);
+        fft_transpose_block(a, n, i0 + di / 2, i1, j0, j1);
+    }
+    else
+    {
+        fft_transpose_block(a, n, i0, i1, j0, j0 + dj / 2);
+        fft_transpose_block(a, n, i0, i1, j0 + dj / 2, j1);
+    }
+}
+
+/* Transposes a square array in-place. Must be called by all threads. */
+template<typename T>
+static void fft_transpose(T* RESTRICT a, const int n)
+{
+    const int num_tiles = (n + FFT_TRANSPOSE_TILE - 1) / FFT_TRANSPOSE_TILE;
+#pragma omp for schedule(dynamic, 1)
+    for (int k = 0; k < num_tiles * num_tiles; ++k)
+    {
+        const int ti = k / num_tiles, tj = k % num_tiles;
+        if (tj < ti) continue;
+        const int i0 = ti * FFT_TRANSPOSE_TILE, j0 = tj * FFT_TRANSPOSE_TILE;
+        const int i1 = (i0 + FFT_TRANSPOSE_TILE < n) ?
+                i0 + FFT_TRANSPOSE_TILE : n;
+        const int j1 = (j0 + FFT_TRANSPOSE_TILE < n) ?
+                j0 + FFT_TRANSPOSE_TILE : n;
+        fft_transpose_block(a, (size_t) n, i0, i1, j0, j1);
+    }
+}
+
+template<typename REAL>
+static void fft_exec(const oskar_FFTCPU* h, const REAL* RESTRICT tw,
+        REAL* RESTRICT data, int* status)
+{
+    const int n = h->dim_size;
+    const int num_rows = (h->num_dim == 1) ? h->batch_size_1d : n;
+    const int num_passes = (h->num_dim == 1) ? 1 : 2;
+    int num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+
+    /* Allocate work space for each thread. */
+    REAL* work_all = (REAL*) malloc(
+            2 * (size_t) n * num_threads * sizeof(REAL));
+    if (!work_all)
+    {
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+#pragma omp parallel num_threads(num_threads)
+    {
+        int thread_id = 0;
+#ifdef _OPENMP
+        thread_id = omp_get_thread_num();
+#endif
+        REAL* work = work_all + 2 * (size_t) n * thread_id;
+        for (int pass = 0; pass < num_passes; ++pass)
+        {
+#pragma omp for schedule(static)
+            for (int row = 0; row < num_rows; ++row)
+                fft_1d<REAL>(h, tw, data + 2 * (size_t) n * row, work);
+
+            /* Transform the columns as rows of the transposed array. */
+            if (h->num_dim == 2)
+                fft_transpose((FFTComplex<REAL>*) data, n);
+        }
+    }
+    free(work_all);
+}
+
+template<typename REAL>
+static void fft_twiddles(oskar_FFTCPU* h, REAL* tw)
+{
+    int len = h->dim_size;
+    for (int i = 0; i < h->num_stages; ++i)
+    {
+        const int radix = h->radix[i], m = len / radix;
+        REAL* w = tw + 2 * h->twiddle_offset[i];
+        for (int p = 0; p < m; ++p)
+        {
+            for (int j = 1; j < radix; ++j, w += 2)
+            {
+                const double a = -2.0 * M_PI *
+                        (double) (((long long) j * p) % len) / len;
+                w[0] = (REAL) cos(a);
+                w[1] = (REAL) sin(a);
+            }
+        }
+        if (radix > 5)
+        {
+            for (int k = 0; k < radix; ++k, w += 2)
+            {
+                const double a = -2.0 * M_PI * k / radix;
+                w[0] = (REAL) cos(a);
+                w[1] = (REAL) sin(a);
+            }
+        }
+        len = m;
+    }
+}
+
+extern "C" {
+
+oskar_FFTCPU* oskar_fft_cpu_create(int precision, int num_dim, int dim_size,
+        int batch_size_1d, int* status)
+{
+    oskar_FFTCPU* h = 0;
+    size_t num_twiddles = 0;
+    int len, factor = 4;
+    if (*status) return 0;
+    if ((num_dim != 1 && num_dim != 2) || dim_size < 1 ||
+            (num_dim == 1 && batch_size_1d < 1))
+    {
+        *status = OSKAR_ERR_INVALID_ARGUMENT;
+        return 0;
+    }
+    if (precision != OSKAR_DOUBLE && precision != OSKAR_SINGLE)
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return 0;
+    }
+    h = (oskar_FFTCPU*) calloc(1, sizeof(oskar_FFTCPU));
+    h->precision = precision;
+    h->num_dim = num_dim;
+    h->dim_size = dim_size;
+    h->batch_size_1d = batch_size_1d;
+
+    /* Factorise the length, using radix 4 where possible. */
+    for (len = dim_size; len > 1;)
+    {
+        while (len % factor != 0)
+            factor = (factor == 4) ? 2 : (factor == 2 ? 3 : factor + 2);
+        h->twiddle_offset[h->num_stages] = num_twiddles;
+        h->radix[h->num_stages++] = factor;
+        len /= factor;
+        num_twiddles += (size_t) len * (factor - 1);
+        if (factor > 5) num_twiddles += factor;
+    }
+
+    /* Generate the twiddle factors for each stage. */
+    h->twiddles = oskar_mem_create(precision | OSKAR_COMPLEX, OSKAR_CPU,
+            num_twiddles, status);
+    if (precision == OSKAR_DOUBLE)
+        fft_twiddles(h, oskar_mem_double(h->twiddles, status));
+    else
+        fft_twiddles(h, oskar_mem_float(h->twiddles, status));
+    return h;
+}
+
+void oskar_fft_cpu_exec(oskar_FFTCPU* h, oskar_Mem* data, int* status)
+{
+    if (*status) return;
+    if (oskar_mem_location(data) != OSKAR_CPU)
+    {
+        *status = OSKAR_ERR_BAD_LOCATION;
+        return;
+    }
+    if (oskar_mem_type(data) != (h->precision | OSKAR_COMPLEX))
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return;
+    }
+    const size_t num_rows = (h->num_dim == 1) ?
+            (size_t) h->batch_size_1d : (size_t) h->dim_size;
+    if (oskar_mem_length(data) < num_rows * (size_t) h->dim_size)
+    {
+        *status = OSKAR_ERR_DIMENSION_MISMATCH;
+        return;
+    }
+    if (h->precision == OSKAR_DOUBLE)
+        fft_exec(h, oskar_mem_double_const(h->twiddles, status),
+                oskar_mem_double(data, status), status);
+    else
+        fft_exec(h, oskar_mem_float_const(h->twiddles, status),
+                oskar_mem_float(data, status), status);
+}
+
+void oskar_fft_cpu_free(oskar_FFTCPU* h)
+{
+    int status = 0;
+    if (!h) return;
+    oskar_mem_free(h->twiddles, &status);
+    free(h);
+}
+
+} /* extern "C" */
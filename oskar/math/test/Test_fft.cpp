@@ -0,0 +1,157 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "math/oskar_cmath.h"
+#include "math/oskar_fft.h"
+#include "math/oskar_fftpack_cfft.h"
+#include "utility/oskar_get_error_string.h"
+#include "utility/oskar_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+static void fill_random(oskar_Mem* data, int* status)
+{
+    const size_t len = 2 * oskar_mem_length(data);
+    if (oskar_mem_precision(data) == OSKAR_DOUBLE)
+    {
+        double* p = oskar_mem_double(data, status);
+        for (size_t i = 0; i < len; ++i) p[i] = rand() / (double)RAND_MAX;
+    }
+    else
+    {
+        float* p = oskar_mem_float(data, status);
+        for (size_t i = 0; i < len; ++i) p[i] = rand() / (float)RAND_MAX;
+    }
+}
+
+/* Returns the maximum error, relative to the maximum output value,
+ * of the FFT of "in" compared with a direct evaluation of the DFT. */
+static double check_dft(int num_dim, int n, int batch,
+        const oskar_Mem* in, const oskar_Mem* out, int* status)
+{
+    const int ny = (num_dim == 2) ? n : 1;
+    const int num_rows = (num_dim == 2) ? 1 : batch;
+    double max_err = 0.0, max_val = 0.0;
+    oskar_Mem* in_d = oskar_mem_convert_precision(in, OSKAR_DOUBLE, status);
+    oskar_Mem* out_d = oskar_mem_convert_precision(out, OSKAR_DOUBLE, status);
+    const double* a = oskar_mem_double_const(in_d, status);
+    const double* b = oskar_mem_double_const(out_d, status);
+    for (int r = 0; r < num_rows; ++r)
+    {
+        const size_t off = (size_t) r * n * ny;
+        for (int ky = 0; ky < ny; ++ky)
+        {
+            for (int kx = 0; kx < n; ++kx)
+            {
+                double re = 0.0, im = 0.0;
+                for (int y = 0; y < ny; ++y)
+                {
+                    for (int x = 0; x < n; ++x)
+                    {
+                        const double arg = -2.0 * M_PI * (
+                                (double) ((kx * x) % n) / n +
+                                (double) ((ky * y) % ny) / ny);
+                        const double* t = &a[2 * (off + y * n + x)];
+                        re += t[0] * cos(arg) - t[1] * sin(arg);
+                        im += t[0] * sin(arg) + t[1] * cos(arg);
+                    }
+                }
+                const double* t = &b[2 * (off + ky * n + kx)];
+                max_err = std::max(max_err,
+                        std::max(fabs(t[0] - re), fabs(t[1] - im)));
+                max_val = std::max(max_val, sqrt(re * re + im * im));
+            }
+        }
+    }
+    oskar_mem_free(in_d, status);
+    oskar_mem_free(out_d, status);
+    return max_err / max_val;
+}
+
+static void run_test(int prec, int num_dim, int n, int batch, double tol)
+{
+    int status = 0;
+    const size_t len = (size_t) n * (num_dim == 2 ? n : batch);
+    oskar_Mem* in = oskar_mem_create(prec | OSKAR_COMPLEX, OSKAR_CPU,
+            len, &status);
+    fill_random(in, &status);
+    oskar_Mem* data = oskar_mem_create_copy(in, OSKAR_CPU, &status);
+    oskar_FFT* fft = oskar_fft_create(prec, OSKAR_CPU, num_dim, n, batch,
+            &status);
+    oskar_fft_exec(fft, data, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    EXPECT_LT(check_dft(num_dim, n, batch, in, data, &status), tol) <<
+            "num_dim = " << num_dim << ", size = " << n;
+    oskar_fft_free(fft);
+    oskar_mem_free(in, &status);
+    oskar_mem_free(data, &status);
+}
+
+TEST(fft, 1d_batch)
+{
+    const int sizes[] = {1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 15, 16, 30, 49,
+            64, 100, 120, 143, 250, 256, 360};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(int); ++i)
+    {
+        run_test(OSKAR_DOUBLE, 1, sizes[i], 3, 1e-14);
+        run_test(OSKAR_SINGLE, 1, sizes[i], 3, 5e-6);
+    }
+}
+
+TEST(fft, 2d)
+{
+    const int sizes[] = {1, 2, 6, 16, 30, 36, 50, 60};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(int); ++i)
+    {
+        run_test(OSKAR_DOUBLE, 2, sizes[i], 0, 1e-14);
+        run_test(OSKAR_SINGLE, 2, sizes[i], 0, 5e-6);
+    }
+}
+
+TEST(fft, 2d_compare_fftpack)
+{
+    int status = 0;
+    const int n = 1536;
+    const size_t num_cells = (size_t) n * n;
+    oskar_Mem* data = oskar_mem_create(OSKAR_DOUBLE_COMPLEX, OSKAR_CPU,
+            num_cells, &status);
+    fill_random(data, &status);
+    oskar_Mem* data_ref = oskar_mem_create_copy(data, OSKAR_CPU, &status);
+    oskar_Timer* tmr = oskar_timer_create(OSKAR_CPU);
+
+    /* Transform with FFTPACK. */
+    const int len = 4 * n + 2 * (int)(log((double)n) / log(2.0)) + 8;
+    double* wsave = (double*) calloc(len, sizeof(double));
+    double* work = (double*) calloc(2 * num_cells, sizeof(double));
+    double* ref = oskar_mem_double(data_ref, &status);
+    oskar_fftpack_cfft2i(n, n, wsave);
+    oskar_timer_start(tmr);
+    oskar_fftpack_cfft2f(n, n, n, ref, wsave, work);
+    printf("FFTPACK 2D FFT (%d x %d): %.3f sec\n", n, n,
+            oskar_timer_elapsed(tmr));
+    free(wsave);
+    free(work);
+
+    /* Transform with oskar_fft (FFTPACK normalises by the size). */
+    oskar_FFT* fft = oskar_fft_create(OSKAR_DOUBLE, OSKAR_CPU, 2, n, 0,
+            &status);
+    oskar_timer_start(tmr);
+    oskar_fft_exec(fft, data, &status);
+    printf("oskar_fft 2D FFT (%d x %d): %.3f sec\n", n, n,
+            oskar_timer_elapsed(tmr));
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    const double* t = oskar_mem_double_const(data, &status);
+    double max_err = 0.0, max_val = 0.0;
+    for (size_t i = 0; i < 2 * num_cells; ++i)
+    {
+        max_err = std::max(max_err, fabs(t[i] - ref[i] * num_cells));
+        max_val = std::max(max_val, fabs(t[i]));
+    }
+    EXPECT_LT(max_err / max_val, 1e-13);
+    oskar_fft_free(fft);
+    oskar_timer_free(tmr);
+    oskar_mem_free(data, &status);
+    oskar_mem_free(data_ref, &status);
+}
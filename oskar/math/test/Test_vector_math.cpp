@@ -0,0 +1,71 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "math/private_vector_math_inline.h"
+
+#include <cmath>
+#include <cstdlib>
+
+TEST(vector_math, sincos_double)
+{
+    double max_err = 0.0;
+    for (int i = 0; i < 200000; ++i)
+    {
+        double s = 0.0, c = 0.0;
+        const double x = (rand() / (double)RAND_MAX - 0.5) *
+                ((i % 2) ? 20.0 : 2e5);
+        oskar_vector_sincos_d(x, &s, &c);
+        max_err = std::max(max_err, fabs(s - sin(x)));
+        max_err = std::max(max_err, fabs(c - cos(x)));
+        EXPECT_EQ(s, oskar_vector_sin_d(x));
+    }
+    EXPECT_LT(max_err, 1e-15);
+}
+
+TEST(vector_math, sincos_float)
+{
+    double max_err = 0.0;
+    for (int i = 0; i < 200000; ++i)
+    {
+        float s = 0.0f, c = 0.0f;
+        const float x = (float) ((rand() / (double)RAND_MAX - 0.5) * 200.0);
+        oskar_vector_sincos_f(x, &s, &c);
+        max_err = std::max(max_err, fabs(s - sin((double) x)));
+        max_err = std::max(max_err, fabs(c - cos((double) x)));
+        EXPECT_EQ(s, oskar_vector_sin_f(x));
+    }
+    EXPECT_LT(max_err, 2e-7);
+}
+
+TEST(vector_math, exp_double)
+{
+    double max_rel_err = 0.0;
+    for (int i = 0; i < 200000; ++i)
+    {
+        const double x = (rand() / (double)RAND_MAX - 0.5) * 1400.0;
+        const double e = exp(x);
+        max_rel_err = std::max(max_rel_err,
+                fabs(oskar_vector_exp_d(x) - e) / e);
+    }
+    EXPECT_LT(max_rel_err, 1e-15);
+    EXPECT_DOUBLE_EQ(1.0, oskar_vector_exp_d(0.0));
+    EXPECT_EQ(0.0, oskar_vector_exp_d(-1e5));
+    EXPECT_TRUE(std::isinf(oskar_vector_exp_d(1e5)));
+}
+
+TEST(vector_math, exp_float)
+{
+    double max_rel_err = 0.0;
+    for (int i = 0; i < 200000; ++i)
+    {
+        const float x = (float) ((rand() / (double)RAND_MAX - 0.5) * 170.0);
+        const double e = exp((double) x);
+        max_rel_err = std::max(max_rel_err,
+                fabs(oskar_vector_exp_f(x) - e) / e);
+    }
+    EXPECT_LT(max_rel_err, 2e-7);
+    EXPECT_FLOAT_EQ(1.0f, oskar_vector_exp_f(0.0f));
+    EXPECT_EQ(0.0f, oskar_vector_exp_f(-1e4f));
+    EXPECT_TRUE(std::isinf(oskar_vector_exp_f(1e4f)));
+}
@@ -88,11 +88,14 @@ enum OSKAR_SKY_TAGS
 #include <sky/oskar_sky_generate_random_power_law.h>
 #include <sky/oskar_sky_horizon_clip.h>
 #include <sky/oskar_sky_load.h>
+#include <sky/oskar_sky_load_mapped.h>
 #include <sky/oskar_sky_override_polarisation.h>
 #include <sky/oskar_sky_read.h>
+#include <sky/oskar_sky_rebin.h>
 #include <sky/oskar_sky_resize.h>
 #include <sky/oskar_sky_rotate_to_position.h>
 #include <sky/oskar_sky_save.h>
+#include <sky/oskar_sky_save_mapped.h>
 #include <sky/oskar_sky_scale_flux_with_frequency.h>
 #include <sky/oskar_sky_set_gaussian_parameters.h>
 #include <sky/oskar_sky_set_source.h>
@@ -84,6 +84,10 @@ extern "C" {
  * - Lines containing 10 or 13 or more columns set the status flag to
  *   indicate an error, and abort the load.
  *
+ * Large files are split into chunks at line boundaries, which are parsed
+ * in parallel. Files written by oskar_sky_save_mapped() are detected
+ * and loaded using oskar_sky_load_mapped().
+ *
  * @param[in]  filename  Path to a source list text file.
  * @param[in]  type      Required data type (OSKAR_SINGLE or OSKAR_DOUBLE).
  * @param[in,out] status Status return code.
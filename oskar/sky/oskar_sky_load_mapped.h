@@ -0,0 +1,41 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_SKY_LOAD_MAPPED_H_
+#define OSKAR_SKY_LOAD_MAPPED_H_
+
+/**
+ * @file oskar_sky_load_mapped.h
+ */
+
+#include <oskar_global.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Loads an OSKAR sky model from a binary file that can be mapped.
+ *
+ * @details
+ * Loads a sky model from a file written by oskar_sky_save_mapped().
+ * Where possible, the file is memory-mapped and its columns are copied
+ * straight into the sky model, converting them to the required data type
+ * only if it differs from the type stored in the file.
+ *
+ * oskar_sky_load() also calls this function if it is given a file in
+ * this format.
+ *
+ * @param[in]  filename  Path to the binary sky model file.
+ * @param[in]  type      Required data type (OSKAR_SINGLE or OSKAR_DOUBLE).
+ * @param[in,out] status Status return code.
+ *
+ * @return A handle to the sky model structure, or NULL if an error occurred.
+ */
+OSKAR_EXPORT
+oskar_Sky* oskar_sky_load_mapped(const char* filename, int type, int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_SKY_LOAD_MAPPED_H_ */
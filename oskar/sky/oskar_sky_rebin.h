@@ -0,0 +1,44 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_SKY_REBIN_H_
+#define OSKAR_SKY_REBIN_H_
+
+/**
+ * @file oskar_sky_rebin.h
+ */
+
+#include <oskar_global.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief
+ * Rebins the flux of one sky model onto the sources of another.
+ *
+ * @details
+ * Sets the Stokes I flux of each source in the output sky model to the
+ * sum of the Stokes I fluxes of all the input sources for which it is the
+ * closest output source. The input source positions are not modified.
+ *
+ * The closest output source is found using a k-d tree built from the
+ * output source positions on the unit sphere, so the cost scales as
+ * N_in log(N_out), and input sources are processed in parallel.
+ * If two output sources are at the same distance, the one with the
+ * lower index is used.
+ *
+ * Both sky models must be in CPU memory.
+ *
+ * @param[in]     in       Input sky model.
+ * @param[in,out] out      Output sky model.
+ * @param[in,out] status   Status return code.
+ */
+OSKAR_EXPORT
+void oskar_sky_rebin(const oskar_Sky* in, oskar_Sky* out, int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_SKY_REBIN_H_ */
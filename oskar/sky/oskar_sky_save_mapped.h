@@ -0,0 +1,52 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_SKY_SAVE_MAPPED_H_
+#define OSKAR_SKY_SAVE_MAPPED_H_
+
+/**
+ * @file oskar_sky_save_mapped.h
+ */
+
+#include <oskar_global.h>
+
+/* Identifier at the start of a binary sky model file. */
+#define OSKAR_SKY_MAPPED_MAGIC "OSKARSKY"
+#define OSKAR_SKY_MAPPED_MAGIC_LEN 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Saves an OSKAR sky model to a binary file that can be mapped.
+ *
+ * @details
+ * Saves the source parameters of the sky model to a binary file in a
+ * native layout that can be memory-mapped when it is loaded,
+ * so that no parsing is required.
+ *
+ * The file starts with a 64-byte header, containing the identifier
+ * "OSKARSKY", followed by 32-bit integers for the format version,
+ * a byte order mark (0x01020304), the data type, the number of columns and
+ * the number of sources. Each column then follows as a contiguous array of
+ * the given data type, padded to a multiple of 64 bytes.
+ * The 12 columns are stored in the same order as those of a text sky model
+ * file, but in SI units (angles in radians).
+ *
+ * Note:
+ * - The sky model must reside in host (CPU) memory.
+ * - The file uses the byte order of the machine on which it was written.
+ *
+ * @param[in] filename    Output filename.
+ * @param[in] sky         Sky model to write.
+ * @param[in,out] status  Status return code.
+ */
+OSKAR_EXPORT
+void oskar_sky_save_mapped(const char* filename, const oskar_Sky* sky,
+        int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_SKY_SAVE_MAPPED_H_ */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2014, The University of Oxford
+ * Copyright (c) 2013-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -28,72 +28,100 @@
 
 #include "sky/oskar_evaluate_tec_tid.h"
 #include "math/oskar_cmath.h"
-#include <stdio.h>
+
+#include <stdlib.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Constants of one TID component, evaluated once per call. */
+struct TIDComponent
+{
+    double amp;              /* Amplitude, multiplied by TEC0. */
+    double k_lon, k_lat;     /* Wavenumbers along longitude and latitude. */
+    double phase;            /* Phase due to motion of the TID. */
+};
+typedef struct TIDComponent TIDComponent;
+
+static double tec_tid(const int num_components, const TIDComponent* c,
+        const double TEC0, const double lon, const double lat,
+        const double sec)
+{
+    int i;
+    double tec = 0.0;
+    for (i = 0; i < num_components; ++i)
+    {
+        tec += sec * c[i].amp * (
+                cos(c[i].k_lon * lon - c[i].phase) +
+                cos(c[i].k_lat * lat - c[i].phase));
+        tec += TEC0;
+    }
+    return tec;
+}
+
+static void tec_tid_f(int num_directions, const float* lon, const float* lat,
+        const float* sec, int num_components, const TIDComponent* c,
+        double TEC0, float* tec)
+{
+    int i;
+#pragma omp parallel for private(i)
+    for (i = 0; i < num_directions; ++i)
+        tec[i] = (float) tec_tid(num_components, c, TEC0,
+                (double) lon[i], (double) lat[i], (double) sec[i]);
+}
+
+static void tec_tid_d(int num_directions, const double* lon,
+        const double* lat, const double* sec, int num_components,
+        const TIDComponent* c, double TEC0, double* tec)
+{
+    int i;
+#pragma omp parallel for private(i)
+    for (i = 0; i < num_directions; ++i)
+        tec[i] = tec_tid(num_components, c, TEC0, lon[i], lat[i], sec[i]);
+}
+
 void oskar_evaluate_tec_tid(oskar_Mem* tec, int num_directions,
         const oskar_Mem* lon, const oskar_Mem* lat,
         const oskar_Mem* rel_path_length, double TEC0,
         oskar_SettingsTIDscreen* TID, double gast)
 {
-    int i, j, type;
-    double pp_lon, pp_lat;
-    double pp_sec;
-    double pp_tec;
-    double amp, w, th, v; /* TID parameters */
-    double time;
-    double earth_radius = 6365.0; /* km -- FIXME */
-    int status = 0;
-
-    /* TODO check types, dimensions etc of memory */
-    type = oskar_mem_type(tec);
+    int i, status = 0;
+    const double earth_radius = 6365.0; /* km -- FIXME */
+    const double time = gast * 86400.0; /* days->sec */
+    TIDComponent* c;
 
-    oskar_mem_set_value_real(tec, 0.0, 0, oskar_mem_length(tec), &status);
-
-    /* Loop over TIDs */
+    /* Evaluate the constants for each TID component. */
+    c = (TIDComponent*) calloc(TID->num_components + 1, sizeof(TIDComponent));
+    if (!c) return;
     for (i = 0; i < TID->num_components; ++i)
     {
-        amp = TID->amp[i];
-        /* convert from km to rads */
-        w = TID->wavelength[i] / (earth_radius + TID->height_km);
-        th = TID->theta[i] * M_PI/180.;
-        /* convert from km/h to rad/s */
-        v = (TID->speed[i]/(earth_radius + TID->height_km)) / 3600;
-
-        time = gast * 86400.0; /* days->sec */
+        /* Convert wavelength from km to radians,
+         * and speed from km/h to radians/s. */
+        const double radius = earth_radius + TID->height_km;
+        const double k = 2.0 * M_PI / (TID->wavelength[i] / radius);
+        const double v = (TID->speed[i] / radius) / 3600;
+        const double th = TID->theta[i] * M_PI / 180.0;
+        c[i].amp = TID->amp[i] * TEC0;
+        c[i].k_lon = k * cos(th);
+        c[i].k_lat = k * sin(th);
+        c[i].phase = k * v * time;
+    }
 
-        /* Loop over directions */
-        for (j = 0; j < num_directions; ++j)
-        {
-            if (type == OSKAR_DOUBLE)
-            {
-                pp_lon = oskar_mem_double_const(lon, &status)[j];
-                pp_lat = oskar_mem_double_const(lat, &status)[j];
-                pp_sec = oskar_mem_double_const(rel_path_length, &status)[j];
-                pp_tec = pp_sec * amp * TEC0 * (
-                        cos( (2.0*M_PI/w) * (cos(th)*pp_lon - v*time) ) +
-                        cos( (2.0*M_PI/w) * (sin(th)*pp_lat - v*time) )
-                        );
-                pp_tec += TEC0;
-                oskar_mem_double(tec, &status)[j] += pp_tec;
-            }
-            else
-            {
-                pp_lon = (double)oskar_mem_float_const(lon, &status)[j];
-                pp_lat = (double)oskar_mem_float_const(lat, &status)[j];
-                pp_sec = (double)oskar_mem_float_const(rel_path_length, &status)[j];
-                pp_tec = pp_sec * amp * TEC0 * (
-                        cos( (2.0*M_PI/w) * (cos(th)*pp_lon - v*time) ) +
-                        cos( (2.0*M_PI/w) * (sin(th)*pp_lat - v*time) )
-                );
-                pp_tec += TEC0;
-                oskar_mem_float(tec, &status)[j] += (float)pp_tec;
-            }
-        } /* loop over directions */
-    } /* loop over components. */
+    /* Loop over directions. */
+    if (oskar_mem_type(tec) == OSKAR_DOUBLE)
+        tec_tid_d(num_directions, oskar_mem_double_const(lon, &status),
+                oskar_mem_double_const(lat, &status),
+                oskar_mem_double_const(rel_path_length, &status),
+                TID->num_components, c, TEC0,
+                oskar_mem_double(tec, &status));
+    else
+        tec_tid_f(num_directions, oskar_mem_float_const(lon, &status),
+                oskar_mem_float_const(lat, &status),
+                oskar_mem_float_const(rel_path_length, &status),
+                TID->num_components, c, TEC0,
+                oskar_mem_float(tec, &status));
+    free(c);
 }
 
 #ifdef __cplusplus
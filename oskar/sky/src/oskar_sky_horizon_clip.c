@@ -31,11 +31,44 @@
 #include "sky/oskar_sky_copy_source_data.h"
 #include "sky/oskar_update_horizon_mask.h"
 
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Maximum number of stations in a leaf of the station cluster tree. */
+#define LEAF_STATIONS 8
+
+/* Sources are grouped into cells on the faces of a cube. */
+#define CELLS_PER_SIDE 16
+#define NUM_CELLS (6 * CELLS_PER_SIDE * CELLS_PER_SIDE)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* A cluster of stations, with the centroid of their zenith directions
+ * and the maximum distance of any zenith direction from the centroid. */
+typedef struct
+{
+    double c[3], d;
+    int begin, end, child;
+} Cluster;
+
+typedef struct
+{
+    int type, num_nodes;
+    double eps;
+    double* zen;
+    float* zen_f;
+    int* perm;
+    Cluster* nodes;
+    const void *l, *m, *n;
+} ClusterTree;
+
 static double ha0(double longitude, double ra0, double gast);
+static void horizon_mask_cpu(int num_sources, const oskar_Sky* sky,
+        const oskar_Telescope* telescope, double gast, oskar_Mem* mask,
+        oskar_Mem* source_indices, int* status);
 
 void oskar_sky_horizon_clip(oskar_Sky* out, const oskar_Sky* in,
         const oskar_Telescope* telescope, double gast,
@@ -80,15 +113,24 @@ void oskar_sky_horizon_clip(oskar_Sky* out, const oskar_Sky* in,
     oskar_mem_ensure(source_indices, num_in + 1, status);
 
     /* Create the horizon mask. */
-    oskar_mem_clear_contents(horizon_mask, status);
-    const int num_stations = oskar_telescope_num_stations(telescope);
-    for (i = 0; i < num_stations; ++i)
+    if (location == OSKAR_CPU)
     {
-        const oskar_Station* s = oskar_telescope_station_const(telescope, i);
-        oskar_update_horizon_mask(num_in, oskar_sky_l_const(in),
-                oskar_sky_m_const(in), oskar_sky_n_const(in),
-                ha0(oskar_station_lon_rad(s), ra0, gast), dec0,
-                oskar_station_lat_rad(s), horizon_mask, status);
+        horizon_mask_cpu(num_in, in, telescope, gast, horizon_mask,
+                source_indices, status);
+    }
+    else
+    {
+        oskar_mem_clear_contents(horizon_mask, status);
+        const int num_stations = oskar_telescope_num_stations(telescope);
+        for (i = 0; i < num_stations; ++i)
+        {
+            const oskar_Station* s =
+                    oskar_telescope_station_const(telescope, i);
+            oskar_update_horizon_mask(num_in, oskar_sky_l_const(in),
+                    oskar_sky_m_const(in), oskar_sky_n_const(in),
+                    ha0(oskar_station_lon_rad(s), ra0, gast), dec0,
+                    oskar_station_lat_rad(s), horizon_mask, status);
+        }
     }
 
     /* Apply exclusive prefix sum to mask to get source output indices.
@@ -105,6 +147,291 @@ static double ha0(double longitude, double ra0, double gast)
     return (gast + longitude) - ra0;
 }
 
+static void get_source(const ClusterTree* t, int i, double* s)
+{
+    if (t->type == OSKAR_DOUBLE)
+    {
+        s[0] = ((const double*) t->l)[i];
+        s[1] = ((const double*) t->m)[i];
+        s[2] = ((const double*) t->n)[i];
+    }
+    else
+    {
+        s[0] = ((const float*) t->l)[i];
+        s[1] = ((const float*) t->m)[i];
+        s[2] = ((const float*) t->n)[i];
+    }
+}
+
+/* Splits stations recursively along the axis of largest extent. */
+static void build_cluster(ClusterTree* t, int node, int begin, int end)
+{
+    int i, j, axis = 0;
+    double lo[3], hi[3];
+    Cluster* c = &t->nodes[node];
+    c->begin = begin;
+    c->end = end;
+    c->child = 0;
+    c->c[0] = c->c[1] = c->c[2] = c->d = 0.0;
+    for (j = 0; j < 3; ++j) lo[j] = hi[j] = t->zen[3 * t->perm[begin] + j];
+    for (i = begin; i < end; ++i)
+    {
+        const double* z = &t->zen[3 * t->perm[i]];
+        for (j = 0; j < 3; ++j)
+        {
+            c->c[j] += z[j];
+            if (z[j] < lo[j]) lo[j] = z[j];
+            if (z[j] > hi[j]) hi[j] = z[j];
+        }
+    }
+    for (j = 0; j < 3; ++j)
+    {
+        c->c[j] /= (end - begin);
+        if (hi[j] - lo[j] > hi[axis] - lo[axis]) axis = j;
+    }
+    for (i = begin; i < end; ++i)
+    {
+        const double* z = &t->zen[3 * t->perm[i]];
+        const double dx = z[0] - c->c[0];
+        const double dy = z[1] - c->c[1];
+        const double dz = z[2] - c->c[2];
+        const double d = sqrt(dx * dx + dy * dy + dz * dz);
+        if (d > c->d) c->d = d;
+    }
+    if (end - begin > LEAF_STATIONS && c->d > 0.0)
+    {
+        /* Partition about the middle of the range on the chosen axis. */
+        const double pivot = 0.5 * (lo[axis] + hi[axis]);
+        int mid = begin;
+        for (i = begin; i < end; ++i)
+        {
+            if (t->zen[3 * t->perm[i] + axis] < pivot)
+            {
+                const int tmp = t->perm[i];
+                t->perm[i] = t->perm[mid];
+                t->perm[mid++] = tmp;
+            }
+        }
+        if (mid > begin && mid < end)
+        {
+            c->child = t->num_nodes;
+            t->num_nodes += 2;
+            build_cluster(t, c->child, begin, mid);
+            build_cluster(t, c->child + 1, mid, end);
+        }
+    }
+}
+
+/* Returns true if the source is above the horizon of any station.
+ * Stations are checked individually only if the source is too close to
+ * the horizon of the cluster for it to be decided from the bounds. */
+static int source_visible(const ClusterTree* t, int node, const double* s,
+        int i)
+{
+    int k;
+    const Cluster* c = &t->nodes[node];
+    const double dot = s[0] * c->c[0] + s[1] * c->c[1] + s[2] * c->c[2];
+    const double margin = c->d + t->eps;
+    if (dot > margin) return 1;
+    if (dot < -margin) return 0;
+    if (c->child)
+        return source_visible(t, c->child, s, i) ||
+                source_visible(t, c->child + 1, s, i);
+    for (k = c->begin; k < c->end; ++k)
+    {
+        const int j = 3 * t->perm[k];
+        if (t->type == OSKAR_DOUBLE)
+        {
+            const double* z = &t->zen[j];
+            if (((const double*) t->l)[i] * z[0] +
+                    ((const double*) t->m)[i] * z[1] +
+                    ((const double*) t->n)[i] * z[2] > 0.) return 1;
+        }
+        else
+        {
+            const float* z = &t->zen_f[j];
+            if (((const float*) t->l)[i] * z[0] +
+                    ((const float*) t->m)[i] * z[1] +
+                    ((const float*) t->n)[i] * z[2] > 0.f) return 1;
+        }
+    }
+    return 0;
+}
+
+/* Returns 1 if all sources within distance r of direction s are visible,
+ * 0 if none of them are, or -1 if they must be checked individually. */
+static int cell_visible(const ClusterTree* t, int node, const double* s,
+        double r)
+{
+    int a, b;
+    const Cluster* c = &t->nodes[node];
+    const double dot = s[0] * c->c[0] + s[1] * c->c[1] + s[2] * c->c[2];
+    const double margin = c->d + t->eps + r * sqrt(
+            c->c[0] * c->c[0] + c->c[1] * c->c[1] + c->c[2] * c->c[2]);
+    if (dot > margin) return 1;
+    if (dot < -margin) return 0;
+    if (!c->child) return -1;
+    if ((a = cell_visible(t, c->child, s, r)) == 1) return 1;
+    if ((b = cell_visible(t, c->child + 1, s, r)) == 1) return 1;
+    return (a == 0 && b == 0) ? 0 : -1;
+}
+
+/* Returns the index of the cube face cell containing the direction. */
+static int cell_index(const double* s)
+{
+    int face, iu, iv;
+    double u, v, major;
+    const double ax = fabs(s[0]), ay = fabs(s[1]), az = fabs(s[2]);
+    if (ax >= ay && ax >= az)
+    {
+        face = s[0] > 0.0 ? 0 : 1;
+        major = ax; u = s[1]; v = s[2];
+    }
+    else if (ay >= az)
+    {
+        face = s[1] > 0.0 ? 2 : 3;
+        major = ay; u = s[0]; v = s[2];
+    }
+    else
+    {
+        face = s[2] > 0.0 ? 4 : 5;
+        major = az; u = s[0]; v = s[1];
+    }
+    if (!(major > 0.0)) return 0;
+    iu = (int) (0.5 * (u / major + 1.0) * CELLS_PER_SIDE);
+    iv = (int) (0.5 * (v / major + 1.0) * CELLS_PER_SIDE);
+    if (iu < 0) iu = 0;
+    if (iv < 0) iv = 0;
+    if (iu >= CELLS_PER_SIDE) iu = CELLS_PER_SIDE - 1;
+    if (iv >= CELLS_PER_SIDE) iv = CELLS_PER_SIDE - 1;
+    return (face * CELLS_PER_SIDE + iv) * CELLS_PER_SIDE + iu;
+}
+
+/* Sets the mask for sources above the horizon of any station.
+ * Stations are grouped hierarchically into clusters, and sources are
+ * grouped into cells, so that whole cells can usually be accepted or
+ * rejected using the bounds of a few clusters. The result is the same as
+ * checking every source against every station. */
+static void horizon_mask_cpu(int num_sources, const oskar_Sky* sky,
+        const oskar_Telescope* telescope, double gast, oskar_Mem* mask,
+        oskar_Mem* source_indices, int* status)
+{
+    int i, j, *mask_, *sorted, *cell_start;
+    double *cell_c, *cell_r;
+    ClusterTree t;
+    const int num_stations = oskar_telescope_num_stations(telescope);
+    const double ra0 = oskar_sky_reference_ra_rad(sky);
+    const double sin_dec0 = sin(oskar_sky_reference_dec_rad(sky));
+    const double cos_dec0 = cos(oskar_sky_reference_dec_rad(sky));
+    if (*status) return;
+    mask_ = oskar_mem_int(mask, status);
+    sorted = oskar_mem_int(source_indices, status);
+    if (num_sources == 0 || *status) return;
+    if (num_stations == 0)
+    {
+        memset(mask_, 0, num_sources * sizeof(int));
+        return;
+    }
+
+    /* Get the zenith direction of each station, relative to the
+     * reference direction of the sky model, and build the cluster tree. */
+    memset(&t, 0, sizeof(ClusterTree));
+    t.type = oskar_sky_precision(sky);
+    t.eps = (t.type == OSKAR_DOUBLE) ? 1e-10 : 1e-5;
+    t.l = oskar_mem_void_const(oskar_sky_l_const(sky));
+    t.m = oskar_mem_void_const(oskar_sky_m_const(sky));
+    t.n = oskar_mem_void_const(oskar_sky_n_const(sky));
+    t.zen = (double*) malloc(3 * num_stations * sizeof(double));
+    t.zen_f = (float*) malloc(3 * num_stations * sizeof(float));
+    t.perm = (int*) malloc(num_stations * sizeof(int));
+    t.nodes = (Cluster*) malloc(2 * num_stations * sizeof(Cluster));
+    cell_start = (int*) calloc(NUM_CELLS + 1, sizeof(int));
+    cell_c = (double*) calloc(3 * NUM_CELLS, sizeof(double));
+    cell_r = (double*) calloc(NUM_CELLS, sizeof(double));
+    if (!t.zen || !t.zen_f || !t.perm || !t.nodes ||
+            !cell_start || !cell_c || !cell_r)
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+    else
+    {
+        for (i = 0; i < num_stations; ++i)
+        {
+            const oskar_Station* st =
+                    oskar_telescope_station_const(telescope, i);
+            const double ha = ha0(oskar_station_lon_rad(st), ra0, gast);
+            const double lat = oskar_station_lat_rad(st);
+            const double sin_lat = sin(lat), cos_lat = cos(lat);
+            const double cos_ha0 = cos(ha);
+            double* z = &t.zen[3 * i];
+            z[0] = cos_lat * sin(ha);
+            z[1] = sin_lat * cos_dec0 - cos_lat * cos_ha0 * sin_dec0;
+            z[2] = sin_lat * sin_dec0 + cos_lat * cos_ha0 * cos_dec0;
+            for (j = 0; j < 3; ++j) t.zen_f[3 * i + j] = (float) z[j];
+            t.perm[i] = i;
+        }
+        t.num_nodes = 1;
+        build_cluster(&t, 0, 0, num_stations);
+
+        /* Sort source indices into cells, using the mask as scratch space
+         * for the cell index, and find the centroid and radius of each cell. */
+        for (i = 0; i < num_sources; ++i)
+        {
+            double s[3];
+            get_source(&t, i, s);
+            const int k = cell_index(s);
+            mask_[i] = k;
+            cell_start[k + 1]++;
+            for (j = 0; j < 3; ++j) cell_c[3 * k + j] += s[j];
+        }
+        for (i = 0; i < NUM_CELLS; ++i)
+        {
+            const int count = cell_start[i + 1];
+            if (count > 0)
+                for (j = 0; j < 3; ++j) cell_c[3 * i + j] /= count;
+            cell_start[i + 1] += cell_start[i];
+        }
+        for (i = 0; i < num_sources; ++i)
+        {
+            double s[3];
+            const int k = mask_[i];
+            const double* c = &cell_c[3 * k];
+            get_source(&t, i, s);
+            const double dx = s[0] - c[0], dy = s[1] - c[1], dz = s[2] - c[2];
+            const double d = sqrt(dx * dx + dy * dy + dz * dz);
+            if (d > cell_r[k]) cell_r[k] = d;
+            sorted[cell_start[k]++] = i;
+        }
+
+        /* Evaluate the mask for each cell (cell_start now holds the end). */
+        for (i = 0; i < NUM_CELLS; ++i)
+        {
+            const int begin = (i == 0) ? 0 : cell_start[i - 1];
+            const int end = cell_start[i];
+            if (begin == end) continue;
+            const int v = cell_visible(&t, 0, &cell_c[3 * i], cell_r[i]);
+            for (j = begin; j < end; ++j)
+            {
+                const int k = sorted[j];
+                if (v >= 0)
+                    mask_[k] = v;
+                else
+                {
+                    double s[3];
+                    get_source(&t, k, s);
+                    mask_[k] = source_visible(&t, 0, s, k);
+                }
+            }
+        }
+    }
+
+    free(t.zen);
+    free(t.zen_f);
+    free(t.perm);
+    free(t.nodes);
+    free(cell_start);
+    free(cell_c);
+    free(cell_r);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,12 +26,37 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/* Needed for fseeko() and 64-bit file offsets. */
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include "sky/oskar_sky.h"
 #include "utility/oskar_getline.h"
 #include "utility/oskar_string_to_array.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Use 64-bit file offsets, so that large files can be split into chunks. */
+#ifdef OSKAR_OS_WIN
+#define sky_fseek _fseeki64
+#define sky_ftell _ftelli64
+typedef __int64 sky_off_t;
+#else
+#define sky_fseek fseeko
+#define sky_ftell ftello
+typedef off_t sky_off_t;
+#endif
+
+/* Files are split into chunks of at least this size for parallel parsing. */
+#define MIN_CHUNK_BYTES (4 * 1024 * 1024)
 
 #ifdef __cplusplus
 extern "C" {
@@ -40,53 +65,70 @@ extern "C" {
 static const double deg2rad = 1.74532925199432957692369e-2;
 static const double arcsec2rad = 4.84813681109535993589914e-6;
 
-oskar_Sky* oskar_sky_load(const char* filename, int type, int* status)
+/* Sources from lines starting in the byte range [start, end) of the file. */
+typedef struct
 {
-    int n = 0;
-    FILE* file;
-    char* line = 0;
-    size_t bufsize = 0;
+    sky_off_t start, end;
     oskar_Sky* sky;
+    int status;
+} SkyChunk;
 
-    /* Check if safe to proceed. */
-    if (*status) return 0;
-
-    /* Get the data type. */
-    if (type != OSKAR_SINGLE && type != OSKAR_DOUBLE)
-    {
-        *status = OSKAR_ERR_BAD_DATA_TYPE;
-        return 0;
-    }
+static void load_chunk(const char* filename, int type, SkyChunk* chunk)
+{
+    int n = 0, capacity = 0, *status = &chunk->status;
+    int c, len;
+    sky_off_t pos = chunk->start;
+    char* line = 0;
+    size_t bufsize = 0;
+    FILE* file;
 
-    /* Open the file. */
-    file = fopen(filename, "r");
+    /* Open the file and skip to the first line starting in this chunk. */
+    file = fopen(filename, "rb");
     if (!file)
     {
         *status = OSKAR_ERR_FILE_IO;
-        return 0;
+        return;
+    }
+    if (pos > 0)
+    {
+        if (sky_fseek(file, pos - 1, SEEK_SET) != 0)
+        {
+            *status = OSKAR_ERR_FILE_IO;
+            fclose(file);
+            return;
+        }
+        while ((c = getc(file)) != EOF && c != '\n') ++pos;
     }
 
-    /* Initialise the sky model. */
-    sky = oskar_sky_create(type, OSKAR_CPU, 0, status);
+    /* Initialise the sky model for this chunk. */
+    chunk->sky = oskar_sky_create(type, OSKAR_CPU, 0, status);
 
-    /* Loop over lines in file. */
-    while (oskar_getline(&line, &bufsize, file) != OSKAR_ERR_EOF)
+    /* Loop over lines in the chunk. */
+    while (pos < chunk->end &&
+            (len = oskar_getline(&line, &bufsize, file)) != OSKAR_ERR_EOF)
     {
         /* Set defaults. */
         /* RA, Dec, I, Q, U, V, freq0, spix, RM, FWHM maj, FWHM min, PA */
         double par[] = {0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0., 0.};
         size_t num_param = sizeof(par) / sizeof(double);
         size_t num_required = 3, num_read = 0;
+        if (len < 0)
+        {
+            *status = len;
+            break;
+        }
+        pos += len + 1;
 
         /* Load source parameters (require at least RA, Dec, Stokes I). */
         num_read = oskar_string_to_array_d(line, num_param, par);
         if (num_read < num_required)
             continue;
 
-        /* Ensure enough space in arrays. */
-        if (oskar_sky_num_sources(sky) <= n)
+        /* Ensure enough space in arrays, growing them geometrically. */
+        if (capacity <= n)
         {
-            oskar_sky_resize(sky, n + 100, status);
+            capacity = capacity ? 2 * capacity : 1024;
+            oskar_sky_resize(chunk->sky, capacity, status);
             if (*status)
                 break;
         }
@@ -94,7 +136,7 @@ oskar_Sky* oskar_sky_load(const char* filename, int type, int* status)
         if (num_read <= 9)
         {
             /* RA, Dec, I, Q, U, V, freq0, spix, RM */
-            oskar_sky_set_source(sky, n, par[0] * deg2rad,
+            oskar_sky_set_source(chunk->sky, n, par[0] * deg2rad,
                     par[1] * deg2rad, par[2], par[3], par[4], par[5],
                     par[6], par[7], par[8], 0.0, 0.0, 0.0, status);
         }
@@ -102,7 +144,7 @@ oskar_Sky* oskar_sky_load(const char* filename, int type, int* status)
         {
             /* Old format, with no rotation measure. */
             /* RA, Dec, I, Q, U, V, freq0, spix, FWHM maj, FWHM min, PA */
-            oskar_sky_set_source(sky, n, par[0] * deg2rad,
+            oskar_sky_set_source(chunk->sky, n, par[0] * deg2rad,
                     par[1] * deg2rad, par[2], par[3], par[4], par[5],
                     par[6], par[7], 0.0, par[8] * arcsec2rad,
                     par[9] * arcsec2rad, par[10] * deg2rad, status);
@@ -111,7 +153,7 @@ oskar_Sky* oskar_sky_load(const char* filename, int type, int* status)
         {
             /* New format. */
             /* RA, Dec, I, Q, U, V, freq0, spix, RM, FWHM maj, FWHM min, PA */
-            oskar_sky_set_source(sky, n, par[0] * deg2rad,
+            oskar_sky_set_source(chunk->sky, n, par[0] * deg2rad,
                     par[1] * deg2rad, par[2], par[3], par[4], par[5],
                     par[6], par[7], par[8], par[9] * arcsec2rad,
                     par[10] * arcsec2rad, par[11] * deg2rad, status);
@@ -126,11 +168,106 @@ oskar_Sky* oskar_sky_load(const char* filename, int type, int* status)
     }
 
     /* Set the size to be the actual number of elements loaded. */
-    oskar_sky_resize(sky, n, status);
+    oskar_sky_resize(chunk->sky, n, status);
 
     /* Free the line buffer and close the file. */
     if (line) free(line);
     fclose(file);
+}
+
+oskar_Sky* oskar_sky_load(const char* filename, int type, int* status)
+{
+    int i, num_chunks = 1, num_sources = 0;
+    sky_off_t file_size = 0;
+    char magic[OSKAR_SKY_MAPPED_MAGIC_LEN];
+    SkyChunk* chunks = 0;
+    FILE* file;
+    oskar_Sky* sky = 0;
+
+    /* Check if safe to proceed. */
+    if (*status) return 0;
+
+    /* Get the data type. */
+    if (type != OSKAR_SINGLE && type != OSKAR_DOUBLE)
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return 0;
+    }
+
+    /* Open the file to get its size, and check for the binary format. */
+    file = fopen(filename, "rb");
+    if (!file)
+    {
+        *status = OSKAR_ERR_FILE_IO;
+        return 0;
+    }
+    if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+            !memcmp(magic, OSKAR_SKY_MAPPED_MAGIC, sizeof(magic)))
+    {
+        fclose(file);
+        return oskar_sky_load_mapped(filename, type, status);
+    }
+    if (sky_fseek(file, 0, SEEK_END) == 0)
+        file_size = sky_ftell(file);
+    fclose(file);
+    if (file_size < 0)
+    {
+        *status = OSKAR_ERR_FILE_IO;
+        return 0;
+    }
+
+    /* Split the file into chunks at line boundaries, and parse them
+     * in parallel. Lines belong to the chunk in which they start. */
+#ifdef _OPENMP
+    if (file_size >= 2 * MIN_CHUNK_BYTES)
+    {
+        num_chunks = 4 * omp_get_max_threads();
+        if (file_size / num_chunks < MIN_CHUNK_BYTES)
+            num_chunks = (int) (file_size / MIN_CHUNK_BYTES);
+    }
+#endif
+    chunks = (SkyChunk*) calloc(num_chunks, sizeof(SkyChunk));
+    if (!chunks)
+    {
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return 0;
+    }
+    for (i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].start = (file_size * i) / num_chunks;
+        chunks[i].end = (i == num_chunks - 1) ?
+                file_size + 1 : (file_size * (i + 1)) / num_chunks;
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for (i = 0; i < num_chunks; ++i)
+        load_chunk(filename, type, &chunks[i]);
+
+    /* Concatenate the chunks in order. */
+    for (i = 0; i < num_chunks; ++i)
+    {
+        if (chunks[i].status && !*status) *status = chunks[i].status;
+        if (chunks[i].sky) num_sources += oskar_sky_num_sources(chunks[i].sky);
+    }
+    if (num_chunks == 1 && !*status)
+    {
+        sky = chunks[0].sky;
+        chunks[0].sky = 0;
+    }
+    else if (!*status)
+    {
+        int offset = 0;
+        sky = oskar_sky_create(type, OSKAR_CPU, num_sources, status);
+        for (i = 0; i < num_chunks; ++i)
+        {
+            const int num = oskar_sky_num_sources(chunks[i].sky);
+            oskar_sky_copy_contents(sky, chunks[i].sky, offset, 0, num,
+                    status);
+            offset += num;
+        }
+    }
+    for (i = 0; i < num_chunks; ++i)
+        oskar_sky_free(chunks[i].sky, status);
+    free(chunks);
 
     /* Check if an error occurred. */
     if (*status)
@@ -0,0 +1,190 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+/* Needed for mmap() and posix_madvise(). */
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "sky/oskar_sky.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef OSKAR_OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define HEADER_BYTES 64
+#define ALIGN_BYTES 64
+#define NUM_COLUMNS 12
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void copy_column(oskar_Mem* dst, const char* src, int src_type,
+        int num_sources)
+{
+    int i;
+    if (oskar_mem_type(dst) == src_type)
+    {
+        memcpy(oskar_mem_void(dst), src,
+                num_sources * oskar_mem_element_size(src_type));
+    }
+    else if (src_type == OSKAR_DOUBLE)
+    {
+        float* out = (float*) oskar_mem_void(dst);
+        const double* in = (const double*) src;
+        for (i = 0; i < num_sources; ++i) out[i] = (float) in[i];
+    }
+    else
+    {
+        double* out = (double*) oskar_mem_void(dst);
+        const float* in = (const float*) src;
+        for (i = 0; i < num_sources; ++i) out[i] = (double) in[i];
+    }
+}
+
+/* Returns a pointer to the contents of the file, which is memory-mapped
+ * if possible, otherwise read into a buffer. */
+static char* map_file(const char* filename, size_t* size, int* status)
+{
+    char* data = 0;
+#ifndef OSKAR_OS_WIN
+    struct stat st;
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        *status = OSKAR_ERR_FILE_IO;
+        return 0;
+    }
+    if (fstat(fd, &st) == 0 && st.st_size >= HEADER_BYTES)
+    {
+        *size = (size_t) st.st_size;
+        data = (char*) mmap(0, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == (char*) MAP_FAILED)
+            data = 0;
+        else
+            posix_madvise(data, *size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+#else
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+    {
+        *status = OSKAR_ERR_FILE_IO;
+        return 0;
+    }
+    if (_fseeki64(file, 0, SEEK_END) == 0)
+    {
+        *size = (size_t) _ftelli64(file);
+        data = (char*) malloc(*size);
+        rewind(file);
+        if (data && fread(data, 1, *size, file) != *size)
+        {
+            free(data);
+            data = 0;
+        }
+    }
+    fclose(file);
+#endif
+    if (!data) *status = OSKAR_ERR_FILE_IO;
+    return data;
+}
+
+static void unmap_file(char* data, size_t size)
+{
+    if (!data) return;
+#ifndef OSKAR_OS_WIN
+    munmap(data, size);
+#else
+    (void) size;
+    free(data);
+#endif
+}
+
+oskar_Sky* oskar_sky_load_mapped(const char* filename, int type, int* status)
+{
+    int i, header[5];
+    size_t size = 0, column_bytes = 0, padded_bytes = 0;
+    char* data = 0;
+    oskar_Mem* columns[NUM_COLUMNS];
+    oskar_Sky* sky = 0;
+
+    /* Check if safe to proceed. */
+    if (*status) return 0;
+
+    /* Get the data type. */
+    if (type != OSKAR_SINGLE && type != OSKAR_DOUBLE)
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return 0;
+    }
+
+    /* Map the file and check the header. */
+    data = map_file(filename, &size, status);
+    if (*status) return 0;
+    memcpy(header, data + OSKAR_SKY_MAPPED_MAGIC_LEN, sizeof(header));
+    if (memcmp(data, OSKAR_SKY_MAPPED_MAGIC, OSKAR_SKY_MAPPED_MAGIC_LEN) ||
+            header[0] != 1 || header[1] != 0x01020304 ||
+            (header[2] != OSKAR_SINGLE && header[2] != OSKAR_DOUBLE) ||
+            header[3] != NUM_COLUMNS || header[4] < 0)
+    {
+        *status = OSKAR_ERR_BAD_SKY_FILE;
+    }
+    else
+    {
+        column_bytes = (size_t) header[4] * oskar_mem_element_size(header[2]);
+        padded_bytes = ALIGN_BYTES * ((column_bytes + ALIGN_BYTES - 1) /
+                ALIGN_BYTES);
+        if (size < HEADER_BYTES + NUM_COLUMNS * padded_bytes)
+            *status = OSKAR_ERR_BAD_SKY_FILE;
+    }
+    if (*status)
+    {
+        unmap_file(data, size);
+        return 0;
+    }
+
+    /* Create the sky model and copy the columns into it. */
+    sky = oskar_sky_create(type, OSKAR_CPU, header[4], status);
+    columns[0]  = oskar_sky_ra_rad(sky);
+    columns[1]  = oskar_sky_dec_rad(sky);
+    columns[2]  = oskar_sky_I(sky);
+    columns[3]  = oskar_sky_Q(sky);
+    columns[4]  = oskar_sky_U(sky);
+    columns[5]  = oskar_sky_V(sky);
+    columns[6]  = oskar_sky_reference_freq_hz(sky);
+    columns[7]  = oskar_sky_spectral_index(sky);
+    columns[8]  = oskar_sky_rotation_measure_rad(sky);
+    columns[9]  = oskar_sky_fwhm_major_rad(sky);
+    columns[10] = oskar_sky_fwhm_minor_rad(sky);
+    columns[11] = oskar_sky_position_angle_rad(sky);
+    if (!*status)
+    {
+#pragma omp parallel for
+        for (i = 0; i < NUM_COLUMNS; ++i)
+            copy_column(columns[i], data + HEADER_BYTES + i * padded_bytes,
+                    header[2], header[4]);
+    }
+    unmap_file(data, size);
+
+    /* Check if an error occurred. */
+    if (*status)
+    {
+        oskar_sky_free(sky, status);
+        sky = 0;
+    }
+
+    /* Return a handle to the sky model. */
+    return sky;
+}
+
+#ifdef __cplusplus
+}
+#endif
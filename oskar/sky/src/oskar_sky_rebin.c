@@ -0,0 +1,258 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "sky/oskar_sky.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of points in a leaf of the k-d tree. */
+#define LEAF_POINTS 8
+
+/* The tree is stored implicitly in the index array: each node covering
+ * more than LEAF_POINTS points is split at its middle element, and the
+ * split axis is stored at the same position in "axis". */
+typedef struct
+{
+    const double* xyz;
+    int* idx;
+    char* axis;
+} KdTree;
+
+static void unit_vectors(const oskar_Mem* ra, const oskar_Mem* dec,
+        int num, double* xyz, int* status)
+{
+    int i;
+    if (*status) return;
+    if (oskar_mem_precision(ra) == OSKAR_DOUBLE)
+    {
+        const double *ra_ = oskar_mem_double_const(ra, status);
+        const double *dec_ = oskar_mem_double_const(dec, status);
+#pragma omp parallel for private(i)
+        for (i = 0; i < num; ++i)
+        {
+            const double cos_dec = cos(dec_[i]);
+            xyz[3 * i + 0] = cos_dec * cos(ra_[i]);
+            xyz[3 * i + 1] = cos_dec * sin(ra_[i]);
+            xyz[3 * i + 2] = sin(dec_[i]);
+        }
+    }
+    else
+    {
+        const float *ra_ = oskar_mem_float_const(ra, status);
+        const float *dec_ = oskar_mem_float_const(dec, status);
+#pragma omp parallel for private(i)
+        for (i = 0; i < num; ++i)
+        {
+            const double cos_dec = cos((double) dec_[i]);
+            xyz[3 * i + 0] = cos_dec * cos((double) ra_[i]);
+            xyz[3 * i + 1] = cos_dec * sin((double) ra_[i]);
+            xyz[3 * i + 2] = sin((double) dec_[i]);
+        }
+    }
+}
+
+/* Partially sorts idx[lo..hi) along the axis, so that element k is
+ * in its sorted position. */
+static void select_kth(const double* xyz, int* idx, int lo, int hi,
+        int k, int axis)
+{
+    while (hi - lo > 1)
+    {
+        int lt = lo, i = lo, gt = hi, t;
+        const int a = idx[lo], b = idx[lo + (hi - lo) / 2], c = idx[hi - 1];
+        const double va = xyz[3 * a + axis], vb = xyz[3 * b + axis];
+        const double vc = xyz[3 * c + axis];
+        const double pivot = (va < vb) ?
+                ((vb < vc) ? vb : ((va < vc) ? vc : va)) :
+                ((va < vc) ? va : ((vb < vc) ? vc : vb));
+
+        /* Three-way partition, so duplicate values are handled well. */
+        while (i < gt)
+        {
+            const double v = xyz[3 * idx[i] + axis];
+            if (v < pivot)
+            {
+                t = idx[lt]; idx[lt++] = idx[i]; idx[i++] = t;
+            }
+            else if (v > pivot)
+            {
+                t = idx[--gt]; idx[gt] = idx[i]; idx[i] = t;
+            }
+            else ++i;
+        }
+        if (k < lt) hi = lt;
+        else if (k >= gt) lo = gt;
+        else return;
+    }
+}
+
+static void build_node(KdTree* tree, int lo, int hi)
+{
+    int i, j, axis = 0;
+    double min_val[3], max_val[3], extent = -1.0;
+    if (hi - lo <= LEAF_POINTS) return;
+
+    /* Split along the axis of largest extent. */
+    for (j = 0; j < 3; ++j)
+        min_val[j] = max_val[j] = tree->xyz[3 * tree->idx[lo] + j];
+    for (i = lo + 1; i < hi; ++i)
+    {
+        const double* p = &tree->xyz[3 * tree->idx[i]];
+        for (j = 0; j < 3; ++j)
+        {
+            if (p[j] < min_val[j]) min_val[j] = p[j];
+            if (p[j] > max_val[j]) max_val[j] = p[j];
+        }
+    }
+    for (j = 0; j < 3; ++j)
+    {
+        if (max_val[j] - min_val[j] > extent)
+        {
+            extent = max_val[j] - min_val[j];
+            axis = j;
+        }
+    }
+    const int mid = lo + (hi - lo) / 2;
+    select_kth(tree->xyz, tree->idx, lo, hi, mid, axis);
+    tree->axis[mid] = (char) axis;
+    build_node(tree, lo, mid);
+    build_node(tree, mid + 1, hi);
+}
+
+static void check_point(const KdTree* tree, const double* p, int k,
+        double* best_d2, int* best)
+{
+    const double* q = &tree->xyz[3 * k];
+    const double dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+    const double d2 = dx * dx + dy * dy + dz * dz;
+    if (d2 < *best_d2 || (d2 == *best_d2 && k < *best))
+    {
+        *best_d2 = d2;
+        *best = k;
+    }
+}
+
+static void nearest(const KdTree* tree, const double* p, int lo, int hi,
+        double* best_d2, int* best)
+{
+    int i;
+    if (hi - lo <= LEAF_POINTS)
+    {
+        for (i = lo; i < hi; ++i)
+            check_point(tree, p, tree->idx[i], best_d2, best);
+        return;
+    }
+    const int mid = lo + (hi - lo) / 2;
+    const int axis = tree->axis[mid];
+    const double diff = p[axis] - tree->xyz[3 * tree->idx[mid] + axis];
+    check_point(tree, p, tree->idx[mid], best_d2, best);
+    if (diff < 0.0)
+    {
+        nearest(tree, p, lo, mid, best_d2, best);
+        if (diff * diff <= *best_d2)
+            nearest(tree, p, mid + 1, hi, best_d2, best);
+    }
+    else
+    {
+        nearest(tree, p, mid + 1, hi, best_d2, best);
+        if (diff * diff <= *best_d2)
+            nearest(tree, p, lo, mid, best_d2, best);
+    }
+}
+
+void oskar_sky_rebin(const oskar_Sky* in, oskar_Sky* out, int* status)
+{
+    int i;
+    KdTree tree;
+    if (*status) return;
+    const int num_in = oskar_sky_num_sources(in);
+    const int num_out = oskar_sky_num_sources(out);
+    const int type = oskar_sky_precision(out);
+    if (oskar_sky_mem_location(in) != OSKAR_CPU ||
+            oskar_sky_mem_location(out) != OSKAR_CPU)
+    {
+        *status = OSKAR_ERR_BAD_LOCATION;
+        return;
+    }
+    if (oskar_sky_precision(in) != type)
+    {
+        *status = OSKAR_ERR_TYPE_MISMATCH;
+        return;
+    }
+    if (type != OSKAR_SINGLE && type != OSKAR_DOUBLE)
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return;
+    }
+    oskar_mem_clear_contents(oskar_sky_I(out), status);
+    if (num_out == 0 || *status) return;
+
+    /* Build the k-d tree from the output source positions. */
+    double* xyz_out = (double*) malloc(3 * (size_t) num_out * sizeof(double));
+    double* xyz_in = (double*) malloc(3 * (size_t) num_in * sizeof(double));
+    int* nearest_out = (int*) malloc(num_in * sizeof(int));
+    double* flux = (double*) calloc(num_out, sizeof(double));
+    tree.xyz = xyz_out;
+    tree.idx = (int*) malloc(num_out * sizeof(int));
+    tree.axis = (char*) calloc(num_out, sizeof(char));
+    if (!xyz_out || !xyz_in || !nearest_out || !flux || !tree.idx ||
+            !tree.axis)
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+    unit_vectors(oskar_sky_ra_rad_const(out), oskar_sky_dec_rad_const(out),
+            num_out, xyz_out, status);
+    unit_vectors(oskar_sky_ra_rad_const(in), oskar_sky_dec_rad_const(in),
+            num_in, xyz_in, status);
+    if (!*status)
+    {
+        for (i = 0; i < num_out; ++i) tree.idx[i] = i;
+        build_node(&tree, 0, num_out);
+
+        /* Find the closest output source to each input source. */
+#pragma omp parallel for private(i) schedule(dynamic, 1024)
+        for (i = 0; i < num_in; ++i)
+        {
+            double best_d2 = DBL_MAX;
+            int best = -1;
+            nearest(&tree, &xyz_in[3 * i], 0, num_out, &best_d2, &best);
+            nearest_out[i] = best;
+        }
+
+        /* Accumulate the flux in input order, so the result is
+         * deterministic. Sources with invalid positions are not matched. */
+        if (type == OSKAR_DOUBLE)
+        {
+            const double* flux_in = oskar_mem_double_const(
+                    oskar_sky_I_const(in), status);
+            double* flux_out = oskar_mem_double(oskar_sky_I(out), status);
+            for (i = 0; i < num_in; ++i)
+                if (nearest_out[i] >= 0) flux[nearest_out[i]] += flux_in[i];
+            for (i = 0; i < num_out; ++i) flux_out[i] = flux[i];
+        }
+        else
+        {
+            const float* flux_in = oskar_mem_float_const(
+                    oskar_sky_I_const(in), status);
+            float* flux_out = oskar_mem_float(oskar_sky_I(out), status);
+            for (i = 0; i < num_in; ++i)
+                if (nearest_out[i] >= 0) flux[nearest_out[i]] += flux_in[i];
+            for (i = 0; i < num_out; ++i) flux_out[i] = (float) flux[i];
+        }
+    }
+
+    /* Clean up. */
+    free(xyz_out);
+    free(xyz_in);
+    free(nearest_out);
+    free(flux);
+    free(tree.idx);
+    free(tree.axis);
+}
+
+#ifdef __cplusplus
+}
+#endif
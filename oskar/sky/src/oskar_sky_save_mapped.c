@@ -0,0 +1,81 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "sky/oskar_sky.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define HEADER_BYTES 64
+#define ALIGN_BYTES 64
+#define NUM_COLUMNS 12
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void oskar_sky_save_mapped(const char* filename, const oskar_Sky* sky,
+        int* status)
+{
+    int i, header[5];
+    char buffer[HEADER_BYTES];
+    size_t column_bytes, padding;
+    const oskar_Mem* columns[NUM_COLUMNS];
+    FILE* file;
+    if (*status) return;
+
+    /* Check sky model is in CPU memory. */
+    if (oskar_sky_mem_location(sky) != OSKAR_CPU)
+    {
+        *status = OSKAR_ERR_BAD_LOCATION;
+        return;
+    }
+
+    /* Columns are in the same order as in a text file. */
+    columns[0]  = oskar_sky_ra_rad_const(sky);
+    columns[1]  = oskar_sky_dec_rad_const(sky);
+    columns[2]  = oskar_sky_I_const(sky);
+    columns[3]  = oskar_sky_Q_const(sky);
+    columns[4]  = oskar_sky_U_const(sky);
+    columns[5]  = oskar_sky_V_const(sky);
+    columns[6]  = oskar_sky_reference_freq_hz_const(sky);
+    columns[7]  = oskar_sky_spectral_index_const(sky);
+    columns[8]  = oskar_sky_rotation_measure_rad_const(sky);
+    columns[9]  = oskar_sky_fwhm_major_rad_const(sky);
+    columns[10] = oskar_sky_fwhm_minor_rad_const(sky);
+    columns[11] = oskar_sky_position_angle_rad_const(sky);
+
+    /* Fill the header. */
+    header[0] = 1; /* Format version. */
+    header[1] = 0x01020304; /* Byte order mark. */
+    header[2] = oskar_sky_precision(sky);
+    header[3] = NUM_COLUMNS;
+    header[4] = oskar_sky_num_sources(sky);
+    memset(buffer, 0, sizeof(buffer));
+    memcpy(buffer, OSKAR_SKY_MAPPED_MAGIC, OSKAR_SKY_MAPPED_MAGIC_LEN);
+    memcpy(buffer + OSKAR_SKY_MAPPED_MAGIC_LEN, header, sizeof(header));
+    column_bytes = (size_t) header[4] * oskar_mem_element_size(header[2]);
+    padding = (ALIGN_BYTES - column_bytes % ALIGN_BYTES) % ALIGN_BYTES;
+
+    /* Write the header and the padded columns. */
+    file = fopen(filename, "wb");
+    if (!file)
+    {
+        *status = OSKAR_ERR_FILE_IO;
+        return;
+    }
+    if (fwrite(buffer, 1, HEADER_BYTES, file) != HEADER_BYTES)
+        *status = OSKAR_ERR_FILE_IO;
+    memset(buffer, 0, sizeof(buffer));
+    for (i = 0; i < NUM_COLUMNS && !*status; ++i)
+    {
+        if (fwrite(oskar_mem_void_const(columns[i]), 1, column_bytes, file)
+                != column_bytes ||
+                fwrite(buffer, 1, padding, file) != padding)
+            *status = OSKAR_ERR_FILE_IO;
+    }
+    fclose(file);
+}
+
+#ifdef __cplusplus
+}
+#endif
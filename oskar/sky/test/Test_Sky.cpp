@@ -30,12 +30,15 @@
 
 #include "telescope/oskar_telescope.h"
 #include "sky/oskar_sky.h"
+#include "sky/oskar_update_horizon_mask.h"
 #include "convert/oskar_convert_lon_lat_to_relative_directions.h"
 #include "utility/oskar_get_error_string.h"
 #include "utility/oskar_timer.h"
 #include "utility/oskar_device.h"
 
+#include <cfloat>
 #include <cstdlib>
+#include <vector>
 #include "math/oskar_cmath.h"
 
 #ifdef OSKAR_HAVE_CUDA
@@ -571,6 +574,94 @@ TEST(SkyModel, horizon_clip)
 }
 
 
+static void horizon_clip_compare(int type, double gast)
+{
+    int status = 0;
+    const int num_sources = 200000, num_stations = 512;
+    const double deg2rad = M_PI / 180.0;
+
+    // Generate random sources over the whole sky.
+    srand(2);
+    oskar_Sky* sky_in = oskar_sky_create(type, OSKAR_CPU, num_sources,
+            &status);
+    for (int i = 0; i < num_sources; ++i)
+    {
+        const double ra = 2.0 * M_PI * rand() / (double)RAND_MAX;
+        const double dec = asin(2.0 * rand() / (double)RAND_MAX - 1.0);
+        oskar_sky_set_source(sky_in, i, ra, dec, i, 0.0, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.0, 0.0, 0.0, &status);
+    }
+    oskar_sky_evaluate_relative_directions(sky_in, 0.3, -0.5, &status);
+
+    // Create a telescope with a dense core and some distant stations.
+    oskar_Telescope* telescope = oskar_telescope_create(type,
+            OSKAR_CPU, 0, &status);
+    oskar_telescope_resize(telescope, num_stations, &status);
+    for (int i = 0; i < num_stations; ++i)
+    {
+        const double r = (i < 400) ? 0.02 : (i < 500 ? 0.3 : 20.0);
+        const double lon = 116.7 + r * (2.0 * rand() / (double)RAND_MAX - 1.0);
+        const double lat = -26.8 + r * (2.0 * rand() / (double)RAND_MAX - 1.0);
+        oskar_station_set_position(oskar_telescope_station(telescope, i),
+                lon * deg2rad, lat * deg2rad, 0.0);
+    }
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Clip the sky model.
+    oskar_StationWork* work = oskar_station_work_create(type, OSKAR_CPU,
+            &status);
+    oskar_Sky* sky_out = oskar_sky_create(type, OSKAR_CPU, 0, &status);
+    oskar_sky_horizon_clip(sky_out, sky_in, telescope, gast, work, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Make the mask by checking every source against every station.
+    oskar_Mem* mask = oskar_mem_create(OSKAR_INT, OSKAR_CPU, num_sources,
+            &status);
+    oskar_mem_clear_contents(mask, &status);
+    for (int i = 0; i < num_stations; ++i)
+    {
+        const oskar_Station* s = oskar_telescope_station_const(telescope, i);
+        oskar_update_horizon_mask(num_sources, oskar_sky_l_const(sky_in),
+                oskar_sky_m_const(sky_in), oskar_sky_n_const(sky_in),
+                gast + oskar_station_lon_rad(s) - 0.3, -0.5,
+                oskar_station_lat_rad(s), mask, &status);
+    }
+
+    // Check the same sources were kept, in the same order.
+    const int* mask_ = oskar_mem_int_const(mask, &status);
+    oskar_Mem* I = oskar_mem_convert_precision(oskar_sky_I_const(sky_out),
+            OSKAR_DOUBLE, &status);
+    const double* I_ = oskar_mem_double_const(I, &status);
+    int num_kept = 0;
+    for (int i = 0; i < num_sources; ++i)
+    {
+        if (!mask_[i]) continue;
+        ASSERT_LT(num_kept, oskar_sky_num_sources(sky_out));
+        ASSERT_EQ((double) i, I_[num_kept]);
+        num_kept++;
+    }
+    EXPECT_EQ(num_kept, oskar_sky_num_sources(sky_out));
+    EXPECT_GT(num_kept, num_sources / 3);
+    EXPECT_LT(num_kept, num_sources);
+
+    oskar_mem_free(I, &status);
+    oskar_mem_free(mask, &status);
+    oskar_sky_free(sky_out, &status);
+    oskar_sky_free(sky_in, &status);
+    oskar_station_work_free(work, &status);
+    oskar_telescope_free(telescope, &status);
+}
+
+
+TEST(SkyModel, horizon_clip_compare)
+{
+    horizon_clip_compare(OSKAR_DOUBLE, 0.0);
+    horizon_clip_compare(OSKAR_DOUBLE, 1.3);
+    horizon_clip_compare(OSKAR_SINGLE, 0.0);
+    horizon_clip_compare(OSKAR_SINGLE, 4.2);
+}
+
+
 TEST(SkyModel, resize)
 {
     int status = 0;
@@ -1252,3 +1343,232 @@ TEST(SkyModel, read_write)
     remove(filename);
 }
 
+
+
+TEST(SkyModel, load_ascii_chunks)
+{
+    int status = 0;
+    const char* filename = "temp_sources_large.osm";
+    const double deg2rad = M_PI / 180.0, arcsec2rad = deg2rad / 3600.0;
+
+    // Write a file large enough to be split into several chunks,
+    // with lines of different lengths, formats and comments.
+    FILE* file = fopen(filename, "w");
+    if (!file) FAIL() << "Unable to create test file";
+    const int num_sources = 300000;
+    for (int i = 0; i < num_sources; ++i)
+    {
+        if (i % 7 == 0) fprintf(file, "# comment %d\n\n", i);
+        if (i % 3 == 0)
+            fprintf(file, "%.6f, %.6f, %d\n", i * 1e-3, i * -1e-4, i);
+        else
+            fprintf(file, "%.6f %.6f %d 1 2 3 1e8 -0.7 0.5 %d 2 30 "
+                    "# Gaussian\n", i * 1e-3, i * -1e-4, i, i % 100);
+    }
+    fclose(file);
+
+    // Load the file and check the sources are all present, in order.
+    oskar_Sky* sky = oskar_sky_load(filename, OSKAR_DOUBLE, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    ASSERT_EQ(num_sources, oskar_sky_num_sources(sky));
+    const double* ra = oskar_mem_double_const(oskar_sky_ra_rad_const(sky),
+            &status);
+    const double* I = oskar_mem_double_const(oskar_sky_I_const(sky), &status);
+    const double* maj = oskar_mem_double_const(
+            oskar_sky_fwhm_major_rad_const(sky), &status);
+    const double* rm = oskar_mem_double_const(
+            oskar_sky_rotation_measure_rad_const(sky), &status);
+    for (int i = 0; i < num_sources; ++i)
+    {
+        ASSERT_DOUBLE_EQ(i * 1e-3 * deg2rad, ra[i]) << "Source " << i;
+        ASSERT_DOUBLE_EQ((double) i, I[i]) << "Source " << i;
+        ASSERT_DOUBLE_EQ(i % 3 == 0 ? 0.0 : (i % 100) * arcsec2rad, maj[i]);
+        ASSERT_DOUBLE_EQ(i % 3 == 0 ? 0.0 : 0.5, rm[i]);
+    }
+    oskar_sky_free(sky, &status);
+
+    // Check that a bad line anywhere in the file is reported.
+    file = fopen(filename, "a");
+    fprintf(file, "1 2 3 4 5 6 7 8 9 10\n");
+    fclose(file);
+    sky = oskar_sky_load(filename, OSKAR_DOUBLE, &status);
+    EXPECT_EQ((int) OSKAR_ERR_BAD_SKY_FILE, status);
+    EXPECT_TRUE(sky == 0);
+    remove(filename);
+}
+
+
+TEST(SkyModel, save_load_mapped)
+{
+    int status = 0;
+    const int num_sources = 1001;
+    const char* filename = "temp_sky_model_mapped.osm";
+    oskar_Sky* sky = oskar_sky_create(OSKAR_DOUBLE, OSKAR_CPU, num_sources,
+            &status);
+    for (int i = 0; i < num_sources; ++i)
+    {
+        oskar_sky_set_source(sky, i, 0.1 * i, 0.2 * i, 1.1 * i, 2.2 * i,
+                3.3 * i, 4.4 * i, 1e8 + i, -0.7 * i, 0.5 * i, 1e-5 * i,
+                2e-5 * i, 0.3 * i, &status);
+    }
+    oskar_sky_save_mapped(filename, sky, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Load in both precisions, directly and via oskar_sky_load().
+    oskar_Sky* sky_d = oskar_sky_load_mapped(filename, OSKAR_DOUBLE, &status);
+    oskar_Sky* sky_f = oskar_sky_load(filename, OSKAR_SINGLE, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    ASSERT_EQ(num_sources, oskar_sky_num_sources(sky_d));
+    ASSERT_EQ(num_sources, oskar_sky_num_sources(sky_f));
+    ASSERT_EQ((int) OSKAR_SINGLE, oskar_sky_precision(sky_f));
+    const oskar_Mem* a[] = {
+            oskar_sky_ra_rad_const(sky), oskar_sky_dec_rad_const(sky),
+            oskar_sky_I_const(sky), oskar_sky_Q_const(sky),
+            oskar_sky_U_const(sky), oskar_sky_V_const(sky),
+            oskar_sky_reference_freq_hz_const(sky),
+            oskar_sky_spectral_index_const(sky),
+            oskar_sky_rotation_measure_rad_const(sky),
+            oskar_sky_fwhm_major_rad_const(sky),
+            oskar_sky_fwhm_minor_rad_const(sky),
+            oskar_sky_position_angle_rad_const(sky)};
+    const oskar_Mem* b[] = {
+            oskar_sky_ra_rad_const(sky_d), oskar_sky_dec_rad_const(sky_d),
+            oskar_sky_I_const(sky_d), oskar_sky_Q_const(sky_d),
+            oskar_sky_U_const(sky_d), oskar_sky_V_const(sky_d),
+            oskar_sky_reference_freq_hz_const(sky_d),
+            oskar_sky_spectral_index_const(sky_d),
+            oskar_sky_rotation_measure_rad_const(sky_d),
+            oskar_sky_fwhm_major_rad_const(sky_d),
+            oskar_sky_fwhm_minor_rad_const(sky_d),
+            oskar_sky_position_angle_rad_const(sky_d)};
+    const oskar_Mem* c[] = {
+            oskar_sky_ra_rad_const(sky_f), oskar_sky_dec_rad_const(sky_f),
+            oskar_sky_I_const(sky_f), oskar_sky_Q_const(sky_f),
+            oskar_sky_U_const(sky_f), oskar_sky_V_const(sky_f),
+            oskar_sky_reference_freq_hz_const(sky_f),
+            oskar_sky_spectral_index_const(sky_f),
+            oskar_sky_rotation_measure_rad_const(sky_f),
+            oskar_sky_fwhm_major_rad_const(sky_f),
+            oskar_sky_fwhm_minor_rad_const(sky_f),
+            oskar_sky_position_angle_rad_const(sky_f)};
+    for (int j = 0; j < 12; ++j)
+    {
+        const double* ref = oskar_mem_double_const(a[j], &status);
+        const double* out_d = oskar_mem_double_const(b[j], &status);
+        const float* out_f = oskar_mem_float_const(c[j], &status);
+        for (int i = 0; i < num_sources; ++i)
+        {
+            ASSERT_EQ(ref[i], out_d[i]) << "Column " << j << ", source " << i;
+            ASSERT_EQ((float) ref[i], out_f[i]) << "Column " << j;
+        }
+    }
+    oskar_sky_free(sky, &status);
+    oskar_sky_free(sky_d, &status);
+    oskar_sky_free(sky_f, &status);
+
+    // Check that a truncated file is rejected.
+    FILE* file = fopen(filename, "r+b");
+    char header[64];
+    ASSERT_EQ(64u, fread(header, 1, sizeof(header), file));
+    fclose(file);
+    file = fopen(filename, "wb");
+    fwrite(header, 1, sizeof(header), file);
+    fclose(file);
+    sky = oskar_sky_load_mapped(filename, OSKAR_DOUBLE, &status);
+    EXPECT_EQ((int) OSKAR_ERR_BAD_SKY_FILE, status);
+    EXPECT_TRUE(sky == 0);
+    remove(filename);
+}
+
+TEST(SkyModel, rebin)
+{
+    int status = 0;
+    const int num_in = 5000, num_out = 777;
+    const int precs[] = {OSKAR_SINGLE, OSKAR_DOUBLE};
+    for (int p = 0; p < 2; ++p)
+    {
+        const int prec = precs[p];
+        // Generate random input and output sky models, with some output
+        // sources repeated, and one input source with an invalid position.
+        srand(2);
+        oskar_Sky* in = oskar_sky_create(prec, OSKAR_CPU, num_in, &status);
+        oskar_Sky* out = oskar_sky_create(prec, OSKAR_CPU, num_out, &status);
+        for (int i = 0; i < num_in; ++i)
+            oskar_sky_set_source(in, i, 2.0 * M_PI * rand() / RAND_MAX,
+                    asin(2.0 * rand() / RAND_MAX - 1.0),
+                    (double) rand() / RAND_MAX, 0.0, 0.0, 0.0, 0.0, 0.0,
+                    0.0, 0.0, 0.0, 0.0, &status);
+        oskar_sky_set_source(in, 5, NAN, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.0, &status);
+        for (int i = 0; i < num_out; ++i)
+        {
+            const int j = (i % 10 == 9) ? i - 1 : i;
+            oskar_sky_set_source(out, i, 0.1 * j, 0.9 * sin(0.37 * j),
+                    99.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+                    &status);
+        }
+        oskar_sky_rebin(in, out, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        // Check against a brute-force search.
+        oskar_Mem *ra_in, *dec_in, *flux_in, *ra_out, *dec_out, *flux_out;
+        ra_in = oskar_mem_convert_precision(oskar_sky_ra_rad_const(in),
+                OSKAR_DOUBLE, &status);
+        dec_in = oskar_mem_convert_precision(oskar_sky_dec_rad_const(in),
+                OSKAR_DOUBLE, &status);
+        flux_in = oskar_mem_convert_precision(oskar_sky_I_const(in),
+                OSKAR_DOUBLE, &status);
+        ra_out = oskar_mem_convert_precision(oskar_sky_ra_rad_const(out),
+                OSKAR_DOUBLE, &status);
+        dec_out = oskar_mem_convert_precision(oskar_sky_dec_rad_const(out),
+                OSKAR_DOUBLE, &status);
+        flux_out = oskar_mem_convert_precision(oskar_sky_I_const(out),
+                OSKAR_DOUBLE, &status);
+        const double* ra_i = oskar_mem_double_const(ra_in, &status);
+        const double* dec_i = oskar_mem_double_const(dec_in, &status);
+        const double* ra_o = oskar_mem_double_const(ra_out, &status);
+        const double* dec_o = oskar_mem_double_const(dec_out, &status);
+        const double* f_i = oskar_mem_double_const(flux_in, &status);
+        const double* f_o = oskar_mem_double_const(flux_out, &status);
+        std::vector<double> ref(num_out, 0.0);
+        for (int i = 0; i < num_in; ++i)
+        {
+            const double x = cos(dec_i[i]) * cos(ra_i[i]);
+            const double y = cos(dec_i[i]) * sin(ra_i[i]);
+            const double z = sin(dec_i[i]);
+            double best_d2 = DBL_MAX;
+            int best = -1;
+            for (int j = 0; j < num_out; ++j)
+            {
+                const double dx = x - cos(dec_o[j]) * cos(ra_o[j]);
+                const double dy = y - cos(dec_o[j]) * sin(ra_o[j]);
+                const double dz = z - sin(dec_o[j]);
+                const double d2 = dx * dx + dy * dy + dz * dz;
+                if (d2 < best_d2) { best_d2 = d2; best = j; }
+            }
+            if (best >= 0) ref[best] += f_i[i];
+        }
+        double total = 0.0;
+        for (int j = 0; j < num_out; ++j)
+        {
+            if (prec == OSKAR_DOUBLE)
+                EXPECT_EQ(ref[j], f_o[j]) << "Output source " << j;
+            else
+                EXPECT_EQ((float) ref[j], f_o[j]) << "Output source " << j;
+            if (j % 10 == 9)
+            {
+                EXPECT_EQ(0.0, f_o[j]);
+            }
+            total += f_o[j];
+        }
+        EXPECT_GT(total, 0.45 * num_in);
+        oskar_mem_free(ra_in, &status);
+        oskar_mem_free(dec_in, &status);
+        oskar_mem_free(flux_in, &status);
+        oskar_mem_free(ra_out, &status);
+        oskar_mem_free(dec_out, &status);
+        oskar_mem_free(flux_out, &status);
+        oskar_sky_free(in, &status);
+        oskar_sky_free(out, &status);
+    }
+}
@@ -0,0 +1,76 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "math/oskar_cmath.h"
+#include "sky/oskar_evaluate_tec_tid.h"
+#include "utility/oskar_get_error_string.h"
+
+#include <cstdlib>
+
+TEST(evaluate_tec_tid, compare_formula)
+{
+    int status = 0;
+    const int num_directions = 10000;
+    const double TEC0 = 2.5, time_days = 55000.3;
+    double amp[] = {0.05, 0.1, 0.02};
+    double wavelength[] = {200.0, 350.0, 120.0};
+    double speed[] = {150.0, 300.0, 80.0};
+    double theta[] = {20.0, 135.0, 270.0};
+    oskar_SettingsTIDscreen tid;
+    tid.height_km = 300.0;
+    tid.num_components = 3;
+    tid.amp = amp;
+    tid.wavelength = wavelength;
+    tid.speed = speed;
+    tid.theta = theta;
+    const int types[] = {OSKAR_DOUBLE, OSKAR_SINGLE};
+    for (int t = 0; t < 2; ++t)
+    {
+        const int type = types[t];
+        oskar_Mem* lon = oskar_mem_create(type, OSKAR_CPU, num_directions,
+                &status);
+        oskar_Mem* lat = oskar_mem_create(type, OSKAR_CPU, num_directions,
+                &status);
+        oskar_Mem* sec = oskar_mem_create(type, OSKAR_CPU, num_directions,
+                &status);
+        oskar_Mem* tec = oskar_mem_create(type, OSKAR_CPU, num_directions,
+                &status);
+        srand(1);
+        oskar_mem_random_range(lon, 2.0, 2.1, &status);
+        oskar_mem_random_range(lat, -0.5, -0.4, &status);
+        oskar_mem_random_range(sec, 1.0, 2.0, &status);
+        oskar_evaluate_tec_tid(tec, num_directions, lon, lat, sec, TEC0,
+                &tid, time_days);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        /* Compare with the TID model evaluated directly. */
+        double max_err = 0.0;
+        const double R = 6365.0 + tid.height_km;
+        for (int i = 0; i < num_directions; ++i)
+        {
+            double expected = 0.0;
+            const double l = oskar_mem_get_element(lon, i, &status);
+            const double b = oskar_mem_get_element(lat, i, &status);
+            const double s = oskar_mem_get_element(sec, i, &status);
+            for (int c = 0; c < tid.num_components; ++c)
+            {
+                const double w = wavelength[c] / R;
+                const double v = speed[c] / R / 3600.0;
+                const double th = theta[c] * M_PI / 180.0;
+                const double ts = time_days * 86400.0;
+                expected += s * amp[c] * TEC0 * (
+                        cos((2.0 * M_PI / w) * (cos(th) * l - v * ts)) +
+                        cos((2.0 * M_PI / w) * (sin(th) * b - v * ts)));
+                expected += TEC0;
+            }
+            max_err = std::max(max_err, fabs(expected -
+                    oskar_mem_get_element(tec, i, &status)));
+        }
+        EXPECT_LT(max_err, type == OSKAR_DOUBLE ? 1e-6 : 1e-5);
+        oskar_mem_free(lon, &status);
+        oskar_mem_free(lat, &status);
+        oskar_mem_free(sec, &status);
+        oskar_mem_free(tec, &status);
+    }
+}
@@ -5,6 +5,8 @@
  * @file oskar_dierckx_bispev.h
  */
 
+#include <oskar_global.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -79,6 +81,7 @@ extern "C" {
  *
  * latest update : march 1987
  */
+OSKAR_EXPORT
 void oskar_dierckx_bispev_f(const float *tx, int nx, const float *ty, int ny,
     const float *c, int kx, int ky, const float *x, int mx, const float *y,
     int my, float *z, float *wrk, int lwrk, int *iwrk, int kwrk, int *ier);
@@ -153,6 +156,7 @@ void oskar_dierckx_bispev_f(const float *tx, int nx, const float *ty, int ny,
  *
  * latest update : march 1987
  */
+OSKAR_EXPORT
 void oskar_dierckx_bispev_d(const double *tx, int nx, const double *ty, int ny,
     const double *c, int kx, int ky, const double *x, int mx, const double *y,
     int my, double *z, double *wrk, int lwrk, int *iwrk, int kwrk, int *ier);
@@ -59,6 +59,35 @@ void oskar_splines_evaluate(const oskar_Splines* spline,
         int num_points, const oskar_Mem* x, const oskar_Mem* y,
         int stride_out, int offset_out, oskar_Mem* output, int* status);
 
+/**
+ * @brief
+ * Evaluates several surfaces fitted by splines at the same positions.
+ *
+ * @details
+ * This function evaluates a set of surfaces fitted by splines at the given
+ * positions. The value of surface k at point i is written to
+ * output[i * stride_out + offset_out + k].
+ *
+ * On the CPU, each point is located in the knot arrays only once for
+ * each distinct set of knots, and the B-spline basis functions are shared
+ * by consecutive splines that have the same knots.
+ *
+ * @param[in] num_splines Number of spline surfaces.
+ * @param[in] splines     Array of pointers to spline data structures.
+ * @param[in] num_points  Number of points.
+ * @param[in] x           List of x coordinates.
+ * @param[in] y           List of y coordinates.
+ * @param[in] stride_out  Stride between points in the output array.
+ * @param[in] offset_out  Offset of the first output value.
+ * @param[out] output     Output values.
+ * @param[in,out] status  Status return code.
+ */
+OSKAR_EXPORT
+void oskar_splines_evaluate_batch(int num_splines,
+        const oskar_Splines* const* splines, int num_points,
+        const oskar_Mem* x, const oskar_Mem* y, int stride_out,
+        int offset_out, oskar_Mem* output, int* status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,14 +26,184 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "splines/oskar_dierckx_bispev.h"
+#include "splines/define_dierckx_bispev_bicubic.h"
 #include "splines/oskar_splines.h"
 #include "utility/oskar_device.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct
+{
+    const void *tx, *ty, *c;
+    int nx, ny, same_knots;
+} SplineArgs;
+
+/* Returns the index l, with t[l-1] <= x < t[l] (or l = n - 4 at the
+ * upper end), of the knot interval containing x, by binary search.
+ * This gives the same index as the linear search in fpbisp. */
+#define KNOT_SEARCH(t, n, x, l) {\
+    int lo_ = 4, hi_ = n - 4;\
+    while (lo_ < hi_) {\
+        const int mid_ = (lo_ + hi_) >> 1;\
+        if (x < t[mid_]) hi_ = mid_; else lo_ = mid_ + 1;\
+    }\
+    l = lo_; }
+
+/* Evaluates a set of bicubic splines at one point, computing the basis
+ * functions only once for consecutive splines with identical knots. */
+#define SPLINES_EVALUATE_POINT(NAME, FP)\
+static void NAME(const int num_splines, const SplineArgs* s,\
+        const FP x, const FP y, FP* z)\
+{\
+    int k, l, lx = 0, ly = 0;\
+    FP hh[3], wx[4], wy[4];\
+    for (k = 0; k < num_splines; ++k)\
+    {\
+        const FP *tx = (const FP*) s[k].tx, *ty = (const FP*) s[k].ty;\
+        const FP *c = (const FP*) s[k].c;\
+        const int nx = s[k].nx, ny = s[k].ny;\
+        int l1, l2, j;\
+        FP sp;\
+        if (nx == 0 || ny == 0) { z[k] = (FP)0; continue; }\
+        if (!s[k].same_knots)\
+        {\
+            FP x_ = x, y_ = y;\
+            if (x_ < tx[3]) x_ = tx[3];\
+            if (x_ > tx[nx - 4]) x_ = tx[nx - 4];\
+            KNOT_SEARCH(tx, nx, x_, l)\
+            FPBSPL(FP, tx, 3, x_, l, wx)\
+            lx = l - 4;\
+            if (y_ < ty[3]) y_ = ty[3];\
+            if (y_ > ty[ny - 4]) y_ = ty[ny - 4];\
+            KNOT_SEARCH(ty, ny, y_, l)\
+            FPBSPL(FP, ty, 3, y_, l, wy)\
+            ly = l - 4;\
+        }\
+        l1 = lx * (ny - 4) + ly;\
+        sp = (FP)0;\
+        for (l = 0; l <= 3; ++l)\
+        {\
+            l2 = l1;\
+            for (j = 0; j <= 3; ++j, ++l2) sp += c[l2] * wx[l] * wy[j];\
+            l1 += (ny - 4);\
+        }\
+        z[k] = sp;\
+    }\
+}
+
+SPLINES_EVALUATE_POINT(splines_evaluate_point_f, float)
+SPLINES_EVALUATE_POINT(splines_evaluate_point_d, double)
+
+static void splines_evaluate_batch_f(const int num_splines,
+        const SplineArgs* s, const int num_points, const float* x,
+        const float* y, const int stride_out, const int offset_out,
+        float* out)
+{
+    int i;
+#pragma omp parallel for private(i)
+    for (i = 0; i < num_points; ++i)
+        splines_evaluate_point_f(num_splines, s, x[i], y[i],
+                out + (size_t) i * stride_out + offset_out);
+}
+
+static void splines_evaluate_batch_d(const int num_splines,
+        const SplineArgs* s, const int num_points, const double* x,
+        const double* y, const int stride_out, const int offset_out,
+        double* out)
+{
+    int i;
+#pragma omp parallel for private(i)
+    for (i = 0; i < num_points; ++i)
+        splines_evaluate_point_d(num_splines, s, x[i], y[i],
+                out + (size_t) i * stride_out + offset_out);
+}
+
+void oskar_splines_evaluate_batch(int num_splines,
+        const oskar_Splines* const* splines, int num_points,
+        const oskar_Mem* x, const oskar_Mem* y, int stride_out,
+        int offset_out, oskar_Mem* output, int* status)
+{
+    int k;
+    SplineArgs* s = 0;
+    if (*status || num_splines <= 0) return;
+    const int type = oskar_mem_type(x);
+    const int location = oskar_mem_location(output);
+    if (location != OSKAR_CPU)
+    {
+        for (k = 0; k < num_splines; ++k)
+            oskar_splines_evaluate(splines[k], num_points, x, y,
+                    stride_out, offset_out + k, output, status);
+        return;
+    }
+    if (type != oskar_mem_type(y) || type != oskar_mem_precision(output))
+    {
+        *status = OSKAR_ERR_TYPE_MISMATCH;
+        return;
+    }
+    if (location != oskar_mem_location(x) ||
+            location != oskar_mem_location(y))
+    {
+        *status = OSKAR_ERR_LOCATION_MISMATCH;
+        return;
+    }
+    if (type != OSKAR_SINGLE && type != OSKAR_DOUBLE)
+    {
+        *status = OSKAR_ERR_BAD_DATA_TYPE;
+        return;
+    }
+
+    /* Collect the spline data, and find which splines can re-use the
+     * basis functions of the one before. */
+    s = (SplineArgs*) calloc(num_splines, sizeof(SplineArgs));
+    if (!s)
+    {
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+    for (k = 0; k < num_splines; ++k)
+    {
+        const oskar_Splines* spl = splines[k];
+        if (oskar_splines_precision(spl) != type)
+            *status = OSKAR_ERR_TYPE_MISMATCH;
+        if (oskar_splines_mem_location(spl) != location)
+            *status = OSKAR_ERR_LOCATION_MISMATCH;
+        if (*status) break;
+        s[k].tx = oskar_mem_void_const(oskar_splines_knots_x_theta_const(spl));
+        s[k].ty = oskar_mem_void_const(oskar_splines_knots_y_phi_const(spl));
+        s[k].c = oskar_mem_void_const(oskar_splines_coeff_const(spl));
+        s[k].nx = oskar_splines_num_knots_x_theta(spl);
+        s[k].ny = oskar_splines_num_knots_y_phi(spl);
+        if (!s[k].tx || !s[k].ty || !s[k].c) s[k].nx = s[k].ny = 0;
+        if (k > 0 && s[k].nx > 0 && s[k].ny > 0 &&
+                s[k].nx == s[k - 1].nx && s[k].ny == s[k - 1].ny)
+        {
+            const size_t elem_size = oskar_mem_element_size(type);
+            s[k].same_knots =
+                    !memcmp(s[k].tx, s[k - 1].tx, s[k].nx * elem_size) &&
+                    !memcmp(s[k].ty, s[k - 1].ty, s[k].ny * elem_size);
+        }
+    }
+    if (!*status)
+    {
+        if (type == OSKAR_SINGLE)
+            splines_evaluate_batch_f(num_splines, s, num_points,
+                    oskar_mem_float_const(x, status),
+                    oskar_mem_float_const(y, status), stride_out, offset_out,
+                    oskar_mem_float(output, status));
+        else
+            splines_evaluate_batch_d(num_splines, s, num_points,
+                    oskar_mem_double_const(x, status),
+                    oskar_mem_double_const(y, status), stride_out, offset_out,
+                    oskar_mem_double(output, status));
+    }
+    free(s);
+}
+
 void oskar_splines_evaluate(const oskar_Splines* spline,
         int num_points, const oskar_Mem* x, const oskar_Mem* y,
         int stride_out, int offset_out, oskar_Mem* output, int* status)
@@ -59,73 +229,8 @@ void oskar_splines_evaluate(const oskar_Splines* spline,
         return;
     }
     if (location == OSKAR_CPU)
-    {
-        int i;
-        if (type == OSKAR_SINGLE)
-        {
-            const float *tx_, *ty_, *coeff_, *x_, *y_;
-            float *out;
-            tx_    = oskar_mem_float_const(tx, status);
-            ty_    = oskar_mem_float_const(ty, status);
-            coeff_ = oskar_mem_float_const(coeff, status);
-            x_     = oskar_mem_float_const(x, status);
-            y_     = oskar_mem_float_const(y, status);
-            out    = oskar_mem_float(output, status) + offset_out;
-            if (nx == 0 || ny == 0 || !tx_ || !ty_ || !coeff_)
-                for (i = 0; i < num_points; ++i) out[i * stride_out] = 0.0f;
-            else
-            {
-                float x1, y1, wrk[8];
-                int iwrk1[2], kwrk1 = 2, lwrk = 8, err = 0;
-                for (i = 0; i < num_points; ++i)
-                {
-                    x1 = x_[i];
-                    y1 = y_[i];
-                    oskar_dierckx_bispev_f(tx_, nx, ty_, ny, coeff_, 3, 3,
-                            &x1, 1, &y1, 1, &out[i * stride_out],
-                            wrk, lwrk, iwrk1, kwrk1, &err);
-                    if (err != 0)
-                    {
-                        *status = OSKAR_ERR_SPLINE_EVAL_FAIL;
-                        return;
-                    }
-                }
-            }
-        }
-        else if (type == OSKAR_DOUBLE)
-        {
-            const double *tx_, *ty_, *coeff_, *x_, *y_;
-            double *out;
-            tx_    = oskar_mem_double_const(tx, status);
-            ty_    = oskar_mem_double_const(ty, status);
-            coeff_ = oskar_mem_double_const(coeff, status);
-            x_     = oskar_mem_double_const(x, status);
-            y_     = oskar_mem_double_const(y, status);
-            out    = oskar_mem_double(output, status) + offset_out;
-            if (nx == 0 || ny == 0 || !tx_ || !ty_ || !coeff_)
-                for (i = 0; i < num_points; ++i) out[i * stride_out] = 0.0;
-            else
-            {
-                double x1, y1, wrk[8];
-                int iwrk1[2], kwrk1 = 2, lwrk = 8, err = 0;
-                for (i = 0; i < num_points; ++i)
-                {
-                    x1 = x_[i];
-                    y1 = y_[i];
-                    oskar_dierckx_bispev_d(tx_, nx, ty_, ny, coeff_, 3, 3,
-                            &x1, 1, &y1, 1, &out[i * stride_out],
-                            wrk, lwrk, iwrk1, kwrk1, &err);
-                    if (err != 0)
-                    {
-                        *status = OSKAR_ERR_SPLINE_EVAL_FAIL;
-                        return;
-                    }
-                }
-            }
-        }
-        else
-            *status = OSKAR_ERR_BAD_DATA_TYPE;
-    }
+        oskar_splines_evaluate_batch(1, &spline, num_points, x, y,
+                stride_out, offset_out, output, status);
     else
     {
         size_t local_size[] = {256, 1, 1}, global_size[] = {1, 1, 1};
@@ -0,0 +1,185 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "splines/oskar_dierckx_bispev.h"
+#include "splines/oskar_splines.h"
+#include "splines/private_splines.h"
+#include "utility/oskar_get_error_string.h"
+
+#include <cmath>
+#include <cstdlib>
+
+static double rand_uniform(double min_val, double max_val)
+{
+    return min_val + (max_val - min_val) * rand() / (double)RAND_MAX;
+}
+
+/* Fits a surface to one of a set of test functions on a regular grid. */
+static oskar_Splines* fit_surface(int func, int* status)
+{
+    const int n = 30;
+    double x[n * n], y[n * n], z[n * n], w[n * n];
+    for (int j = 0, i = 0; j < n; ++j)
+    {
+        for (int k = 0; k < n; ++k, ++i)
+        {
+            x[i] = (double) k / (n - 1);
+            y[i] = (double) j / (n - 1);
+            w[i] = 1.0;
+            if (func == 0)
+                z[i] = sin(4.0 * x[i]) * cos(3.0 * y[i]);
+            else if (func == 1)
+                z[i] = exp(-10.0 * ((x[i] - 0.3) * (x[i] - 0.3) +
+                        (y[i] - 0.6) * (y[i] - 0.6)));
+            else
+                z[i] = x[i] * x[i] - 2.0 * x[i] * y[i] + 0.5;
+        }
+    }
+    double avg_frac_err = 0.0;
+    oskar_Splines* s = oskar_splines_create(OSKAR_DOUBLE, OSKAR_CPU, status);
+    oskar_splines_fit(s, n * n, x, y, z, w, OSKAR_SPLINES_LINEAR, 0,
+            &avg_frac_err, 1.5, 1e-4, 1e-14, status);
+    return s;
+}
+
+/* Returns a single-precision copy of the spline. */
+static oskar_Splines* to_single(const oskar_Splines* in, int* status)
+{
+    oskar_Splines* s = oskar_splines_create(OSKAR_SINGLE, OSKAR_CPU, status);
+    s->num_knots_x_theta = in->num_knots_x_theta;
+    s->num_knots_y_phi = in->num_knots_y_phi;
+    oskar_mem_free(s->knots_x_theta, status);
+    oskar_mem_free(s->knots_y_phi, status);
+    oskar_mem_free(s->coeff, status);
+    s->knots_x_theta = oskar_mem_convert_precision(in->knots_x_theta,
+            OSKAR_SINGLE, status);
+    s->knots_y_phi = oskar_mem_convert_precision(in->knots_y_phi,
+            OSKAR_SINGLE, status);
+    s->coeff = oskar_mem_convert_precision(in->coeff, OSKAR_SINGLE, status);
+    return s;
+}
+
+/* Evaluates each spline at one point using oskar_dierckx_bispev(). */
+static double bispev(const oskar_Splines* s, double x, double y, int* status)
+{
+    int iwrk[2], err = 0;
+    const int nx = oskar_splines_num_knots_x_theta(s);
+    const int ny = oskar_splines_num_knots_y_phi(s);
+    if (nx == 0 || ny == 0) return 0.0;
+    if (oskar_splines_precision(s) == OSKAR_DOUBLE)
+    {
+        double z = 0.0, wrk[8];
+        oskar_dierckx_bispev_d(
+                oskar_mem_double_const(s->knots_x_theta, status), nx,
+                oskar_mem_double_const(s->knots_y_phi, status), ny,
+                oskar_mem_double_const(s->coeff, status), 3, 3,
+                &x, 1, &y, 1, &z, wrk, 8, iwrk, 2, &err);
+        return z;
+    }
+    float xf = (float) x, yf = (float) y, z = 0.0f, wrk[8];
+    oskar_dierckx_bispev_f(
+            oskar_mem_float_const(s->knots_x_theta, status), nx,
+            oskar_mem_float_const(s->knots_y_phi, status), ny,
+            oskar_mem_float_const(s->coeff, status), 3, 3,
+            &xf, 1, &yf, 1, &z, wrk, 8, iwrk, 2, &err);
+    return z;
+}
+
+static void run_test(int prec)
+{
+    int status = 0;
+    const int num_points = 5000, stride = 6, offset = 1;
+
+    /* Create a set of splines, two of which share their knots,
+     * and one of which is empty. */
+    oskar_Splines* s[5];
+    s[0] = fit_surface(0, &status);
+    s[1] = oskar_splines_create(OSKAR_DOUBLE, OSKAR_CPU, &status);
+    oskar_splines_copy(s[1], s[0], &status);
+    oskar_mem_scale_real(s[1]->coeff, -0.5, 0, oskar_mem_length(s[1]->coeff),
+            &status);
+    s[2] = fit_surface(1, &status);
+    s[3] = oskar_splines_create(OSKAR_DOUBLE, OSKAR_CPU, &status);
+    s[4] = fit_surface(2, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    if (prec == OSKAR_SINGLE)
+    {
+        for (int k = 0; k < 5; ++k)
+        {
+            oskar_Splines* t = to_single(s[k], &status);
+            oskar_splines_free(s[k], &status);
+            s[k] = t;
+        }
+    }
+
+    /* Generate points, some of which lie outside the fitted range. */
+    oskar_Mem* x = oskar_mem_create(prec, OSKAR_CPU, num_points, &status);
+    oskar_Mem* y = oskar_mem_create(prec, OSKAR_CPU, num_points, &status);
+    for (int i = 0; i < num_points; ++i)
+    {
+        oskar_mem_set_element_real(x, i, rand_uniform(-0.1, 1.1), &status);
+        oskar_mem_set_element_real(y, i, rand_uniform(-0.1, 1.1), &status);
+    }
+
+    /* Evaluate the splines in a batch, and one at a time. */
+    oskar_Mem* out = oskar_mem_create(prec | OSKAR_COMPLEX, OSKAR_CPU,
+            num_points * stride / 2, &status);
+    oskar_Mem* out2 = oskar_mem_create(prec | OSKAR_COMPLEX, OSKAR_CPU,
+            num_points * stride / 2, &status);
+    oskar_mem_set_value_real(out, 1.0, 0, oskar_mem_length(out), &status);
+    oskar_splines_evaluate_batch(5, s, num_points, x, y, stride, offset,
+            out, &status);
+    for (int k = 0; k < 5; ++k)
+        oskar_splines_evaluate(s[k], num_points, x, y, stride, offset + k,
+                out2, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Check results are identical to those from oskar_dierckx_bispev(). */
+    oskar_Mem* out_d = oskar_mem_convert_precision(out, OSKAR_DOUBLE, &status);
+    oskar_Mem* out2_d = oskar_mem_convert_precision(out2, OSKAR_DOUBLE,
+            &status);
+    oskar_Mem* x_d = oskar_mem_convert_precision(x, OSKAR_DOUBLE, &status);
+    oskar_Mem* y_d = oskar_mem_convert_precision(y, OSKAR_DOUBLE, &status);
+    const double* z = oskar_mem_double_const(out_d, &status);
+    const double* z2 = oskar_mem_double_const(out2_d, &status);
+    const double* xp = oskar_mem_double_const(x_d, &status);
+    const double* yp = oskar_mem_double_const(y_d, &status);
+    for (int i = 0; i < num_points; ++i)
+    {
+        EXPECT_EQ(1.0, z[i * stride]);
+        for (int k = 0; k < 5; ++k)
+        {
+            const double ref = bispev(s[k], xp[i], yp[i], &status);
+            ASSERT_EQ(ref, z[i * stride + offset + k]) << "Spline " << k;
+            ASSERT_EQ(ref, z2[i * stride + offset + k]) << "Spline " << k;
+        }
+    }
+
+    /* Check mismatched precision is caught. */
+    oskar_splines_evaluate_batch(5, s, num_points, x_d, y_d, stride, offset,
+            out_d, &status);
+    if (prec == OSKAR_SINGLE)
+    {
+        EXPECT_EQ((int) OSKAR_ERR_TYPE_MISMATCH, status);
+        status = 0;
+    }
+
+    /* Clean up. */
+    for (int k = 0; k < 5; ++k) oskar_splines_free(s[k], &status);
+    oskar_mem_free(x, &status);
+    oskar_mem_free(y, &status);
+    oskar_mem_free(x_d, &status);
+    oskar_mem_free(y_d, &status);
+    oskar_mem_free(out, &status);
+    oskar_mem_free(out2, &status);
+    oskar_mem_free(out_d, &status);
+    oskar_mem_free(out2_d, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+}
+
+TEST(splines, evaluate_batch)
+{
+    run_test(OSKAR_DOUBLE);
+    run_test(OSKAR_SINGLE);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2016, The University of Oxford
+ * Copyright (c) 2013-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -76,5 +76,6 @@ enum OSKAR_POL_MODE_TYPE
 #include <telescope/oskar_telescope_set_station_coords_ecef.h>
 #include <telescope/oskar_telescope_set_station_coords_enu.h>
 #include <telescope/oskar_telescope_set_station_coords_wgs84.h>
+#include <telescope/oskar_telescope_snapshot.h>
 
 #endif /* OSKAR_TELESCOPE_H_ */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2016, The University of Oxford
+ * Copyright (c) 2013-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -57,6 +57,37 @@ OSKAR_EXPORT
 void oskar_telescope_load(oskar_Telescope* telescope, const char* path,
         oskar_Log* log, int* status);
 
+/**
+ * @brief
+ * Loads a telescope model directory, using a binary snapshot if possible.
+ *
+ * @details
+ * This function behaves in the same way as oskar_telescope_load(), but
+ * also uses a binary snapshot file to avoid re-parsing a telescope model
+ * directory that has not changed since it was last loaded.
+ *
+ * The snapshot is keyed by a hash of the contents of all files in the
+ * directory tree, together with the OSKAR version and the telescope
+ * settings that affect the load (precision, polarisation mode, and whether
+ * numerical element patterns are enabled). If the key in the snapshot
+ * matches, the telescope model is read from the snapshot; otherwise it is
+ * loaded from the directory and a new snapshot is written.
+ *
+ * If the snapshot filename is NULL or empty, this is the same as
+ * oskar_telescope_load().
+ *
+ * @param[in,out] telescope      Pointer to telescope model to fill.
+ * @param[in]     path           Pathname of telescope model directory to load.
+ * @param[in]     snapshot_file  Pathname of the snapshot file (may be NULL).
+ * @param[in,out] log            Pointer to log (IGNORED, WILL BE REMOVED).
+ * @param[in,out] status         Status return code.
+ *
+ * @return Returns 1 if the telescope model was read from the snapshot.
+ */
+OSKAR_EXPORT
+int oskar_telescope_load_cached(oskar_Telescope* telescope, const char* path,
+        const char* snapshot_file, oskar_Log* log, int* status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,71 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#ifndef OSKAR_TELESCOPE_SNAPSHOT_H_
+#define OSKAR_TELESCOPE_SNAPSHOT_H_
+
+/**
+ * @file oskar_telescope_snapshot.h
+ */
+
+#include <oskar_global.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief
+ * Reads a telescope model from a binary snapshot file.
+ *
+ * @details
+ * Restores the contents of a telescope model, as populated by
+ * oskar_telescope_load(), from a snapshot file previously written by
+ * oskar_telescope_write_snapshot().
+ *
+ * The snapshot is only used if its format version and key both match:
+ * if the file does not exist, cannot be opened, or does not match,
+ * the telescope model is not modified, the status code is not set,
+ * and the function returns 0.
+ *
+ * The telescope model must be empty and in CPU memory.
+ *
+ * @param[in,out] telescope  Pointer to telescope model to fill.
+ * @param[in]     filename   Pathname of the snapshot file.
+ * @param[in]     key        Key string identifying the telescope model.
+ * @param[in,out] status     Status return code.
+ *
+ * @return Returns 1 if the telescope model was read from the snapshot.
+ */
+OSKAR_EXPORT
+int oskar_telescope_read_snapshot(oskar_Telescope* telescope,
+        const char* filename, const char* key, int* status);
+
+/**
+ * @brief
+ * Writes a telescope model to a binary snapshot file.
+ *
+ * @details
+ * Writes the parts of a telescope model populated by oskar_telescope_load()
+ * to a binary snapshot file, so that it can be restored quickly using
+ * oskar_telescope_read_snapshot().
+ *
+ * Numerically-defined element pattern data are not stored, so no
+ * snapshot is written if any station uses them, and the function
+ * returns 0.
+ *
+ * @param[in]     telescope  Pointer to telescope model to write.
+ * @param[in]     filename   Pathname of the snapshot file.
+ * @param[in]     key        Key string identifying the telescope model.
+ * @param[in,out] status     Status return code.
+ *
+ * @return Returns 1 if the snapshot was written.
+ */
+OSKAR_EXPORT
+int oskar_telescope_write_snapshot(const oskar_Telescope* telescope,
+        const char* filename, const char* key, int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSKAR_TELESCOPE_SNAPSHOT_H_ */
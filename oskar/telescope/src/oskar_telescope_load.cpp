@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2013-2016, The University of Oxford
+ * Copyright (c) 2013-2019, The University of Oxford
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -26,9 +26,11 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "binary/oskar_crc.h"
 #include "telescope/oskar_telescope.h"
 #include "utility/oskar_dir.h"
 #include "utility/oskar_get_error_string.h"
+#include "oskar_version.h"
 #include "telescope/private_TelescopeLoaderApodisation.h"
 #include "telescope/private_TelescopeLoaderElementPattern.h"
 #include "telescope/private_TelescopeLoaderElementTypes.h"
@@ -40,7 +42,9 @@
 #include "telescope/private_TelescopeLoaderPermittedBeams.h"
 #include "telescope/private_TelescopeLoaderPosition.h"
 
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <string>
 #include <vector>
@@ -54,6 +58,9 @@ static void load_directories(oskar_Telescope* telescope,
         const vector<oskar_TelescopeLoadAbstract*>& loaders,
         map<string, string> filemap, int* status);
 
+static string snapshot_key(const oskar_Telescope* telescope,
+        const char* path, const char* snapshot_file);
+
 extern "C"
 void oskar_telescope_load(oskar_Telescope* telescope, const char* path,
         oskar_Log* log, int* status)
@@ -112,8 +119,131 @@ void oskar_telescope_load(oskar_Telescope* telescope, const char* path,
     oskar_telescope_set_station_ids(telescope);
 }
 
+extern "C"
+int oskar_telescope_load_cached(oskar_Telescope* telescope, const char* path,
+        const char* snapshot_file, oskar_Log* log, int* status)
+{
+    // Check if safe to proceed.
+    if (*status) return 0;
+
+    // Load from the directory if there is no snapshot file.
+    if (!snapshot_file || strlen(snapshot_file) == 0 ||
+            !path || !oskar_dir_exists(path))
+    {
+        oskar_telescope_load(telescope, path, log, status);
+        return 0;
+    }
+
+    // Use the snapshot if it matches the contents of the directory.
+    const string key = snapshot_key(telescope, path, snapshot_file);
+    int snapshot_status = 0;
+    if (oskar_telescope_read_snapshot(telescope, snapshot_file,
+            key.c_str(), &snapshot_status))
+    {
+        oskar_log_message('M', 0, "Loaded telescope model snapshot '%s'",
+                snapshot_file);
+        oskar_telescope_set_station_ids(telescope);
+        return 1;
+    }
+    if (snapshot_status)
+    {
+        // Discard anything read from a damaged snapshot.
+        oskar_log_warning("Could not read telescope model snapshot (%s).",
+                oskar_get_error_string(snapshot_status));
+        snapshot_status = 0;
+        oskar_telescope_resize(telescope, 0, &snapshot_status);
+    }
+
+    // Load the directory and write a new snapshot.
+    oskar_telescope_load(telescope, path, log, status);
+    if (*status) return 0;
+    if (oskar_telescope_write_snapshot(telescope, snapshot_file,
+            key.c_str(), &snapshot_status))
+        oskar_log_message('M', 0, "Wrote telescope model snapshot '%s'",
+                snapshot_file);
+    else if (snapshot_status)
+        oskar_log_warning("Could not write telescope model snapshot (%s).",
+                oskar_get_error_string(snapshot_status));
+    return 0;
+}
+
 // Private functions.
 
+struct DirectoryHash
+{
+    oskar_CRC *crc32, *crc32c;
+    unsigned long a, b;
+    vector<char> buffer;
+};
+
+static void hash_bytes(DirectoryHash& h, const void* data, size_t size)
+{
+    h.a = oskar_crc_update(h.crc32, h.a, data, size);
+    h.b = oskar_crc_update(h.crc32c, h.b, data, size);
+}
+
+// Hashes the names and contents of all files in the directory tree,
+// excluding any with the given name (the snapshot and its temporary file).
+static void hash_directory(DirectoryHash& h, const string& cwd,
+        const string& exclude)
+{
+    int num_files = 0, num_dirs = 0;
+    char **files = 0, **dirs = 0;
+    oskar_dir_items(cwd.c_str(), NULL, 1, 0, &num_files, &files);
+    for (int i = 0; i < num_files; ++i)
+    {
+        if (exclude == files[i] || exclude + ".tmp" == files[i]) continue;
+        const string path = oskar_TelescopeLoadAbstract::get_path(cwd,
+                files[i]);
+        hash_bytes(h, files[i], strlen(files[i]) + 1);
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) continue;
+        size_t num_read = 0;
+        while ((num_read = fread(&h.buffer[0], 1, h.buffer.size(), file)) > 0)
+            hash_bytes(h, &h.buffer[0], num_read);
+        fclose(file);
+    }
+    oskar_dir_items(cwd.c_str(), NULL, 0, 1, &num_dirs, &dirs);
+    for (int i = 0; i < num_dirs; ++i)
+    {
+        hash_bytes(h, "/", 1);
+        hash_bytes(h, dirs[i], strlen(dirs[i]) + 1);
+        hash_directory(h,
+                oskar_TelescopeLoadAbstract::get_path(cwd, dirs[i]), exclude);
+    }
+    for (int i = 0; i < num_files; ++i) free(files[i]);
+    for (int i = 0; i < num_dirs; ++i) free(dirs[i]);
+    free(files);
+    free(dirs);
+}
+
+// Returns a key that identifies the telescope model loaded from the
+// directory, which changes if any file in it or any option
+// affecting the load is changed.
+static string snapshot_key(const oskar_Telescope* telescope,
+        const char* path, const char* snapshot_file)
+{
+    char key[64];
+    DirectoryHash h;
+    int options[3];
+    h.crc32 = oskar_crc_create(OSKAR_CRC_32);
+    h.crc32c = oskar_crc_create(OSKAR_CRC_32C);
+    h.buffer.resize(1 << 20);
+    h.a = oskar_crc_compute(h.crc32, OSKAR_VERSION_STR,
+            strlen(OSKAR_VERSION_STR));
+    h.b = oskar_crc_compute(h.crc32c, OSKAR_VERSION_STR,
+            strlen(OSKAR_VERSION_STR));
+    options[0] = oskar_telescope_precision(telescope);
+    options[1] = oskar_telescope_pol_mode(telescope);
+    options[2] = oskar_telescope_enable_numerical_patterns(telescope);
+    hash_bytes(h, options, sizeof(options));
+    hash_directory(h, string(path), oskar_dir_leafname(snapshot_file));
+    oskar_crc_free(h.crc32);
+    oskar_crc_free(h.crc32c);
+    sprintf(key, "%08lx%08lx", h.a, h.b);
+    return string(key);
+}
+
 // Must pass filemap by value rather than by reference; otherwise, recursive
 // behaviour will not work as intended.
 static void load_directories(oskar_Telescope* telescope,
@@ -168,13 +298,21 @@ static void load_directories(oskar_Telescope* telescope,
             }
 
             // Loop over and descend into all stations.
+            // Sibling stations are independent, so load them in parallel.
+#pragma omp parallel for schedule(dynamic)
             for (int i = 0; i < num_dirs; ++i)
             {
                 // Recursive call to load the station.
+                int thread_status = 0;
                 load_directories(telescope,
                         oskar_TelescopeLoadAbstract::get_path(cwd, children[i]),
                         oskar_telescope_station(telescope, i), depth + 1,
-                        loaders, filemap, status);
+                        loaders, filemap, &thread_status);
+                if (thread_status)
+                {
+#pragma omp critical (load_directories)
+                    if (!*status) *status = thread_status;
+                }
             }
         } // End check on number of directories.
     }
@@ -217,13 +355,21 @@ static void load_directories(oskar_Telescope* telescope,
             }
 
             // Loop over and descend into all stations.
+            // This is only parallel if the parent level was not.
+#pragma omp parallel for schedule(dynamic)
             for (int i = 0; i < num_dirs; ++i)
             {
                 // Recursive call to load the station.
+                int thread_status = 0;
                 load_directories(telescope,
                         oskar_TelescopeLoadAbstract::get_path(cwd, children[i]),
                         oskar_station_child(station, i), depth + 1, loaders,
-                        filemap, status);
+                        filemap, &thread_status);
+                if (thread_status)
+                {
+#pragma omp critical (load_directories)
+                    if (!*status) *status = thread_status;
+                }
             }
         } // End check on number of directories.
     } // End check on depth.
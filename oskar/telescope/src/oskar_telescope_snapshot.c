@@ -0,0 +1,432 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include "binary/oskar_binary.h"
+#include "mem/oskar_binary_read_mem.h"
+#include "mem/oskar_binary_write_mem.h"
+#include "telescope/private_telescope.h"
+#include "telescope/oskar_telescope.h"
+#include "telescope/station/private_station.h"
+#include "telescope/station/element/private_element.h"
+#include "utility/oskar_file_exists.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Increment this if the contents of the snapshot change. */
+#define SNAPSHOT_FORMAT_VERSION 1
+
+enum
+{
+    TAG_FORMAT_VERSION = 1,
+    TAG_KEY = 2,
+    TAG_TELESCOPE_INTS = 3,
+    TAG_TELESCOPE_DOUBLES = 4,
+    TAG_TELESCOPE_ARRAYS = 8,   /* Up to 16 arrays. */
+    TAG_STATION_INTS = 32,
+    TAG_STATION_DOUBLES = 33,
+    TAG_ELEMENT_INTS = 34,
+    TAG_ELEMENT_DOUBLES = 35,
+    TAG_STATION_ARRAYS = 40     /* Up to 32 arrays. */
+};
+
+enum
+{
+    NUM_TELESCOPE_INTS = 6,
+    NUM_TELESCOPE_DOUBLES = 5,
+    NUM_TELESCOPE_ARRAYS = 12,
+    NUM_STATION_INTS = 17,
+    NUM_STATION_DOUBLES = 9,
+    NUM_STATION_ARRAYS = 24,
+    NUM_ELEMENT_INTS = 9,
+    NUM_ELEMENT_DOUBLES = 13
+};
+
+static const unsigned char group = OSKAR_TAG_GROUP_TELESCOPE_SNAPSHOT;
+
+static void telescope_arrays(const oskar_Telescope* t, oskar_Mem** a)
+{
+    a[0] = t->station_true_x_offset_ecef_metres;
+    a[1] = t->station_true_y_offset_ecef_metres;
+    a[2] = t->station_true_z_offset_ecef_metres;
+    a[3] = t->station_true_x_enu_metres;
+    a[4] = t->station_true_y_enu_metres;
+    a[5] = t->station_true_z_enu_metres;
+    a[6] = t->station_measured_x_offset_ecef_metres;
+    a[7] = t->station_measured_y_offset_ecef_metres;
+    a[8] = t->station_measured_z_offset_ecef_metres;
+    a[9] = t->station_measured_x_enu_metres;
+    a[10] = t->station_measured_y_enu_metres;
+    a[11] = t->station_measured_z_enu_metres;
+}
+
+static void station_arrays(const oskar_Station* s, oskar_Mem** a)
+{
+    a[0] = s->noise_freq_hz;
+    a[1] = s->noise_rms_jy;
+    a[2] = s->element_true_x_enu_metres;
+    a[3] = s->element_true_y_enu_metres;
+    a[4] = s->element_true_z_enu_metres;
+    a[5] = s->element_measured_x_enu_metres;
+    a[6] = s->element_measured_y_enu_metres;
+    a[7] = s->element_measured_z_enu_metres;
+    a[8] = s->element_gain;
+    a[9] = s->element_gain_error;
+    a[10] = s->element_phase_offset_rad;
+    a[11] = s->element_phase_error_rad;
+    a[12] = s->element_weight;
+    a[13] = s->element_types;
+    a[14] = s->element_types_cpu;
+    a[15] = s->element_mount_types_cpu;
+    a[16] = s->element_x_alpha_cpu;
+    a[17] = s->element_x_beta_cpu;
+    a[18] = s->element_x_gamma_cpu;
+    a[19] = s->element_y_alpha_cpu;
+    a[20] = s->element_y_beta_cpu;
+    a[21] = s->element_y_gamma_cpu;
+    a[22] = s->permitted_beam_az_rad;
+    a[23] = s->permitted_beam_el_rad;
+}
+
+static int has_numerical_element_data(const oskar_Station* s)
+{
+    int i;
+    if (s->child)
+    {
+        for (i = 0; i < s->num_elements; ++i)
+            if (has_numerical_element_data(s->child[i])) return 1;
+    }
+    if (s->element)
+    {
+        for (i = 0; i < s->num_element_types; ++i)
+            if (s->element[i]->num_freq > 0) return 1;
+    }
+    return 0;
+}
+
+
+/* Stations are indexed in depth-first order. */
+static void write_station(oskar_Binary* h, const oskar_Station* s,
+        int* index, int* status)
+{
+    int i, ints[NUM_STATION_INTS], *e_ints = 0;
+    double doubles[NUM_STATION_DOUBLES], *e_doubles = 0;
+    oskar_Mem* arrays[NUM_STATION_ARRAYS];
+    const int idx = (*index)++;
+    if (*status) return;
+    ints[0] = s->unique_id;
+    ints[1] = s->station_type;
+    ints[2] = s->normalise_final_beam;
+    ints[3] = s->beam_coord_type;
+    ints[4] = s->identical_children;
+    ints[5] = s->num_elements;
+    ints[6] = s->element ? s->num_element_types : 0;
+    ints[7] = s->normalise_array_pattern;
+    ints[8] = s->enable_array_pattern;
+    ints[9] = s->common_element_orientation;
+    ints[10] = s->array_is_3d;
+    ints[11] = s->apply_element_errors;
+    ints[12] = s->apply_element_weight;
+    ints[13] = (int) s->seed_time_variable_errors;
+    ints[14] = s->num_permitted_beams;
+    ints[15] = s->child ? 1 : 0;
+    ints[16] = 0; /* Reserved. */
+    doubles[0] = s->lon_rad;
+    doubles[1] = s->lat_rad;
+    doubles[2] = s->alt_metres;
+    doubles[3] = s->pm_x_rad;
+    doubles[4] = s->pm_y_rad;
+    doubles[5] = s->beam_lon_rad;
+    doubles[6] = s->beam_lat_rad;
+    doubles[7] = s->gaussian_beam_fwhm_rad;
+    doubles[8] = s->gaussian_beam_reference_freq_hz;
+    oskar_binary_write(h, OSKAR_INT, group, TAG_STATION_INTS, idx,
+            sizeof(ints), ints, status);
+    oskar_binary_write(h, OSKAR_DOUBLE, group, TAG_STATION_DOUBLES, idx,
+            sizeof(doubles), doubles, status);
+    station_arrays(s, arrays);
+    for (i = 0; i < NUM_STATION_ARRAYS; ++i)
+        oskar_binary_write_mem(h, arrays[i], group,
+                (unsigned char) (TAG_STATION_ARRAYS + i), idx, 0, status);
+
+    /* Write the analytic element model parameters. */
+    if (ints[6] > 0)
+    {
+        const int n = ints[6];
+        e_ints = (int*) calloc(n * NUM_ELEMENT_INTS, sizeof(int));
+        e_doubles = (double*) calloc(n * NUM_ELEMENT_DOUBLES, sizeof(double));
+        for (i = 0; i < n; ++i)
+        {
+            const oskar_Element* e = s->element[i];
+            int* p = e_ints + i * NUM_ELEMENT_INTS;
+            double* q = e_doubles + i * NUM_ELEMENT_DOUBLES;
+            p[0] = e->element_type;
+            p[1] = e->taper_type;
+            p[2] = e->dipole_length_units;
+            p[3] = e->x_element_type;
+            p[4] = e->y_element_type;
+            p[5] = e->x_taper_type;
+            p[6] = e->y_taper_type;
+            p[7] = e->x_dipole_length_units;
+            p[8] = e->y_dipole_length_units;
+            q[0] = e->dipole_length;
+            q[1] = e->cosine_power;
+            q[2] = e->gaussian_fwhm_rad;
+            q[3] = e->x_dipole_length;
+            q[4] = e->y_dipole_length;
+            q[5] = e->x_taper_cosine_power;
+            q[6] = e->y_taper_cosine_power;
+            q[7] = e->x_taper_gaussian_fwhm_rad;
+            q[8] = e->y_taper_gaussian_fwhm_rad;
+            q[9] = e->x_taper_ref_freq_hz;
+            q[10] = e->y_taper_ref_freq_hz;
+            q[11] = e->max_radius_rad;
+            q[12] = (double) e->coord_sys;
+        }
+        oskar_binary_write(h, OSKAR_INT, group, TAG_ELEMENT_INTS, idx,
+                n * NUM_ELEMENT_INTS * sizeof(int), e_ints, status);
+        oskar_binary_write(h, OSKAR_DOUBLE, group, TAG_ELEMENT_DOUBLES, idx,
+                n * NUM_ELEMENT_DOUBLES * sizeof(double), e_doubles, status);
+        free(e_ints);
+        free(e_doubles);
+    }
+
+    /* Recursively write child stations. */
+    if (s->child)
+    {
+        for (i = 0; i < s->num_elements; ++i)
+            write_station(h, s->child[i], index, status);
+    }
+}
+
+
+static void read_station(oskar_Binary* h, oskar_Station* s,
+        int* index, int* status)
+{
+    int i, ints[NUM_STATION_INTS], *e_ints = 0;
+    double doubles[NUM_STATION_DOUBLES], *e_doubles = 0;
+    oskar_Mem* arrays[NUM_STATION_ARRAYS];
+    const int idx = (*index)++;
+    oskar_binary_read(h, OSKAR_INT, group, TAG_STATION_INTS, idx,
+            sizeof(ints), ints, status);
+    oskar_binary_read(h, OSKAR_DOUBLE, group, TAG_STATION_DOUBLES, idx,
+            sizeof(doubles), doubles, status);
+    if (*status) return;
+
+    /* Resize the station first, as this sets default element values. */
+    oskar_station_resize(s, ints[5], status);
+    s->unique_id = ints[0];
+    s->station_type = ints[1];
+    s->normalise_final_beam = ints[2];
+    s->beam_coord_type = ints[3];
+    s->identical_children = ints[4];
+    s->normalise_array_pattern = ints[7];
+    s->enable_array_pattern = ints[8];
+    s->common_element_orientation = ints[9];
+    s->array_is_3d = ints[10];
+    s->apply_element_errors = ints[11];
+    s->apply_element_weight = ints[12];
+    s->seed_time_variable_errors = (unsigned int) ints[13];
+    s->num_permitted_beams = ints[14];
+    s->lon_rad = doubles[0];
+    s->lat_rad = doubles[1];
+    s->alt_metres = doubles[2];
+    s->pm_x_rad = doubles[3];
+    s->pm_y_rad = doubles[4];
+    s->beam_lon_rad = doubles[5];
+    s->beam_lat_rad = doubles[6];
+    s->gaussian_beam_fwhm_rad = doubles[7];
+    s->gaussian_beam_reference_freq_hz = doubles[8];
+    station_arrays(s, arrays);
+    for (i = 0; i < NUM_STATION_ARRAYS; ++i)
+        oskar_binary_read_mem(h, arrays[i], group,
+                (unsigned char) (TAG_STATION_ARRAYS + i), idx, status);
+
+    /* Read the analytic element model parameters. */
+    if (ints[6] > 0 && !*status)
+    {
+        const int n = ints[6];
+        oskar_station_resize_element_types(s, n, status);
+        e_ints = (int*) calloc(n * NUM_ELEMENT_INTS, sizeof(int));
+        e_doubles = (double*) calloc(n * NUM_ELEMENT_DOUBLES, sizeof(double));
+        oskar_binary_read(h, OSKAR_INT, group, TAG_ELEMENT_INTS, idx,
+                n * NUM_ELEMENT_INTS * sizeof(int), e_ints, status);
+        oskar_binary_read(h, OSKAR_DOUBLE, group, TAG_ELEMENT_DOUBLES, idx,
+                n * NUM_ELEMENT_DOUBLES * sizeof(double), e_doubles, status);
+        for (i = 0; i < n && !*status; ++i)
+        {
+            oskar_Element* e = s->element[i];
+            const int* p = e_ints + i * NUM_ELEMENT_INTS;
+            const double* q = e_doubles + i * NUM_ELEMENT_DOUBLES;
+            e->element_type = p[0];
+            e->taper_type = p[1];
+            e->dipole_length_units = p[2];
+            e->x_element_type = p[3];
+            e->y_element_type = p[4];
+            e->x_taper_type = p[5];
+            e->y_taper_type = p[6];
+            e->x_dipole_length_units = p[7];
+            e->y_dipole_length_units = p[8];
+            e->dipole_length = q[0];
+            e->cosine_power = q[1];
+            e->gaussian_fwhm_rad = q[2];
+            e->x_dipole_length = q[3];
+            e->y_dipole_length = q[4];
+            e->x_taper_cosine_power = q[5];
+            e->y_taper_cosine_power = q[6];
+            e->x_taper_gaussian_fwhm_rad = q[7];
+            e->y_taper_gaussian_fwhm_rad = q[8];
+            e->x_taper_ref_freq_hz = q[9];
+            e->y_taper_ref_freq_hz = q[10];
+            e->max_radius_rad = q[11];
+            e->coord_sys = (int) q[12];
+        }
+        free(e_ints);
+        free(e_doubles);
+    }
+
+    /* Recursively read child stations. */
+    if (ints[15])
+    {
+        oskar_station_create_child_stations(s, status);
+        for (i = 0; i < s->num_elements && !*status; ++i)
+            read_station(h, s->child[i], index, status);
+    }
+}
+
+
+int oskar_telescope_read_snapshot(oskar_Telescope* telescope,
+        const char* filename, const char* key, int* status)
+{
+    int i, version = 0, index = 0, header_status = 0;
+    int ints[NUM_TELESCOPE_INTS];
+    double doubles[NUM_TELESCOPE_DOUBLES];
+    oskar_Mem* arrays[NUM_TELESCOPE_ARRAYS];
+    oskar_Binary* h = 0;
+    oskar_Mem* stored_key = 0;
+    if (*status || !filename || !key || !oskar_file_exists(filename))
+        return 0;
+    if (telescope->mem_location != OSKAR_CPU)
+    {
+        *status = OSKAR_ERR_BAD_LOCATION;
+        return 0;
+    }
+
+    /* Check the format version and key, and return if they don't match. */
+    h = oskar_binary_create(filename, 'r', &header_status);
+    stored_key = oskar_mem_create(OSKAR_CHAR, OSKAR_CPU, 0, &header_status);
+    oskar_binary_read_int(h, group, TAG_FORMAT_VERSION, 0, &version,
+            &header_status);
+    oskar_binary_read_mem(h, stored_key, group, TAG_KEY, 0, &header_status);
+    if (header_status || version != SNAPSHOT_FORMAT_VERSION ||
+            oskar_mem_length(stored_key) != strlen(key) + 1 ||
+            strcmp(oskar_mem_char(stored_key), key))
+    {
+        oskar_mem_free(stored_key, &header_status);
+        oskar_binary_free(h);
+        return 0;
+    }
+    oskar_mem_free(stored_key, status);
+
+    /* Read the telescope-level data. */
+    oskar_binary_read(h, OSKAR_INT, group, TAG_TELESCOPE_INTS, 0,
+            sizeof(ints), ints, status);
+    oskar_binary_read(h, OSKAR_DOUBLE, group, TAG_TELESCOPE_DOUBLES, 0,
+            sizeof(doubles), doubles, status);
+    if (!*status)
+    {
+        oskar_telescope_resize(telescope, ints[0], status);
+        telescope->supplied_coord_type = ints[1];
+        telescope->max_station_size = ints[2];
+        telescope->max_station_depth = ints[3];
+        telescope->identical_stations = ints[4];
+        telescope->lon_rad = doubles[0];
+        telescope->lat_rad = doubles[1];
+        telescope->alt_metres = doubles[2];
+        telescope->pm_x_rad = doubles[3];
+        telescope->pm_y_rad = doubles[4];
+        telescope_arrays(telescope, arrays);
+        for (i = 0; i < NUM_TELESCOPE_ARRAYS; ++i)
+            oskar_binary_read_mem(h, arrays[i], group,
+                    (unsigned char) (TAG_TELESCOPE_ARRAYS + i), 0, status);
+    }
+
+    /* Read each station. */
+    for (i = 0; i < telescope->num_stations && !*status; ++i)
+        read_station(h, telescope->station[i], &index, status);
+    oskar_binary_free(h);
+    return *status ? 0 : 1;
+}
+
+
+int oskar_telescope_write_snapshot(const oskar_Telescope* telescope,
+        const char* filename, const char* key, int* status)
+{
+    int i, index = 0;
+    int ints[NUM_TELESCOPE_INTS];
+    double doubles[NUM_TELESCOPE_DOUBLES];
+    oskar_Mem* arrays[NUM_TELESCOPE_ARRAYS];
+    oskar_Binary* h = 0;
+    char* temp_name = 0;
+    if (*status || !filename || !key) return 0;
+    for (i = 0; i < telescope->num_stations; ++i)
+        if (has_numerical_element_data(telescope->station[i])) return 0;
+
+    /* Write to a temporary file first, and rename it when complete,
+     * so that a partly-written snapshot is never read. */
+    temp_name = (char*) calloc(strlen(filename) + 5, sizeof(char));
+    if (!temp_name)
+    {
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return 0;
+    }
+    sprintf(temp_name, "%s.tmp", filename);
+    h = oskar_binary_create(temp_name, 'w', status);
+    oskar_binary_write_int(h, group, TAG_FORMAT_VERSION, 0,
+            SNAPSHOT_FORMAT_VERSION, status);
+    oskar_binary_write(h, OSKAR_CHAR, group, TAG_KEY, 0,
+            strlen(key) + 1, key, status);
+
+    /* Write the telescope-level data. */
+    ints[0] = telescope->num_stations;
+    ints[1] = telescope->supplied_coord_type;
+    ints[2] = telescope->max_station_size;
+    ints[3] = telescope->max_station_depth;
+    ints[4] = telescope->identical_stations;
+    ints[5] = 0; /* Reserved. */
+    doubles[0] = telescope->lon_rad;
+    doubles[1] = telescope->lat_rad;
+    doubles[2] = telescope->alt_metres;
+    doubles[3] = telescope->pm_x_rad;
+    doubles[4] = telescope->pm_y_rad;
+    oskar_binary_write(h, OSKAR_INT, group, TAG_TELESCOPE_INTS, 0,
+            sizeof(ints), ints, status);
+    oskar_binary_write(h, OSKAR_DOUBLE, group, TAG_TELESCOPE_DOUBLES, 0,
+            sizeof(doubles), doubles, status);
+    telescope_arrays(telescope, arrays);
+    for (i = 0; i < NUM_TELESCOPE_ARRAYS; ++i)
+        oskar_binary_write_mem(h, arrays[i], group,
+                (unsigned char) (TAG_TELESCOPE_ARRAYS + i), 0, 0, status);
+
+    /* Write each station. */
+    for (i = 0; i < telescope->num_stations; ++i)
+        write_station(h, telescope->station[i], &index, status);
+    oskar_binary_free(h);
+    if (!*status && rename(temp_name, filename))
+    {
+        /* Renaming over an existing file fails on some platforms. */
+        remove(filename);
+        if (rename(temp_name, filename)) *status = OSKAR_ERR_FILE_IO;
+    }
+    if (*status) remove(temp_name);
+    free(temp_name);
+    return *status ? 0 : 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -102,14 +102,11 @@ void oskar_element_evaluate(
                     4, offset_out_cplx + 0, output, status);
         else if (oskar_element_has_x_spline_data(model, id))
         {
-            oskar_splines_evaluate(model->x_h_re[id], num_points, theta, phi,
+            const oskar_Splines* splines[] = {
+                    model->x_h_re[id], model->x_h_im[id],
+                    model->x_v_re[id], model->x_v_im[id]};
+            oskar_splines_evaluate_batch(4, splines, num_points, theta, phi,
                     8, offset_out_real + 0, output, status);
-            oskar_splines_evaluate(model->x_h_im[id], num_points, theta, phi,
-                    8, offset_out_real + 1, output, status);
-            oskar_splines_evaluate(model->x_v_re[id], num_points, theta, phi,
-                    8, offset_out_real + 2, output, status);
-            oskar_splines_evaluate(model->x_v_im[id], num_points, theta, phi,
-                    8, offset_out_real + 3, output, status);
             oskar_convert_ludwig3_to_theta_phi_components(num_points, phi,
                     4, offset_out_cplx + 0, output, status);
         }
@@ -131,14 +128,11 @@ void oskar_element_evaluate(
                     4, offset_out_cplx + 2, output, status);
         else if (oskar_element_has_y_spline_data(model, id))
         {
-            oskar_splines_evaluate(model->y_h_re[id], num_points, theta, phi,
+            const oskar_Splines* splines[] = {
+                    model->y_h_re[id], model->y_h_im[id],
+                    model->y_v_re[id], model->y_v_im[id]};
+            oskar_splines_evaluate_batch(4, splines, num_points, theta, phi,
                     8, offset_out_real + 4, output, status);
-            oskar_splines_evaluate(model->y_h_im[id], num_points, theta, phi,
-                    8, offset_out_real + 5, output, status);
-            oskar_splines_evaluate(model->y_v_re[id], num_points, theta, phi,
-                    8, offset_out_real + 6, output, status);
-            oskar_splines_evaluate(model->y_v_im[id], num_points, theta, phi,
-                    8, offset_out_real + 7, output, status);
             oskar_convert_ludwig3_to_theta_phi_components(num_points, phi,
                     4, offset_out_cplx + 2, output, status);
         }
@@ -155,10 +149,10 @@ void oskar_element_evaluate(
         const int offset_out_real = offset_out * 2;
         if (oskar_element_has_scalar_spline_data(model, id))
         {
-            oskar_splines_evaluate(model->scalar_re[id], num_points, theta, phi,
+            const oskar_Splines* splines[] = {
+                    model->scalar_re[id], model->scalar_im[id]};
+            oskar_splines_evaluate_batch(2, splines, num_points, theta, phi,
                     2, offset_out_real + 0, output, status);
-            oskar_splines_evaluate(model->scalar_im[id], num_points, theta, phi,
-                    2, offset_out_real + 1, output, status);
         }
         else if (element_type == OSKAR_ELEMENT_TYPE_DIPOLE)
             oskar_evaluate_dipole_pattern(num_points, theta, phi,
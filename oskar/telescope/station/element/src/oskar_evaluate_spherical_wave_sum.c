@@ -27,19 +27,239 @@
  */
 
 #include "telescope/station/element/oskar_evaluate_spherical_wave_sum.h"
-#include "telescope/station/element/define_evaluate_spherical_wave.h"
 #include "log/oskar_log.h"
-#include "math/define_legendre_polynomial.h"
-#include "math/define_multiply.h"
+#include "math/oskar_cmath.h"
 #include "utility/oskar_device.h"
-#include "utility/oskar_kernel_macros.h"
+
+#include <stdlib.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-OSKAR_EVALUATE_SPHERICAL_WAVE_SUM(evaluate_spherical_wave_sum_float, float, float2)
-OSKAR_EVALUATE_SPHERICAL_WAVE_SUM(evaluate_spherical_wave_sum_double, double, double2)
+/* Number of points evaluated together on the CPU. */
+#define BLOCK 16
+
+/* Sets up the tables used on the CPU, which depend only on l_max.
+ *
+ * The coefficients are scaled by sqrt((2l + 1) / (4 pi l (l + 1))), and
+ * the remaining normalisation factor sqrt((l - m)! / (l + m)!) is absorbed
+ * into the associated Legendre functions, which keeps them bounded
+ * (the un-normalised P_l^m overflows single precision for l > 17).
+ * The table "w" holds the weights of the recurrence relation for the
+ * normalised functions, with two values for each (m, l), which generate
+ * P_l^m from P_{l-1}^m and P_{l-2}^m.
+ * The tables are only filled if they were all allocated. */
+#define SPHERICAL_WAVE_TABLES(FP, FP2, L_MAX, TE_IN, TM_IN, TE, TM, W) {\
+    int l_, m_;\
+    const int num_coeffs_ = (2 * L_MAX + 1) * L_MAX;\
+    TE = (FP2*) malloc((num_coeffs_ + 1) * sizeof(FP2));\
+    TM = (FP2*) malloc((num_coeffs_ + 1) * sizeof(FP2));\
+    W = (FP*) calloc(2 * (L_MAX + 1) * (L_MAX + 2), sizeof(FP));\
+    if (TE && TM && W) {\
+    for (l_ = 1; l_ <= L_MAX; ++l_) {\
+        const int ind0_ = (2 * L_MAX + 1) * (l_ - 1) + l_;\
+        const double f_ = sqrt((2 * l_ + 1) / (4 * M_PI * l_ * (l_ + 1)));\
+        for (m_ = -l_; m_ <= l_; ++m_) {\
+            TE[ind0_ + m_].x = (FP) (TE_IN[ind0_ + m_].x * f_);\
+            TE[ind0_ + m_].y = (FP) (TE_IN[ind0_ + m_].y * f_);\
+            TM[ind0_ + m_].x = (FP) (TM_IN[ind0_ + m_].x * f_);\
+            TM[ind0_ + m_].y = (FP) (TM_IN[ind0_ + m_].y * f_);\
+        }\
+    }\
+    for (m_ = 0; m_ <= L_MAX; ++m_) {\
+        for (l_ = m_ + 2; l_ <= L_MAX + 1; ++l_) {\
+            FP* t_ = &W[2 * (m_ * (L_MAX + 2) + l_)];\
+            const double d_ = (double)l_ * l_ - (double)m_ * m_;\
+            t_[0] = (FP) ((2 * l_ - 1) / sqrt(d_));\
+            t_[1] = (FP) sqrt(((double)(l_ - 1) * (l_ - 1) -\
+                    (double)m_ * m_) / d_);\
+        }\
+    }\
+    }\
+    }
+
+/* Evaluates the spherical wave sum for a block of points.
+ *
+ * The order m is in the outer loop, so the associated Legendre functions
+ * for all l are generated by a single upward recurrence starting from
+ * P_m^m, and cos(m phi) and sin(m phi) are generated by multiplying
+ * by exp(i phi) rather than evaluated for each m.
+ * The recurrence is applied to P_l^m / sin(theta) when m > 0, and the
+ * derivative with respect to theta is carried along with it, so there
+ * are no divisions by sin(theta), which would lose precision near
+ * the zenith.
+ * The inner loops are over the points in the block, so can be
+ * vectorised. */
+#define SPHERICAL_WAVE_SUM_BLOCK(NAME, FP, FP2)\
+static void NAME(const int n, const FP* theta, const FP* phi,\
+        const int l_max, const FP2* te, const FP2* tm, const FP* w,\
+        const int stride, const int theta_off, const int phi_off,\
+        FP2* pattern)\
+{\
+    int l, m, p;\
+    FP cos_t[BLOCK], sin_t[BLOCK], g[BLOCK], c1[BLOCK], s1[BLOCK];\
+    FP cm[BLOCK], sm[BLOCK], pmm[BLOCK], p0[BLOCK], p1[BLOCK];\
+    FP d0[BLOCK], d1[BLOCK];\
+    FP ph_re[BLOCK], ph_im[BLOCK], th_re[BLOCK], th_im[BLOCK];\
+    for (p = 0; p < BLOCK; ++p) {\
+        const FP t = (p < n) ? theta[p] : (FP)0;\
+        const FP f = (p < n && phi[p] == phi[p]) ? phi[p] : (FP)0;\
+        cos_t[p] = cos(t); sin_t[p] = sin(t);\
+        c1[p] = cos(f); s1[p] = sin(f);\
+        cm[p] = (FP)1; sm[p] = (FP)0; pmm[p] = (FP)1;\
+        ph_re[p] = ph_im[p] = th_re[p] = th_im[p] = (FP)0;\
+    }\
+    for (m = 0; m <= l_max; ++m) {\
+        const FP* w_m = &w[2 * m * (l_max + 2)];\
+        if (m > 0) {\
+            /* pmm holds P_m^m / sin(theta) for m > 0. */\
+            const FP f = (FP) -sqrt((2 * m - 1) / (2.0 * m));\
+            for (p = 0; p < BLOCK; ++p) {\
+                const FP c = cm[p] * c1[p] - sm[p] * s1[p];\
+                sm[p] = sm[p] * c1[p] + cm[p] * s1[p];\
+                cm[p] = c;\
+                pmm[p] *= (m == 1) ? f : f * sin_t[p];\
+                g[p] = sin_t[p] * sin_t[p];\
+            }\
+        }\
+        else {\
+            for (p = 0; p < BLOCK; ++p) g[p] = sin_t[p];\
+        }\
+        {\
+            const FP f = (FP) sqrt(2.0 * m + 1);\
+            for (p = 0; p < BLOCK; ++p) {\
+                p0[p] = pmm[p];\
+                d0[p] = m * cos_t[p] * pmm[p];\
+                p1[p] = f * cos_t[p] * p0[p];\
+                d1[p] = f * (cos_t[p] * d0[p] - g[p] * p0[p]);\
+            }\
+        }\
+        for (l = m; l <= l_max; ++l) {\
+            if (l > 0) {\
+                const int ind0 = (2 * l_max + 1) * (l - 1) + l;\
+                const FP2 a = te[ind0 + m], b = tm[ind0 + m];\
+                const FP2 a_ = te[ind0 - m], b_ = tm[ind0 - m];\
+                for (p = 0; p < BLOCK; ++p) {\
+                    const FP pds = (m > 0) ? p0[p] : (FP)0;\
+                    const FP dpms = -d0[p];\
+                    const FP q_re = -cm[p] * dpms, d_im = cm[p] * pds * m;\
+                    FP q_im = -sm[p] * dpms, d_re = -sm[p] * pds * m;\
+                    /* Order +m. */\
+                    ph_re[p] += q_re * b.x - q_im * b.y;\
+                    ph_im[p] += q_re * b.y + q_im * b.x;\
+                    ph_re[p] -= d_re * a.x - d_im * a.y;\
+                    ph_im[p] -= d_re * a.y + d_im * a.x;\
+                    th_re[p] += d_re * b.x - d_im * b.y;\
+                    th_im[p] += d_re * b.y + d_im * b.x;\
+                    th_re[p] += q_re * a.x - q_im * a.y;\
+                    th_im[p] += q_re * a.y + q_im * a.x;\
+                    if (m > 0) {\
+                        /* Order -m: sin(-m phi) = -sin(m phi). */\
+                        q_im = -q_im;\
+                        ph_re[p] += q_re * b_.x - q_im * b_.y;\
+                        ph_im[p] += q_re * b_.y + q_im * b_.x;\
+                        ph_re[p] -= d_re * a_.x + d_im * a_.y;\
+                        ph_im[p] -= d_re * a_.y - d_im * a_.x;\
+                        th_re[p] += d_re * b_.x + d_im * b_.y;\
+                        th_im[p] += d_re * b_.y - d_im * b_.x;\
+                        th_re[p] += q_re * a_.x - q_im * a_.y;\
+                        th_im[p] += q_re * a_.y + q_im * a_.x;\
+                    }\
+                }\
+            }\
+            if (l < l_max) {\
+                /* Recurrence for P_{l+2}^m. */\
+                const FP w0 = w_m[2 * (l + 2)], w1 = w_m[2 * (l + 2) + 1];\
+                for (p = 0; p < BLOCK; ++p) {\
+                    const FP t = w0 * cos_t[p] * p1[p] - w1 * p0[p];\
+                    const FP u = w0 * (cos_t[p] * d1[p] - g[p] * p1[p]) -\
+                            w1 * d0[p];\
+                    p0[p] = p1[p]; p1[p] = t;\
+                    d0[p] = d1[p]; d1[p] = u;\
+                }\
+            }\
+        }\
+    }\
+    for (p = 0; p < n; ++p) {\
+        const int i_out = p * stride;\
+        FP2 *e_theta = &pattern[i_out + theta_off];\
+        FP2 *e_phi = &pattern[i_out + phi_off];\
+        if (phi[p] != phi[p]) {\
+            /* Propagate NAN. */\
+            e_theta->x = e_theta->y = e_phi->x = e_phi->y = phi[p];\
+        }\
+        else if (sin_t[p] == (FP)0) {\
+            /* Return zero at the pole, as the device kernels do. */\
+            e_theta->x = e_theta->y = e_phi->x = e_phi->y = (FP)0;\
+        }\
+        else {\
+            e_theta->x = th_re[p]; e_theta->y = th_im[p];\
+            e_phi->x = ph_re[p]; e_phi->y = ph_im[p];\
+        }\
+    }\
+}
+
+SPHERICAL_WAVE_SUM_BLOCK(spherical_wave_sum_block_f, float, float2)
+SPHERICAL_WAVE_SUM_BLOCK(spherical_wave_sum_block_d, double, double2)
+
+static void evaluate_spherical_wave_sum_float(int num_points,
+        const float* theta, const float* phi, int l_max,
+        const float2* alpha_te, const float2* alpha_tm, int stride,
+        int E_theta_offset, int E_phi_offset, float2* pattern, int* status)
+{
+    int i;
+    float2 *te = 0, *tm = 0;
+    float* w = 0;
+    SPHERICAL_WAVE_TABLES(float, float2, l_max, alpha_te, alpha_tm, te, tm, w)
+    if (!te || !tm || !w)
+    {
+        free(te);
+        free(tm);
+        free(w);
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+#pragma omp parallel for private(i)
+    for (i = 0; i < num_points; i += BLOCK)
+    {
+        const int n = (num_points - i < BLOCK) ? num_points - i : BLOCK;
+        spherical_wave_sum_block_f(n, theta + i, phi + i, l_max, te, tm, w,
+                stride, E_theta_offset, E_phi_offset, pattern + i * stride);
+    }
+    free(te);
+    free(tm);
+    free(w);
+}
+
+static void evaluate_spherical_wave_sum_double(int num_points,
+        const double* theta, const double* phi, int l_max,
+        const double2* alpha_te, const double2* alpha_tm, int stride,
+        int E_theta_offset, int E_phi_offset, double2* pattern, int* status)
+{
+    int i;
+    double2 *te = 0, *tm = 0;
+    double* w = 0;
+    SPHERICAL_WAVE_TABLES(double, double2, l_max, alpha_te, alpha_tm, te, tm, w)
+    if (!te || !tm || !w)
+    {
+        free(te);
+        free(tm);
+        free(w);
+        *status = OSKAR_ERR_MEMORY_ALLOC_FAILURE;
+        return;
+    }
+#pragma omp parallel for private(i)
+    for (i = 0; i < num_points; i += BLOCK)
+    {
+        const int n = (num_points - i < BLOCK) ? num_points - i : BLOCK;
+        spherical_wave_sum_block_d(n, theta + i, phi + i, l_max, te, tm, w,
+                stride, E_theta_offset, E_phi_offset, pattern + i * stride);
+    }
+    free(te);
+    free(tm);
+    free(w);
+}
 
 void oskar_evaluate_spherical_wave_sum(int num_points, const oskar_Mem* theta,
         const oskar_Mem* phi, int l_max, const oskar_Mem* alpha_te,
@@ -68,8 +288,7 @@ void oskar_evaluate_spherical_wave_sum(int num_points, const oskar_Mem* theta,
                     oskar_mem_float2_const(alpha_te, status),
                     oskar_mem_float2_const(alpha_tm, status),
                     stride, E_theta_offset, E_phi_offset,
-                    oskar_mem_float2(pattern, status),
-                    oskar_mem_float2(pattern, status));
+                    oskar_mem_float2(pattern, status), status);
             break;
         case OSKAR_DOUBLE_COMPLEX_MATRIX:
             evaluate_spherical_wave_sum_double(num_points,
@@ -78,8 +297,7 @@ void oskar_evaluate_spherical_wave_sum(int num_points, const oskar_Mem* theta,
                     oskar_mem_double2_const(alpha_te, status),
                     oskar_mem_double2_const(alpha_tm, status),
                     stride, E_theta_offset, E_phi_offset,
-                    oskar_mem_double2(pattern, status),
-                    oskar_mem_double2(pattern, status));
+                    oskar_mem_double2(pattern, status), status);
             break;
         case OSKAR_SINGLE_COMPLEX:
         case OSKAR_DOUBLE_COMPLEX:
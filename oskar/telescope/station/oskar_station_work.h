@@ -100,6 +100,35 @@ OSKAR_EXPORT
 oskar_Mem* oskar_station_work_beam(oskar_StationWork* work,
         const oskar_Mem* output_beam, size_t length, int depth, int* status);
 
+OSKAR_EXPORT
+oskar_Mem* oskar_station_work_element_pattern(oskar_StationWork* work,
+        const oskar_Mem* output_beam, size_t length, int* status);
+
+OSKAR_EXPORT
+int oskar_station_work_reuse_element_pattern(const oskar_StationWork* work);
+
+/**
+ * @brief Sets whether the next station beam may reuse the last one's
+ * element pattern.
+ *
+ * @details
+ * If set, the next call to oskar_evaluate_station_beam() reuses the ENU
+ * directions and the element pattern of the previous call, instead of
+ * evaluating them again. The element pattern is still evaluated at the
+ * last point, which may be the normalisation direction of the station.
+ *
+ * This must only be set if the previous call used the same work buffer,
+ * the same input directions, time and frequency, and a station without
+ * child stations that has the same element model, element orientation,
+ * and (for relative directions) the same position and beam direction.
+ *
+ * @param[in,out] work   Pointer to work buffer structure.
+ * @param[in]     value  If true, reuse the element pattern.
+ */
+OSKAR_EXPORT
+void oskar_station_work_set_reuse_element_pattern(oskar_StationWork* work,
+        int value);
+
 #ifdef __cplusplus
 }
 #endif
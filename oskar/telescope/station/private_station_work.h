@@ -46,6 +46,9 @@ struct oskar_StationWork
     oskar_Mem* weights_error;    /* Complex scalar. */
     oskar_Mem* array_pattern;    /* Complex scalar. */
     oskar_Mem* beam_out_scratch; /* Output scratch array. */
+    oskar_Mem* element_pattern;  /* Element pattern of the last station. */
+    int reuse_element_pattern;   /* If set, reuse the above for all but the
+                                    last point. */
 
     int num_depths;
     oskar_Mem** beam;            /* For hierarchical stations. */
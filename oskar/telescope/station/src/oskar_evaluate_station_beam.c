@@ -125,11 +125,13 @@ static void evaluate_station_beam_relative_directions(oskar_Mem* beam_pattern,
     oskar_Mem *x, *y, *z; /* ENU direction cosines */
     if (*status) return;
 
-    /* ENU directions are needed for horizon clip in all cases */
+    /* ENU directions are needed for horizon clip in all cases.
+     * They are the same as last time if the element pattern is reused. */
     x = oskar_station_work_enu_direction_x(work);
     y = oskar_station_work_enu_direction_y(work);
     z = oskar_station_work_enu_direction_z(work);
-    compute_enu_directions(x, y, z, np, l, m, n, station, GAST, status);
+    if (!oskar_station_work_reuse_element_pattern(work))
+        compute_enu_directions(x, y, z, np, l, m, n, station, GAST, status);
 
     switch (oskar_station_type(station))
     {
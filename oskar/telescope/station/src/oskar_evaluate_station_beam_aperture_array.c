@@ -88,6 +88,7 @@ static void oskar_evaluate_station_beam_aperture_array_private(
 {
     double beam_x, beam_y, beam_z;
     oskar_Mem *weights, *weights_error, *signal, *theta, *phi, *array;
+    oskar_Mem *element;
     int i;
     if (*status) return;
 
@@ -114,11 +115,20 @@ static void oskar_evaluate_station_beam_aperture_array_private(
                 (oskar_station_common_element_orientation(s) ||
                         oskar_element_is_isotropic(element0)) )
         {
+            /* Keep the element pattern, so the next station can reuse it.
+             * Only the last point needs to be evaluated in that case. */
+            const int num_reuse = (depth == 0 &&
+                    work->reuse_element_pattern) ? num_points - 1 : 0;
+            element = oskar_station_work_element_pattern(work, beam,
+                    num_points, status);
             oskar_element_evaluate(element0,
                     oskar_station_element_x_alpha_rad(s, 0) + M_PI/2.0, /* FIXME Will change: This matches the old convention. */
                     oskar_station_element_y_alpha_rad(s, 0),
-                    offset_points, num_points, x, y, z, frequency_hz,
-                    theta, phi, offset_out, beam, status);
+                    offset_points + num_reuse, num_points - num_reuse,
+                    x, y, z, frequency_hz, theta, phi, num_reuse, element,
+                    status);
+            oskar_mem_copy_contents(beam, element, offset_out, 0,
+                    num_points, status);
             if (oskar_station_enable_array_pattern(s))
             {
                 oskar_evaluate_element_weights(weights, weights_error,
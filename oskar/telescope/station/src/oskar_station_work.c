@@ -63,6 +63,8 @@ oskar_StationWork* oskar_station_work_create(int type,
     work->array_pattern = oskar_mem_create((type | OSKAR_COMPLEX),
             location, 0, status);
     work->beam_out_scratch = 0;
+    work->element_pattern = 0;
+    work->reuse_element_pattern = 0;
     work->num_depths = 0;
     work->beam = 0;
 
@@ -85,6 +87,7 @@ void oskar_station_work_free(oskar_StationWork* work, int* status)
     oskar_mem_free(work->weights_error, status);
     oskar_mem_free(work->array_pattern, status);
     oskar_mem_free(work->beam_out_scratch, status);
+    oskar_mem_free(work->element_pattern, status);
 
     for (i = 0; i < work->num_depths; ++i)
     {
@@ -148,6 +151,24 @@ oskar_Mem* oskar_station_work_beam(oskar_StationWork* work,
     return work->beam[depth];
 }
 
+oskar_Mem* oskar_station_work_element_pattern(oskar_StationWork* work,
+        const oskar_Mem* output_beam, size_t length, int* status)
+{
+    get_mem_from_template(&work->element_pattern, output_beam, length, status);
+    return work->element_pattern;
+}
+
+int oskar_station_work_reuse_element_pattern(const oskar_StationWork* work)
+{
+    return work->reuse_element_pattern;
+}
+
+void oskar_station_work_set_reuse_element_pattern(oskar_StationWork* work,
+        int value)
+{
+    work->reuse_element_pattern = value;
+}
+
 static void get_mem_from_template(oskar_Mem** b, const oskar_Mem* a,
         size_t length, int* status)
 {
@@ -0,0 +1,245 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "math/oskar_cmath.h"
+#include "telescope/station/element/oskar_evaluate_spherical_wave_sum.h"
+#include "utility/oskar_device.h"
+#include "utility/oskar_get_error_string.h"
+#include "utility/oskar_timer.h"
+
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef std::complex<double> Complex;
+
+/* Returns P_l^m(cos_theta). */
+static double legendre(int l, int m, double cos_t, double sin_t)
+{
+    double p0 = 1.0;
+    for (int i = 1; i <= m; ++i) p0 *= -(2 * i - 1) * sin_t;
+    if (l == m) return p0;
+    double p1 = cos_t * (2 * m + 1) * p0;
+    for (int i = m + 2; i <= l; ++i)
+    {
+        const double t = ((2 * i - 1) * cos_t * p1 - (i + m - 1) * p0) /
+                (i - m);
+        p0 = p1;
+        p1 = t;
+    }
+    return p1;
+}
+
+/* Direct evaluation of the spherical wave sum at one point, in double
+ * precision, evaluating each term independently. */
+static void spherical_wave_ref(double theta, double phi, int l_max,
+        const Complex* alpha_te, const Complex* alpha_tm,
+        Complex* e_theta, Complex* e_phi)
+{
+    Complex comp_theta(0.0, 0.0), comp_phi(0.0, 0.0);
+    const double sin_t = sin(theta), cos_t = cos(theta);
+    for (int l = 1; l <= l_max; ++l)
+    {
+        const int ind0 = (2 * l_max + 1) * (l - 1) + l;
+        const double f = (2 * l + 1) / (4 * M_PI * l * (l + 1));
+        for (int abs_m = l; abs_m >= 0; --abs_m)
+        {
+            double pds = 0.0, dpms = 0.0, ratio = 1.0;
+            const double p = legendre(l, abs_m, cos_t, sin_t);
+            if (sin_t != 0.0)
+            {
+                pds = p / sin_t;
+                dpms = (cos_t * p * (l + 1) - (l - abs_m + 1) *
+                        legendre(l + 1, abs_m, cos_t, sin_t)) / sin_t;
+            }
+            for (int i = l - abs_m + 1; i <= l + abs_m; ++i) ratio /= i;
+            const double nf = sqrt(f * ratio);
+            for (int s = -1; s <= 1; s += 2)
+            {
+                const int m = s * abs_m;
+                if (abs_m == 0 && s < 0) continue;
+                const Complex e = nf * std::polar(1.0, m * phi);
+                const Complex qq(-e.real() * dpms, -e.imag() * dpms);
+                const Complex dd(-e.imag() * pds * m, e.real() * pds * m);
+                comp_phi += qq * alpha_tm[ind0 + m] - dd * alpha_te[ind0 + m];
+                comp_theta += dd * alpha_tm[ind0 + m] + qq * alpha_te[ind0 + m];
+            }
+        }
+    }
+    *e_theta = comp_theta;
+    *e_phi = comp_phi;
+}
+
+static double rand_uniform(double min_val, double max_val)
+{
+    return min_val + (max_val - min_val) * rand() / (double)RAND_MAX;
+}
+
+static void run_test(int prec, int l_max, int num_points, double tol)
+{
+    int status = 0;
+    const int num_coeffs = (2 * l_max + 1) * l_max, stride = 4, offset = 2;
+    oskar_Mem *te, *tm, *theta, *phi, *pattern;
+    te = oskar_mem_create(OSKAR_DOUBLE_COMPLEX, OSKAR_CPU, num_coeffs, &status);
+    tm = oskar_mem_create(OSKAR_DOUBLE_COMPLEX, OSKAR_CPU, num_coeffs, &status);
+    theta = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_points, &status);
+    phi = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_points, &status);
+    Complex* te_ = (Complex*) oskar_mem_void(te);
+    Complex* tm_ = (Complex*) oskar_mem_void(tm);
+    double* theta_ = oskar_mem_double(theta, &status);
+    double* phi_ = oskar_mem_double(phi, &status);
+    for (int i = 0; i < num_coeffs; ++i)
+    {
+        te_[i] = Complex(rand_uniform(-1, 1), rand_uniform(-1, 1));
+        tm_[i] = Complex(rand_uniform(-1, 1), rand_uniform(-1, 1));
+    }
+    for (int i = 0; i < num_points; ++i)
+    {
+        theta_[i] = rand_uniform(0.0, M_PI / 2);
+        phi_[i] = rand_uniform(0.0, 2 * M_PI);
+    }
+    theta_[0] = 0.0; /* Zenith. */
+    phi_[1] = NAN;
+
+    /* Evaluate the sum in the requested precision. */
+    oskar_Mem *te_p, *tm_p, *theta_p, *phi_p, *pattern_d;
+    te_p = oskar_mem_convert_precision(te, prec, &status);
+    tm_p = oskar_mem_convert_precision(tm, prec, &status);
+    theta_p = oskar_mem_convert_precision(theta, prec, &status);
+    phi_p = oskar_mem_convert_precision(phi, prec, &status);
+    pattern = oskar_mem_create(prec | OSKAR_COMPLEX | OSKAR_MATRIX, OSKAR_CPU,
+            num_points, &status);
+    oskar_Timer* tmr = oskar_timer_create(OSKAR_CPU);
+    oskar_timer_start(tmr);
+    oskar_evaluate_spherical_wave_sum(num_points, theta_p, phi_p, l_max,
+            te_p, tm_p, stride, offset, pattern, &status);
+    printf("Spherical wave sum (%s, l_max = %d, %d points): %.3f sec\n",
+            prec == OSKAR_DOUBLE ? "double" : "single", l_max, num_points,
+            oskar_timer_elapsed(tmr));
+    oskar_timer_free(tmr);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    /* Compare with the reference, evaluated at the same coordinates. */
+    pattern_d = oskar_mem_convert_precision(pattern, OSKAR_DOUBLE, &status);
+    oskar_Mem* theta_d = oskar_mem_convert_precision(theta_p, OSKAR_DOUBLE,
+            &status);
+    oskar_Mem* phi_d = oskar_mem_convert_precision(phi_p, OSKAR_DOUBLE,
+            &status);
+    theta_ = oskar_mem_double(theta_d, &status);
+    phi_ = oskar_mem_double(phi_d, &status);
+    const Complex* out = (const Complex*) oskar_mem_void_const(pattern_d);
+    double max_err = 0.0, max_val = 0.0, zenith_err = 0.0;
+    for (int i = 0; i < num_points; ++i)
+    {
+        Complex e_theta, e_phi;
+        const Complex* t = &out[i * stride + offset];
+        if (i == 1)
+        {
+            EXPECT_TRUE(std::isnan(t[0].real()));
+            EXPECT_TRUE(std::isnan(t[1].imag()));
+            continue;
+        }
+
+        /* The pattern is set to zero at the zenith, as in the reference
+         * and the device kernels. */
+        spherical_wave_ref(theta_[i], phi_[i], l_max,
+                te_, tm_, &e_theta, &e_phi);
+        const double err = std::max(std::abs(t[0] - e_theta),
+                std::abs(t[1] - e_phi));
+        if (i == 0)
+            zenith_err = err;
+        else
+            max_err = std::max(max_err, err);
+        max_val = std::max(max_val, std::abs(e_theta));
+        max_val = std::max(max_val, std::abs(e_phi));
+    }
+    EXPECT_LT(max_err, tol * max_val) << "l_max = " << l_max;
+    EXPECT_EQ(0.0, zenith_err) << "l_max = " << l_max;
+
+    /* Clean up. */
+    oskar_mem_free(te, &status);
+    oskar_mem_free(tm, &status);
+    oskar_mem_free(theta, &status);
+    oskar_mem_free(phi, &status);
+    oskar_mem_free(te_p, &status);
+    oskar_mem_free(tm_p, &status);
+    oskar_mem_free(theta_p, &status);
+    oskar_mem_free(phi_p, &status);
+    oskar_mem_free(pattern, &status);
+    oskar_mem_free(pattern_d, &status);
+    oskar_mem_free(theta_d, &status);
+    oskar_mem_free(phi_d, &status);
+}
+
+TEST(evaluate_spherical_wave_sum, compare_direct)
+{
+    const int l_max[] = {1, 2, 5, 12, 30};
+    for (size_t i = 0; i < sizeof(l_max) / sizeof(int); ++i)
+    {
+        run_test(OSKAR_DOUBLE, l_max[i], 1001, 1e-11);
+        run_test(OSKAR_SINGLE, l_max[i], 1001, 1e-4);
+    }
+}
+
+TEST(evaluate_spherical_wave_sum, compare_device)
+{
+    int location = 0, status = 0;
+    const int l_max = 12, num_points = 1001, stride = 4, offset = 2;
+    const int num_coeffs = (2 * l_max + 1) * l_max;
+    if (oskar_device_count(0, &location) == 0)
+    {
+        printf("No compute device found: skipping device comparison.\n");
+        return;
+    }
+    oskar_device_set(location, 0, &status);
+    const int prec[] = {OSKAR_SINGLE, OSKAR_DOUBLE};
+    for (int j = 0; j < 2; ++j)
+    {
+        const int type = prec[j] | OSKAR_COMPLEX | OSKAR_MATRIX;
+        oskar_Mem *te, *tm, *theta, *phi, *pattern;
+        te = oskar_mem_create(prec[j] | OSKAR_COMPLEX, OSKAR_CPU,
+                num_coeffs, &status);
+        tm = oskar_mem_create(prec[j] | OSKAR_COMPLEX, OSKAR_CPU,
+                num_coeffs, &status);
+        theta = oskar_mem_create(prec[j], OSKAR_CPU, num_points, &status);
+        phi = oskar_mem_create(prec[j], OSKAR_CPU, num_points, &status);
+        oskar_mem_random_range(te, -1.0, 1.0, &status);
+        oskar_mem_random_range(tm, -1.0, 1.0, &status);
+        oskar_mem_random_range(theta, 0.0, M_PI / 2, &status);
+        oskar_mem_random_range(phi, 0.0, 2 * M_PI, &status);
+        oskar_mem_set_value_real(theta, 0.0, 0, 1, &status); /* Zenith. */
+        pattern = oskar_mem_create(type, OSKAR_CPU, num_points, &status);
+        oskar_evaluate_spherical_wave_sum(num_points, theta, phi, l_max,
+                te, tm, stride, offset, pattern, &status);
+
+        /* Evaluate on the device and compare. */
+        oskar_Mem *te_d, *tm_d, *theta_d, *phi_d, *pattern_d, *pattern_h;
+        te_d = oskar_mem_create_copy(te, location, &status);
+        tm_d = oskar_mem_create_copy(tm, location, &status);
+        theta_d = oskar_mem_create_copy(theta, location, &status);
+        phi_d = oskar_mem_create_copy(phi, location, &status);
+        pattern_d = oskar_mem_create(type, location, num_points, &status);
+        oskar_evaluate_spherical_wave_sum(num_points, theta_d, phi_d, l_max,
+                te_d, tm_d, stride, offset, pattern_d, &status);
+        pattern_h = oskar_mem_create_copy(pattern_d, OSKAR_CPU, &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        double max_err = 0.0, avg_err = 0.0;
+        oskar_mem_evaluate_relative_error(pattern_h, pattern, 0,
+                &max_err, &avg_err, 0, &status);
+        EXPECT_LT(avg_err, prec[j] == OSKAR_DOUBLE ? 1e-10 : 1e-3);
+
+        oskar_mem_free(te, &status);
+        oskar_mem_free(tm, &status);
+        oskar_mem_free(theta, &status);
+        oskar_mem_free(phi, &status);
+        oskar_mem_free(pattern, &status);
+        oskar_mem_free(te_d, &status);
+        oskar_mem_free(tm_d, &status);
+        oskar_mem_free(theta_d, &status);
+        oskar_mem_free(phi_d, &status);
+        oskar_mem_free(pattern_d, &status);
+        oskar_mem_free(pattern_h, &status);
+    }
+}
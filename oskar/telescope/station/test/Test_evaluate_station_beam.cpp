@@ -29,6 +29,7 @@
 #include <gtest/gtest.h>
 
 #include "telescope/station/oskar_station.h"
+#include "telescope/station/oskar_evaluate_station_beam.h"
 #include "telescope/station/oskar_evaluate_station_beam_aperture_array.h"
 #include "telescope/station/oskar_evaluate_station_beam_gaussian.h"
 #include "telescope/station/oskar_evaluate_beam_horizon_direction.h"
@@ -40,6 +41,7 @@
 #include "utility/oskar_device.h"
 
 #include "math/oskar_cmath.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 
@@ -315,3 +317,92 @@ TEST(evaluate_station_beam, gaussian)
         oskar_mem_free(beam, &error);
     }
 }
+
+
+static oskar_Station* create_dipole_station(double lat_rad, int* status)
+{
+    const int num_elements = 32;
+    oskar_Station* s = oskar_station_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_elements, status);
+    oskar_station_resize_element_types(s, 1, status);
+    oskar_element_set_element_type(oskar_station_element(s, 0), "Dipole",
+            status);
+    oskar_station_set_position(s, 0.1, lat_rad, 0.0);
+    oskar_station_set_phase_centre(s, OSKAR_SPHERICAL_TYPE_EQUATORIAL,
+            0.2, -0.5);
+    oskar_station_set_normalise_final_beam(s, 1);
+    for (int i = 0; i < num_elements; ++i)
+    {
+        double xyz[] = {0., 0., 0.};
+        xyz[0] = 20.0 * (2.0 * rand() / (double)RAND_MAX - 1.0);
+        xyz[1] = 20.0 * (2.0 * rand() / (double)RAND_MAX - 1.0);
+        oskar_station_set_element_coords(s, i, xyz, xyz, status);
+    }
+    return s;
+}
+
+
+TEST(evaluate_station_beam, reuse_element_pattern)
+{
+    int status = 0;
+    const int size = 20, num_points = size * size;
+    srand(4);
+
+    // Check both coordinate types. Only relative directions need the
+    // stations at the same position to share the direction conversion.
+    for (int coord_type = 0; coord_type < 2; ++coord_type)
+    {
+        const int relative = (coord_type == OSKAR_RELATIVE_DIRECTIONS);
+        oskar_Station* a = create_dipole_station(-0.5, &status);
+        oskar_Station* b = create_dipole_station(relative ? -0.5 : -0.4,
+                &status);
+        oskar_Mem *x, *y, *z, *beam[2];
+        x = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_points + 1, &status);
+        y = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_points + 1, &status);
+        z = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, num_points + 1, &status);
+        double *x_ = oskar_mem_double(x, &status);
+        double *y_ = oskar_mem_double(y, &status);
+        double *z_ = oskar_mem_double(z, &status);
+        for (int i = 0; i < num_points; ++i)
+        {
+            x_[i] = 0.8 * ((i % size) / (double)(size - 1) - 0.5);
+            y_[i] = 0.8 * ((i / size) / (double)(size - 1) - 0.5);
+            z_[i] = sqrt(1.0 - x_[i] * x_[i] - y_[i] * y_[i]);
+        }
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        // Evaluate the beam of station b after station a,
+        // without and with reusing the element pattern of station a.
+        for (int reuse = 0; reuse < 2; ++reuse)
+        {
+            oskar_StationWork* work = oskar_station_work_create(
+                    OSKAR_DOUBLE, OSKAR_CPU, &status);
+            beam[reuse] = oskar_mem_create(OSKAR_DOUBLE_COMPLEX_MATRIX,
+                    OSKAR_CPU, 2 * num_points, &status);
+            oskar_evaluate_station_beam(num_points, coord_type, x, y, z,
+                    0.2, -0.5, a, work, 0, 100e6, 1.0, 0, beam[reuse],
+                    &status);
+            oskar_station_work_set_reuse_element_pattern(work, reuse);
+            oskar_evaluate_station_beam(num_points, coord_type, x, y, z,
+                    0.2, -0.5, b, work, 0, 100e6, 1.0, num_points,
+                    beam[reuse], &status);
+            oskar_station_work_free(work, &status);
+        }
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+        // Check the beams are the same.
+        double max_diff = 0.0;
+        const double *p = oskar_mem_double_const(beam[0], &status);
+        const double *q = oskar_mem_double_const(beam[1], &status);
+        for (int i = 0; i < 16 * num_points; ++i)
+            max_diff = std::max(max_diff, fabs(p[i] - q[i]));
+        EXPECT_LT(max_diff, 1e-12) << "Coordinate type " << coord_type;
+        oskar_mem_free(beam[0], &status);
+        oskar_mem_free(beam[1], &status);
+        oskar_mem_free(x, &status);
+        oskar_mem_free(y, &status);
+        oskar_mem_free(z, &status);
+        oskar_station_free(a, &status);
+        oskar_station_free(b, &status);
+    }
+}
@@ -0,0 +1,124 @@
+/* Copyright (c) 2019, The University of Oxford. See LICENSE file. */
+
+#include <gtest/gtest.h>
+
+#include "math/oskar_cmath.h"
+#include "mem/oskar_mem.h"
+#include "telescope/oskar_telescope.h"
+#include "utility/oskar_dir.h"
+#include "utility/oskar_file_exists.h"
+#include "utility/oskar_get_error_string.h"
+
+#include <cstdio>
+#include <string>
+
+static void check_same(const oskar_Telescope* a, const oskar_Telescope* b)
+{
+    int status = 0;
+    ASSERT_EQ(oskar_telescope_num_stations(a),
+            oskar_telescope_num_stations(b));
+    EXPECT_EQ(oskar_telescope_lon_rad(a), oskar_telescope_lon_rad(b));
+    EXPECT_EQ(oskar_telescope_lat_rad(a), oskar_telescope_lat_rad(b));
+    EXPECT_EQ(oskar_telescope_alt_metres(a), oskar_telescope_alt_metres(b));
+    EXPECT_FALSE(oskar_mem_different(
+            oskar_telescope_station_true_x_offset_ecef_metres_const(a),
+            oskar_telescope_station_true_x_offset_ecef_metres_const(b),
+            0, &status));
+    EXPECT_FALSE(oskar_mem_different(
+            oskar_telescope_station_measured_z_enu_metres_const(a),
+            oskar_telescope_station_measured_z_enu_metres_const(b),
+            0, &status));
+    for (int i = 0; i < oskar_telescope_num_stations(a); ++i)
+    {
+        const oskar_Station* s1 = oskar_telescope_station_const(a, i);
+        const oskar_Station* s2 = oskar_telescope_station_const(b, i);
+        EXPECT_EQ(oskar_station_unique_id(s1), oskar_station_unique_id(s2));
+        EXPECT_FALSE(oskar_station_different(s1, s2, &status))
+                << "Station " << i << " differs";
+    }
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+}
+
+TEST(telescope_snapshot, load_cached)
+{
+    int status = 0;
+    const char* tm = "temp_test_telescope_snapshot";
+    const char* snapshot = "temp_test_telescope_snapshot.bin";
+    const int num_stations = 3, num_tiles = 4, num_elements = 8;
+
+    // Create and save a two-level telescope model.
+    oskar_Telescope* tel = oskar_telescope_create(OSKAR_DOUBLE,
+            OSKAR_CPU, num_stations, &status);
+    oskar_telescope_set_position(tel, 0.1, 0.5, 1.0);
+    for (int i = 0; i < num_stations; ++i)
+    {
+        double xyz[] = {1.0 * i, 2.0 * i, 3.0 * i};
+        oskar_Station* st = oskar_telescope_station(tel, i);
+        oskar_telescope_set_station_coords(tel, i, xyz, xyz, xyz, xyz,
+                &status);
+        oskar_station_resize(st, num_tiles, &status);
+        oskar_station_create_child_stations(st, &status);
+        for (int j = 0; j < num_tiles; ++j)
+        {
+            oskar_Station* tile = oskar_station_child(st, j);
+            xyz[0] = 10.0 * i + j; xyz[1] = 20.0 * i + j; xyz[2] = 0.0;
+            oskar_station_set_element_coords(st, j, xyz, xyz, &status);
+            oskar_station_resize(tile, num_elements, &status);
+            for (int k = 0; k < num_elements; ++k)
+            {
+                xyz[0] = 0.1 * k + i; xyz[1] = 0.2 * k + j;
+                oskar_station_set_element_coords(tile, k, xyz, xyz, &status);
+                oskar_station_set_element_errors(tile, k,
+                        1.0 + 0.01 * k, 0.1, 0.02 * j, 0.2, &status);
+            }
+        }
+    }
+    oskar_telescope_save(tel, tm, &status);
+    oskar_telescope_free(tel, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    remove(snapshot);
+
+    // Load the directory directly, then via the snapshot twice:
+    // the first writes the snapshot, and the second reads it.
+    oskar_Telescope* ref = oskar_telescope_create(OSKAR_DOUBLE,
+            OSKAR_CPU, 0, &status);
+    oskar_telescope_load(ref, tm, 0, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    for (int i = 0; i < 2; ++i)
+    {
+        oskar_Telescope* t = oskar_telescope_create(OSKAR_DOUBLE,
+                OSKAR_CPU, 0, &status);
+        const int used = oskar_telescope_load_cached(t, tm, snapshot, 0,
+                &status);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        EXPECT_EQ(i, used);
+        EXPECT_TRUE(oskar_file_exists(snapshot));
+        check_same(ref, t);
+        oskar_telescope_free(t, &status);
+    }
+
+    // Change a file, and check that the snapshot is not used.
+    FILE* f = fopen((std::string(tm) + "/position.txt").c_str(), "w");
+    ASSERT_TRUE(f != 0);
+    fprintf(f, "10.0, 20.0, 0.0\n");
+    fclose(f);
+    oskar_Telescope* t = oskar_telescope_create(OSKAR_DOUBLE,
+            OSKAR_CPU, 0, &status);
+    EXPECT_EQ(0, oskar_telescope_load_cached(t, tm, snapshot, 0, &status));
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    EXPECT_NEAR(10.0 * M_PI / 180.0, oskar_telescope_lon_rad(t), 1e-12);
+    oskar_telescope_free(t, &status);
+
+    // Check that a snapshot made with different settings is not used.
+    t = oskar_telescope_create(OSKAR_SINGLE, OSKAR_CPU, 0, &status);
+    EXPECT_EQ(0, oskar_telescope_load_cached(t, tm, snapshot, 0, &status));
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+    EXPECT_EQ(OSKAR_SINGLE, oskar_mem_precision(
+            oskar_telescope_station_true_x_enu_metres_const(t)));
+    oskar_telescope_free(t, &status);
+
+    // Clean up.
+    oskar_telescope_free(ref, &status);
+    oskar_dir_remove(tm);
+    remove(snapshot);
+}
@@ -163,6 +163,57 @@ void oskar_barrier_set_num_threads(oskar_Barrier* barrier, int num_threads);
 OSKAR_EXPORT
 int oskar_barrier_wait(oskar_Barrier* barrier);
 
+/**
+ * @brief Atomically adds a value to an integer.
+ *
+ * @details
+ * Atomically adds \p increment to the integer at \p value,
+ * and returns the value it held previously.
+ *
+ * @param[in,out] value     Pointer to integer to update.
+ * @param[in]     increment Value to add.
+ */
+OSKAR_EXPORT
+int oskar_atomic_fetch_add(volatile int* value, int increment);
+
+/**
+ * @brief Atomically compares and swaps an integer.
+ *
+ * @details
+ * If the integer at \p value is equal to \p expected, it is replaced
+ * by \p desired. The value it held previously is returned in any case.
+ *
+ * @param[in,out] value    Pointer to integer to update.
+ * @param[in]     expected Value to compare against.
+ * @param[in]     desired  Value to store if the comparison succeeds.
+ */
+OSKAR_EXPORT
+int oskar_atomic_compare_and_swap(volatile int* value, int expected,
+        int desired);
+
+/**
+ * @brief Atomically loads an integer.
+ *
+ * @details
+ * Atomically loads the integer at \p value, with a full memory barrier.
+ *
+ * @param[in] value Pointer to integer to load.
+ */
+OSKAR_EXPORT
+int oskar_atomic_load(volatile int* value);
+
+/**
+ * @brief Atomically stores an integer.
+ *
+ * @details
+ * Atomically stores \p new_value at \p value, with a full memory barrier.
+ *
+ * @param[in,out] value     Pointer to integer to update.
+ * @param[in]     new_value Value to store.
+ */
+OSKAR_EXPORT
+void oskar_atomic_store(volatile int* value, int new_value);
+
 #ifdef __cplusplus
 }
 #endif
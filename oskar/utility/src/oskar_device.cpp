@@ -592,12 +592,13 @@ static void oskar_device_set_up_cl(oskar_Device* device)
     //printf("%s\n", src.c_str());
 
     // Use cached program binary if available.
-    int program_binary_size = 0, used_binary = 0;
+    int program_binary_size = 0;
     unsigned char* program_binary = oskar_device_binary_load_cl(device,
             &program_binary_size);
 
 #ifdef OSKAR_HAVE_OPENCL
     // Create OpenCL context and program.
+    int used_binary = 0;
     cl_int error = CL_SUCCESS;
     const char* func = 0;
     cl_context_properties props[] =
@@ -684,10 +685,10 @@ static void oskar_device_set_up_cl(oskar_Device* device)
         if (error != CL_SUCCESS) func = "clCreateCommandQueue";
     }
     if (error || func) oskar_log_error("%s error (%d).", func, error);
-#endif
-    free(program_binary);
 
     // Save program binary to file if it was built from source.
     if (!used_binary && !error)
         oskar_device_binary_save_cl(device);
+#endif
+    free(program_binary);
 }
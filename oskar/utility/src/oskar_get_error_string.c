@@ -113,6 +113,8 @@ const char* oskar_get_error_string(int error)
     case OSKAR_ERR_BINARY_TAG_TOO_LONG:    return "binary tag name too long";
     case OSKAR_ERR_BINARY_TAG_OUT_OF_RANGE:return "binary tag out of range";
     case OSKAR_ERR_BINARY_CRC_FAIL:        return "CRC code mismatch";
+    case OSKAR_ERR_BINARY_MEMORY_ALLOC_FAILURE:
+        return "memory allocation failure reading binary file";
 
     /* OSKAR settings errors. */
     case OSKAR_ERR_SETTINGS_NO_VALUE:
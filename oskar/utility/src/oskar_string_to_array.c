@@ -64,13 +64,15 @@ size_t oskar_string_to_array_i(char* str, size_t n, int* data)
 size_t oskar_string_to_array_f(char* str, size_t n, float* data)
 {
     size_t i = 0;
-    char *save_ptr = 0, *token = 0;
+    float val;
+    char *save_ptr = 0, *token = 0, *end = 0;
     do
     {
         token = strtok_r(str, DELIMITERS, &save_ptr);
         str = NULL;
         if (!token || token[0] == '#') break;
-        if (sscanf(token, "%f", &data[i]) > 0) i++;
+        val = strtof(token, &end);
+        if (end != token) data[i++] = val;
     }
     while (i < n);
     return i;
@@ -80,13 +82,15 @@ size_t oskar_string_to_array_f(char* str, size_t n, float* data)
 size_t oskar_string_to_array_d(char* str, size_t n, double* data)
 {
     size_t i = 0;
-    char *save_ptr = 0, *token = 0;
+    double val;
+    char *save_ptr = 0, *token = 0, *end = 0;
     do
     {
         token = strtok_r(str, DELIMITERS, &save_ptr);
         str = NULL;
         if (!token || token[0] == '#') break;
-        if (sscanf(token, "%lf", &data[i]) > 0) i++;
+        val = strtod(token, &end);
+        if (end != token) data[i++] = val;
     }
     while (i < n);
     return i;
@@ -115,10 +119,12 @@ size_t oskar_string_to_array_realloc_d(char* str, size_t* n, double** data)
     for (;;)
     {
         double val;
+        char* end = 0;
         token = strtok_r(str, DELIMITERS, &save_ptr);
         str = NULL;
         if (!token || token[0] == '#') break;
-        if (sscanf(token, "%lf", &val) > 0)
+        val = strtod(token, &end);
+        if (end != token)
         {
             i++;
             if (*n < i || !(*data))
@@ -302,6 +302,52 @@ int oskar_barrier_wait(oskar_Barrier* barrier)
     return 0;
 }
 
+
+/* =========================================================================
+ *  ATOMICS
+ * =========================================================================*/
+
+int oskar_atomic_fetch_add(volatile int* value, int increment)
+{
+#ifdef OSKAR_OS_WIN
+    return (int) InterlockedExchangeAdd((volatile LONG*) value,
+            (LONG) increment);
+#else
+    return __atomic_fetch_add(value, increment, __ATOMIC_SEQ_CST);
+#endif
+}
+
+int oskar_atomic_compare_and_swap(volatile int* value, int expected,
+        int desired)
+{
+#ifdef OSKAR_OS_WIN
+    return (int) InterlockedCompareExchange((volatile LONG*) value,
+            (LONG) desired, (LONG) expected);
+#else
+    __atomic_compare_exchange_n(value, &expected, desired, 0,
+            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+#endif
+}
+
+int oskar_atomic_load(volatile int* value)
+{
+#ifdef OSKAR_OS_WIN
+    return (int) InterlockedCompareExchange((volatile LONG*) value, 0, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void oskar_atomic_store(volatile int* value, int new_value)
+{
+#ifdef OSKAR_OS_WIN
+    InterlockedExchange((volatile LONG*) value, (LONG) new_value);
+#else
+    __atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -124,3 +124,49 @@ TEST(thread, barriers)
     free(args);
     free(threads);
 }
+
+struct AtomicArgs
+{
+    volatile int* counter;
+    int num_increments;
+};
+typedef struct AtomicArgs AtomicArgs;
+
+void* thread_atomic_add(void* arg)
+{
+    AtomicArgs* args = (AtomicArgs*) arg;
+    for (int i = 0; i < args->num_increments; ++i)
+        oskar_atomic_fetch_add(args->counter, 1);
+    return 0;
+}
+
+TEST(thread, atomics)
+{
+    // Check single-threaded behaviour.
+    volatile int value = 5;
+    EXPECT_EQ(5, oskar_atomic_fetch_add(&value, 2));
+    EXPECT_EQ(7, oskar_atomic_load(&value));
+    EXPECT_EQ(7, oskar_atomic_compare_and_swap(&value, 6, 10));
+    EXPECT_EQ(7, oskar_atomic_load(&value));
+    EXPECT_EQ(7, oskar_atomic_compare_and_swap(&value, 7, 10));
+    EXPECT_EQ(10, oskar_atomic_load(&value));
+    oskar_atomic_store(&value, 0);
+    EXPECT_EQ(0, oskar_atomic_load(&value));
+
+    // Increment a shared counter from many threads.
+    const int num_threads = 8, num_increments = 100000;
+    AtomicArgs args;
+    args.counter = &value;
+    args.num_increments = num_increments;
+    oskar_Thread** threads = (oskar_Thread**)
+            calloc((size_t) num_threads, sizeof(oskar_Thread*));
+    for (int i = 0; i < num_threads; ++i)
+        threads[i] = oskar_thread_create(thread_atomic_add, (void*)&args, 0);
+    for (int i = 0; i < num_threads; ++i)
+    {
+        oskar_thread_join(threads[i]);
+        oskar_thread_free(threads[i]);
+    }
+    free(threads);
+    EXPECT_EQ(num_threads * num_increments, oskar_atomic_load(&value));
+}
@@ -44,10 +44,16 @@ extern "C" {
 /**
  * @brief Add a random Gaussian noise component to the visibilities.
  *
+ * @details
+ * Noise is added in parallel. The random numbers depend only on the seed,
+ * block, time, baseline and station indices, so the result does not depend
+ * on the number of threads used.
+ *
  * @param[in,out] vis             Visibility structure to which to add noise.
  * @param[in]     telescope       Telescope model in use.
  * @param[in]     block_index     Simulation time index for the block.
- * @param[in,out] station_work    Work buffer of length num_stations.
+ * @param[in,out] station_work    Work buffer, resized to
+ *                                num_stations * num_channels.
  * @param[in,out] status          Status return code.
  */
 OSKAR_EXPORT
@@ -172,7 +172,7 @@ oskar_Vis* oskar_vis_read_new(oskar_Binary* h, int* status)
     oskar_Mem* amp = 0;
     const oskar_Mem* xcorr = 0;
     int amp_type, max_times_per_block, num_channels, num_stations, num_times;
-    int i, num_blocks;
+    int i, max_channels_per_block, num_blocks;
     double freq_ref_hz, freq_inc_hz, time_ref_mjd_utc, time_inc_sec;
 
     /* Try to read the new header. */
@@ -234,38 +234,48 @@ oskar_Vis* oskar_vis_read_new(oskar_Binary* h, int* status)
     amp = oskar_vis_amplitude(vis);
     xcorr = oskar_vis_block_cross_correlations_const(blk);
 
-    /* Work out the number of blocks. */
-    num_blocks = (num_times + max_times_per_block - 1) / max_times_per_block;
+    /* Work out the number of blocks. Blocks are written in time order,
+     * and may each hold only a subset of the channels. */
+    max_channels_per_block = oskar_vis_header_max_channels_per_block(hdr);
+    num_blocks = ((num_times + max_times_per_block - 1) / max_times_per_block)
+            * ((num_channels + max_channels_per_block - 1) /
+                    max_channels_per_block);
     for (i = 0; i < num_blocks; ++i)
     {
-        int block_length, num_baselines, time_offset, total_baselines, t, c;
+        int block_channels, block_times, num_baselines, t, c;
+        int start_channel, start_time;
 
         /* Read the block. */
         oskar_vis_block_read(blk, hdr, h, i, status);
+        if (*status) break;
         num_baselines = oskar_vis_block_num_baselines(blk);
-        block_length = oskar_vis_block_num_times(blk);
+        block_channels = oskar_vis_block_num_channels(blk);
+        block_times = oskar_vis_block_num_times(blk);
+        start_channel = oskar_vis_block_start_channel_index(blk);
+        start_time = oskar_vis_block_start_time_index(blk);
 
         /* Copy the baseline coordinate data. */
-        time_offset = i * max_times_per_block * num_baselines;
-        total_baselines = num_baselines * block_length;
         oskar_mem_copy_contents(oskar_vis_baseline_uu_metres(vis),
                 oskar_vis_block_baseline_uu_metres_const(blk),
-                time_offset, 0, total_baselines, status);
+                start_time * num_baselines, 0,
+                block_times * num_baselines, status);
         oskar_mem_copy_contents(oskar_vis_baseline_vv_metres(vis),
                 oskar_vis_block_baseline_vv_metres_const(blk),
-                time_offset, 0, total_baselines, status);
+                start_time * num_baselines, 0,
+                block_times * num_baselines, status);
         oskar_mem_copy_contents(oskar_vis_baseline_ww_metres(vis),
                 oskar_vis_block_baseline_ww_metres_const(blk),
-                time_offset, 0, total_baselines, status);
+                start_time * num_baselines, 0,
+                block_times * num_baselines, status);
 
         /* Fill the array in the old dimension order. */
-        for (t = 0; t < block_length; ++t)
+        for (t = 0; t < block_times; ++t)
         {
-            for (c = 0; c < num_channels; ++c)
+            for (c = 0; c < block_channels; ++c)
             {
                 oskar_mem_copy_contents(amp, xcorr, num_baselines *
-                        (c * num_times + i * max_times_per_block + t),
-                        num_baselines * (t * num_channels + c),
+                        ((start_channel + c) * num_times + start_time + t),
+                        num_baselines * (t * block_channels + c),
                         num_baselines, status);
             }
         }
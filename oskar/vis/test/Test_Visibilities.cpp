@@ -28,13 +28,18 @@
 
 #include <gtest/gtest.h>
 
+#include "vis/oskar_vis.h"
 #include "vis/oskar_vis_header.h"
 #include "vis/oskar_vis_block.h"
+#include "vis/oskar_vis_block_add_system_noise.h"
+#include "math/oskar_random_gaussian.h"
+#include "telescope/oskar_telescope.h"
 #include "utility/oskar_get_error_string.h"
 
 #include <cstring>
 #include <cstdio>
 #include <cmath>
+#include <algorithm>
 
 TEST(Visibilities, read_write)
 {
@@ -209,3 +214,197 @@ TEST(Visibilities, read_write)
     // Delete temporary file.
     remove(filename);
 }
+
+// Writes a file with blocks that each hold only some of the channels.
+static void write_channel_split(const char* filename, int num_times,
+        int max_times_per_block, int num_channels, int max_channels_per_block,
+        int num_stations, double scale, int* status)
+{
+    const int num_baselines = num_stations * (num_stations - 1) / 2;
+    oskar_VisHeader* hdr = oskar_vis_header_create(OSKAR_DOUBLE_COMPLEX,
+            OSKAR_DOUBLE, max_times_per_block, num_times,
+            max_channels_per_block, num_channels, num_stations, 0, 1, status);
+    oskar_vis_header_set_freq_start_hz(hdr, 100e6);
+    oskar_vis_header_set_freq_inc_hz(hdr, 1e6);
+    oskar_Binary* h = oskar_vis_header_write(hdr, filename, status);
+    oskar_VisBlock* blk = oskar_vis_block_create_from_header(OSKAR_CPU,
+            hdr, status);
+    for (int t0 = 0, i_block = 0; t0 < num_times; t0 += max_times_per_block)
+    {
+        for (int c0 = 0; c0 < num_channels;
+                c0 += max_channels_per_block, ++i_block)
+        {
+            const int nt = std::min(max_times_per_block, num_times - t0);
+            const int nc = std::min(max_channels_per_block, num_channels - c0);
+            oskar_vis_block_set_num_times(blk, nt, status);
+            oskar_vis_block_set_num_channels(blk, nc, status);
+            oskar_vis_block_set_start_time_index(blk, t0);
+            oskar_vis_block_set_start_channel_index(blk, c0);
+            double2* v = oskar_mem_double2(
+                    oskar_vis_block_cross_correlations(blk), status);
+            double* uu = oskar_mem_double(
+                    oskar_vis_block_baseline_uu_metres(blk), status);
+            for (int i = 0, t = 0; t < nt; ++t)
+                for (int c = 0; c < nc; ++c)
+                    for (int b = 0; b < num_baselines; ++b, ++i)
+                    {
+                        v[i].x = scale * (100 * (t0 + t) + 10 * (c0 + c) + b);
+                        v[i].y = -scale * b;
+                    }
+            for (int i = 0, t = 0; t < nt; ++t)
+                for (int b = 0; b < num_baselines; ++b, ++i)
+                    uu[i] = t0 + t + 0.5 * b;
+            oskar_vis_block_write(blk, h, i_block, status);
+        }
+    }
+    oskar_vis_block_free(blk, status);
+    oskar_vis_header_free(hdr, status);
+    oskar_binary_free(h);
+}
+
+TEST(Visibilities, combine_channel_split)
+{
+    int status = 0;
+    const int num_times = 5, num_channels = 7, num_stations = 4;
+    const int num_baselines = num_stations * (num_stations - 1) / 2;
+    const char* filename[] = {"temp_test_vis_split1.dat",
+            "temp_test_vis_split2.dat"};
+
+    // Write two files with different block layouts.
+    write_channel_split(filename[0], num_times, 2, num_channels, 3,
+            num_stations, 1.0, &status);
+    write_channel_split(filename[1], num_times, 3, num_channels, 2,
+            num_stations, 2.0, &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Read both and add them, as oskar_vis_add does for these files.
+    oskar_Vis* vis[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        oskar_Binary* h = oskar_binary_create(filename[i], 'r', &status);
+        vis[i] = oskar_vis_read(h, &status);
+        oskar_binary_free(h);
+        ASSERT_EQ(0, status) << oskar_get_error_string(status);
+        ASSERT_EQ(num_channels, oskar_vis_num_channels(vis[i]));
+        ASSERT_EQ(num_times, oskar_vis_num_times(vis[i]));
+    }
+    oskar_mem_add(oskar_vis_amplitude(vis[0]), oskar_vis_amplitude(vis[0]),
+            oskar_vis_amplitude_const(vis[1]), 0, 0, 0,
+            oskar_mem_length(oskar_vis_amplitude(vis[0])), &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Check the sum, in channel-time-baseline order.
+    const double2* v = oskar_mem_double2_const(
+            oskar_vis_amplitude_const(vis[0]), &status);
+    const double* uu = oskar_mem_double_const(
+            oskar_vis_baseline_uu_metres_const(vis[1]), &status);
+    for (int i = 0, c = 0; c < num_channels; ++c)
+        for (int t = 0; t < num_times; ++t)
+            for (int b = 0; b < num_baselines; ++b, ++i)
+            {
+                ASSERT_DOUBLE_EQ(3.0 * (100 * t + 10 * c + b), v[i].x);
+                ASSERT_DOUBLE_EQ(-3.0 * b, v[i].y);
+            }
+    for (int i = 0, t = 0; t < num_times; ++t)
+        for (int b = 0; b < num_baselines; ++b, ++i)
+            ASSERT_DOUBLE_EQ(t + 0.5 * b, uu[i]);
+
+    // Clean up.
+    for (int i = 0; i < 2; ++i)
+    {
+        oskar_vis_free(vis[i], &status);
+        remove(filename[i]);
+    }
+}
+
+TEST(Visibilities, add_system_noise)
+{
+    int status = 0;
+    const int num_stations = 30, num_times = 3, num_channels = 4;
+    const int num_baselines = num_stations * (num_stations - 1) / 2;
+    const unsigned int seed = 1, block_index = 2;
+    const double bandwidth_hz = 1e5, int_time_sec = 2.0;
+
+    // Create a header, a block and a telescope model with noise values.
+    oskar_VisHeader* hdr = oskar_vis_header_create(OSKAR_DOUBLE_COMPLEX_MATRIX,
+            OSKAR_DOUBLE, num_times, num_times, num_channels, num_channels,
+            num_stations, 1, 1, &status);
+    oskar_vis_header_set_freq_start_hz(hdr, 100e6);
+    oskar_vis_header_set_freq_inc_hz(hdr, 1e6);
+    oskar_vis_header_set_channel_bandwidth_hz(hdr, bandwidth_hz);
+    oskar_vis_header_set_time_average_sec(hdr, int_time_sec);
+    oskar_VisBlock* block = oskar_vis_block_create_from_header(OSKAR_CPU,
+            hdr, &status);
+    oskar_Telescope* tel = oskar_telescope_create(OSKAR_DOUBLE, OSKAR_CPU,
+            num_stations, &status);
+    for (int i = 0; i < num_stations; ++i)
+    {
+        oskar_Station* st = oskar_telescope_station(tel, i);
+        oskar_mem_realloc(oskar_station_noise_freq_hz(st), 2, &status);
+        oskar_mem_realloc(oskar_station_noise_rms_jy(st), 2, &status);
+        for (int j = 0; j < 2; ++j)
+        {
+            oskar_mem_set_element_real(oskar_station_noise_freq_hz(st), j,
+                    100e6 + 2e6 * j, &status);
+            oskar_mem_set_element_real(oskar_station_noise_rms_jy(st), j,
+                    1.0 + 0.1 * i + j, &status);
+        }
+    }
+    oskar_Mem* work = oskar_mem_create(OSKAR_DOUBLE, OSKAR_CPU, 0, &status);
+    oskar_vis_block_add_system_noise(block, hdr, tel, block_index, work,
+            &status);
+    ASSERT_EQ(0, status) << oskar_get_error_string(status);
+
+    // Check against the random numbers generated serially, with a counter
+    // incremented for each baseline then each station, for each time.
+    const double* xc = oskar_mem_double_const(
+            oskar_vis_block_cross_correlations(block), &status);
+    const double* ac = oskar_mem_double_const(
+            oskar_vis_block_auto_correlations(block), &status);
+    const double sefd_factor = sqrt(2.0 * bandwidth_hz * int_time_sec);
+    for (int c = 0; c < num_channels; ++c)
+    {
+        // Closest noise frequency is at index 0 for channels 0 and 1.
+        const int j = (c < 2) ? 0 : 1;
+        unsigned int counter = 0;
+        for (int t = 0; t < num_times; ++t)
+        {
+            for (int a1 = 0, b = 0; a1 < num_stations; ++a1)
+            {
+                for (int a2 = a1 + 1; a2 < num_stations; ++a2, ++b)
+                {
+                    double rnd[8];
+                    oskar_random_gaussian4(seed, counter++, block_index,
+                            0, 0, rnd);
+                    oskar_random_gaussian4(seed, counter++, block_index,
+                            0, 0, rnd + 4);
+                    const double std = sqrt((1.0 + 0.1 * a1 + j) *
+                            (1.0 + 0.1 * a2 + j));
+                    const double* v = &xc[8 * (num_baselines *
+                            (num_channels * t + c) + b)];
+                    for (int k = 0; k < 8; ++k)
+                        ASSERT_EQ(std * rnd[k], v[k]);
+                }
+            }
+            for (int a1 = 0; a1 < num_stations; ++a1)
+            {
+                double rnd[8];
+                oskar_random_gaussian4(seed, counter++, block_index,
+                        0, 0, rnd);
+                oskar_random_gaussian4(seed, counter++, block_index,
+                        0, 0, rnd + 4);
+                const double std = (1.0 + 0.1 * a1 + j) * sqrt(2.0);
+                const double* v = &ac[8 * (num_stations *
+                        (num_channels * t + c) + a1)];
+                ASSERT_EQ(std * rnd[0] + std * sefd_factor, v[0]);
+                ASSERT_EQ(std * rnd[5] + std * sefd_factor, v[6]);
+            }
+        }
+    }
+
+    // Clean up.
+    oskar_mem_free(work, &status);
+    oskar_telescope_free(tel, &status);
+    oskar_vis_block_free(block, &status);
+    oskar_vis_header_free(hdr, &status);
+}